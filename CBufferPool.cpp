@@ -0,0 +1,60 @@
+/*!
+    \file
+    \brief Пул буферов фиксированного размера.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CBufferPool.h"
+#include "esp_heap_caps.h"
+
+CBufferPool::CBufferPool(size_t blockSize, uint16_t count, uint32_t caps) : mBlockSize((blockSize + 3) & ~(size_t)3), mCount(count)
+{
+    mSlab = (uint8_t *)heap_caps_malloc(mBlockSize * count, caps);
+    mFree = (uint16_t *)heap_caps_malloc(sizeof(uint16_t) * count, MALLOC_CAP_DEFAULT);
+    if ((mSlab == nullptr) || (mFree == nullptr))
+    {
+        heap_caps_free(mSlab);
+        heap_caps_free(mFree);
+        mSlab = nullptr;
+        mFree = nullptr;
+        return;
+    }
+    for (uint16_t i = 0; i < count; i++)
+        mFree[i] = count - 1 - i;
+    mTop = count;
+    mMinFree = count;
+}
+
+CBufferPool::~CBufferPool()
+{
+    heap_caps_free(mSlab);
+    heap_caps_free(mFree);
+}
+
+uint8_t *CBufferPool::alloc()
+{
+    uint8_t *res = nullptr;
+    portENTER_CRITICAL(&mMux);
+    if (mTop > 0)
+    {
+        mTop--;
+        res = mSlab + (size_t)mFree[mTop] * mBlockSize;
+        if (mTop < mMinFree)
+            mMinFree = mTop;
+    }
+    portEXIT_CRITICAL(&mMux);
+    return res;
+}
+
+void CBufferPool::free(uint8_t *buf)
+{
+    if ((buf == nullptr) || (mSlab == nullptr))
+        return;
+    uint16_t index = (uint16_t)((buf - mSlab) / mBlockSize);
+    portENTER_CRITICAL(&mMux);
+    if (mTop < mCount)
+        mFree[mTop++] = index;
+    portEXIT_CRITICAL(&mMux);
+}
@@ -0,0 +1,201 @@
+/*!
+    \file
+    \brief Контекст быстрого подключения в RTC-памяти (пробуждение из deep sleep).
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CFastConnect.h"
+
+#if CONFIG_WIFICHN_FAST_CONNECT
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_rtc_time.h"
+#include "esp_rom_crc.h"
+#include <cstring>
+#include <cstddef>
+
+static const char *TAG = "fastconn";
+
+#define FASTCONN_MAGIC (0x46415354) ///< Признак валидности RTC-контекста.
+
+/// Контекст подключения в RTC-памяти (переживает deep sleep, но не пропадание питания).
+struct SFastConnectRtc
+{
+    uint32_t magic;       ///< FASTCONN_MAGIC, если запись валидна.
+    uint32_t crc;         ///< CRC32 полей после crc.
+    uint8_t ssid[32];     ///< Имя сети.
+    uint8_t password[64]; ///< Пароль.
+    uint8_t bssid[6];     ///< BSSID точки доступа (channel == 0 - не сохранён).
+    uint8_t channel;      ///< Канал точки доступа.
+    uint8_t authmode;     ///< Режим аутентификации (wifi_auth_mode_t).
+    uint32_t ip;          ///< Адрес аренды (0 - аренды нет).
+    uint32_t netmask;     ///< Маска.
+    uint32_t gw;          ///< Шлюз.
+    uint32_t dns;         ///< Основной DNS.
+    uint64_t lease_us;    ///< Показание RTC-часов при получении аренды, мкс.
+};
+
+static RTC_NOINIT_ATTR SFastConnectRtc sRtc;
+
+uint32_t CFastConnect::mPhase[(size_t)EFastPhase::Count] = {};
+bool CFastConnect::mFast = false;
+bool CFastConnect::mStatic = false;
+
+static uint32_t crc()
+{
+    const size_t offset = offsetof(SFastConnectRtc, crc) + sizeof(sRtc.crc);
+    return esp_rom_crc32_le(0, (const uint8_t *)&sRtc + offset, sizeof(sRtc) - offset);
+}
+
+static bool valid()
+{
+    return (sRtc.magic == FASTCONN_MAGIC) && (sRtc.crc == crc());
+}
+
+static void seal()
+{
+    sRtc.crc = crc();
+    sRtc.magic = FASTCONN_MAGIC;
+}
+
+/// Сетевая часть контекста: точка доступа и аренда.
+static void forgetNetwork()
+{
+    std::memset(sRtc.bssid, 0, sizeof(sRtc.bssid));
+    sRtc.channel = 0;
+    sRtc.authmode = 0;
+    sRtc.ip = 0;
+    sRtc.lease_us = 0;
+}
+
+static bool leaseFresh()
+{
+    uint64_t rtc = esp_rtc_get_time_us();
+    return (sRtc.ip != 0) && (rtc >= sRtc.lease_us) &&
+           (rtc - sRtc.lease_us < (uint64_t)CONFIG_WIFICHN_FAST_LEASE_S * 1000000ULL);
+}
+
+bool CFastConnect::loadConfig(wifi_config_t &cfg)
+{
+    if (!valid())
+        return false;
+    std::memcpy(cfg.sta.ssid, sRtc.ssid, sizeof(cfg.sta.ssid));
+    std::memcpy(cfg.sta.password, sRtc.password, sizeof(cfg.sta.password));
+    return true;
+}
+
+bool CFastConnect::prepare(wifi_config_t &cfg)
+{
+    mFast = false;
+    mStatic = false;
+    if (!valid() || (std::memcmp(sRtc.ssid, cfg.sta.ssid, sizeof(sRtc.ssid)) != 0) ||
+        (std::memcmp(sRtc.password, cfg.sta.password, sizeof(sRtc.password)) != 0))
+    {
+        std::memcpy(sRtc.ssid, cfg.sta.ssid, sizeof(sRtc.ssid));
+        std::memcpy(sRtc.password, cfg.sta.password, sizeof(sRtc.password));
+        forgetNetwork();
+        seal();
+    }
+    if (sRtc.channel == 0)
+        return false;
+
+    // С известными BSSID и каналом драйвер проверяет один канал вместо полного сканирования.
+    std::memcpy(cfg.sta.bssid, sRtc.bssid, sizeof(cfg.sta.bssid));
+    cfg.sta.bssid_set = true;
+    cfg.sta.channel = sRtc.channel;
+    cfg.sta.scan_method = WIFI_FAST_SCAN;
+    mFast = true;
+    return true;
+}
+
+void CFastConnect::onConnected(const wifi_event_sta_connected_t *evt, esp_netif_t *netif)
+{
+    if ((sRtc.channel != evt->channel) || (std::memcmp(sRtc.bssid, evt->bssid, sizeof(sRtc.bssid)) != 0))
+    {
+        // Другая точка доступа - прежняя аренда к ней не относится.
+        std::memcpy(sRtc.bssid, evt->bssid, sizeof(sRtc.bssid));
+        sRtc.channel = evt->channel;
+        sRtc.ip = 0;
+        sRtc.lease_us = 0;
+    }
+    sRtc.authmode = (uint8_t)evt->authmode;
+    seal();
+
+    if (!mFast || !leaseFresh())
+        return;
+    esp_netif_ip_info_t ip;
+    ip.ip.addr = sRtc.ip;
+    ip.netmask.addr = sRtc.netmask;
+    ip.gw.addr = sRtc.gw;
+    esp_netif_dhcpc_stop(netif);
+    if (ESP_OK != esp_netif_set_ip_info(netif, &ip))
+    {
+        esp_netif_dhcpc_start(netif);
+        return;
+    }
+    if (sRtc.dns != 0)
+    {
+        esp_netif_dns_info_t dns;
+        std::memset(&dns, 0, sizeof(dns));
+        dns.ip.u_addr.ip4.addr = sRtc.dns;
+        dns.ip.type = ESP_IPADDR_TYPE_V4;
+        esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+    mStatic = true;
+}
+
+void CFastConnect::onGotIp(const esp_netif_ip_info_t &ip, esp_netif_t *netif)
+{
+    if (mStatic)
+        return; // аренда не продлевалась: срок отсчитывается от последнего обмена DHCP
+    esp_netif_dns_info_t dns;
+    sRtc.dns = (ESP_OK == esp_netif_get_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns)) ? dns.ip.u_addr.ip4.addr : 0;
+    sRtc.ip = ip.ip.addr;
+    sRtc.netmask = ip.netmask.addr;
+    sRtc.gw = ip.gw.addr;
+    sRtc.lease_us = esp_rtc_get_time_us();
+    seal();
+}
+
+bool CFastConnect::onFail(wifi_config_t &cfg, esp_netif_t *netif)
+{
+    if (!mFast && !mStatic)
+        return false;
+    ESP_LOGW(TAG, "saved AP context failed, full connect");
+    if (mStatic)
+        esp_netif_dhcpc_start(netif);
+    if (valid())
+    {
+        forgetNetwork();
+        seal();
+    }
+    std::memset(cfg.sta.bssid, 0, sizeof(cfg.sta.bssid));
+    cfg.sta.bssid_set = false;
+    cfg.sta.channel = 0;
+    mFast = false;
+    mStatic = false;
+    return true;
+}
+
+void CFastConnect::invalidate()
+{
+    sRtc.magic = 0;
+    mFast = false;
+    mStatic = false;
+}
+
+void CFastConnect::mark(EFastPhase phase)
+{
+    if (phase == EFastPhase::Start)
+        std::memset(mPhase, 0, sizeof(mPhase));
+    mPhase[(size_t)phase] = (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+uint32_t CFastConnect::phaseMs(EFastPhase phase)
+{
+    return mPhase[(size_t)phase];
+}
+#endif
@@ -0,0 +1,251 @@
+/*!
+    \file
+    \brief Упаковка мелких записей в кадры размером до MTU и разбор кадров без копирования.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CFrameCoalescer.h"
+
+#if CONFIG_WIFICHN_FRAMING
+#include <cstring>
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+/// Байт varint для длины.
+static inline size_t varint_size(size_t v)
+{
+    return (v < 0x80) ? 1 : ((v < 0x4000) ? 2 : 3);
+}
+
+static inline size_t put_varint(uint8_t *p, size_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80)
+    {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+/// Прочитать varint не дальше end (длина записи в кадре не больше 3 байт).
+static inline bool get_varint(const uint8_t *&p, const uint8_t *end, size_t &v)
+{
+    v = 0;
+    for (int shift = 0; (shift < 21) && (p < end); shift += 7)
+    {
+        uint8_t b = *p++;
+        v |= (size_t)(b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+CFrameCoalescer::CFrameCoalescer(TFlush flush, size_t mtu, uint32_t deadline, uint32_t caps)
+    : mFlush(flush), mMtu((mtu > FRAME_MAX_SIZE) ? FRAME_MAX_SIZE : mtu), mDeadline(deadline)
+{
+    if (mMtu > FRAME_HEADER_SIZE + 1)
+        mBuf = (uint8_t *)heap_caps_malloc(mMtu, caps);
+}
+
+CFrameCoalescer::~CFrameCoalescer()
+{
+    heap_caps_free(mBuf);
+}
+
+size_t CFrameCoalescer::maxRecord()
+{
+    size_t res = mMtu - FRAME_HEADER_SIZE - 1;
+    while ((res != 0) && (FRAME_HEADER_SIZE + varint_size(res) + res > mMtu))
+        res--;
+    return res;
+}
+
+bool CFrameCoalescer::emit(uint32_t now, uint32_t *counter)
+{
+    if (mCount == 0)
+        return true;
+    put16(mBuf, (uint16_t)(mLen - FRAME_HEADER_SIZE));
+    if (!mFlush(mBuf, mLen))
+        return false;
+
+    uint16_t fill = (uint16_t)(mLen * 1000 / mMtu);
+    if ((mStats.frames == 0) || (fill < mStats.fillMin))
+        mStats.fillMin = fill;
+    mStats.frames++;
+    mStats.wire += mLen;
+    mFillSum += fill;
+    // Ожидание каждой записи - от её добавления до отправки кадра.
+    mLatencySum += (uint64_t)mCount * now - mAddSum;
+    if (now - mFirstAt > mStats.latencyMax)
+        mStats.latencyMax = now - mFirstAt;
+    if (counter != nullptr)
+        (*counter)++;
+
+    mLen = FRAME_HEADER_SIZE;
+    mCount = 0;
+    mAddSum = 0;
+    return true;
+}
+
+bool CFrameCoalescer::add(const uint8_t *data, size_t len, uint32_t now)
+{
+    if ((mBuf == nullptr) || (len > maxRecord()))
+    {
+        mStats.rejected++;
+        return false;
+    }
+    if ((mLen + varint_size(len) + len > mMtu) && !emit(now, &mStats.fullFlushes))
+    {
+        mStats.rejected++; // получатель ещё не принял заполненный кадр
+        return false;
+    }
+    if (mCount == 0)
+        mFirstAt = now;
+    mLen += put_varint(mBuf + mLen, len);
+    if (len != 0)
+        std::memcpy(mBuf + mLen, data, len);
+    mLen += len;
+    mCount++;
+    mAddSum += now;
+    mStats.records++;
+    mStats.bytes += len;
+    if (mDeadline == 0)
+        emit(now, &mStats.deadlineFlushes);
+    return true;
+}
+
+bool CFrameCoalescer::flush(uint32_t now)
+{
+    return emit(now, nullptr);
+}
+
+uint32_t CFrameCoalescer::poll(uint32_t now)
+{
+    if (mCount == 0)
+        return (mDeadline == 0) ? 1 : mDeadline;
+    uint32_t age = now - mFirstAt;
+    if ((age >= mDeadline) && emit(now, &mStats.deadlineFlushes))
+        return (mDeadline == 0) ? 1 : mDeadline;
+    // Получатель занят - повтор через 1 мс.
+    return (age >= mDeadline) ? 1 : mDeadline - age;
+}
+
+SFrameStats CFrameCoalescer::stats()
+{
+    SFrameStats res = mStats;
+    if (res.frames != 0)
+        res.fillAvg = (uint16_t)(mFillSum / res.frames);
+    if (res.records > mCount)
+        res.latencyAvg = (uint32_t)(mLatencySum / (res.records - mCount));
+    return res;
+}
+
+CFrameView::CFrameView(const uint8_t *frame, size_t len)
+{
+    size_t size = frameSize(frame, len);
+    mValid = (size != 0) && (size <= len);
+    mPos = frame + FRAME_HEADER_SIZE;
+    mEnd = mValid ? frame + size : mPos;
+}
+
+size_t CFrameView::frameSize(const uint8_t *data, size_t len)
+{
+    return (len < FRAME_HEADER_SIZE) ? 0 : FRAME_HEADER_SIZE + get16(data);
+}
+
+bool CFrameView::next(SFrameRecord &rec)
+{
+    if (!mValid || (mPos >= mEnd))
+        return false;
+    size_t len;
+    if (!get_varint(mPos, mEnd, len) || (len > (size_t)(mEnd - mPos)))
+    {
+        mValid = false;
+        return false;
+    }
+    rec.data = mPos;
+    rec.len = len;
+    mPos += len;
+    return true;
+}
+
+CFrameSplitter::CFrameSplitter(TFrame onFrame, size_t mtu, uint32_t caps)
+    : mOnFrame(onFrame), mMtu((mtu > FRAME_MAX_SIZE) ? FRAME_MAX_SIZE : mtu)
+{
+    mBuf = (uint8_t *)heap_caps_malloc(mMtu, caps);
+}
+
+CFrameSplitter::~CFrameSplitter()
+{
+    heap_caps_free(mBuf);
+}
+
+void CFrameSplitter::reset()
+{
+    mHave = 0;
+    mBroken = false;
+}
+
+bool CFrameSplitter::broken()
+{
+    // Длина кадра больше MTU: граница кадров потеряна, дальше в потоке мусор.
+    mBroken = true;
+    mHave = 0;
+    return false;
+}
+
+bool CFrameSplitter::feed(const uint8_t *data, size_t len)
+{
+    if (mBroken || (mBuf == nullptr))
+        return false;
+    while (len != 0)
+    {
+        size_t size;
+        if (mHave == 0)
+        {
+            // Кадр целиком в куске - отдаётся на месте.
+            size = CFrameView::frameSize(data, len);
+            if (size > mMtu)
+                return broken();
+            if ((size != 0) && (size <= len))
+            {
+                mOnFrame(data, size);
+                data += size;
+                len -= size;
+                continue;
+            }
+        }
+        // Начало кадра без продолжения - копится до следующего куска.
+        size = CFrameView::frameSize(mBuf, mHave);
+        size_t want = ((size == 0) ? FRAME_HEADER_SIZE : size) - mHave;
+        size_t n = (want < len) ? want : len;
+        std::memcpy(mBuf + mHave, data, n);
+        mHave += n;
+        data += n;
+        len -= n;
+        size = CFrameView::frameSize(mBuf, mHave);
+        if (size > mMtu)
+            return broken();
+        if ((size != 0) && (mHave == size))
+        {
+            mHave = 0;
+            mOnFrame(mBuf, size);
+        }
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,242 @@
+/*!
+    \file
+    \brief Пул постоянных HTTP(S) соединений.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CHttpPool.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "mbedtls/sha256.h"
+#include <cstring>
+
+#if CONFIG_WIFICHN_HTTP_POOL
+static const char *TAG = "http_pool";
+
+CHttpPool::~CHttpPool()
+{
+    for (auto &e : mEntries)
+        close(e);
+}
+
+std::string CHttpPool::origin(const char *url)
+{
+    std::string res(url);
+    size_t host = res.find("://");
+    if (host == std::string::npos)
+        return res;
+    host += 3;
+    size_t end = res.find_first_of("/?#", host);
+    if (end != std::string::npos)
+        res.erase(end);
+    size_t at = res.find('@', host); // user:password@host
+    if (at != std::string::npos)
+        res.erase(host, at + 1 - host);
+    if (res.find(':', host) == std::string::npos)
+        res += (res.compare(0, 5, "https") == 0) ? ":443" : ":80";
+    return res;
+}
+
+/// Дописать значение в ключ настроек.
+template <typename T>
+static void put(std::string &key, const T &value)
+{
+    key.append((const char *)&value, sizeof(value));
+}
+
+/// Дописать строку в ключ настроек (с длиной, nullptr отличается от пустой).
+static void put_str(std::string &key, const char *str)
+{
+    int32_t len = (str == nullptr) ? -1 : (int32_t)strlen(str);
+    put(key, len);
+    if (len > 0)
+        key.append(str, len);
+}
+
+/// Дописать в ключ настроек хэш сертификата или ключа (PEM - len 0, длина по строке).
+static void put_cert(std::string &key, const char *data, size_t len)
+{
+    if (data == nullptr)
+    {
+        put(key, (int32_t)-1);
+        return;
+    }
+    if (len == 0)
+        len = strlen(data);
+    uint8_t hash[32];
+    mbedtls_sha256((const unsigned char *)data, len, hash, 0);
+    key.append((const char *)hash, sizeof(hash));
+}
+
+std::string CHttpPool::settings(const esp_http_client_config_t &cfg)
+{
+    std::string key;
+    put(key, cfg.event_handler);
+    put(key, cfg.method);
+    put(key, cfg.timeout_ms);
+    put(key, cfg.disable_auto_redirect);
+    put(key, cfg.max_redirection_count);
+    put(key, cfg.transport_type);
+    put(key, cfg.buffer_size_tx);
+    put(key, cfg.is_async);
+    put(key, cfg.auth_type);
+    put_str(key, cfg.username);
+    put_str(key, cfg.password);
+    put_str(key, cfg.user_agent);
+    // Проверка сервера: соединение, открытое с другим доверием (пакет CA, без проверки
+    // имени), не проверялось по закреплённому сертификату.
+    put_cert(key, cfg.cert_pem, cfg.cert_len);
+    put_cert(key, cfg.client_cert_pem, cfg.client_cert_len);
+    put_cert(key, cfg.client_key_pem, cfg.client_key_len);
+    put(key, cfg.crt_bundle_attach);
+    put(key, cfg.use_global_ca_store);
+    put(key, cfg.skip_cert_common_name_check);
+    put_str(key, cfg.common_name);
+    return key;
+}
+
+CHttpPool::SEntry *CHttpPool::find(esp_http_client_handle_t client)
+{
+    for (auto &e : mEntries)
+    {
+        if (e.client == client)
+            return &e;
+    }
+    return nullptr;
+}
+
+void CHttpPool::close(SEntry &entry)
+{
+    if (entry.client != nullptr)
+    {
+        esp_http_client_close(entry.client);
+        esp_http_client_cleanup(entry.client);
+    }
+    entry = SEntry();
+}
+
+esp_http_client_handle_t CHttpPool::acquire(const esp_http_client_config_t &cfg)
+{
+    std::string org = origin(cfg.url);
+    std::string key = settings(cfg);
+    int64_t now = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mMutex);
+    SEntry *slot = nullptr;
+    for (auto &e : mEntries)
+    {
+        if (e.busy)
+            continue;
+        // Простаивающее соединение сервер скорее всего уже закрыл.
+        if ((e.client != nullptr) && ((now - e.used) > (int64_t)CONFIG_WIFICHN_HTTP_POOL_IDLE_S * 1000000))
+            close(e);
+        if ((e.client != nullptr) && (e.origin == org) && (e.settings == key) && (e.bufferSize >= cfg.buffer_size) && (ESP_OK == esp_http_client_set_url(e.client, cfg.url)))
+        {
+            esp_http_client_set_user_data(e.client, cfg.user_data);
+            e.busy = true;
+            mHits++;
+            return e.client;
+        }
+        // Новый клиент - в пустой элемент, иначе вместо дольше всех простаивающего.
+        if ((slot == nullptr) || ((slot->client != nullptr) && ((e.client == nullptr) || (e.used < slot->used))))
+            slot = &e;
+    }
+
+    esp_http_client_config_t c = cfg;
+    c.keep_alive_enable = true;
+    esp_http_client_handle_t client = esp_http_client_init(&c);
+    mMisses++;
+    if ((client == nullptr) || (slot == nullptr))
+        return client; // пул занят - клиент вне пула
+    close(*slot);
+    slot->client = client;
+    slot->origin = org;
+    slot->settings = key;
+    slot->bufferSize = cfg.buffer_size;
+    slot->busy = true;
+    return client;
+}
+
+void CHttpPool::release(esp_http_client_handle_t client, bool keep)
+{
+    if (client == nullptr)
+        return;
+    std::lock_guard<std::mutex> lock(mMutex);
+    SEntry *e = find(client);
+    if (e == nullptr)
+    {
+        esp_http_client_close(client);
+        esp_http_client_cleanup(client);
+        return;
+    }
+    // Недочитанный ответ сдвинул бы следующий запрос - такое соединение не сохраняем.
+    if (!keep || e->stale || !esp_http_client_is_complete_data_received(client))
+    {
+        close(*e);
+        return;
+    }
+    for (auto &h : e->headers)
+        esp_http_client_delete_header(client, h.c_str());
+    e->headers.clear();
+    char url[256];
+    if (ESP_OK == esp_http_client_get_url(client, url, sizeof(url)))
+        e->origin = origin(url); // после переадресации соединение открыто с другим сервером
+    esp_http_client_set_user_data(client, nullptr); // владелец user_data может завершиться раньше соединения
+    e->used = esp_timer_get_time();
+    e->busy = false;
+    e->warm = true;
+}
+
+esp_err_t CHttpPool::setHeader(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    esp_err_t err = esp_http_client_set_header(client, key, value);
+    std::lock_guard<std::mutex> lock(mMutex);
+    SEntry *e = find(client);
+    if ((err == ESP_OK) && (e != nullptr))
+        e->headers.emplace_back(key);
+    return err;
+}
+
+bool CHttpPool::isWarm(esp_http_client_handle_t client)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    SEntry *e = find(client);
+    return (e != nullptr) && e->warm;
+}
+
+esp_err_t CHttpPool::open(esp_http_client_handle_t client, int writeLen, int64_t &contentLength)
+{
+    esp_err_t err = esp_http_client_open(client, writeLen);
+    contentLength = (err == ESP_OK) ? esp_http_client_fetch_headers(client) : -1;
+    if ((contentLength < 0) && isWarm(client))
+    {
+        // Сохранённое соединение закрыто сервером - одна попытка с новым соединением.
+        ESP_LOGD(TAG, "stale connection, reconnect");
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            SEntry *e = find(client);
+            if (e != nullptr)
+                e->warm = false;
+        }
+        esp_http_client_close(client);
+        err = esp_http_client_open(client, writeLen);
+        contentLength = (err == ESP_OK) ? esp_http_client_fetch_headers(client) : -1;
+    }
+    if ((err == ESP_OK) && (contentLength < 0))
+        err = ESP_FAIL;
+    return err;
+}
+
+void CHttpPool::flush()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto &e : mEntries)
+    {
+        if (e.busy)
+            e.stale = true;
+        else
+            close(e);
+    }
+}
+#endif
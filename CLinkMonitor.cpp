@@ -0,0 +1,164 @@
+/*!
+    \file
+    \brief Монитор качества канала WiFi: RSSI, режим PHY, потери маяков, причины отключений.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CLinkMonitor.h"
+
+#if CONFIG_WIFICHN_LINK_MONITOR
+/// Ступень канальной скорости: наибольшая скорость, устойчивая при RSSI не ниже порога.
+struct SRateStep
+{
+    int8_t rssi;   ///< Порог RSSI, дБм.
+    uint32_t kbps; ///< Скорость, кбит/с.
+};
+
+// Пороги - чувствительность приёмника ESP32 плюс ~8 дБ запаса на замирания.
+static const SRateStep RATES_11B[] = {{-80, 11000}, {-84, 5500}, {-87, 2000}, {-90, 1000}};
+static const SRateStep RATES_11G[] = {{-67, 54000}, {-69, 48000}, {-73, 36000}, {-76, 24000}, {-79, 18000}, {-82, 12000}, {-83, 9000}, {-85, 6000}};
+static const SRateStep RATES_HT20[] = {{-65, 65000}, {-68, 58500}, {-70, 52000}, {-74, 39000}, {-77, 26000}, {-80, 19500}, {-82, 13000}, {-85, 6500}};
+static const SRateStep RATES_HE20[] = {{-60, 114700}, {-62, 103200}, {-65, 86000}, {-68, 77400}, {-70, 68800}, {-74, 51600}, {-77, 34400}, {-80, 25800}, {-82, 17200}, {-85, 8600}};
+static const SRateStep RATES_LR[] = {{-90, 500}, {-98, 250}};
+
+template <size_t N>
+static uint32_t lookup(const SRateStep (&table)[N], int rssi)
+{
+    for (size_t i = 0; i < N; i++)
+    {
+        if (rssi >= table[i].rssi)
+            return table[i].kbps;
+    }
+    return 0;
+}
+
+uint32_t CLinkMonitor::phyRate(uint8_t phy, int8_t rssi)
+{
+    switch ((wifi_phy_mode_t)phy)
+    {
+    case WIFI_PHY_MODE_LR:
+        return lookup(RATES_LR, rssi);
+    case WIFI_PHY_MODE_11B:
+        return lookup(RATES_11B, rssi);
+    case WIFI_PHY_MODE_11G:
+    case WIFI_PHY_MODE_11A:
+        return lookup(RATES_11G, rssi);
+    case WIFI_PHY_MODE_HT40:
+        // Вдвое больше поднесущих, но и шума: порог на 3 дБ выше.
+        return 2 * lookup(RATES_HT20, rssi - 3);
+    case WIFI_PHY_MODE_HE20:
+        return lookup(RATES_HE20, rssi);
+    default:
+        return lookup(RATES_HT20, rssi);
+    }
+}
+
+CLinkMonitor::CLinkMonitor()
+{
+    const esp_timer_create_args_t args = {
+        .callback = timer_cb, .arg = this, .dispatch_method = ESP_TIMER_TASK, .name = "wifi_lmon", .skip_unhandled_events = true};
+    esp_timer_create(&args, &mTimer);
+}
+
+CLinkMonitor::~CLinkMonitor()
+{
+    esp_timer_stop(mTimer);
+    esp_timer_delete(mTimer);
+}
+
+void CLinkMonitor::start()
+{
+    mFirst = true;
+    esp_timer_stop(mTimer);
+    esp_timer_start_periodic(mTimer, (uint64_t)CONFIG_WIFICHN_LINK_MON_PERIOD_MS * 1000);
+    timer_cb(this); // первый отсчёт - сразу по подключению
+}
+
+void CLinkMonitor::stop()
+{
+    esp_timer_stop(mTimer);
+    mQuality.store(0, std::memory_order_relaxed);
+    mKbps.store(0, std::memory_order_relaxed);
+}
+
+void CLinkMonitor::onBeaconTimeout()
+{
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+    mBeaconLoss.fetch_add(1, std::memory_order_relaxed);
+    if (now - mLastBeaconLoss.load(std::memory_order_relaxed) > LINKMON_BEACON_WINDOW_S * 1000)
+        mRecentBeaconLoss.store(0, std::memory_order_relaxed);
+    mRecentBeaconLoss.fetch_add(1, std::memory_order_relaxed);
+    mLastBeaconLoss.store(now, std::memory_order_relaxed);
+}
+
+void CLinkMonitor::onDisconnect(uint8_t reason)
+{
+    mDisconnects.fetch_add(1, std::memory_order_relaxed);
+    mLastReason.store(reason, std::memory_order_relaxed);
+    stop();
+}
+
+void CLinkMonitor::timer_cb(void *arg)
+{
+    CLinkMonitor *self = (CLinkMonitor *)arg;
+    wifi_ap_record_t ap;
+    if (ESP_OK != esp_wifi_sta_get_ap_info(&ap))
+        return;
+    wifi_phy_mode_t phy = WIFI_PHY_MODE_HT20;
+    esp_wifi_sta_get_negotiated_phymode(&phy);
+    self->addSample(ap.rssi, (uint8_t)phy, ap.primary);
+}
+
+void CLinkMonitor::addSample(int8_t rssi, uint8_t phy, uint8_t channel)
+{
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+    // Экспоненциальное сглаживание в фиксированной точке.
+    if (mFirst)
+        mRssiAcc = (int32_t)rssi << LINKMON_EWMA_SHIFT;
+    else
+        mRssiAcc += rssi - (mRssiAcc >> LINKMON_EWMA_SHIFT);
+    mFirst = false;
+    int8_t smooth = (int8_t)(mRssiAcc >> LINKMON_EWMA_SHIFT);
+
+    int quality = (smooth - LINKMON_RSSI_MIN) * 100 / (LINKMON_RSSI_MAX - LINKMON_RSSI_MIN);
+    if (now - mLastBeaconLoss.load(std::memory_order_relaxed) <= LINKMON_BEACON_WINDOW_S * 1000)
+        quality -= (int)mRecentBeaconLoss.load(std::memory_order_relaxed) * LINKMON_BEACON_PENALTY;
+    quality = (quality < 0) ? 0 : ((quality > 100) ? 100 : quality);
+    uint32_t kbps = phyRate(phy, smooth) * LINKMON_EFFICIENCY_PCT / 100;
+    kbps = kbps * (50 + quality / 2) / 100; // повторы и потери растут с падением качества
+
+    mRssi.store(smooth, std::memory_order_relaxed);
+    mQuality.store((uint8_t)quality, std::memory_order_relaxed);
+    mKbps.store(kbps, std::memory_order_relaxed);
+    mPhy.store(phy, std::memory_order_relaxed);
+
+    portENTER_CRITICAL(&mMux);
+    SLinkSample &s = mRing[mHead];
+    s.time_ms = now;
+    s.rssi = rssi;
+    s.phy = phy;
+    s.channel = channel;
+    s.quality = (uint8_t)quality;
+    s.kbps = kbps;
+    mHead = (mHead + 1) % CONFIG_WIFICHN_LINK_MON_SAMPLES;
+    if (mCount < CONFIG_WIFICHN_LINK_MON_SAMPLES)
+        mCount++;
+    portEXIT_CRITICAL(&mMux);
+}
+
+size_t CLinkMonitor::history(SLinkSample *buf, size_t max)
+{
+    portENTER_CRITICAL(&mMux);
+    size_t n = (mCount < max) ? mCount : max;
+    size_t tail = (mHead + CONFIG_WIFICHN_LINK_MON_SAMPLES - n) % CONFIG_WIFICHN_LINK_MON_SAMPLES;
+    for (size_t i = 0; i < n; i++)
+    {
+        buf[i] = mRing[tail];
+        tail = (tail + 1) % CONFIG_WIFICHN_LINK_MON_SAMPLES;
+    }
+    portEXIT_CRITICAL(&mMux);
+    return n;
+}
+#endif
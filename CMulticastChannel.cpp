@@ -0,0 +1,442 @@
+/*!
+    \file
+    \brief Групповая рассылка датаграмм одному множеству узлов: номера, NACK, разбиение и сборка.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CMulticastChannel.h"
+
+#if CONFIG_WIFICHN_MCAST
+#include "esp_random.h"
+#include <cstring>
+
+// Заголовок (little-endian):
+//   0      тип (EMcastType)
+//   1      флаги (0)
+//   2..3   Data: индекс фрагмента в сообщении
+//   4..7   сеанс отправителя (Nack - сеанс, к которому относится запрос)
+//   8..9   Data: номер фрагмента; Heartbeat: номер следующего; Nack: первый пропущенный
+//   10..11 Data: номер сообщения
+//   12..13 Data: число фрагментов сообщения
+//   14..15 Data/Heartbeat: старейший номер в истории отправителя
+//   16..19 Data: длина сообщения; Nack: карта, бит i - пропущен номер (8..9) + 1 + i
+
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+/// Степень двойки не больше n (номера по модулю 65536 ложатся в кольцо без разрыва).
+static uint16_t floor_pow2(uint16_t n)
+{
+    uint16_t res = 1;
+    while ((n != 0) && (res <= n / 2))
+        res <<= 1;
+    return (n == 0) ? 0 : res;
+}
+
+CMulticastChannel::CMulticastChannel(TTransmit transmit, TReply reply, TDeliver deliver, uint16_t history, uint32_t caps)
+    : mTransmit(transmit), mReply(reply), mDeliver(deliver), mHistorySize(floor_pow2(history)),
+      mTxPool(MCAST_HEADER_SIZE + MCAST_CHUNK, mHistorySize, caps),
+      mRxPool(CONFIG_WIFICHN_MCAST_MAX_MSG, CONFIG_WIFICHN_MCAST_REASM, caps)
+{
+    mTxSession = esp_random() | 1;
+    mRand = esp_random() | 1;
+    if ((mHistorySize == 0) || !mTxPool.isValid())
+        return;
+    mHistory = (SHistory *)heap_caps_calloc(mHistorySize, sizeof(SHistory), MALLOC_CAP_DEFAULT);
+    if (mHistory == nullptr)
+        return;
+    for (uint16_t i = 0; i < mHistorySize; i++)
+        mHistory[i].buf = mTxPool.alloc();
+}
+
+CMulticastChannel::~CMulticastChannel()
+{
+    heap_caps_free(mHistory);
+}
+
+uint32_t CMulticastChannel::jitter(uint32_t max)
+{
+    // xorshift32: задержки NACK разных узлов не должны совпадать, криптостойкость не нужна.
+    mRand ^= mRand << 13;
+    mRand ^= mRand >> 17;
+    mRand ^= mRand << 5;
+    return mRand % (max + 1);
+}
+
+void CMulticastChannel::header(uint8_t *p, EMcastType type, uint32_t session, uint16_t seq)
+{
+    std::memset(p, 0, MCAST_HEADER_SIZE);
+    p[0] = (uint8_t)type;
+    put32(p + 4, session);
+    put16(p + 8, seq);
+}
+
+int32_t CMulticastChannel::send(const uint8_t *data, size_t len, uint32_t now)
+{
+    uint32_t count = (len == 0) ? 1 : (len + MCAST_CHUNK - 1) / MCAST_CHUNK;
+    // Все фрагменты сообщения должны оставаться в истории, пока его могут запросить.
+    if ((mHistory == nullptr) || (len > CONFIG_WIFICHN_MCAST_MAX_MSG) || (count > mHistorySize))
+        return -1;
+    uint16_t id = mMsgId++;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        SHistory &h = mHistory[mTxNext & (mHistorySize - 1)];
+        size_t part = ((i + 1 == count) ? len - i * MCAST_CHUNK : MCAST_CHUNK);
+        uint8_t *p = h.buf;
+        header(p, EMcastType::Data, mTxSession, mTxNext);
+        put16(p + 2, (uint16_t)i);
+        put16(p + 10, id);
+        put16(p + 12, (uint16_t)count);
+        put32(p + 16, (uint32_t)len);
+        if (part != 0)
+            std::memcpy(p + MCAST_HEADER_SIZE, data + i * MCAST_CHUNK, part);
+        h.len = (uint16_t)(MCAST_HEADER_SIZE + part);
+        h.seq = mTxNext;
+        h.wasRepaired = false;
+        mTxNext++;
+        mStats.chunks++;
+        // Номер, вытесненный этим фрагментом из истории, получатели перестанут ждать.
+        put16(p + 14, oldest());
+        mTransmit(p, h.len);
+    }
+    mLastTx = now;
+    mAnnounced = true;
+    mStats.sent++;
+    mBeacons = MCAST_HEARTBEATS;
+    mBeaconAt = now + MCAST_HEARTBEAT_MS;
+    return id;
+}
+
+uint16_t CMulticastChannel::oldest()
+{
+    uint16_t stored = (mStats.chunks < mHistorySize) ? (uint16_t)mStats.chunks : mHistorySize;
+    return (uint16_t)(mTxNext - stored);
+}
+
+void CMulticastChannel::sendBeacon(uint32_t now)
+{
+    uint8_t p[MCAST_HEADER_SIZE];
+    header(p, EMcastType::Heartbeat, mTxSession, mTxNext);
+    put16(p + 14, oldest());
+    mTransmit(p, sizeof(p));
+    mLastTx = now;
+    mStats.heartbeats++;
+}
+
+void CMulticastChannel::onNack(uint16_t base, uint32_t map, uint32_t now)
+{
+    mStats.nacksRecv++;
+    uint16_t first = oldest();
+    bool expired = false;
+    for (int i = -1; i < 32; i++)
+    {
+        if ((i >= 0) && ((map & (1UL << i)) == 0))
+            continue;
+        uint16_t seq = (uint16_t)(base + 1 + i);
+        if ((int16_t)(seq - mTxNext) >= 0)
+            break; // номер ещё не отправлялся
+        if ((int16_t)(seq - first) < 0)
+        {
+            expired = true;
+            continue;
+        }
+        SHistory &h = mHistory[seq & (mHistorySize - 1)];
+        // Пропуск, общий для многих получателей, исправляется одним повтором группе.
+        if (h.wasRepaired && ((now - h.repaired) < MCAST_REPAIR_HOLDOFF_MS))
+            continue;
+        put16(h.buf + 14, first);
+        mTransmit(h.buf, h.len);
+        mLastTx = now;
+        h.repaired = now;
+        h.wasRepaired = true;
+        mStats.repairs++;
+    }
+    // Запрошенного уже нет в истории: маяк сообщит, с какого номера ждать.
+    if (expired)
+        sendBeacon(now);
+}
+
+void CMulticastChannel::sendNack()
+{
+    uint8_t p[MCAST_HEADER_SIZE];
+    header(p, EMcastType::Nack, mRxSession, mRxNext);
+    uint16_t span = (uint16_t)(mRxEnd - mRxNext - 1);
+    uint32_t limit = (span >= 32) ? 0xffffffffUL : ((1UL << span) - 1);
+    put32(p + 16, ~mRxMask & limit);
+    mReply(p, sizeof(p));
+    mStats.nacksSent++;
+}
+
+void CMulticastChannel::stepRx()
+{
+    bool next;
+    do
+    {
+        next = (mRxMask & 1) != 0;
+        mRxMask >>= 1;
+        mRxNext++;
+    } while (next);
+    mNackTries = 0;
+    if ((int16_t)(mRxNext - mRxEnd) > 0)
+        mRxEnd = mRxNext;
+}
+
+bool CMulticastChannel::isReceived(uint16_t seq)
+{
+    int16_t d = (int16_t)(seq - mRxNext);
+    if (d < 0)
+        return true;
+    if ((d == 0) || (d > 32))
+        return false;
+    return (mRxMask & (1UL << (d - 1))) != 0;
+}
+
+void CMulticastChannel::markReceived(uint16_t seq)
+{
+    uint16_t d = (uint16_t)(seq - mRxNext);
+    if (d == 0)
+        stepRx();
+    else
+        mRxMask |= 1UL << (d - 1);
+    if ((int16_t)(seq + 1 - mRxEnd) > 0)
+        mRxEnd = (uint16_t)(seq + 1);
+}
+
+void CMulticastChannel::resync(uint32_t session, uint16_t first)
+{
+    reset();
+    mSynced = true;
+    mRxSession = session;
+    mRxNext = first;
+    mRxEnd = first;
+}
+
+void CMulticastChannel::reset()
+{
+    mSynced = false;
+    mRxMask = 0;
+    mNackPending = false;
+    mNackTries = 0;
+    for (auto &r : mReasm)
+        release(r);
+}
+
+void CMulticastChannel::release(SReasm &r)
+{
+    mRxPool.free(r.buf);
+    r.buf = nullptr;
+}
+
+void CMulticastChannel::onChunk(uint16_t id, uint16_t index, uint16_t count, uint32_t total, const uint8_t *data, size_t len, uint32_t now)
+{
+    if (count == 1)
+    {
+        // Сообщение из одного фрагмента доставляется из пакета, без копирования.
+        mStats.delivered++;
+        mDeliver(id, data, len);
+        return;
+    }
+    SReasm *slot = nullptr;
+    SReasm *oldest = nullptr;
+    for (auto &r : mReasm)
+    {
+        if (r.buf == nullptr)
+        {
+            if (slot == nullptr)
+                slot = &r;
+            continue;
+        }
+        if ((r.id == id) && (r.count == count) && (r.len == total))
+        {
+            slot = &r;
+            break;
+        }
+        if ((oldest == nullptr) || ((int32_t)(r.started - oldest->started) < 0))
+            oldest = &r;
+    }
+    if (slot == nullptr)
+    {
+        // Все буферы заняты: дольше всех собираемое сообщение, скорее всего, уже не собрать.
+        slot = oldest;
+        release(*slot);
+        mStats.incomplete++;
+    }
+    if (slot->buf == nullptr)
+    {
+        slot->buf = mRxPool.alloc();
+        if (slot->buf == nullptr)
+        {
+            mStats.dropped++;
+            return;
+        }
+        slot->id = id;
+        slot->count = count;
+        slot->len = total;
+        slot->have = 0;
+        slot->started = now;
+        std::memset(slot->map, 0, sizeof(slot->map));
+    }
+    if ((slot->map[index / 8] & (1 << (index % 8))) != 0)
+    {
+        mStats.duplicates++;
+        return;
+    }
+    slot->map[index / 8] |= (uint8_t)(1 << (index % 8));
+    std::memcpy(slot->buf + (size_t)index * MCAST_CHUNK, data, len);
+    if (++slot->have < slot->count)
+        return;
+    mStats.delivered++;
+    mDeliver(slot->id, slot->buf, slot->len);
+    release(*slot);
+}
+
+void CMulticastChannel::input(const uint8_t *data, size_t len, uint32_t now)
+{
+    if ((len < MCAST_HEADER_SIZE) || (data[1] != 0))
+    {
+        mStats.dropped++;
+        return;
+    }
+    EMcastType type = (EMcastType)data[0];
+    uint32_t session = get32(data + 4);
+    uint16_t seq = get16(data + 8);
+    if (type == EMcastType::Nack)
+    {
+        if ((mHistory != nullptr) && (session == mTxSession))
+            onNack(seq, get32(data + 16), now);
+        return;
+    }
+    if ((type != EMcastType::Data) && (type != EMcastType::Heartbeat))
+    {
+        mStats.dropped++;
+        return;
+    }
+    if (session == mTxSession)
+        return; // собственная рассылка (петля группы на отправителе)
+
+    uint16_t index = get16(data + 2);
+    uint16_t id = get16(data + 10);
+    uint16_t count = get16(data + 12);
+    uint16_t oldest = get16(data + 14);
+    uint32_t total = get32(data + 16);
+    size_t part = len - MCAST_HEADER_SIZE;
+    if (type == EMcastType::Data)
+    {
+        uint32_t expect = (total == 0) ? 1 : (total + MCAST_CHUNK - 1) / MCAST_CHUNK;
+        if ((total > CONFIG_WIFICHN_MCAST_MAX_MSG) || (count != expect) || (index >= count) ||
+            (part != ((index + 1U == count) ? total - (uint32_t)index * MCAST_CHUNK : MCAST_CHUNK)))
+        {
+            mStats.dropped++;
+            return;
+        }
+    }
+
+    // Новый отправитель (или его перезагрузка): ждём с начала сообщения, которое застали.
+    if (!mSynced || (session != mRxSession))
+        resync(session, (type == EMcastType::Data) ? (uint16_t)(seq - index) : seq);
+    // Номеров до oldest у отправителя уже нет - ждать их бесполезно.
+    while ((int16_t)(oldest - mRxNext) > 0)
+    {
+        mStats.lost++;
+        stepRx();
+    }
+    if (type == EMcastType::Heartbeat)
+    {
+        if ((int16_t)(seq - mRxEnd) > 0)
+            mRxEnd = seq;
+        return;
+    }
+
+    if (isReceived(seq))
+    {
+        mStats.duplicates++;
+        return;
+    }
+    // Номер за окном карты: самые старые пропуски больше не ждём.
+    while ((int16_t)(seq - mRxNext) > 32)
+    {
+        mStats.lost++;
+        stepRx();
+    }
+    markReceived(seq);
+    onChunk(id, index, count, total, data + MCAST_HEADER_SIZE, part, now);
+}
+
+uint32_t CMulticastChannel::poll(uint32_t now)
+{
+    uint32_t wait = 1000;
+    if (mBeacons != 0)
+    {
+        if ((int32_t)(now - mBeaconAt) >= 0)
+        {
+            sendBeacon(now);
+            mBeacons--;
+            mBeaconAt = now + (MCAST_HEARTBEAT_MS << (MCAST_HEARTBEATS - mBeacons));
+        }
+        if (mBeacons != 0)
+            wait = mBeaconAt - now;
+    }
+    else if (mHistory != nullptr)
+    {
+        // Получатель, узнавший сеанс заранее, запросит даже потерянный первый пакет рассылки.
+        if (!mAnnounced || (now - mLastTx >= MCAST_IDLE_BEACON_MS))
+        {
+            sendBeacon(now);
+            mAnnounced = true;
+        }
+        if (MCAST_IDLE_BEACON_MS - (now - mLastTx) < wait)
+            wait = MCAST_IDLE_BEACON_MS - (now - mLastTx);
+    }
+
+    if (!mSynced || ((int16_t)(mRxEnd - mRxNext) <= 0))
+    {
+        mNackPending = false;
+        return wait;
+    }
+    if (!mNackPending)
+    {
+        // Случайная задержка: пропуск успеет прийти не по порядку, а NACK узлов парка разойдутся.
+        mNackPending = true;
+        mNackAt = now + jitter(MCAST_NACK_DELAY_MS);
+    }
+    while (mNackPending && ((int32_t)(now - mNackAt) >= 0))
+    {
+        if (mNackTries < CONFIG_WIFICHN_MCAST_NACK_RETRIES)
+        {
+            sendNack();
+            mNackTries++;
+            mNackAt = now + MCAST_NACK_INTERVAL_MS + jitter(MCAST_NACK_DELAY_MS);
+            break;
+        }
+        // Отправитель не отвечает на этот номер: перестаём его ждать.
+        mStats.lost++;
+        stepRx();
+        if ((int16_t)(mRxEnd - mRxNext) <= 0)
+            mNackPending = false;
+    }
+    if (mNackPending && ((mNackAt - now) < wait))
+        wait = mNackAt - now;
+    return wait;
+}
+#endif
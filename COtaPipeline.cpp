@@ -0,0 +1,318 @@
+/*!
+    \file
+    \brief Конвейер закачки образа: HTTP(S) источник, проверка, буферизация и запись в приёмник.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "COtaPipeline.h"
+#include "tasks/task_settings.h"
+#if CONFIG_WIFICHN_QOS
+#include "tasks/CTrafficTask.h"
+#endif
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "CTimeline.h"
+#include <cstring>
+#include <string>
+
+static const char *TAG = "ota_pipe";
+
+COtaPipeline::COtaPipeline(COtaSink *sink, onWriteEvent *event, std::atomic<bool> &cancel, TNotify notify, uint32_t caps, size_t readSize) : mSink(sink), mCancel(cancel), mNotify(notify), mCaps(caps), mReadSize(readSize)
+{
+    mSink->setWriteEvent(event);
+}
+
+COtaPipeline::~COtaPipeline()
+{
+    heap_caps_free(mBuf);
+}
+
+void COtaPipeline::notify(uint16_t progress, int16_t status)
+{
+    if (mNotify)
+        mNotify(progress, status, mWritten);
+}
+
+int16_t COtaPipeline::begin(uint32_t size)
+{
+    if (size == 0)
+        return OTA_STATUS_ERR_IMAGE_SIZE;
+    mSize = size;
+    mWritten = 0;
+    mFill = 0;
+    mProgress = 0xffff;
+    int16_t res = mSink->begin(size);
+    if (res != OTA_STATUS_OK)
+        return res;
+
+    heap_caps_free(mBuf);
+    mBuf = nullptr;
+    mBufSize = mReadSize;
+#if CONFIG_WIFICHN_OTA_PSRAM_BURST
+    // Образ (или его крупная часть) сначала целиком закачивается в PSRAM без обращений
+    // к flash, затем пишется пакетами по CONFIG_WIFICHN_OTA_BURST_KB с одним окном
+    // writeEvent на пакет. Если PSRAM не хватает даже на пакет - запись потоком.
+    size_t stage = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+    stage = (stage > OTATASK_PSRAM_RESERVE) ? ((stage - OTATASK_PSRAM_RESERVE) & ~(size_t)(SPI_FLASH_SEC_SIZE - 1)) : 0;
+    if (stage > size)
+        stage = size;
+    if (stage >= OTATASK_BURST_SIZE)
+    {
+        mBuf = (uint8_t *)heap_caps_malloc(stage, MALLOC_CAP_SPIRAM);
+        if (mBuf != nullptr)
+            mBufSize = stage;
+    }
+    if (mBuf == nullptr)
+        ESP_LOGW(TAG, "no PSRAM for staging, streaming write");
+#endif
+    // Порция манифеста должна помещаться в буфер целиком: в приёмник уходят только сверенные.
+    if ((mBuf != nullptr) && (mBufSize < mVerifier.chunkSize()))
+    {
+        heap_caps_free(mBuf);
+        mBuf = nullptr;
+    }
+    if (mBufSize < mVerifier.chunkSize())
+        mBufSize = mVerifier.chunkSize();
+    if (mBuf == nullptr)
+        mBuf = (uint8_t *)heap_caps_malloc(mBufSize, mCaps);
+    if (mBuf == nullptr)
+        ESP_LOGE(TAG, "no memory for %u byte buffer", (unsigned)mBufSize);
+    return (mBuf != nullptr) ? OTA_STATUS_OK : OTA_STATUS_ERR_PERFORM;
+}
+
+int16_t COtaPipeline::commit(size_t len)
+{
+    if (mWritten + len > mSize)
+        return OTA_STATUS_ERR_IMAGE_SIZE;
+    int16_t res = mSink->inspect(mWritten, mBuf + mFill, len);
+    if (res != OTA_STATUS_OK)
+        return res;
+    // Порция, не совпавшая с манифестом, прерывает закачку: она ещё в буфере, не в приёмнике.
+    if (!mVerifier.update(mBuf + mFill, len))
+        return OTA_STATUS_ERR_VERIFY;
+    mFill += len;
+    mWritten += len;
+    // Образ принят целиком: проверка до записи последней порции (в режиме PSRAM - до первой записи).
+    if ((mWritten == mSize) && !mVerifier.finish(mSink->hashAppended()))
+        return OTA_STATUS_ERR_VERIFY;
+    if ((mFill == mBufSize) || (mWritten == mSize))
+        res = flushStage(mFill - (mWritten - mVerifier.verified()));
+    uint16_t prg = ((uint64_t)mWritten * 100) / mSize;
+    if (mProgress != prg)
+    {
+        mProgress = prg;
+        notify(prg, OTA_STATUS_WRITE);
+    }
+    return res;
+}
+
+int16_t COtaPipeline::flushStage(size_t len)
+{
+    for (size_t pos = 0; pos < len; pos += OTATASK_BURST_SIZE)
+    {
+        if (mCancel)
+            return OTA_STATUS_CANCEL;
+        size_t n = ((len - pos) < OTATASK_BURST_SIZE) ? (len - pos) : OTATASK_BURST_SIZE;
+        mSink->beginBurst();
+        int16_t res = mSink->write(mBuf + pos, n);
+        mSink->endBurst();
+        if (res != OTA_STATUS_OK)
+            return res;
+#if CONFIG_WIFICHN_OTA_PSRAM_BURST
+        vTaskDelay(pdMS_TO_TICKS(OTATASK_BURST_GAP_MS)); // пауза между пакетами - радио и подписчики наверстывают
+#endif
+    }
+    // Несверенный хвост порции остаётся до её конца.
+    if (len < mFill)
+        std::memmove(mBuf, mBuf + len, mFill - len);
+    mFill -= len;
+    return OTA_STATUS_OK;
+}
+
+int16_t COtaPipeline::feed(const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        if (mCancel)
+            return OTA_STATUS_CANCEL;
+        size_t n = mBufSize - mFill;
+        if (n > len)
+            n = len;
+        std::memcpy(mBuf + mFill, data, n);
+        int16_t res = commit(n);
+        if (res != OTA_STATUS_OK)
+            return res;
+        data += n;
+        len -= n;
+    }
+    return OTA_STATUS_OK;
+}
+
+int16_t COtaPipeline::end(int16_t res)
+{
+    if ((res == OTA_STATUS_OK) && (mWritten != mSize))
+        res = OTA_STATUS_ERR_PERFORM;
+    if (res == OTA_STATUS_OK)
+        res = mSink->finish();
+    if (res == OTA_STATUS_OK)
+    {
+        notify(100, OTA_STATUS_FINISH);
+    }
+    else
+    {
+        mSink->abort();
+        if (res != OTA_STATUS_CANCEL)
+            notify(mProgress, OTA_STATUS_ABORT);
+    }
+    heap_caps_free(mBuf);
+    mBuf = nullptr;
+    return res;
+}
+
+esp_http_client_handle_t COtaPipeline::connect(esp_http_client_config_t &cfg)
+{
+#if CONFIG_WIFICHN_HTTP_POOL
+    if (mPool != nullptr)
+        return mPool->acquire(cfg);
+#endif
+    return esp_http_client_init(&cfg);
+}
+
+void COtaPipeline::disconnect(esp_http_client_handle_t client, bool keep)
+{
+#if CONFIG_WIFICHN_HTTP_POOL
+    if (mPool != nullptr)
+    {
+        mPool->release(client, keep);
+        return;
+    }
+#endif
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+}
+
+esp_err_t COtaPipeline::request(esp_http_client_handle_t client, int64_t &len)
+{
+    TIMELINE_SCOPE("http.open"); // TCP, рукопожатие TLS (отметка tls.connected) и заголовки ответа
+    if (mTls != nullptr)
+        mTls->begin();
+#if CONFIG_WIFICHN_HTTP_POOL
+    if (mPool != nullptr)
+        return mPool->open(client, 0, len);
+#endif
+    esp_err_t err = esp_http_client_open(client, 0);
+    len = (err == ESP_OK) ? esp_http_client_fetch_headers(client) : -1;
+    return ((err == ESP_OK) && (len < 0)) ? ESP_FAIL : err;
+}
+
+esp_err_t COtaPipeline::open(esp_http_client_handle_t client)
+{
+    esp_err_t err = ESP_FAIL;
+    for (uint8_t attempt = 0; (attempt < OTATASK_BEGIN_RETRIES) && !mCancel; attempt++)
+    {
+        for (uint8_t redirect = 0; redirect <= OTATASK_MAX_REDIRECTS; redirect++)
+        {
+            int64_t len;
+            err = request(client, len);
+            if (err != ESP_OK)
+                break;
+            int status = esp_http_client_get_status_code(client);
+            if (status == 200)
+            {
+                mSize = (len > 0) ? (uint32_t)len : 0;
+                return ESP_OK;
+            }
+            esp_http_client_close(client);
+            err = ESP_FAIL;
+            if ((status < 300) || (status >= 400) || (ESP_OK != esp_http_client_set_redirection(client)))
+                break;
+        }
+        ESP_LOGW(TAG, "HTTP open failed: %s (attempt %d/%d)", esp_err_to_name(err), attempt + 1, OTATASK_BEGIN_RETRIES);
+        vTaskDelay(pdMS_TO_TICKS(OTATASK_RETRY_DELAY_MS));
+    }
+    return err;
+}
+
+bool COtaPipeline::loadManifest(esp_http_client_config_t &cfg, const char *key)
+{
+    esp_http_client_handle_t client = connect(cfg);
+    bool res = false;
+    bool keep = false;
+    if (client != nullptr)
+    {
+        int64_t len;
+        if ((ESP_OK == request(client, len)) && (esp_http_client_get_status_code(client) == 200) && (len > 0) && (len <= OTATASK_MANIFEST_MAX))
+        {
+            std::string text(len, 0);
+            int64_t n = 0;
+            int r;
+            while ((n < len) && ((r = esp_http_client_read(client, &text[n], len - n)) > 0))
+                n += r;
+            keep = (n == len);
+            res = keep && mVerifier.loadManifest(text.data(), n, key);
+        }
+        disconnect(client, keep);
+    }
+    if (!res)
+        ESP_LOGW(TAG, "manifest %s not loaded", cfg.url);
+    // С ключом манифест обязателен: иначе проверка подписи обходится удалением манифеста.
+    return res || (key == nullptr);
+}
+
+int16_t COtaPipeline::download(esp_http_client_config_t &cfg, const char *manifest, const char *key)
+{
+    notify(0, OTA_STATUS_START);
+    if (manifest != nullptr)
+    {
+        esp_http_client_config_t mcfg = cfg;
+        mcfg.url = manifest;
+        if (!loadManifest(mcfg, key))
+            return mCancel ? OTA_STATUS_CANCEL : OTA_STATUS_ERR_VERIFY;
+    }
+    esp_http_client_handle_t client = connect(cfg);
+    if (client == nullptr)
+        return OTA_STATUS_ERR_BEGIN;
+    if (ESP_OK != open(client))
+    {
+        disconnect(client, false);
+        return mCancel ? OTA_STATUS_CANCEL : OTA_STATUS_ERR_BEGIN;
+    }
+    notify(0, OTA_STATUS_CONNECTED);
+
+    int16_t res = begin(mSize);
+    while ((res == OTA_STATUS_OK) && (mWritten < mSize))
+    {
+        if (mCancel)
+        {
+            res = OTA_STATUS_CANCEL;
+            break;
+        }
+        // Чтение прямо в буфер накопления, без промежуточной копии.
+        size_t chunk = mBufSize - mFill;
+        size_t readSize = (mTuner != nullptr) ? mTuner->readSize() : mReadSize;
+        if (chunk > readSize)
+            chunk = readSize;
+#if CONFIG_WIFICHN_QOS
+        if (mQos != nullptr)
+            mQos->yield(ETrafficClass::Background); // до замера: пауза не портит подбор размера чтения
+#endif
+        int64_t t = esp_timer_get_time();
+        TIMELINE_BEGIN("ota.read");
+        int n = esp_http_client_read(client, (char *)(mBuf + mFill), chunk);
+        TIMELINE_END("ota.read");
+        if (n <= 0)
+        {
+            res = OTA_STATUS_ERR_PERFORM;
+            break;
+        }
+        if (mTuner != nullptr)
+            mTuner->account(n, esp_timer_get_time() - t);
+        res = commit(n);
+    }
+    disconnect(client, res == OTA_STATUS_OK);
+    return end(res);
+}
@@ -0,0 +1,245 @@
+/*!
+    \file
+    \brief Приёмники образа OTA: раздел приложения, произвольный раздел, файл, обработчик.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "COtaSink.h"
+#include "esp_ota_ops.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "bootloader_common.h"
+#include <cstring>
+
+static const char *TAG = "ota_sink";
+
+COtaPartitionSink::COtaPartitionSink(const esp_partition_t *part, bool skipUnchanged, uint32_t caps) : mPart(part), mSkip(skipUnchanged), mCaps(caps)
+{
+}
+
+COtaPartitionSink::COtaPartitionSink(const char *label, bool skipUnchanged, uint32_t caps) : mSkip(skipUnchanged), mCaps(caps)
+{
+    mPart = esp_partition_find_first(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, label);
+}
+
+COtaPartitionSink::~COtaPartitionSink()
+{
+    delete mWriter;
+}
+
+int16_t COtaPartitionSink::begin(uint32_t size)
+{
+    if ((mPart == nullptr) || (size > mPart->size))
+        return OTA_STATUS_ERR_IMAGE_SIZE;
+    delete mWriter;
+    mWriter = new COtaWriter(mPart, mEvent, mSkip, mCaps);
+    return mWriter->isValid() ? OTA_STATUS_OK : OTA_STATUS_ERR_BEGIN;
+}
+
+int16_t COtaPartitionSink::write(const uint8_t *data, size_t len)
+{
+    return (ESP_OK == mWriter->write(data, len)) ? OTA_STATUS_OK : OTA_STATUS_ERR_PERFORM;
+}
+
+int16_t COtaPartitionSink::finish()
+{
+    return (ESP_OK == mWriter->finish()) ? OTA_STATUS_OK : OTA_STATUS_ERR_PERFORM;
+}
+
+void COtaPartitionSink::abort()
+{
+    if (mWriter != nullptr)
+        mWriter->endBurst();
+}
+
+void COtaPartitionSink::beginBurst()
+{
+    mWriter->beginBurst();
+}
+
+void COtaPartitionSink::endBurst()
+{
+    mWriter->endBurst();
+}
+
+void COtaPartitionSink::stats(SOtaSinkStats &st)
+{
+    st = SOtaSinkStats();
+    if (mWriter == nullptr)
+        return;
+    st.sectors = mWriter->sectors();
+    st.skipped = mWriter->skipped();
+    st.writeTime = mWriter->writeTime();
+    st.savedTime = mWriter->savedTime();
+    st.locks = mWriter->lock().locks();
+    st.lockTime = mWriter->lock().time();
+    st.maxLock = mWriter->lock().maxTime();
+}
+
+COtaAppSink::COtaAppSink(bool skipUnchanged, uint32_t caps, onImageDesc *desc) : COtaPartitionSink(esp_ota_get_next_update_partition(nullptr), skipUnchanged, caps), mDesc(desc)
+{
+}
+
+int16_t COtaAppSink::inspect(uint32_t offset, const uint8_t *data, size_t len)
+{
+    // Заголовок образа, чип и описание приложения проверяются до записи первого сектора.
+    if (offset >= sizeof(mHead))
+        return OTA_STATUS_OK;
+    size_t n = ((sizeof(mHead) - offset) < len) ? (sizeof(mHead) - offset) : len;
+    std::memcpy(mHead + offset, data, n);
+    if (offset + n < sizeof(mHead))
+        return OTA_STATUS_OK;
+
+    esp_image_header_t *head = (esp_image_header_t *)mHead;
+    esp_app_desc_t *desc = (esp_app_desc_t *)(mHead + sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t));
+    if ((head->magic != ESP_IMAGE_HEADER_MAGIC) || (desc->magic_word != ESP_APP_DESC_MAGIC_WORD))
+        return OTA_STATUS_ERR_IMAGE_DESC;
+    // Образ другого чипа или ревизии загрузчик не запустит: отказ до стирания первого сектора.
+    // Проверка та же, что в загрузчике: id чипа, минимальная ревизия, максимальная - если
+    // задана в образе и не отключена efuse disable_wafer_version_major.
+    if (ESP_OK != bootloader_common_check_chip_validity(head, ESP_IMAGE_APPLICATION))
+        return OTA_STATUS_ERR_CHIP;
+    mHashAppended = (head->hash_appended != 0);
+    if (mDesc != nullptr)
+        mDesc(*desc);
+    return OTA_STATUS_OK;
+}
+
+int16_t COtaAppSink::finish()
+{
+    int16_t res = COtaPartitionSink::finish();
+    if (res != OTA_STATUS_OK)
+        return res;
+    // esp_ota_set_boot_partition() проверяет образ (в т.ч. подпись при secure boot).
+    COtaLock lock(mEvent);
+    lock.lock();
+    esp_err_t err = esp_ota_set_boot_partition(mPart);
+    lock.unlock();
+    return (err == ESP_OK) ? OTA_STATUS_OK : OTA_STATUS_ERR_FINISH;
+}
+
+bool COtaAppSink::hashAppended()
+{
+    // У подписанных образов за хэшем следуют выравнивание и блок подписи - их проверяет загрузчик.
+#if CONFIG_SECURE_SIGNED_APPS
+    return false;
+#else
+    return mHashAppended;
+#endif
+}
+
+COtaFileSink::COtaFileSink(const char *path) : mPath(path), mTemp(path), mBackup(path)
+{
+    mTemp += ".tmp";
+    mBackup += ".bak";
+    // Питание пропало между переименованиями в finish(): образ - только в резервной копии.
+    FILE *f = fopen(mPath.c_str(), "rb");
+    if (f != nullptr)
+        fclose(f);
+    else if (0 == rename(mBackup.c_str(), mPath.c_str()))
+        ESP_LOGW(TAG, "%s restored from backup", mPath.c_str());
+}
+
+COtaFileSink::~COtaFileSink()
+{
+    abort();
+}
+
+int16_t COtaFileSink::begin(uint32_t size)
+{
+    mLock = COtaLock(mEvent);
+    mFile = fopen(mTemp.c_str(), "wb");
+    if (mFile == nullptr)
+    {
+        ESP_LOGE(TAG, "can't create %s", mTemp.c_str());
+        return OTA_STATUS_ERR_BEGIN;
+    }
+    return OTA_STATUS_OK;
+}
+
+int16_t COtaFileSink::write(const uint8_t *data, size_t len)
+{
+    mLock.lock();
+    int64_t t = esp_timer_get_time();
+    size_t n = fwrite(data, 1, len, mFile);
+    mWriteTime += esp_timer_get_time() - t;
+    if (!mBurst)
+        mLock.unlock();
+    return (n == len) ? OTA_STATUS_OK : OTA_STATUS_ERR_PERFORM;
+}
+
+int16_t COtaFileSink::finish()
+{
+    mLock.lock();
+    int res = fclose(mFile);
+    mFile = nullptr;
+    if ((res == 0) && (0 != rename(mTemp.c_str(), mPath.c_str())))
+    {
+        // SPIFFS и FAT не переименовывают поверх существующего файла: прежний образ
+        // уходит в резервную копию и удаляется только после переименования нового.
+        remove(mBackup.c_str());
+        res = rename(mPath.c_str(), mBackup.c_str());
+        if (res == 0)
+        {
+            res = rename(mTemp.c_str(), mPath.c_str());
+            if (res == 0)
+                remove(mBackup.c_str());
+            else
+                rename(mBackup.c_str(), mPath.c_str());
+        }
+    }
+    mLock.unlock();
+    return (res == 0) ? OTA_STATUS_OK : OTA_STATUS_ERR_FINISH;
+}
+
+void COtaFileSink::abort()
+{
+    mBurst = false;
+    mLock.unlock();
+    if (mFile != nullptr)
+    {
+        fclose(mFile);
+        mFile = nullptr;
+        remove(mTemp.c_str());
+    }
+}
+
+void COtaFileSink::beginBurst()
+{
+    mBurst = true;
+}
+
+void COtaFileSink::endBurst()
+{
+    mBurst = false;
+    mLock.unlock();
+}
+
+void COtaFileSink::stats(SOtaSinkStats &st)
+{
+    st = SOtaSinkStats();
+    st.writeTime = mWriteTime;
+    st.locks = mLock.locks();
+    st.lockTime = mLock.time();
+    st.maxLock = mLock.maxTime();
+}
+
+int16_t COtaCallbackSink::write(const uint8_t *data, size_t len)
+{
+    return mData(data, len, mArg) ? OTA_STATUS_OK : OTA_STATUS_ERR_PERFORM;
+}
+
+int16_t COtaCallbackSink::finish()
+{
+    if ((mEnd != nullptr) && !mEnd(true, mArg))
+        return OTA_STATUS_ERR_FINISH;
+    return OTA_STATUS_OK;
+}
+
+void COtaCallbackSink::abort()
+{
+    if (mEnd != nullptr)
+        mEnd(false, mArg);
+}
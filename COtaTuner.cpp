@@ -0,0 +1,119 @@
+/*!
+    \file
+    \brief Подбор размера буфера HTTP(S) чтения по измеренной скорости.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "COtaTuner.h"
+#include "tasks/task_settings.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+static const char *TAG = "ota_tune";
+static const char *NVS_NAMESPACE = "wifi_chn";
+static const char *NVS_KEY = "ota_rx";
+
+size_t COtaTuner::stored()
+{
+    uint32_t size = 0;
+    nvs_handle_t h;
+    if (ESP_OK == nvs_open(NVS_NAMESPACE, NVS_READONLY, &h))
+    {
+        if (ESP_OK != nvs_get_u32(h, NVS_KEY, &size))
+            size = 0;
+        nvs_close(h);
+    }
+    return size;
+}
+
+void COtaTuner::reset()
+{
+    nvs_handle_t h;
+    if (ESP_OK == nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h))
+    {
+        nvs_erase_key(h, NVS_KEY);
+        nvs_commit(h);
+        nvs_close(h);
+    }
+}
+
+size_t COtaTuner::prepare(size_t def, uint32_t caps, bool force)
+{
+    // Буфер esp_http_client всегда во внутренней RAM; запас - под TLS и стек WiFi.
+    size_t internal = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    internal = (internal > OTATASK_TUNE_RESERVE) ? (internal - OTATASK_TUNE_RESERVE) : 0;
+    size_t other = heap_caps_get_largest_free_block(caps);
+    auto fits = [internal, other](size_t size)
+    { return (size <= internal) && (size <= other); };
+
+    mActive = false;
+    mCount = 0;
+    mBestRate = 0;
+    mBest = force ? 0 : stored();
+    if ((mBest != 0) && fits(mBest))
+        return mBest;
+
+    for (size_t size = OTATASK_TUNE_MIN; (size <= OTATASK_TUNE_MAX) && (mCount < OTATUNER_MAX_STEPS) && fits(size); size *= 2)
+        mSizes[mCount++] = size;
+    if (mCount < 2)
+    {
+        mBest = (mCount == 1) ? mSizes[0] : def;
+        return mBest;
+    }
+    mStep = mCount - 1; // разгон - наибольшим вариантом
+    mWarmup = true;
+    mBytes = 0;
+    mTime = 0;
+    mActive = true;
+    return mSizes[mCount - 1];
+}
+
+void COtaTuner::account(size_t len, int64_t time)
+{
+    if (!mActive)
+        return;
+    mBytes += len;
+    mTime += time;
+    if (mBytes < OTATASK_TUNE_WINDOW)
+        return;
+    if (mWarmup)
+    {
+        mWarmup = false;
+        mStep = 0;
+    }
+    else
+    {
+        mRates[mStep] = (mTime > 0) ? (uint32_t)(((int64_t)mBytes * 1000000) / mTime) : UINT32_MAX;
+        mStep++;
+        if (mStep == mCount)
+            finish();
+    }
+    mBytes = 0;
+    mTime = 0;
+}
+
+void COtaTuner::finish()
+{
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < mCount; i++)
+    {
+        // Больший буфер - только при заметном выигрыше: он дороже во внутренней RAM.
+        if (mRates[i] > mRates[best] + mRates[best] / 20)
+            best = i;
+    }
+    mBest = mSizes[best];
+    mBestRate = mRates[best];
+    mActive = false;
+    ESP_LOGI(TAG, "read size %u (%lu B/s)", (unsigned)mBest, (unsigned long)mBestRate);
+
+    nvs_handle_t h;
+    if (ESP_OK == nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h))
+    {
+        nvs_set_u32(h, NVS_KEY, mBest);
+        nvs_commit(h);
+        nvs_close(h);
+    }
+}
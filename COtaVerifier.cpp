@@ -0,0 +1,202 @@
+/*!
+    \file
+    \brief Потоковая проверка SHA-256 образа OTA с ранним прерыванием.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "COtaVerifier.h"
+#include "CJsonType.h"
+#include "mbedtls/pk.h"
+#include "esp_log.h"
+#include <cstring>
+#include <string>
+
+static const char *TAG = "ota_verify";
+
+COtaVerifier::COtaVerifier()
+{
+    mbedtls_sha256_init(&mImage);
+    mbedtls_sha256_starts(&mImage, 0);
+    mbedtls_sha256_init(&mChunk);
+    mbedtls_sha256_starts(&mChunk, 0);
+    std::memset(mHash, 0, sizeof(mHash));
+}
+
+COtaVerifier::~COtaVerifier()
+{
+    mbedtls_sha256_free(&mImage);
+    mbedtls_sha256_free(&mChunk);
+}
+
+bool COtaVerifier::parseHex(const char *str, uint8_t *out, size_t len)
+{
+    if (std::strlen(str) != len * 2)
+        return false;
+    for (size_t i = 0; i < len * 2; i++)
+    {
+        char c = str[i];
+        uint8_t v;
+        if ((c >= '0') && (c <= '9'))
+            v = c - '0';
+        else if ((c >= 'a') && (c <= 'f'))
+            v = c - 'a' + 10;
+        else if ((c >= 'A') && (c <= 'F'))
+            v = c - 'A' + 10;
+        else
+            return false;
+        out[i / 2] = (i & 1) ? (out[i / 2] | v) : (v << 4);
+    }
+    return true;
+}
+
+bool COtaVerifier::loadManifest(const char *text, size_t len, const char *keyPem)
+{
+    json data = json::parse(text, text + len, nullptr, false, true);
+    if (data.is_discarded() || !data.contains("size") || !data["size"].is_number_unsigned() ||
+        !data.contains("chunk") || !data["chunk"].is_number_unsigned() ||
+        !data.contains("sha256") || !data["sha256"].is_string() ||
+        !data.contains("chunks") || !data["chunks"].is_array())
+    {
+        ESP_LOGW(TAG, "bad manifest");
+        return false;
+    }
+    mSize = data["size"].template get<uint32_t>();
+    mChunkSize = data["chunk"].template get<uint32_t>();
+    if ((mChunkSize == 0) || (data["chunks"].size() != (mSize + mChunkSize - 1) / mChunkSize) ||
+        !parseHex(data["sha256"].template get<std::string>().c_str(), mImageHash.data(), OTAVERIFIER_HASH_SIZE))
+        return false;
+    mChunks.resize(data["chunks"].size());
+    for (size_t i = 0; i < mChunks.size(); i++)
+    {
+        if (!data["chunks"][i].is_string() || !parseHex(data["chunks"][i].template get<std::string>().c_str(), mChunks[i].data(), OTAVERIFIER_HASH_SIZE))
+            return false;
+    }
+
+    if (keyPem != nullptr)
+    {
+        if (!data.contains("sig") || !data["sig"].is_string())
+            return false;
+        std::string hex = data["sig"].template get<std::string>();
+        std::vector<uint8_t> sig(hex.size() / 2);
+        if (!parseHex(hex.c_str(), sig.data(), sig.size()))
+            return false;
+
+        // Подписывается двоичное представление, а не текст JSON: не зависит от форматирования.
+        uint8_t digest[OTAVERIFIER_HASH_SIZE];
+        uint8_t hdr[8];
+        for (int i = 0; i < 4; i++)
+        {
+            hdr[i] = (uint8_t)(mSize >> (8 * i));
+            hdr[4 + i] = (uint8_t)(mChunkSize >> (8 * i));
+        }
+        mbedtls_sha256_context ctx;
+        mbedtls_sha256_init(&ctx);
+        mbedtls_sha256_starts(&ctx, 0);
+        mbedtls_sha256_update(&ctx, hdr, sizeof(hdr));
+        mbedtls_sha256_update(&ctx, mImageHash.data(), OTAVERIFIER_HASH_SIZE);
+        for (auto const &h : mChunks)
+            mbedtls_sha256_update(&ctx, h.data(), OTAVERIFIER_HASH_SIZE);
+        mbedtls_sha256_finish(&ctx, digest);
+        mbedtls_sha256_free(&ctx);
+
+        mbedtls_pk_context pk;
+        mbedtls_pk_init(&pk);
+        int err = mbedtls_pk_parse_public_key(&pk, (const unsigned char *)keyPem, std::strlen(keyPem) + 1);
+        if (err == 0)
+            err = mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, digest, sizeof(digest), sig.data(), sig.size());
+        mbedtls_pk_free(&pk);
+        if (err != 0)
+        {
+            ESP_LOGE(TAG, "manifest signature: -0x%x", -err);
+            return false;
+        }
+    }
+    mManifest = true;
+    return true;
+}
+
+bool COtaVerifier::checkChunk()
+{
+    uint8_t hash[OTAVERIFIER_HASH_SIZE];
+    mbedtls_sha256_finish(&mChunk, hash);
+    mbedtls_sha256_starts(&mChunk, 0);
+    bool res = (mIndex < mChunks.size()) && (std::memcmp(hash, mChunks[mIndex].data(), OTAVERIFIER_HASH_SIZE) == 0);
+    if (!res)
+        ESP_LOGE(TAG, "chunk %u mismatch", (unsigned)mIndex);
+    mIndex++;
+    mChunkFill = 0;
+    return res;
+}
+
+bool COtaVerifier::update(const uint8_t *data, size_t len)
+{
+    if (mManifest && (mReceived + len > mSize))
+        return false;
+    mReceived += len;
+
+    // Хэш образа отстаёт на 32 байта: они могут оказаться дописанным SHA-256.
+    size_t total = mTailLen + len;
+    if (total <= OTAVERIFIER_HASH_SIZE)
+    {
+        std::memcpy(mTail + mTailLen, data, len);
+        mTailLen = total;
+    }
+    else
+    {
+        size_t out = total - OTAVERIFIER_HASH_SIZE;
+        size_t fromTail = (out < mTailLen) ? out : mTailLen;
+        size_t fromData = out - fromTail;
+        mbedtls_sha256_update(&mImage, mTail, fromTail);
+        mbedtls_sha256_update(&mImage, data, fromData);
+        std::memmove(mTail, mTail + fromTail, mTailLen - fromTail);
+        std::memcpy(mTail + (mTailLen - fromTail), data + fromData, len - fromData);
+        mTailLen = OTAVERIFIER_HASH_SIZE;
+    }
+
+    if (!mManifest)
+        return true;
+    while (len > 0)
+    {
+        size_t n = mChunkSize - mChunkFill;
+        if (n > len)
+            n = len;
+        mbedtls_sha256_update(&mChunk, data, n);
+        mChunkFill += n;
+        data += n;
+        len -= n;
+        if ((mChunkFill == mChunkSize) && !checkChunk())
+            return false;
+    }
+    return true;
+}
+
+bool COtaVerifier::finish(bool appended)
+{
+    mbedtls_sha256_context full;
+    mbedtls_sha256_init(&full);
+    mbedtls_sha256_clone(&full, &mImage);
+    mbedtls_sha256_update(&full, mTail, mTailLen);
+    mbedtls_sha256_finish(&full, mHash);
+    mbedtls_sha256_free(&full);
+
+    bool res = true;
+    if (mManifest)
+    {
+        if ((mChunkFill > 0) && !checkChunk())
+            res = false;
+        if ((mReceived != mSize) || (std::memcmp(mHash, mImageHash.data(), OTAVERIFIER_HASH_SIZE) != 0))
+            res = false;
+    }
+    if (appended)
+    {
+        uint8_t hash[OTAVERIFIER_HASH_SIZE];
+        mbedtls_sha256_finish(&mImage, hash);
+        if ((mTailLen != OTAVERIFIER_HASH_SIZE) || (std::memcmp(hash, mTail, OTAVERIFIER_HASH_SIZE) != 0))
+            res = false;
+    }
+    if (!res)
+        ESP_LOGE(TAG, "image hash mismatch");
+    return res;
+}
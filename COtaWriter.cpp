@@ -0,0 +1,126 @@
+/*!
+    \file
+    \brief Посекторная запись образа в раздел flash с пропуском неизменённых секторов.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "COtaWriter.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <cstring>
+
+COtaWriter::COtaWriter(const esp_partition_t *part, onWriteEvent *lock, bool skipUnchanged, uint32_t caps) : mPart(part), mLock(lock), mSkip(skipUnchanged)
+{
+    mSector = (uint8_t *)heap_caps_malloc(SPI_FLASH_SEC_SIZE, caps);
+}
+
+COtaWriter::~COtaWriter()
+{
+    heap_caps_free(mSector);
+}
+
+bool COtaWriter::same(size_t len)
+{
+    // Сравнение порциями: изменённый сектор обычно отличается уже в первой порции,
+    // и чтение остатка не нужно. Чтение flash коротко и окна writeEvent не требует.
+    uint8_t cmp[OTAWRITER_CMP_CHUNK];
+    for (size_t pos = 0; pos < len; pos += OTAWRITER_CMP_CHUNK)
+    {
+        size_t n = ((len - pos) < OTAWRITER_CMP_CHUNK) ? (len - pos) : OTAWRITER_CMP_CHUNK;
+        if ((ESP_OK != esp_partition_read(mPart, mOffset + pos, cmp, n)) || (std::memcmp(cmp, mSector + pos, n) != 0))
+            return false;
+    }
+    return true;
+}
+
+void COtaLock::lock()
+{
+    if (mLocked)
+        return;
+    mLocked = true;
+    mLocks++;
+    if (mEvent != nullptr)
+        mEvent(true);
+    mStart = esp_timer_get_time();
+}
+
+void COtaLock::unlock()
+{
+    if (!mLocked)
+        return;
+    int64_t dt = esp_timer_get_time() - mStart;
+    mTime += dt;
+    if (dt > mMaxTime)
+        mMaxTime = dt;
+    mLocked = false;
+    if (mEvent != nullptr)
+        mEvent(false);
+}
+
+void COtaWriter::beginBurst()
+{
+    mBurst = true;
+}
+
+void COtaWriter::endBurst()
+{
+    mBurst = false;
+    mLock.unlock();
+}
+
+esp_err_t COtaWriter::flush()
+{
+    if (mFill == 0)
+        return ESP_OK;
+    if (mOffset + SPI_FLASH_SEC_SIZE > mPart->size)
+        return ESP_ERR_INVALID_SIZE;
+
+    esp_err_t err = ESP_OK;
+    mSectors++;
+    if (mSkip && same(mFill))
+    {
+        mSkipped++;
+    }
+    else
+    {
+        mLock.lock();
+        int64_t t = esp_timer_get_time();
+        err = esp_partition_erase_range(mPart, mOffset, SPI_FLASH_SEC_SIZE);
+        if (err == ESP_OK)
+            err = esp_partition_write(mPart, mOffset, mSector, mFill);
+        mWriteTime += esp_timer_get_time() - t;
+        if (!mBurst)
+            mLock.unlock();
+    }
+    mOffset += SPI_FLASH_SEC_SIZE;
+    mFill = 0;
+    return err;
+}
+
+esp_err_t COtaWriter::write(const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        size_t n = SPI_FLASH_SEC_SIZE - mFill;
+        if (n > len)
+            n = len;
+        std::memcpy(mSector + mFill, data, n);
+        mFill += n;
+        data += n;
+        len -= n;
+        if (mFill == SPI_FLASH_SEC_SIZE)
+        {
+            esp_err_t err = flush();
+            if (err != ESP_OK)
+                return err;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t COtaWriter::finish()
+{
+    return flush();
+}
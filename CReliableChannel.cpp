@@ -0,0 +1,417 @@
+/*!
+    \file
+    \brief Надёжная доставка датаграмм: номера, выборочные подтверждения, окно, RTO, XOR FEC.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CReliableChannel.h"
+
+#if CONFIG_WIFICHN_RUDP
+#include <cstring>
+
+// Заголовок (little-endian):
+//   0    тип (ERudpType)
+//   1    FEC: число сообщений группы
+//   2..3 Data: номер; Ack: первый не принятый номер; Fec: первый номер группы
+//   4..5 Data/Fec: старейший неподтверждённый номер отправителя
+//   6..7 Data: длина сообщения; Fec: XOR длин сообщений группы
+// Ack дополняется 32-битной картой: бит i - принят номер (2..3) + 1 + i.
+
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+/// Блоков пула: окно передачи, копии принятых сообщений (окно + группа) и накопитель FEC.
+static uint16_t pool_blocks(uint8_t fecGroup)
+{
+    return RUDP_WINDOW + ((fecGroup != 0) ? (RUDP_WINDOW + fecGroup + 1) : 0);
+}
+
+CReliableChannel::CReliableChannel(TTransmit transmit, TDeliver deliver, uint8_t fecGroup, uint32_t caps)
+    : mTransmit(transmit), mDeliver(deliver), mFecGroup((fecGroup > RUDP_WINDOW) ? RUDP_WINDOW : fecGroup),
+      mPool(RUDP_HEADER_SIZE + CONFIG_WIFICHN_RUDP_MTU, pool_blocks(mFecGroup), caps)
+{
+    if (mFecGroup != 0)
+        mFecBuf = mPool.alloc();
+}
+
+SRudpStats CReliableChannel::stats()
+{
+    SRudpStats res = mStats;
+    res.srtt = (mSrtt < 0) ? 0 : (uint16_t)(mSrtt >> 3);
+    res.rto = (uint16_t)mRto;
+    return res;
+}
+
+void CReliableChannel::transmit(STxSlot &slot, uint32_t now)
+{
+    put16(slot.buf + 4, mTxBase);
+    slot.sent = now;
+    slot.tries++;
+    mTransmit(slot.buf, slot.len);
+}
+
+void CReliableChannel::sendAck()
+{
+    uint8_t ack[RUDP_ACK_SIZE];
+    ack[0] = (uint8_t)ERudpType::Ack;
+    ack[1] = 0;
+    put16(ack + 2, mRxNext);
+    put16(ack + 4, 0);
+    put16(ack + 6, 0);
+    put32(ack + RUDP_HEADER_SIZE, mRxMask);
+    mTransmit(ack, sizeof(ack));
+}
+
+void CReliableChannel::flushFec()
+{
+    if (mFecCount == 0)
+        return;
+    mFecBuf[0] = (uint8_t)ERudpType::Fec;
+    mFecBuf[1] = mFecCount;
+    put16(mFecBuf + 2, mFecFirst);
+    put16(mFecBuf + 4, mTxBase);
+    put16(mFecBuf + 6, mFecLenXor);
+    mTransmit(mFecBuf, RUDP_HEADER_SIZE + mFecMax);
+    mStats.fecSent++;
+    mFecCount = 0;
+}
+
+bool CReliableChannel::send(const uint8_t *data, size_t len, uint32_t now)
+{
+    if ((len > CONFIG_WIFICHN_RUDP_MTU) || !canSend())
+        return false;
+    uint8_t *buf = mPool.alloc();
+    if (buf == nullptr)
+    {
+        mStats.dropped++;
+        return false;
+    }
+    uint16_t seq = mTxNext++;
+    buf[0] = (uint8_t)ERudpType::Data;
+    buf[1] = 0;
+    put16(buf + 2, seq);
+    put16(buf + 6, (uint16_t)len);
+    std::memcpy(buf + RUDP_HEADER_SIZE, data, len);
+    STxSlot &slot = mTx[seq % RUDP_WINDOW];
+    slot.buf = buf;
+    slot.len = (uint16_t)(RUDP_HEADER_SIZE + len);
+    slot.tries = 0;
+    slot.fast = false;
+    transmit(slot, now);
+    mStats.sent++;
+
+    if (mFecBuf != nullptr)
+    {
+        if (mFecCount == 0)
+        {
+            mFecFirst = seq;
+            mFecMax = 0;
+            mFecLenXor = 0;
+        }
+        uint8_t *x = mFecBuf + RUDP_HEADER_SIZE;
+        if (len > mFecMax)
+        {
+            std::memset(x + mFecMax, 0, len - mFecMax);
+            mFecMax = (uint16_t)len;
+        }
+        for (size_t i = 0; i < len; i++)
+            x[i] ^= data[i];
+        mFecLenXor ^= (uint16_t)len;
+        mFecTime = now;
+        if (++mFecCount == mFecGroup)
+            flushFec();
+    }
+    return true;
+}
+
+void CReliableChannel::input(const uint8_t *data, size_t len, uint32_t now)
+{
+    if ((len < RUDP_HEADER_SIZE) || (len > RUDP_HEADER_SIZE + CONFIG_WIFICHN_RUDP_MTU))
+    {
+        mStats.dropped++;
+        return;
+    }
+    uint16_t seq = get16(data + 2);
+    uint16_t base = get16(data + 4);
+    uint16_t field = get16(data + 6);
+    switch ((ERudpType)data[0])
+    {
+    case ERudpType::Ack:
+        if (len >= RUDP_ACK_SIZE)
+            onAck(seq, get32(data + RUDP_HEADER_SIZE), now);
+        break;
+    case ERudpType::Data:
+        if (field != len - RUDP_HEADER_SIZE)
+        {
+            mStats.dropped++;
+            break;
+        }
+        skipTo(base);
+        onData(seq, data + RUDP_HEADER_SIZE, field);
+        break;
+    case ERudpType::Fec:
+        skipTo(base);
+        onFec(seq, data[1], field, data + RUDP_HEADER_SIZE, len - RUDP_HEADER_SIZE);
+        break;
+    default:
+        mStats.dropped++;
+        break;
+    }
+}
+
+void CReliableChannel::updateRtt(int32_t rtt)
+{
+    // RFC 6298 в фиксированной точке: mSrtt - 8*SRTT, mRttVar - 4*RTTVAR.
+    if (mSrtt < 0)
+    {
+        mSrtt = rtt << 3;
+        mRttVar = rtt << 1;
+    }
+    else
+    {
+        int32_t err = rtt - (mSrtt >> 3);
+        mSrtt += err;
+        if (err < 0)
+            err = -err;
+        mRttVar += err - (mRttVar >> 2);
+    }
+    int32_t rto = (mSrtt >> 3) + ((mRttVar > 1) ? mRttVar : 1);
+    mRto = (rto < RUDP_RTO_MIN_MS) ? RUDP_RTO_MIN_MS : ((rto > RUDP_RTO_MAX_MS) ? RUDP_RTO_MAX_MS : rto);
+}
+
+void CReliableChannel::advanceTx()
+{
+    while ((mTxBase != mTxNext) && (mTx[mTxBase % RUDP_WINDOW].buf == nullptr))
+        mTxBase++;
+}
+
+void CReliableChannel::onAck(uint16_t cum, uint32_t sack, uint32_t now)
+{
+    if ((int16_t)(cum - mTxNext) > 0)
+        return; // подтверждение неотправленного - чужой или испорченный пакет
+    int32_t sample = -1;
+    for (uint16_t s = mTxBase; s != mTxNext; s++)
+    {
+        STxSlot &slot = mTx[s % RUDP_WINDOW];
+        if (slot.buf == nullptr)
+            continue;
+        int16_t off = (int16_t)(s - cum);
+        if ((off >= 0) && ((off == 0) || (off > 32) || ((sack & (1u << (off - 1))) == 0)))
+            continue;
+        if (slot.tries == 1)
+            sample = (int32_t)(now - slot.sent); // алгоритм Карна: только по пакетам без повторов
+        mPool.free(slot.buf);
+        slot.buf = nullptr;
+    }
+    if (sample >= 0)
+        updateRtt(sample);
+    advanceTx();
+
+    // Быстрый повтор: потерянный пакет виден по подтверждённым более поздним.
+    for (uint16_t s = mTxBase; s != mTxNext; s++)
+    {
+        STxSlot &slot = mTx[s % RUDP_WINDOW];
+        int16_t off = (int16_t)(s - cum);
+        if ((slot.buf == nullptr) || slot.fast || (off < 0) || (off >= 32))
+            continue;
+        if (__builtin_popcount(sack >> off) >= RUDP_DUP_THRESH)
+        {
+            slot.fast = true;
+            mStats.fastRetransmits++;
+            transmit(slot, now);
+        }
+    }
+}
+
+void CReliableChannel::releaseKeep(uint16_t seq)
+{
+    SRxKeep &k = mKeep[seq % (2 * RUDP_WINDOW)];
+    if ((k.buf != nullptr) && (k.seq == seq))
+    {
+        mPool.free(k.buf);
+        k.buf = nullptr;
+    }
+}
+
+void CReliableChannel::stepRx()
+{
+    bool next;
+    do
+    {
+        next = (mRxMask & 1) != 0;
+        mRxMask >>= 1;
+        mRxNext++;
+        if (mFecGroup != 0)
+            releaseKeep((uint16_t)(mRxNext - mFecGroup - 1)); // его группа уже не может быть неполной
+    } while (next);
+}
+
+void CReliableChannel::skipTo(uint16_t base)
+{
+    int16_t d = (int16_t)(base - mRxNext);
+    if (d > RUDP_WINDOW)
+        return; // отправитель не может уйти дальше окна
+    while ((int16_t)(base - mRxNext) > 0)
+        stepRx();
+}
+
+bool CReliableChannel::isReceived(uint16_t seq)
+{
+    int16_t d = (int16_t)(seq - mRxNext);
+    if (d < 0)
+        return true;
+    if ((d == 0) || (d > 32))
+        return false;
+    return (mRxMask & (1u << (d - 1))) != 0;
+}
+
+void CReliableChannel::accept(uint16_t seq, const uint8_t *data, size_t len, uint8_t *owned)
+{
+    mDeliver(data, len);
+    mStats.delivered++;
+    if (mFecGroup != 0)
+    {
+        SRxKeep &k = mKeep[seq % (2 * RUDP_WINDOW)];
+        if (k.buf != nullptr)
+            mPool.free(k.buf);
+        k.buf = owned;
+        if ((k.buf == nullptr) && ((k.buf = mPool.alloc()) != nullptr))
+            std::memcpy(k.buf, data, len);
+        k.len = (uint16_t)len;
+        k.seq = seq;
+    }
+    else
+    {
+        mPool.free(owned);
+    }
+    int16_t d = (int16_t)(seq - mRxNext);
+    if (d == 0)
+        stepRx();
+    else
+        mRxMask |= 1u << (d - 1);
+}
+
+void CReliableChannel::onData(uint16_t seq, const uint8_t *data, size_t len)
+{
+    if ((int16_t)(seq - mRxNext) >= RUDP_WINDOW)
+        mStats.dropped++;
+    else if (isReceived(seq))
+        mStats.duplicates++; // подтверждение потерялось - повторяем его
+    else
+        accept(seq, data, len, nullptr);
+    sendAck();
+}
+
+void CReliableChannel::onFec(uint16_t first, uint8_t count, uint16_t lenXor, const uint8_t *data, size_t len)
+{
+    if ((mFecGroup == 0) || (count == 0) || (count > mFecGroup))
+        return;
+    int32_t missing = -1;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint16_t s = first + i;
+        if (isReceived(s))
+            continue;
+        if (missing >= 0)
+            return; // XOR восстанавливает только одну потерю
+        missing = s;
+    }
+    if ((missing < 0) || ((int16_t)((uint16_t)missing - mRxNext) >= RUDP_WINDOW))
+        return;
+
+    uint8_t *buf = mPool.alloc();
+    if (buf == nullptr)
+    {
+        mStats.dropped++;
+        return;
+    }
+    std::memcpy(buf, data, len);
+    uint16_t restored = lenXor;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint16_t s = first + i;
+        if (s == (uint16_t)missing)
+            continue;
+        SRxKeep &k = mKeep[s % (2 * RUDP_WINDOW)];
+        if ((k.buf == nullptr) || (k.seq != s) || (k.len > len))
+        {
+            mPool.free(buf); // копии нет (не хватило пула или номер пропущен)
+            return;
+        }
+        for (size_t j = 0; j < k.len; j++)
+            buf[j] ^= k.buf[j];
+        restored ^= k.len;
+    }
+    if (restored > len)
+    {
+        mPool.free(buf);
+        mStats.dropped++;
+        return;
+    }
+    mStats.fecRecovered++;
+    accept((uint16_t)missing, buf, restored, buf);
+    sendAck();
+}
+
+uint32_t CReliableChannel::poll(uint32_t now)
+{
+    uint32_t next = RUDP_RTO_MAX_MS;
+    for (uint16_t s = mTxBase; s != mTxNext; s++)
+    {
+        STxSlot &slot = mTx[s % RUDP_WINDOW];
+        if (slot.buf == nullptr)
+            continue;
+        uint8_t shift = (slot.tries > 5) ? 4 : (slot.tries - 1);
+        uint32_t rto = mRto << shift;
+        if (rto > RUDP_RTO_MAX_MS)
+            rto = RUDP_RTO_MAX_MS;
+        int32_t left = (int32_t)(slot.sent + rto - now);
+        if (left <= 0)
+        {
+            if (slot.tries > CONFIG_WIFICHN_RUDP_MAX_RETRIES)
+            {
+                mPool.free(slot.buf);
+                slot.buf = nullptr;
+                mStats.lost++;
+                continue;
+            }
+            mStats.retransmits++;
+            transmit(slot, now);
+            left = (int32_t)((rto * 2 > RUDP_RTO_MAX_MS) ? RUDP_RTO_MAX_MS : rto * 2);
+        }
+        if ((uint32_t)left < next)
+            next = left;
+    }
+    advanceTx();
+
+    if (mFecCount != 0)
+    {
+        if ((int32_t)(now - mFecTime) >= RUDP_FEC_FLUSH_MS)
+            flushFec();
+        else if (next > RUDP_FEC_FLUSH_MS)
+            next = RUDP_FEC_FLUSH_MS;
+    }
+    return next;
+}
+#endif
@@ -0,0 +1,240 @@
+/*!
+    \file
+    \brief Защищённые датаграммы: AES-GCM, ключи из PSK или ECDH (X25519) через HKDF, окно повторов.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CSecureChannel.h"
+#include "esp_random.h"
+#include "mbedtls/hkdf.h"
+#include "mbedtls/md.h"
+#include "mbedtls/platform_util.h"
+#include <cstring>
+
+#if CONFIG_WIFICHN_SECURE
+#define SECURE_PSK_MAX (64) ///< Наибольший PSK, подмешиваемый в обмен ключами.
+
+static const uint8_t SECURE_SALT[] = {'w', 'i', 'f', 'i', 'c', 'h', 'n', '-', 's', 'e', 'c', 'u', 'r', 'e', '-', 'v', '1'};
+
+static int secure_rng(void *ctx, unsigned char *buf, size_t len)
+{
+    esp_fill_random(buf, len);
+    return 0;
+}
+
+CSecureChannel::CSecureChannel()
+{
+    mbedtls_gcm_init(&mTx);
+    mbedtls_gcm_init(&mRx);
+}
+
+CSecureChannel::~CSecureChannel()
+{
+    clear();
+    mbedtls_gcm_free(&mTx);
+    mbedtls_gcm_free(&mRx);
+}
+
+void CSecureChannel::clear()
+{
+    mbedtls_gcm_free(&mTx);
+    mbedtls_gcm_free(&mRx);
+    mbedtls_gcm_init(&mTx);
+    mbedtls_gcm_init(&mRx);
+    mbedtls_platform_zeroize(mTxIv, sizeof(mTxIv));
+    mbedtls_platform_zeroize(mRxIv, sizeof(mRxIv));
+    mKeyed = false;
+}
+
+esp_err_t CSecureChannel::setKey(const uint8_t *secret, size_t len, ESecureRole role, const uint8_t *context, size_t contextLen)
+{
+    return derive(secret, len, role, SECURE_SALT, sizeof(SECURE_SALT), context, contextLen);
+}
+
+esp_err_t CSecureChannel::setSessionKey(const uint8_t *psk, size_t len, ESecureRole role, const uint8_t *nonceI, const uint8_t *nonceR,
+                                        const uint8_t *context, size_t contextLen)
+{
+    if ((nonceI == nullptr) || (nonceR == nullptr))
+    {
+        clear();
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Соль - метка версии и nonce обеих сторон в порядке ролей.
+    uint8_t salt[sizeof(SECURE_SALT) + 2 * SECURE_NONCE_SIZE];
+    std::memcpy(salt, SECURE_SALT, sizeof(SECURE_SALT));
+    std::memcpy(salt + sizeof(SECURE_SALT), nonceI, SECURE_NONCE_SIZE);
+    std::memcpy(salt + sizeof(SECURE_SALT) + SECURE_NONCE_SIZE, nonceR, SECURE_NONCE_SIZE);
+    return derive(psk, len, role, salt, sizeof(salt), context, contextLen);
+}
+
+void CSecureChannel::makeNonce(uint8_t *nonce)
+{
+    esp_fill_random(nonce, SECURE_NONCE_SIZE);
+}
+
+esp_err_t CSecureChannel::derive(const uint8_t *secret, size_t len, ESecureRole role, const uint8_t *salt, size_t saltLen, const uint8_t *context,
+                                 size_t contextLen)
+{
+    clear();
+    if ((secret == nullptr) || (len < 16) || ((context == nullptr) && (contextLen != 0)))
+        return ESP_ERR_INVALID_ARG;
+    // Initiator -> Responder, затем Responder -> Initiator: ключ и IV каждого направления.
+    uint8_t okm[2 * (SECURE_KEY_SIZE + SECURE_IV_SIZE)];
+    const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    esp_err_t res = ESP_FAIL;
+    if ((md != nullptr) && (0 == mbedtls_hkdf(md, salt, saltLen, secret, len, context, contextLen, okm, sizeof(okm))))
+    {
+        const uint8_t *i2r = okm;
+        const uint8_t *r2i = okm + SECURE_KEY_SIZE + SECURE_IV_SIZE;
+        const uint8_t *tx = (role == ESecureRole::Initiator) ? i2r : r2i;
+        const uint8_t *rx = (role == ESecureRole::Initiator) ? r2i : i2r;
+        if ((0 == mbedtls_gcm_setkey(&mTx, MBEDTLS_CIPHER_ID_AES, tx, SECURE_KEY_SIZE * 8)) &&
+            (0 == mbedtls_gcm_setkey(&mRx, MBEDTLS_CIPHER_ID_AES, rx, SECURE_KEY_SIZE * 8)))
+        {
+            std::memcpy(mTxIv, tx + SECURE_KEY_SIZE, SECURE_IV_SIZE);
+            std::memcpy(mRxIv, rx + SECURE_KEY_SIZE, SECURE_IV_SIZE);
+            mTxSeq = 0;
+            mRxTop = 0;
+            mRxMask = 0;
+            mKeyed = true;
+            res = ESP_OK;
+        }
+    }
+    mbedtls_platform_zeroize(okm, sizeof(okm));
+    if (res != ESP_OK)
+        clear();
+    return res;
+}
+
+void CSecureChannel::nonce(const uint8_t *iv, uint64_t seq, uint8_t *out)
+{
+    std::memcpy(out, iv, SECURE_IV_SIZE);
+    for (size_t i = 0; i < 8; i++)
+        out[SECURE_IV_SIZE - 8 + i] ^= (uint8_t)(seq >> (8 * i));
+}
+
+size_t CSecureChannel::seal(uint8_t *buf, size_t len, size_t size)
+{
+    if (!mKeyed)
+    {
+        mStats.noKey++;
+        return 0;
+    }
+    if ((size < SECURE_OVERHEAD) || (len > size - SECURE_OVERHEAD) || (mTxSeq == UINT64_MAX))
+        return 0;
+    uint64_t seq = mTxSeq++;
+    for (size_t i = 0; i < SECURE_HEADER_SIZE; i++)
+        buf[i] = (uint8_t)(seq >> (8 * i));
+    uint8_t iv[SECURE_IV_SIZE];
+    nonce(mTxIv, seq, iv);
+    uint8_t *data = buf + SECURE_HEADER_SIZE;
+    if (0 != mbedtls_gcm_crypt_and_tag(&mTx, MBEDTLS_GCM_ENCRYPT, len, iv, sizeof(iv), buf, SECURE_HEADER_SIZE, data, data,
+                                       SECURE_TAG_SIZE, data + len))
+        return 0;
+    mStats.sealed++;
+    return len + SECURE_OVERHEAD;
+}
+
+bool CSecureChannel::open(uint8_t *buf, size_t &len)
+{
+    if (!mKeyed)
+    {
+        mStats.noKey++;
+        return false;
+    }
+    if (len < SECURE_OVERHEAD)
+    {
+        mStats.malformed++;
+        return false;
+    }
+    uint64_t seq = 0;
+    for (size_t i = 0; i < SECURE_HEADER_SIZE; i++)
+        seq |= (uint64_t)buf[i] << (8 * i);
+    // Повтор отсекается до расшифровки: подделка с чужим номером стоит только сравнения.
+    uint64_t age = mRxTop - seq;
+    if ((seq <= mRxTop) && ((age >= SECURE_REPLAY_WINDOW) || (mRxMask & ((uint64_t)1 << age))))
+    {
+        mStats.replayed++;
+        return false;
+    }
+    size_t plain = len - SECURE_OVERHEAD;
+    uint8_t iv[SECURE_IV_SIZE];
+    nonce(mRxIv, seq, iv);
+    uint8_t *data = buf + SECURE_HEADER_SIZE;
+    if (0 != mbedtls_gcm_auth_decrypt(&mRx, plain, iv, sizeof(iv), buf, SECURE_HEADER_SIZE, data + plain, SECURE_TAG_SIZE, data, data))
+    {
+        mStats.authFailed++;
+        return false;
+    }
+    if (seq > mRxTop)
+    {
+        uint64_t shift = seq - mRxTop;
+        mRxMask = (shift >= SECURE_REPLAY_WINDOW) ? 0 : (mRxMask << shift);
+        mRxTop = seq;
+        age = 0;
+    }
+    mRxMask |= (uint64_t)1 << age;
+    mStats.opened++;
+    len = plain;
+    return true;
+}
+
+CSecureKeyExchange::CSecureKeyExchange()
+{
+    mbedtls_ecdh_init(&mCtx);
+}
+
+CSecureKeyExchange::~CSecureKeyExchange()
+{
+    mbedtls_ecdh_free(&mCtx);
+}
+
+esp_err_t CSecureKeyExchange::begin(uint8_t *pub)
+{
+    mbedtls_ecdh_free(&mCtx);
+    mbedtls_ecdh_init(&mCtx);
+    mReady = false;
+    size_t olen = 0;
+    if ((0 != mbedtls_ecdh_setup(&mCtx, MBEDTLS_ECP_DP_CURVE25519)) ||
+        (0 != mbedtls_ecdh_make_public(&mCtx, &olen, mPublic, sizeof(mPublic), secure_rng, nullptr)) || (olen != SECURE_PUBLIC_SIZE))
+        return ESP_FAIL;
+    std::memcpy(pub, mPublic, SECURE_PUBLIC_SIZE);
+    mReady = true;
+    return ESP_OK;
+}
+
+esp_err_t CSecureKeyExchange::finish(const uint8_t *peer, ESecureRole role, const uint8_t *psk, size_t pskLen, uint8_t *secret)
+{
+    if (!mReady)
+        return ESP_ERR_INVALID_STATE;
+    if ((pskLen > SECURE_PSK_MAX) || ((psk == nullptr) && (pskLen != 0)))
+        return ESP_ERR_INVALID_ARG;
+    mReady = false;
+    esp_err_t res = ESP_ERR_INVALID_ARG;
+    uint8_t ikm[SECURE_SECRET_SIZE + SECURE_PSK_MAX];
+    size_t olen = 0;
+    if (0 == mbedtls_ecdh_read_public(&mCtx, peer, SECURE_PUBLIC_SIZE))
+    {
+        res = ESP_FAIL;
+        if ((0 == mbedtls_ecdh_calc_secret(&mCtx, &olen, ikm, SECURE_SECRET_SIZE, secure_rng, nullptr)) && (olen == SECURE_SECRET_SIZE))
+        {
+            if (pskLen != 0)
+                std::memcpy(ikm + SECURE_SECRET_SIZE, psk, pskLen);
+            // Соль - оба открытых ключа в порядке ролей: подмена любого меняет секрет.
+            uint8_t salt[2 * SECURE_PUBLIC_SIZE];
+            const bool first = (role == ESecureRole::Initiator);
+            std::memcpy(salt + (first ? 0 : SECURE_PUBLIC_SIZE), mPublic, SECURE_PUBLIC_SIZE);
+            std::memcpy(salt + (first ? SECURE_PUBLIC_SIZE : 0), peer, SECURE_PUBLIC_SIZE);
+            const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+            if ((md != nullptr) && (0 == mbedtls_hkdf_extract(md, salt, sizeof(salt), ikm, SECURE_SECRET_SIZE + pskLen, secret)))
+                res = ESP_OK;
+        }
+    }
+    mbedtls_platform_zeroize(ikm, sizeof(ikm));
+    mbedtls_ecdh_free(&mCtx);
+    mbedtls_ecdh_init(&mCtx);
+    return res;
+}
+#endif
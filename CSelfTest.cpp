@@ -0,0 +1,145 @@
+/*!
+    \file
+    \brief Протокол и замер самопроверки канала (пропускная способность, джиттер, потери).
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CSelfTest.h"
+
+#if CONFIG_WIFICHN_SELFTEST
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+size_t selfTestPackRequest(uint8_t *buf, const SSelfTestConfig &cfg)
+{
+    put32(buf, SELFTEST_MAGIC);
+    buf[4] = (uint8_t)cfg.mode;
+    buf[5] = 0;
+    put16(buf + 6, cfg.port);
+    put32(buf + 8, cfg.durationMs);
+    put32(buf + 12, cfg.rateKbps);
+    put16(buf + 16, cfg.block);
+    put16(buf + 18, 0);
+    return SELFTEST_REQUEST_SIZE;
+}
+
+size_t selfTestPackReport(uint8_t *buf, const SSelfTestReport &report)
+{
+    put32(buf, SELFTEST_MAGIC);
+    put32(buf + 4, (uint32_t)report.bytes);
+    put32(buf + 8, (uint32_t)(report.bytes >> 32));
+    put32(buf + 12, report.elapsedUs);
+    put32(buf + 16, report.packets);
+    put32(buf + 20, report.lost);
+    put32(buf + 24, report.reordered);
+    put32(buf + 28, report.jitterUs);
+    return SELFTEST_REPORT_SIZE;
+}
+
+bool selfTestParseReport(const uint8_t *buf, size_t len, SSelfTestReport &report)
+{
+    if ((len < SELFTEST_REPORT_SIZE) || (get32(buf) != SELFTEST_MAGIC))
+        return false;
+    report.bytes = (uint64_t)get32(buf + 4) | ((uint64_t)get32(buf + 8) << 32);
+    report.elapsedUs = get32(buf + 12);
+    report.packets = get32(buf + 16);
+    report.lost = get32(buf + 20);
+    report.reordered = get32(buf + 24);
+    report.jitterUs = get32(buf + 28);
+    return true;
+}
+
+void selfTestStamp(uint8_t *buf, uint32_t seq, uint32_t ts)
+{
+    put32(buf, seq);
+    put32(buf + 4, ts);
+}
+
+void CSelfTestMeter::account(size_t len, uint32_t now)
+{
+    if (!mStarted)
+    {
+        mStarted = true;
+        mFirst = now;
+    }
+    mLast = now;
+    mBytes += len;
+}
+
+bool CSelfTestMeter::onDatagram(const uint8_t *data, size_t len, uint32_t now)
+{
+    if (len < SELFTEST_HEADER_SIZE)
+        return false;
+    uint32_t seq = get32(data);
+    uint32_t transit = now - get32(data + 4); // часы отправителя и получателя не сверены: важна только разность
+    if (mPackets != 0)
+    {
+        int32_t d = (int32_t)(transit - mTransit);
+        uint32_t ad = (d < 0) ? (uint32_t)(-(int64_t)d) : (uint32_t)d;
+        mJitter16 = mJitter16 + ad - ((mJitter16 + 8) >> 4);
+    }
+    mTransit = transit;
+    if ((mPackets == 0) || ((int32_t)(seq - mNext) >= 0))
+        mNext = seq + 1;
+    else
+        mReordered++;
+    mPackets++;
+    account(len, now);
+    return true;
+}
+
+SSelfTestReport CSelfTestMeter::report(uint32_t sent)
+{
+    SSelfTestReport res = {};
+    res.bytes = mBytes;
+    res.elapsedUs = mStarted ? (mLast - mFirst) : 0;
+    res.packets = mPackets;
+    uint32_t expected = (sent != 0) ? sent : mNext;
+    res.lost = (expected > mPackets) ? (expected - mPackets) : 0;
+    res.reordered = mReordered;
+    res.jitterUs = mJitter16 >> 4;
+    return res;
+}
+
+CSelfTestPacer::CSelfTestPacer(uint32_t rateKbps, uint16_t block, uint32_t slack)
+    : mInterval((rateKbps == 0) ? 0 : (uint32_t)((uint64_t)block * 8000 / rateKbps)), mSlack(slack)
+{
+}
+
+uint32_t CSelfTestPacer::wait(uint32_t now)
+{
+    if (!mStarted)
+    {
+        mStarted = true;
+        mNext = now;
+    }
+    int32_t ahead = (int32_t)(mNext - now);
+    if (ahead > 0)
+        return (uint32_t)ahead;
+    // После задержки стека пачкой догоняется не больше mSlack: средний темп не превышается.
+    if ((uint32_t)(-ahead) > mSlack)
+        mNext = now - mSlack;
+    return 0;
+}
+
+void CSelfTestPacer::sent()
+{
+    mNext += mInterval;
+}
+#endif
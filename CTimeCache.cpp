@@ -0,0 +1,109 @@
+/*!
+    \file
+    \brief Кэш последнего достоверного времени (RTC + NVS).
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CTimeCache.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_rtc_time.h"
+#include "nvs.h"
+#include "CDateTimeSystem.h"
+#include <sys/time.h>
+
+static const char *TAG = "tcache";
+static const char *NVS_NAMESPACE = "wifi_chn";
+static const char *NVS_KEY = "time";
+
+#define TIMECACHE_MAGIC (0x54494d45) ///< Признак валидности RTC-кэша.
+
+/// Кэш времени в RTC-памяти (переживает перезагрузку и deep sleep, но не пропадание питания).
+struct STimeCacheRtc
+{
+    uint32_t magic;   ///< TIMECACHE_MAGIC, если запись валидна.
+    int64_t epoch_us; ///< Время синхронизации, мкс от 1970.
+    uint64_t rtc_us;  ///< Показание RTC-часов в момент синхронизации, мкс.
+};
+
+static RTC_NOINIT_ATTR STimeCacheRtc sRtcCache;
+
+ETimeSource CTimeCache::mSource = ETimeSource::None;
+
+bool CTimeCache::restore()
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (tv.tv_sec >= TIMECACHE_MIN_EPOCH)
+    {
+        // Системное время ведётся от RTC и пережило deep sleep / программный сброс.
+        if (mSource == ETimeSource::None)
+            mSource = ETimeSource::System;
+        return mSource != ETimeSource::Nvs;
+    }
+
+    int64_t us = 0;
+    ETimeSource src = ETimeSource::Rtc;
+    uint64_t rtc = esp_rtc_get_time_us();
+    if ((sRtcCache.magic == TIMECACHE_MAGIC) && (rtc >= sRtcCache.rtc_us))
+    {
+        us = sRtcCache.epoch_us + (int64_t)(rtc - sRtcCache.rtc_us);
+    }
+    else
+    {
+        // RTC сброшен (пропадало питание): берём нижнюю границу из NVS - лучше, чем 1970,
+        // но для проверки сертификатов нужна синхронизация.
+        src = ETimeSource::Nvs;
+        nvs_handle_t h;
+        if (ESP_OK == nvs_open(NVS_NAMESPACE, NVS_READONLY, &h))
+        {
+            int64_t sec = 0;
+            if (ESP_OK == nvs_get_i64(h, NVS_KEY, &sec))
+                us = sec * 1000000LL;
+            nvs_close(h);
+        }
+    }
+    if (us < (int64_t)TIMECACHE_MIN_EPOCH * 1000000LL)
+        return false;
+
+    tv.tv_sec = us / 1000000LL;
+    tv.tv_usec = us % 1000000LL;
+    settimeofday(&tv, nullptr);
+    mSource = src;
+    ESP_LOGI(TAG, "time restored from %s: %lld", (src == ETimeSource::Rtc) ? "RTC" : "NVS", (long long)tv.tv_sec);
+    return src == ETimeSource::Rtc;
+}
+
+void CTimeCache::save()
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (tv.tv_sec < TIMECACHE_MIN_EPOCH)
+        return;
+
+    sRtcCache.epoch_us = (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+    sRtcCache.rtc_us = esp_rtc_get_time_us();
+    sRtcCache.magic = TIMECACHE_MAGIC;
+
+    nvs_handle_t h;
+    if (ESP_OK == nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h))
+    {
+        int64_t sec = 0;
+        if ((ESP_OK != nvs_get_i64(h, NVS_KEY, &sec)) || (tv.tv_sec - sec >= TIMECACHE_NVS_STEP) || (tv.tv_sec < sec))
+        {
+            nvs_set_i64(h, NVS_KEY, tv.tv_sec);
+            nvs_commit(h);
+        }
+        nvs_close(h);
+    }
+    mSource = ETimeSource::Sync;
+}
+
+bool CTimeCache::isValid()
+{
+    if (CDateTimeSystem::isSync())
+        return true;
+    return (mSource != ETimeSource::Nvs) && (time(nullptr) >= TIMECACHE_MIN_EPOCH);
+}
@@ -0,0 +1,136 @@
+/*!
+    \file
+    \brief Шкала времени: интервалы фаз WiFi/OTA в кольцевом буфере с выгрузкой в Chrome trace.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CTimeline.h"
+
+#if CONFIG_WIFICHN_TIMELINE
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include <cstdio>
+#include <cinttypes>
+
+CTimeline::SSlot CTimeline::mRing[CONFIG_WIFICHN_TIMELINE_SIZE];
+std::atomic<uint32_t> CTimeline::mHead{0};
+std::atomic<bool> CTimeline::mEnabled{true};
+
+void CTimeline::record(ETimelinePhase phase, const char *name, int32_t arg)
+{
+    if (!mEnabled.load(std::memory_order_relaxed))
+        return;
+    uint32_t n = mHead.fetch_add(1, std::memory_order_relaxed);
+    SSlot &slot = mRing[n % CONFIG_WIFICHN_TIMELINE_SIZE];
+    // Слот помечается занятым до записи: выгрузка не примет смесь старой и новой записи.
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.ev.ts = esp_timer_get_time();
+    slot.ev.name = name;
+    slot.ev.task = (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+    slot.ev.arg = arg;
+    slot.ev.phase = phase;
+    slot.ev.core = (uint8_t)xPortGetCoreID();
+    slot.seq.store(n + 1, std::memory_order_release);
+}
+
+void CTimeline::clear()
+{
+    bool on = mEnabled.exchange(false);
+    for (auto &slot : mRing)
+        slot.seq.store(0, std::memory_order_relaxed);
+    mHead.store(0);
+    mEnabled.store(on);
+}
+
+size_t CTimeline::count()
+{
+    uint32_t head = mHead.load();
+    return (head < CONFIG_WIFICHN_TIMELINE_SIZE) ? head : CONFIG_WIFICHN_TIMELINE_SIZE;
+}
+
+uint32_t CTimeline::lost()
+{
+    uint32_t head = mHead.load();
+    return (head > CONFIG_WIFICHN_TIMELINE_SIZE) ? (head - CONFIG_WIFICHN_TIMELINE_SIZE) : 0;
+}
+
+/// Прочитать запись n, если её слот не перезаписан.
+static bool read_slot(const std::atomic<uint32_t> &seq, const STimelineEvent &src, uint32_t n, STimelineEvent &ev)
+{
+    if (seq.load(std::memory_order_acquire) != n + 1)
+        return false;
+    ev = src;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq.load(std::memory_order_relaxed) == n + 1;
+}
+
+size_t CTimeline::snapshot(STimelineEvent *out, size_t max)
+{
+    uint32_t head = mHead.load(std::memory_order_acquire);
+    uint32_t first = (head > CONFIG_WIFICHN_TIMELINE_SIZE) ? (head - CONFIG_WIFICHN_TIMELINE_SIZE) : 0;
+    size_t res = 0;
+    for (uint32_t n = first; (n != head) && (res < max); n++)
+    {
+        const SSlot &slot = mRing[n % CONFIG_WIFICHN_TIMELINE_SIZE];
+        if (read_slot(slot.seq, slot.ev, n, out[res]))
+            res++;
+    }
+    return res;
+}
+
+size_t CTimeline::exportJson(TWrite write)
+{
+    static const char head[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    static const char tail[] = "]}\n";
+    write(head, sizeof(head) - 1);
+
+    uint32_t top = mHead.load(std::memory_order_acquire);
+    uint32_t first = (top > CONFIG_WIFICHN_TIMELINE_SIZE) ? (top - CONFIG_WIFICHN_TIMELINE_SIZE) : 0;
+    size_t res = 0;
+    char line[192];
+    for (uint32_t n = first; n != top; n++)
+    {
+        const SSlot &slot = mRing[n % CONFIG_WIFICHN_TIMELINE_SIZE];
+        STimelineEvent ev;
+        if (!read_slot(slot.seq, slot.ev, n, ev))
+            continue;
+        // Имена - константы кода без кавычек и '\', экранирование не нужно.
+        int len = snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"cat\":\"wifichn\",\"ph\":\"%c\",\"ts\":%" PRId64 ",\"pid\":1,\"tid\":%" PRIu32,
+                           (res == 0) ? "" : ",\n", ev.name, (char)ev.phase, ev.ts, ev.task);
+        switch (ev.phase)
+        {
+        case ETimelinePhase::AsyncBegin:
+        case ETimelinePhase::AsyncEnd:
+            len += snprintf(line + len, sizeof(line) - len, ",\"id\":%" PRId32 ",\"args\":{\"core\":%u}}", ev.arg, ev.core);
+            break;
+        case ETimelinePhase::Instant:
+            len += snprintf(line + len, sizeof(line) - len, ",\"s\":\"t\",\"args\":{\"core\":%u,\"v\":%" PRId32 "}}", ev.core, ev.arg);
+            break;
+        default:
+            len += snprintf(line + len, sizeof(line) - len, ",\"args\":{\"core\":%u}}", ev.core);
+            break;
+        }
+        if (len >= (int)sizeof(line))
+            continue; // слишком длинное имя
+        write(line, len);
+        res++;
+    }
+    write(tail, sizeof(tail) - 1);
+    return res;
+}
+
+bool CTimeline::save(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f == nullptr)
+        return false;
+    bool ok = true;
+    exportJson([f, &ok](const char *data, size_t len)
+               { ok = ok && (fwrite(data, 1, len, f) == len); });
+    return (fclose(f) == 0) && ok;
+}
+#endif
@@ -0,0 +1,40 @@
+/*!
+    \file
+    \brief Замер установки TLS соединения esp_http_client: время и память.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CTlsStats.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "CTimeline.h"
+
+void CTlsStats::begin()
+{
+    if (mDone)
+        return;
+    mFreeBefore = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    mMinBefore = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    mStart = esp_timer_get_time();
+}
+
+esp_err_t CTlsStats::handler(esp_http_client_event_t *evt)
+{
+    CTlsStats *st = (CTlsStats *)evt->user_data;
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED)
+        TIMELINE_INSTANT("tls.connected", 0);
+    if ((evt->event_id != HTTP_EVENT_ON_CONNECTED) || (st == nullptr) || (st->mStart == 0))
+        return ESP_OK;
+    st->mHandshake = esp_timer_get_time() - st->mStart;
+    size_t free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t min = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    st->mRetained = (st->mFreeBefore > free) ? (st->mFreeBefore - free) : 0;
+    // Минимум свободной памяти общий с начала работы: пик виден, только если рукопожатие
+    // опустило его ниже прежнего значения, иначе оценка снизу - занятое после рукопожатия.
+    st->mPeak = ((min < st->mMinBefore) && (st->mFreeBefore > min)) ? (st->mFreeBefore - min) : st->mRetained;
+    st->mStart = 0;
+    st->mDone = true;
+    return ESP_OK;
+}
@@ -0,0 +1,159 @@
+/*!
+    \file
+    \brief Классы трафика (DSCP/WMM) и планировщик отправки со строгим приоритетом.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CTrafficScheduler.h"
+
+#if CONFIG_WIFICHN_QOS
+#include <cstring>
+
+CTrafficScheduler::CTrafficScheduler(TSend send, uint16_t depth, size_t mtu, uint32_t holdoff, uint32_t caps)
+    : mSend(send), mPool(mtu, (uint16_t)(depth * TRAFFIC_CLASSES), caps), mDepth(depth), mHoldoff(holdoff)
+{
+    if (depth == 0)
+        return;
+    mRings = (SPacket *)heap_caps_malloc(sizeof(SPacket) * depth * TRAFFIC_CLASSES, caps);
+    if (mRings == nullptr)
+        return;
+    for (uint8_t c = 0; c < TRAFFIC_CLASSES; c++)
+        mQueue[c].ring = mRings + c * depth;
+}
+
+CTrafficScheduler::~CTrafficScheduler()
+{
+    heap_caps_free(mRings);
+}
+
+void CTrafficScheduler::account(SQueue &q, uint32_t delay)
+{
+    q.stats.sent++;
+    q.delaySum += delay;
+    if (delay > q.stats.delayMax)
+        q.stats.delayMax = delay;
+}
+
+bool CTrafficScheduler::pending(ETrafficClass cls)
+{
+    for (uint8_t c = (uint8_t)cls; c < TRAFFIC_CLASSES; c++)
+    {
+        if (mQueue[c].count != 0)
+            return true;
+    }
+    return false;
+}
+
+bool CTrafficScheduler::busy(ETrafficClass cls, uint32_t now)
+{
+    for (uint8_t c = (uint8_t)cls + 1; c < TRAFFIC_CLASSES; c++)
+    {
+        const SQueue &q = mQueue[c];
+        if (q.count != 0)
+            return true;
+        // Классы реального времени держат эфир ещё holdoff после своего пакета.
+        if ((c >= (uint8_t)ETrafficClass::Video) && (cls < ETrafficClass::Video) && q.active && (now - q.lastAt < mHoldoff))
+            return true;
+    }
+    return false;
+}
+
+bool CTrafficScheduler::send(ETrafficClass cls, void *ctx, uint32_t ip, uint16_t port, const uint8_t *data, size_t len, uint32_t now)
+{
+    SQueue &q = mQueue[(uint8_t)cls];
+    if (!isValid() || (len > mPool.blockSize()))
+    {
+        q.stats.dropped++;
+        return false;
+    }
+    // Ранее поставленные пакеты этого класса и выше уходят первыми.
+    pump(now, cls);
+    q.lastAt = now;
+    q.active = true;
+    if (!pending(cls) && !busy(cls, now) && mSend(cls, ctx, ip, port, data, len))
+    {
+        q.stats.direct++;
+        account(q, 0);
+        return true;
+    }
+
+    uint8_t *buf = (q.count < mDepth) ? mPool.alloc() : nullptr;
+    if (buf == nullptr)
+    {
+        q.stats.dropped++;
+        return false;
+    }
+    std::memcpy(buf, data, len);
+    SPacket &p = q.ring[(q.head + q.count) % mDepth];
+    p = {buf, ctx, ip, port, (uint16_t)len, now};
+    q.count++;
+    q.stats.queued++;
+    if (q.count > q.stats.depthMax)
+        q.stats.depthMax = q.count;
+    return true;
+}
+
+uint32_t CTrafficScheduler::pump(uint32_t now, ETrafficClass min)
+{
+    uint32_t res = 0;
+    for (int c = TRAFFIC_CLASSES - 1; c >= (int)min; c--)
+    {
+        SQueue &q = mQueue[c];
+        // Очередь выше не пуста или идёт обмен реального времени - этот класс и все ниже ждут.
+        if ((q.count != 0) && busy((ETrafficClass)c, now))
+            return res;
+        while (q.count != 0)
+        {
+            SPacket &p = q.ring[q.head];
+            if (!mSend((ETrafficClass)c, p.ctx, p.ip, p.port, p.buf, p.len))
+                return res; // стек занят - очередь сохраняется
+            account(q, now - p.at);
+            mPool.free(p.buf);
+            q.head = (q.head + 1) % mDepth;
+            q.count--;
+            res++;
+        }
+    }
+    return res;
+}
+
+void CTrafficScheduler::cancel(void *ctx)
+{
+    for (auto &q : mQueue)
+    {
+        uint16_t keep = 0;
+        for (uint16_t i = 0; i < q.count; i++)
+        {
+            SPacket &p = q.ring[(q.head + i) % mDepth];
+            if (p.ctx == ctx)
+            {
+                mPool.free(p.buf);
+                q.stats.dropped++;
+            }
+            else
+                q.ring[(q.head + keep++) % mDepth] = p;
+        }
+        q.count = keep;
+    }
+}
+
+uint16_t CTrafficScheduler::backlog()
+{
+    uint16_t res = 0;
+    for (auto &q : mQueue)
+        res += q.count;
+    return res;
+}
+
+STrafficStats CTrafficScheduler::stats(ETrafficClass cls)
+{
+    const SQueue &q = mQueue[(uint8_t)cls];
+    STrafficStats res = q.stats;
+    res.depth = q.count;
+    if (res.sent != 0)
+        res.delayAvg = (uint32_t)(q.delaySum / res.sent);
+    return res;
+}
+#endif
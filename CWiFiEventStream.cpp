@@ -0,0 +1,110 @@
+/*!
+    \file
+    \brief Кольцевой буфер событий WiFi и OTA для пакетного чтения.
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CWiFiEventStream.h"
+#include "esp_timer.h"
+
+CWiFiEventStream::CWiFiEventStream()
+{
+    mEvents = xEventGroupCreate();
+}
+
+CWiFiEventStream::~CWiFiEventStream()
+{
+    vEventGroupDelete(mEvents);
+}
+
+/// Запись хода операции, которую заменяет следующая такая же.
+static bool is_progress(uint8_t type, int16_t code)
+{
+    return (type == (uint8_t)EWiFiEvent::OtaProgress) || ((type == (uint8_t)EWiFiEvent::OtaStatus) && (code == OTA_STATUS_SYNC_TIME));
+}
+
+void CWiFiEventStream::push(EWiFiEvent type, int16_t code, uint32_t bytes, uint32_t rate)
+{
+    uint32_t time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    bool batch;
+    portENTER_CRITICAL(&mMux);
+    size_t last = (mHead + CONFIG_WIFICHN_EVENT_STREAM_SIZE - 1) % CONFIG_WIFICHN_EVENT_STREAM_SIZE;
+    bool merge = (mCount > 0) && (mRing[last].type == (uint8_t)type) && is_progress((uint8_t)type, code) &&
+                 is_progress(mRing[last].type, mRing[last].code);
+    SWiFiEventRecord &rec = merge ? mRing[last] : mRing[mHead];
+    rec.time_ms = time_ms;
+    rec.type = (uint8_t)type;
+    rec.code = code;
+    rec.bytes = bytes;
+    rec.rate = rate;
+    if (!merge)
+    {
+        rec.seq = (uint8_t)mSeq++;
+        mHead = (mHead + 1) % CONFIG_WIFICHN_EVENT_STREAM_SIZE;
+        if (mCount < CONFIG_WIFICHN_EVENT_STREAM_SIZE)
+            mCount++;
+        else
+            mDropped++;
+    }
+    batch = (mCount >= mThreshold);
+    portEXIT_CRITICAL(&mMux);
+
+    // Потребитель будится один раз на пачку, а не на каждую запись.
+    if (batch)
+        xEventGroupSetBits(mEvents, BATCH_BIT);
+}
+
+size_t CWiFiEventStream::read(SWiFiEventRecord *buf, size_t max)
+{
+    portENTER_CRITICAL(&mMux);
+    size_t n = (mCount < max) ? mCount : max;
+    size_t tail = (mHead + CONFIG_WIFICHN_EVENT_STREAM_SIZE - mCount) % CONFIG_WIFICHN_EVENT_STREAM_SIZE;
+    for (size_t i = 0; i < n; i++)
+    {
+        buf[i] = mRing[tail];
+        tail = (tail + 1) % CONFIG_WIFICHN_EVENT_STREAM_SIZE;
+    }
+    mCount -= n;
+    bool pending = (mCount >= mThreshold);
+    portEXIT_CRITICAL(&mMux);
+    // Бит сбрасывается, только если непрочитанных записей меньше порога: иначе
+    // waitBatch() другого потребителя не увидел бы оставшуюся пачку.
+    if (!pending)
+    {
+        xEventGroupClearBits(mEvents, BATCH_BIT);
+        // push() между проверкой и сбросом бита: пробуждение не теряется.
+        portENTER_CRITICAL(&mMux);
+        pending = (mCount >= mThreshold);
+        portEXIT_CRITICAL(&mMux);
+        if (pending)
+            xEventGroupSetBits(mEvents, BATCH_BIT);
+    }
+    return n;
+}
+
+bool CWiFiEventStream::waitBatch(size_t count, TickType_t xTicksToWait)
+{
+    if (count == 0)
+        count = 1;
+    if (count > CONFIG_WIFICHN_EVENT_STREAM_SIZE)
+        count = CONFIG_WIFICHN_EVENT_STREAM_SIZE;
+    xEventGroupClearBits(mEvents, BATCH_BIT);
+    portENTER_CRITICAL(&mMux);
+    mThreshold = count;
+    bool ready = (mCount >= count);
+    portEXIT_CRITICAL(&mMux);
+    if (ready)
+        return true;
+    xEventGroupWaitBits(mEvents, BATCH_BIT, pdTRUE, pdTRUE, xTicksToWait);
+    return available() >= count;
+}
+
+size_t CWiFiEventStream::available()
+{
+    portENTER_CRITICAL(&mMux);
+    size_t n = mCount;
+    portEXIT_CRITICAL(&mMux);
+    return n;
+}
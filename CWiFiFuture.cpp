@@ -0,0 +1,48 @@
+/*!
+    \file
+    \brief Результат асинхронной операции WiFiStation (подключение, сканирование, OTA).
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CWiFiFuture.h"
+
+bool CWiFiPromise::complete(int32_t result)
+{
+    // Завершает первый вызов (например, подключение раньше таймаута), результат
+    // пишется до публикации mDone.
+    bool expected = false;
+    if (!mClaimed.compare_exchange_strong(expected, true))
+        return false;
+    mResult = result;
+    mDone.store(true, std::memory_order_release);
+
+    TaskHandle_t waiter = mWaiter.exchange(nullptr);
+    if (waiter != nullptr)
+        xTaskNotifyGiveIndexed(waiter, CONFIG_WIFICHN_NOTIFY_INDEX);
+    return true;
+}
+
+bool CWiFiPromise::wait(TickType_t xTicksToWait)
+{
+    if (isDone())
+        return true;
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    mWaiter.store(self);
+    TickType_t start = xTaskGetTickCount();
+    // Уведомление, оставшееся от операции, ожидание которой ранее ушло в таймаут,
+    // даёт ложное пробуждение - поэтому проверяем isDone() и ждём остаток времени.
+    while (!isDone())
+    {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if ((xTicksToWait != portMAX_DELAY) && (elapsed >= xTicksToWait))
+            break;
+        ulTaskNotifyTakeIndexed(CONFIG_WIFICHN_NOTIFY_INDEX, pdTRUE, (xTicksToWait == portMAX_DELAY) ? portMAX_DELAY : (xTicksToWait - elapsed));
+    }
+
+    TaskHandle_t expected = self;
+    mWaiter.compare_exchange_strong(expected, nullptr);
+    return isDone();
+}
@@ -9,12 +9,33 @@
 #include "WiFiStation.h"
 #include "esp_log.h"
 #include "CTrace.h"
-#include "esp_netif_sntp.h"
+#include "CTimeline.h"
 #include "esp_sntp.h"
 #include "CDateTimeSystem.h"
+#include "CTimeCache.h"
+#if CONFIG_WIFICHN_FAST_CONNECT
+#include "esp_sleep.h"
+#endif
 #ifdef CONFIG_WIFICHN_OTA
 #include "tasks/COTATask.h"
 #endif
+#if (CONFIG_WIFICHN_SYNC_TIME == 1)
+#include "tasks/CTimeSyncTask.h"
+#endif
+#if CONFIG_WIFICHN_APSTA
+#include "tasks/CProvisionTask.h"
+#endif
+#if CONFIG_WIFICHN_MCAST
+#include "tasks/CMulticastTask.h"
+#endif
+#if CONFIG_WIFICHN_QOS
+#include "tasks/CTrafficTask.h"
+#endif
+#if CONFIG_WIFICHN_SELFTEST
+#include "tasks/CSelfTestTask.h"
+#endif
+#include "tasks/task_settings.h"
+#include <iterator>
 
 static const char *TAG = "wifi";
 
@@ -186,91 +207,329 @@ static const char *TAG = "wifi";
 // }
 // // ===== КОНЕЦ ВРЕМЕННОЙ ОТЛАДКИ =====
 
-WiFiStation *WiFiStation::theSingleInstance = nullptr;
+std::atomic<WiFiStation *> WiFiStation::theSingleInstance{nullptr};
+std::mutex WiFiStation::mInstanceMutex;
 
 WiFiStation::WiFiStation()
 {
     std::memset(&m_wifi_config, 0, sizeof(m_wifi_config));
     m_wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    mEvents = xEventGroupCreate();
+    xEventGroupSetBits(mEvents, DISCONNECTED_BIT | IDLE_BIT);
+    const esp_timer_create_args_t args = {
+        .callback = connect_timeout_cb, .arg = this, .dispatch_method = ESP_TIMER_TASK, .name = "wifi_cto", .skip_unhandled_events = true};
+    esp_timer_create(&args, &mConnectTimer);
+#if CONFIG_WIFICHN_QOS
+    mQos = new CTrafficTask();
+#endif
 }
 
 WiFiStation::~WiFiStation()
 {
     stop();
+#if CONFIG_WIFICHN_MCAST
+    stopMulticast();
+#endif
+#if CONFIG_WIFICHN_SELFTEST
+    stopSelfTest();
+#endif
+#if CONFIG_WIFICHN_QOS
+    delete mQos; // после каналов: они удаляют свои пакеты из очередей
+#endif
+    esp_timer_stop(mConnectTimer);
+    esp_timer_delete(mConnectTimer);
+    vEventGroupDelete(mEvents);
 }
 
-void WiFiStation::event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+void WiFiStation::setState(EWiFiState state)
 {
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START)
+    mState.store(state);
+    if (state == EWiFiState::Idle)
+        xEventGroupSetBits(mEvents, IDLE_BIT);
+    else
+        xEventGroupClearBits(mEvents, IDLE_BIT);
+}
+
+std::shared_ptr<CWiFiPromise> WiFiStation::claimPromise(std::shared_ptr<CWiFiPromise> &slot, bool &created)
+{
+    std::lock_guard<std::mutex> lock(mAsyncMutex);
+    created = (slot == nullptr);
+    if (created)
+        slot = std::make_shared<CWiFiPromise>();
+    return slot;
+}
+
+void WiFiStation::completePromise(std::shared_ptr<CWiFiPromise> &slot, int32_t result)
+{
+    std::shared_ptr<CWiFiPromise> promise;
     {
-        // Не вызываем esp_wifi_connect(), если идёт остановка
-        if (!WiFiStation::Instance()->mStopping)
-            esp_wifi_connect();
+        std::lock_guard<std::mutex> lock(mAsyncMutex);
+        promise.swap(slot);
     }
-    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE)
+    if (promise != nullptr)
+        promise->complete(result);
+}
+
+void WiFiStation::connect_timeout_cb(void *arg)
+{
+    WiFiStation *self = (WiFiStation *)arg;
+    // Таймаут завершает только то подключение, для которого взведён: прежнее могло
+    // завершиться по IP_EVENT_STA_GOT_IP, а слот уже занять следующее.
+    std::shared_ptr<CWiFiPromise> promise;
     {
-        uint16_t ap_count = 0;
-        wifi_ap_record_t *ap_list = nullptr;
-        ESP_ERROR_CHECK(esp_wifi_scan_get_ap_num(&ap_count)); // Get number of APs found
+        std::lock_guard<std::mutex> lock(self->mAsyncMutex);
+        if ((self->mConnectArmed == self->mConnectGen) && (esp_timer_get_time() >= self->mConnectDeadline))
+            promise.swap(self->mConnectPromise);
+    }
+    if (promise != nullptr)
+        promise->complete(ESP_ERR_TIMEOUT);
+}
 
-        if (ap_count > 0)
+CWiFiFuture WiFiStation::connectAsync(TickType_t timeout, const char *ssid, const char *password)
+{
+    bool created;
+    std::shared_ptr<CWiFiPromise> promise = claimPromise(mConnectPromise, created);
+    if (!created)
+        return CWiFiFuture(promise); // подключение уже ожидается
+
+    // Таймаут взводится до start(): подключение может завершиться раньше, чем start() вернётся.
+    // Срок отсекает срабатывание прежнего таймаута, уже ждущего mAsyncMutex.
+    esp_timer_stop(mConnectTimer);
+    {
+        std::lock_guard<std::mutex> lock(mAsyncMutex);
+        mConnectGen++;
+        if (timeout != portMAX_DELAY)
         {
+            mConnectArmed = mConnectGen;
+            mConnectDeadline = esp_timer_get_time() + (int64_t)timeout * portTICK_PERIOD_MS * 1000;
+        }
+    }
+    if (timeout != portMAX_DELAY)
+        esp_timer_start_once(mConnectTimer, (uint64_t)timeout * portTICK_PERIOD_MS * 1000);
+
+    // Слот занят до проверки состояния: IP_EVENT_STA_GOT_IP после проверки завершит операцию сам.
+    EWiFiState st = mState.load();
+    if (st == EWiFiState::Idle)
+    {
+        start(mConnectCallback, mEventCallback, ssid, password);
+        st = mState.load();
+    }
+    if (st == EWiFiState::Connected)
+        completePromise(mConnectPromise, ESP_OK);
+    else if (st != EWiFiState::Connecting)
+        completePromise(mConnectPromise, ESP_ERR_INVALID_STATE);
+    return CWiFiFuture(promise);
+}
+
+#if CONFIG_WIFICHN_SCAN
+CWiFiFuture WiFiStation::scanAsync()
+{
+    bool created;
+    std::shared_ptr<CWiFiPromise> promise = claimPromise(mScanPromise, created);
+    if (created && !startScan(mWiFiScanCallback))
+        completePromise(mScanPromise, -1);
+    return CWiFiFuture(promise);
+}
+
+size_t WiFiStation::getScanResults(std::vector<wifi_ap_record_t> &list)
+{
+    std::lock_guard<std::mutex> lock(mAsyncMutex);
+    list = mScanResults;
+    return list.size();
+}
+
+void WiFiStation::on_scan_done(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    WiFiStation *self = (WiFiStation *)arg;
+    TIMELINE_ASYNC_END("scan", 0);
+    uint16_t ap_count = 0;
+    wifi_ap_record_t *ap_list = nullptr;
+    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_num(&ap_count)); // Get number of APs found
+
+    if (ap_count > 0)
+    {
 #ifdef CONFIG_SPIRAM
-            ap_list = (wifi_ap_record_t *)heap_caps_malloc(sizeof(wifi_ap_record_t) * ap_count, MALLOC_CAP_SPIRAM);
+        ap_list = (wifi_ap_record_t *)heap_caps_malloc(sizeof(wifi_ap_record_t) * ap_count, MALLOC_CAP_SPIRAM);
 #else
-            ap_list = (wifi_ap_record_t *)heap_caps_malloc(sizeof(wifi_ap_record_t) * ap_count, MALLOC_CAP_DEFAULT);
-#endif                                                                         // CONFIG_SPIRAM
-            ESP_ERROR_CHECK(esp_wifi_scan_get_ap_records(&ap_count, ap_list)); // Get AP records
-        }
-        if (WiFiStation::Instance()->mWiFiScanCallback != nullptr)
-            WiFiStation::Instance()->mWiFiScanCallback(ap_list, ap_count);
+        ap_list = (wifi_ap_record_t *)heap_caps_malloc(sizeof(wifi_ap_record_t) * ap_count, MALLOC_CAP_DEFAULT);
+#endif                                                                     // CONFIG_SPIRAM
+        ESP_ERROR_CHECK(esp_wifi_scan_get_ap_records(&ap_count, ap_list)); // Get AP records
+    }
+    {
+        std::lock_guard<std::mutex> lock(self->mAsyncMutex);
         if (ap_list != nullptr)
-            heap_caps_free(ap_list);
+            self->mScanResults.assign(ap_list, ap_list + ap_count);
+        else
+            self->mScanResults.clear();
     }
-    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
+    if (self->mWiFiScanCallback != nullptr)
+        self->mWiFiScanCallback(ap_list, ap_count);
+    if (ap_list != nullptr)
+        heap_caps_free(ap_list);
+    xEventGroupSetBits(self->mEvents, SCAN_DONE_BIT);
+    self->completePromise(self->mScanPromise, ap_count);
+}
+#endif
+
+void WiFiStation::subscribe(const SEventRoute *routes, size_t count)
+{
+    mRoutes = routes;
+    mRouteCount = count;
+    for (size_t i = 0; i < count; i++)
+        ESP_ERROR_CHECK(esp_event_handler_instance_register(*routes[i].base, routes[i].id, routes[i].handler, this, &mHandlers[i]));
+}
+
+void WiFiStation::unsubscribe()
+{
+    for (size_t i = 0; i < mRouteCount; i++)
     {
-        if (WiFiStation::Instance()->mSrcIP != 0)
-        {
-            WiFiStation::Instance()->mSrcIP = 0;
-            if (WiFiStation::Instance()->mConnectCallback != nullptr)
-                WiFiStation::Instance()->mConnectCallback(nullptr);
-        }
-        else if (WiFiStation::Instance()->mConnecting && !WiFiStation::Instance()->mStopping)
-        {
-            esp_wifi_connect();
-            if (WiFiStation::Instance()->mEventCallback != nullptr)
-                WiFiStation::Instance()->mEventCallback(event_id, "connecting was failed");
-            else
-                ESP_LOGW(TAG, "connecting was failed");
-        }
+        esp_event_handler_instance_unregister(*mRoutes[i].base, mRoutes[i].id, mHandlers[i]);
+        mHandlers[i] = nullptr;
     }
-    else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
+    mRouteCount = 0;
+}
+
+void WiFiStation::on_sta_start(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    WiFiStation *self = (WiFiStation *)arg;
+    // Не вызываем esp_wifi_connect(), если идёт остановка
+    if (self->mState.load() != EWiFiState::Stopping)
     {
-        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-        // ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
-        WiFiStation::Instance()->mSrcIP = event->ip_info.ip.addr;
-#if (CONFIG_WIFICHN_SYNC_TIME == 1)
-#if (CONFIG_LWIP_DHCP_GET_NTP_SRV == 1)
-        esp_netif_sntp_start();
-#else
-        WiFiStation::Instance()->syncTime();
+        TIMELINE_ASYNC_BEGIN("assoc", 0); // поиск точки доступа драйвером, аутентификация и ассоциация
+        esp_wifi_connect();
+    }
+}
+
+#if CONFIG_WIFICHN_FAST_CONNECT || CONFIG_WIFICHN_TIMELINE
+void WiFiStation::on_sta_connected(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    TIMELINE_ASYNC_END("assoc", 0);
+    TIMELINE_ASYNC_BEGIN("dhcp", 0);
+#if CONFIG_WIFICHN_FAST_CONNECT
+    WiFiStation *self = (WiFiStation *)arg;
+    CFastConnect::mark(EFastPhase::Assoc);
+    CFastConnect::onConnected((wifi_event_sta_connected_t *)event_data, self->m_net_if);
+#endif
+}
 #endif
+
+#if CONFIG_WIFICHN_LINK_MONITOR
+void WiFiStation::on_beacon_timeout(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    ((WiFiStation *)arg)->mLink.onBeaconTimeout();
+}
+#endif
+
+void WiFiStation::on_sta_disconnected(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    WiFiStation *self = (WiFiStation *)arg;
+    EWiFiState st = self->mState.load();
+    int16_t reason = ((wifi_event_sta_disconnected_t *)event_data)->reason;
+    if (self->mSrcIP.exchange(0) != 0)
+    {
+        TIMELINE_INSTANT("link down", reason);
+        self->mEventStream.push(EWiFiEvent::LinkDown, reason);
+#if CONFIG_WIFICHN_LINK_MONITOR
+        self->mLink.onDisconnect(reason);
+#endif
+#if CONFIG_WIFICHN_HTTP_POOL
+        self->mHttpPool.flush(); // сокеты потерянного соединения уже недействительны
+#endif
+#if CONFIG_WIFICHN_MCAST
+        if (CMulticastTask *mc = self->mMulticast.load())
+            mc->linkDown();
+#endif
+#if CONFIG_WIFICHN_FAST_CONNECT
+        // Переподключение (если будет) - с обычным поиском точки и DHCP.
+        if ((st != EWiFiState::Stopping) && CFastConnect::onFail(self->m_wifi_config, self->m_net_if))
+            esp_wifi_set_config(WIFI_IF_STA, &self->m_wifi_config);
+#endif
+        // Потеря установленного соединения: переподключение - на усмотрение приложения.
+        EWiFiState connected = EWiFiState::Connected;
+        self->mState.compare_exchange_strong(connected, EWiFiState::Connecting);
+        xEventGroupClearBits(self->mEvents, CONNECTED_BIT);
+        xEventGroupSetBits(self->mEvents, DISCONNECTED_BIT);
+        if (self->mConnectCallback != nullptr)
+            self->mConnectCallback(nullptr);
+    }
+    else if (st == EWiFiState::Connecting)
+    {
+        self->mEventStream.push(EWiFiEvent::ConnectFail, reason);
+        // Обрыв на любой фазе: незакрытый интервал другой фазы просмотрщик пропустит.
+        TIMELINE_ASYNC_END("assoc", 0);
+        TIMELINE_ASYNC_END("dhcp", 0);
+        TIMELINE_INSTANT("connect fail", reason);
+#if CONFIG_WIFICHN_FAST_CONNECT
+        // Точка доступа сменила канал или недоступна: следующая попытка - с полным сканированием.
+        if (CFastConnect::onFail(self->m_wifi_config, self->m_net_if))
+            esp_wifi_set_config(WIFI_IF_STA, &self->m_wifi_config);
 #endif
-        if (WiFiStation::Instance()->mConnectCallback != nullptr)
-            WiFiStation::Instance()->mConnectCallback(&event->ip_info.ip.addr);
+        TIMELINE_ASYNC_BEGIN("assoc", 0);
+        esp_wifi_connect();
+        if (self->mEventCallback != nullptr)
+            self->mEventCallback(event_id, "connecting was failed");
+        else
+            ESP_LOGW(TAG, "connecting was failed");
     }
 }
 
+void WiFiStation::on_got_ip(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    WiFiStation *self = (WiFiStation *)arg;
+    ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+    TIMELINE_ASYNC_END("dhcp", 0);
+    // ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
+    self->mSrcIP.store(event->ip_info.ip.addr);
+    self->mEventStream.push(EWiFiEvent::LinkUp, 0, event->ip_info.ip.addr);
+#if CONFIG_WIFICHN_FAST_CONNECT
+    CFastConnect::mark(EFastPhase::Ip);
+    CFastConnect::onGotIp(event->ip_info, self->m_net_if);
+    {
+        uint32_t t0 = CFastConnect::phaseMs(EFastPhase::Start);
+        uint32_t assoc = CFastConnect::phaseMs(EFastPhase::Assoc);
+        uint32_t ip = CFastConnect::phaseMs(EFastPhase::Ip);
+        int16_t path = (CFastConnect::isFast() ? 1 : 0) | (CFastConnect::isStatic() ? 2 : 0);
+        self->mEventStream.push(EWiFiEvent::FastConnect, path, ip - t0, (assoc != 0) ? (assoc - t0) : 0);
+        ESP_LOGI(TAG, "boot->start %lu ms, init %lu ms, assoc %lu ms, ip %lu ms (path %d)", (unsigned long)t0,
+                 (unsigned long)(CFastConnect::phaseMs(EFastPhase::Init) - t0), (unsigned long)(assoc - t0),
+                 (unsigned long)(ip - assoc), path);
+    }
+#endif
+#if CONFIG_WIFICHN_LINK_MONITOR
+    self->mLink.start();
+#endif
+#if CONFIG_WIFICHN_MCAST
+    if (CMulticastTask *mc = self->mMulticast.load())
+        mc->linkUp(event->ip_info.ip.addr);
+#endif
+    EWiFiState connecting = EWiFiState::Connecting;
+    self->mState.compare_exchange_strong(connecting, EWiFiState::Connected);
+    xEventGroupClearBits(self->mEvents, DISCONNECTED_BIT);
+    xEventGroupSetBits(self->mEvents, CONNECTED_BIT);
+#if (CONFIG_WIFICHN_SYNC_TIME == 1)
+    if (!CDateTimeSystem::isSync())
+        self->syncTime();
+#endif
+    if (self->mConnectCallback != nullptr)
+        self->mConnectCallback(&event->ip_info.ip.addr);
+    esp_timer_stop(self->mConnectTimer);
+    self->completePromise(self->mConnectPromise, ESP_OK);
+}
+
 #ifdef CONFIG_WIFICHN_OTA
 std::list<onWriteEvent *> WiFiStation::mWriteQueue; ///< Очередь обработчиков события записи HTTPS OTA во flash
 
 // Вызвать все обработчики из очереди
 void WiFiStation::writeEvent(bool lock)
 {
+    if (lock)
+        TIMELINE_BEGIN("writeEvent");
     for (auto const &event : mWriteQueue)
     {
         event(lock);
     }
+    if (!lock)
+        TIMELINE_END("writeEvent");
 }
 
 // Добавить обработчик события записи HTTPS OTA
@@ -288,27 +547,57 @@ void WiFiStation::removeWriteEvent(onWriteEvent *event)
 
 bool WiFiStation::startOta(onOtaProgress *otaProgressCallback, const char *file, onOtaImageDesc *otaImageDesc)
 {
-    if (mOTA == nullptr)
-    {
-        mOtaProgressCallback = otaProgressCallback;
-        mOtaImageDesc = otaImageDesc;
-        mOTA = new COTATask(this, file);
-        return true;
-    }
-    return false;
+    // Слот занимается атомарно: параллельные startOta() из разных задач не создадут две задачи.
+    if (mOtaBusy.exchange(true))
+        return false;
+    mOtaProgressCallback = otaProgressCallback;
+    mOtaImageDesc = otaImageDesc;
+    mOTA.store(new COTATask(this, file));
+    return true;
+}
+
+bool WiFiStation::startDownload(onOtaProgress *otaProgressCallback, const char *file, COtaSink *sink)
+{
+    if (mOtaBusy.exchange(true))
+        return false;
+    mOtaProgressCallback = otaProgressCallback;
+    mOtaImageDesc = nullptr;
+    mOTA.store(new COTATask(this, file, sink));
+    return true;
+}
+
+CWiFiFuture WiFiStation::otaAsync(const char *file, onOtaImageDesc *otaImageDesc)
+{
+    bool created;
+    std::shared_ptr<CWiFiPromise> promise = claimPromise(mOtaPromise, created);
+    if (created && !startOta(mOtaProgressCallback, file, otaImageDesc))
+        completePromise(mOtaPromise, -1);
+    return CWiFiFuture(promise);
+}
+
+CWiFiFuture WiFiStation::downloadAsync(const char *file, COtaSink *sink)
+{
+    bool created;
+    std::shared_ptr<CWiFiPromise> promise = claimPromise(mOtaPromise, created);
+    if (created && !startDownload(mOtaProgressCallback, file, sink))
+        completePromise(mOtaPromise, -1);
+    return CWiFiFuture(promise);
 }
 
 bool WiFiStation::stopOta()
 {
-    if (mOTA != nullptr)
+    COTATask *ota = mOTA.exchange(nullptr);
+    if (ota != nullptr)
     {
-        delete mOTA;
-        mOTA = nullptr;
+        delete ota;
+        mOtaBusy.store(false);
         return true;
     }
-    else if (mConnecting)
+    else if (mState.load() == EWiFiState::Connecting)
     {
-        mSrcIP = 1;
+        // Следующий обрыв будет сообщён как отключение, а не как неудачная попытка подключения.
+        mSrcIP.store(1);
+        xEventGroupClearBits(mEvents, DISCONNECTED_BIT);
     }
     return false;
 }
@@ -318,6 +607,13 @@ bool WiFiStation::start(onWiFiConnect *connectCallback, onWiFiEvent *eventCallba
 {
     // ВРЕМЕННАЯ ОТЛАДКА: в STA/OTA-фазе приманки не взводим (порча происходит в фазе
     // скана, а во время TLS-хендшейка каждый килобайт внутренней кучи на счету).
+    // Переход Idle->Connecting атомарный: одновременный start() из другой задачи получит false.
+    EWiFiState idle = EWiFiState::Idle;
+    if (!mState.compare_exchange_strong(idle, EWiFiState::Connecting))
+        return false;
+    TIMELINE_SCOPE("wifi.start");
+    xEventGroupClearBits(mEvents, IDLE_BIT | CONNECTED_BIT);
+    xEventGroupSetBits(mEvents, DISCONNECTED_BIT);
     mConnectCallback = connectCallback;
     mEventCallback = eventCallback;
     if (ssid != nullptr)
@@ -328,60 +624,84 @@ bool WiFiStation::start(onWiFiConnect *connectCallback, onWiFiEvent *eventCallba
         // std::strncpy((char *)m_wifi_config.sta.password, password, sizeof(m_wifi_config.sta.password));
 
     ESP_LOGI(TAG, "%s %s", m_wifi_config.sta.ssid, m_wifi_config.sta.password);
+#if CONFIG_WIFICHN_FAST_CONNECT
+    CFastConnect::mark(EFastPhase::Start);
+    // Без сохранённого контекста BSSID/канал из прошлого подключения не подставляются.
+    m_wifi_config.sta.bssid_set = false;
+    m_wifi_config.sta.channel = 0;
+    CFastConnect::prepare(m_wifi_config);
+#endif
 
     // netif и default event loop создаются один раз при старте приложения (main.cpp)
     // и не удаляются: повторные вызовы вернут ESP_ERR_INVALID_STATE - это норма.
     esp_netif_init();
     esp_event_loop_create_default();
-#if (CONFIG_WIFICHN_SYNC_TIME == 1) && (CONFIG_LWIP_DHCP_GET_NTP_SRV == 1)
-    if (!CDateTimeSystem::isSync())
-    {
-        mStartSyncTime = true;
-        esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG("pool.ntp.org");
-        config.start = false;                     // start SNTP service explicitly (after connecting)
-        config.server_from_dhcp = true;           // accept NTP offers from DHCP server, if any (need to enable *before* connecting)
-        config.renew_servers_after_new_IP = true; // let esp-netif update configured SNTP server(s) after receiving DHCP lease
-        config.index_of_first_server = 1;         // updates from server num 1, leaving server 0 (from DHCP) intact
-        config.ip_event_to_renew = IP_EVENT_STA_GOT_IP;
-        config.sync_cb = time_sync_notification_cb; // only if we need the notification function
-        esp_netif_sntp_init(&config);
-    }
+#if (CONFIG_WIFICHN_SYNC_TIME == 1)
+    // До синхронизации берём время из RTC кэша: его точности хватает для проверки
+    // сроков действия сертификата, и HTTPS не ждёт ответа NTP. После пропадания
+    // питания часы ставятся по нижней границе из NVS, но OTA ждёт синхронизации.
+    CTimeCache::restore();
+    if (CDateTimeSystem::isSync())
+        xEventGroupSetBits(mEvents, TIME_SYNC_BIT);
+    else
+        xEventGroupClearBits(mEvents, TIME_SYNC_BIT);
+#if (CONFIG_LWIP_DHCP_GET_NTP_SRV == 1)
+    esp_sntp_servermode_dhcp(true); // принимать NTP сервер от DHCP (включается до подключения)
+#endif
 #endif
     m_net_if = esp_netif_create_default_wifi_sta();
     // wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
-                                                        ESP_EVENT_ANY_ID,
-                                                        &event_handler,
-                                                        nullptr,
-                                                        nullptr));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
-                                                        IP_EVENT_STA_GOT_IP,
-                                                        &event_handler,
-                                                        nullptr,
-                                                        nullptr));
+    // Таблица собирается при компиляции: обработчики отключённых функций не попадают в прошивку.
+    // Это замена цепочки сравнений в общем обработчике, а не шаблонная политика класса:
+    // выигрыш по флеш/IRAM и времени разбора события не измерен (см. WIFICHN_SCAN).
+    static constexpr SEventRoute routes[] = {
+        {&WIFI_EVENT, WIFI_EVENT_STA_START, &on_sta_start},
+        {&WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &on_sta_disconnected},
+        {&IP_EVENT, IP_EVENT_STA_GOT_IP, &on_got_ip},
+#if CONFIG_WIFICHN_FAST_CONNECT || CONFIG_WIFICHN_TIMELINE
+        {&WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &on_sta_connected},
+#endif
+#if CONFIG_WIFICHN_LINK_MONITOR
+        {&WIFI_EVENT, WIFI_EVENT_STA_BEACON_TIMEOUT, &on_beacon_timeout},
+#endif
+#if CONFIG_WIFICHN_SCAN
+        {&WIFI_EVENT, WIFI_EVENT_SCAN_DONE, &on_scan_done}, // сканирование при работающей станции (провижининг)
+#endif
+    };
+    static_assert(std::size(routes) <= MAX_ROUTES, "MAX_ROUTES");
+    subscribe(routes, std::size(routes));
 
+#if CONFIG_WIFICHN_FAST_CONNECT
+    // Конфигурация задаётся при каждом start(): запись её драйвером в NVS только тратит время.
+    esp_wifi_set_storage(WIFI_STORAGE_RAM);
+#endif
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &m_wifi_config));
-    mConnecting = true;
     ESP_ERROR_CHECK(esp_wifi_start());
+#if CONFIG_WIFICHN_FAST_CONNECT
+    CFastConnect::mark(EFastPhase::Init);
+#endif
     // ESP_LOGI(TAG, "wifi_init_sta finished.");
     return true;
 }
 
+#if CONFIG_WIFICHN_SCAN
 bool WiFiStation::startScan(onWiFiScan *scanCallback)
 {
     // dbg_canary_arm(); // ВРЕМЕННАЯ ОТЛАДКА: захватить область порчи до инициализации WiFi
+    EWiFiState idle = EWiFiState::Idle;
+    if (!mState.compare_exchange_strong(idle, EWiFiState::Scanning))
+        return false;
+    xEventGroupClearBits(mEvents, IDLE_BIT | SCAN_DONE_BIT);
     mWiFiScanCallback = scanCallback;
 
     esp_event_loop_create_default(); 
     // wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
-                                                        WIFI_EVENT_SCAN_DONE,
-                                                        &event_handler,
-                                                        nullptr,
-                                                        nullptr));
+    static constexpr SEventRoute routes[] = {
+        {&WIFI_EVENT, WIFI_EVENT_SCAN_DONE, &on_scan_done}};
+    subscribe(routes, std::size(routes));
 
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_start());
@@ -393,21 +713,33 @@ bool WiFiStation::startScan(onWiFiScan *scanCallback)
     };
 
     ESP_LOGI(TAG, "Starting Wi-Fi scan...");
+    TIMELINE_ASYNC_BEGIN("scan", 0);
     ESP_ERROR_CHECK(esp_wifi_scan_start(&scan_config, false));
     return true;
 }
+#endif
 
 bool WiFiStation::stop()
 {
-    if (mConnecting)
+    // Захват остановки атомарный: из двух одновременных stop() работу выполнит один.
+    // Из Idle остановка тоже выполняется (драйвер и default event loop), как до машины состояний.
+    EWiFiState st = mState.load();
+    do
     {
-        mConnecting = false;
-        mStopping = true; // Блокируем event_handler от вызова esp_wifi_connect()
+        if (st == EWiFiState::Stopping)
+            return false;
+    } while (!mState.compare_exchange_weak(st, EWiFiState::Stopping)); // Блокируем обработчики событий от вызова esp_wifi_connect()
+    TIMELINE_SCOPE("wifi.stop");
 
+    if ((st != EWiFiState::Scanning) && (st != EWiFiState::Idle))
+    {
         // Принудительно разрываем соединение, чтобы остановить внутренний retry ESP-IDF.
-        // Повторный esp_wifi_connect() из event_handler уже заблокирован флагом mStopping,
+        // Повторный esp_wifi_connect() из обработчиков событий уже заблокирован состоянием Stopping,
         // поэтому обработчики можно не отключать заранее — иначе некому будет сбросить mSrcIP
-        // по событию WIFI_EVENT_STA_DISCONNECTED и цикл ожидания ниже зависнет навсегда.
+        // по событию WIFI_EVENT_STA_DISCONNECTED и ожидание ниже уйдёт в таймаут.
+#if CONFIG_WIFICHN_APSTA
+        stopAp();
+#endif
         esp_wifi_disconnect();
 
         // Сбрасываем внутреннее состояние reconnect в ESP-IDF
@@ -416,48 +748,214 @@ bool WiFiStation::stop()
         // Безопасно останавливаем WiFi
         esp_wifi_stop();
 
-        while (mSrcIP != 0)
-            vTaskDelay(1);
+        if (!wait(DISCONNECTED_BIT, pdMS_TO_TICKS(WIFI_STOP_TIMEOUT_MS)))
+        {
+            ESP_LOGW(TAG, "no disconnect event");
+            mSrcIP.store(0);
+            xEventGroupClearBits(mEvents, CONNECTED_BIT);
+            xEventGroupSetBits(mEvents, DISCONNECTED_BIT);
+        }
 
         // Отключаем обработчики после того, как соединение гарантированно разорвано
-        esp_event_handler_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler);
-        esp_event_handler_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler);
+        unsubscribe();
 
         // default event loop и esp_netif живут весь аптайм (созданы в main.cpp):
         // их удаление здесь гонялось с отложенными esp_event_post из WiFi-драйвера
         // (ppTask/таймеры ядра 1) и оставляло висячие регистрации.
 
 #if (CONFIG_WIFICHN_SYNC_TIME == 1)
-        // Если синхронизация времени не успела завершиться (time_sync_notification_cb
-        // не вызывался), esp_netif_sntp остаётся инициализированным. Без этого деинита
-        // повторный WiFiStation::start() в той же сессии получит от
-        // esp_netif_sntp_init() ESP_ERR_INVALID_STATE (см. esp_netif_sntp.c) - ошибку,
-        // которая нигде не проверяется, поэтому новая синхронизация молча не запустится.
-        if (mStartSyncTime)
+        // Задача синхронизации могла не успеть завершиться - отменяем её до деинициализации
+        // WiFi, чтобы повторный start() запустил новую синхронизацию.
+        if (mTimeSync != nullptr)
         {
-            esp_netif_sntp_deinit();
-            mStartSyncTime = false;
+            delete mTimeSync;
+            mTimeSync = nullptr;
         }
 #endif
         esp_wifi_deinit();
         esp_netif_destroy_default_wifi(m_net_if);
-
-        mStopping = false;
     }
     else
     {
         esp_wifi_stop();
         esp_wifi_deinit();
-        esp_event_handler_unregister(WIFI_EVENT, WIFI_EVENT_SCAN_DONE, &event_handler);
+        unsubscribe();
         // default event loop не удаляем (см. комментарий выше)
     }
     esp_event_loop_delete_default();
       // dbg_canary_release(); // ВРЕМЕННАЯ ОТЛАДКА: вернуть память до пересоздания аудио
+    esp_timer_stop(mConnectTimer);
+    completePromise(mConnectPromise, ESP_ERR_INVALID_STATE);
+#if CONFIG_WIFICHN_SCAN
+    completePromise(mScanPromise, -1);
+#endif
+    setState(EWiFiState::Idle);
+    return true;
+}
+
+#if CONFIG_WIFICHN_APSTA
+bool WiFiStation::startAp(const char *ssid, const char *password, const char *token)
+{
+    EWiFiState st = mState.load();
+    if ((mProvision != nullptr) || ((st != EWiFiState::Connecting) && (st != EWiFiState::Connected)))
+        return false;
+    if ((password == nullptr) || (strlen(password) < 8) || (token == nullptr) || (strlen(token) < 8))
+    {
+        ESP_LOGW(TAG, "SoftAP needs WPA2 password and provisioning token (8+ chars)");
+        return false;
+    }
+
+    wifi_config_t ap_config;
+    std::memset(&ap_config, 0, sizeof(ap_config));
+    strlcpy((char *)ap_config.ap.ssid, ssid, sizeof(ap_config.ap.ssid));
+    ap_config.ap.ssid_len = strlen((char *)ap_config.ap.ssid);
+    ap_config.ap.max_connection = CONFIG_WIFICHN_AP_MAX_CONN;
+    strlcpy((char *)ap_config.ap.password, password, sizeof(ap_config.ap.password));
+    ap_config.ap.authmode = WIFI_AUTH_WPA2_PSK;
+
+    m_ap_if = esp_netif_create_default_wifi_ap();
+    if ((esp_wifi_set_mode(WIFI_MODE_APSTA) != ESP_OK) || (esp_wifi_set_config(WIFI_IF_AP, &ap_config) != ESP_OK))
+    {
+        ESP_LOGW(TAG, "SoftAP start failed");
+        esp_wifi_set_mode(WIFI_MODE_STA);
+        esp_netif_destroy_default_wifi(m_ap_if);
+        m_ap_if = nullptr;
+        return false;
+    }
+    esp_netif_ip_info_t ip_info;
+    esp_netif_get_ip_info(m_ap_if, &ip_info);
+    mProvision = new CProvisionTask(this, ip_info.ip.addr, token);
+    ESP_LOGI(TAG, "SoftAP %s started", ap_config.ap.ssid);
+    return true;
+}
+
+bool WiFiStation::stopAp()
+{
+    if (mProvision == nullptr)
+        return false;
+    delete mProvision;
+    mProvision = nullptr;
+    esp_wifi_set_mode(WIFI_MODE_STA);
+    esp_netif_destroy_default_wifi(m_ap_if);
+    m_ap_if = nullptr;
+    return true;
+}
+
+void WiFiStation::applyConfig()
+{
+#if CONFIG_WIFICHN_FAST_CONNECT
+    // BSSID, канал и аренда в RTC-памяти относятся к прежней сети: контекст сбрасывается
+    // до отключения (событие обрыва уже не подставит их обратно), DHCP клиент - к обычной работе.
+    if (CFastConnect::isStatic())
+        esp_netif_dhcpc_start(m_net_if);
+    CFastConnect::invalidate();
+    m_wifi_config.sta.bssid_set = false;
+    m_wifi_config.sta.channel = 0;
+    CFastConnect::prepare(m_wifi_config);
+#endif
+    // Обрыв текущего соединения сообщается как обычно (LinkDown), подключение идёт с новыми настройками.
+    esp_wifi_disconnect();
+    esp_wifi_set_config(WIFI_IF_STA, &m_wifi_config);
+    EWiFiState connected = EWiFiState::Connected;
+    mState.compare_exchange_strong(connected, EWiFiState::Connecting);
+    TIMELINE_ASYNC_BEGIN("assoc", 0);
+    esp_wifi_connect();
+}
+#endif
+
+#if CONFIG_WIFICHN_MCAST
+bool WiFiStation::startMulticast(uint32_t group, uint16_t port, CMulticastChannel::TDeliver deliver)
+{
+    if (mMulticast.load() != nullptr)
+        return false;
+    CMulticastTask *mc = new CMulticastTask(group, port, deliver);
+    mMulticast.store(mc);
+    // IP адрес мог быть получен до запуска канала: IP_EVENT_STA_GOT_IP уже не придёт.
+    uint32_t ip = mSrcIP.load();
+    if (ip != 0)
+        mc->linkUp(ip);
+    return true;
+}
+
+bool WiFiStation::stopMulticast()
+{
+    CMulticastTask *mc = mMulticast.exchange(nullptr);
+    if (mc == nullptr)
+        return false;
+    delete mc;
+    return true;
+}
+#endif
+
+#if CONFIG_WIFICHN_SELFTEST
+bool WiFiStation::startSelfTest(const SSelfTestConfig &cfg, onSelfTest *callback)
+{
+    CSelfTestTask *old;
+    {
+        std::lock_guard<std::mutex> lock(mSelfTestMutex);
+        if (((mSelfTest != nullptr) && !mSelfTest->isFinished()) || (mState.load() != EWiFiState::Connected))
+            return false;
+        // Из обработчика завершения прошлый тест не удалить: его задача ещё не вышла из run().
+        if ((mSelfTest != nullptr) && mSelfTest->isOwnTask())
+            return false;
+        old = mSelfTest;
+        mSelfTest = new CSelfTestTask(cfg, [this, callback](esp_err_t err, const SSelfTestResult &result)
+                                      {
+        {
+            std::lock_guard<std::mutex> lock(mAsyncMutex);
+            mSelfTestResult = result;
+            mSelfTestValid = true;
+        }
+        mEventStream.push(EWiFiEvent::SelfTest, (err == ESP_OK) ? (int16_t)result.mode : -(int16_t)result.mode, result.goodputKbps, result.lost);
+        if (callback != nullptr)
+            callback(err, &result);
+        completePromise(mSelfTestPromise, err); });
+    }
+    // Удаление ждёт выхода задачи прошлого теста из обработчика - вне блокировки,
+    // чтобы обработчик мог вызвать startSelfTest()/stopSelfTest().
+    delete old;
     return true;
 }
 
+CWiFiFuture WiFiStation::selfTestAsync(const SSelfTestConfig &cfg)
+{
+    bool created;
+    std::shared_ptr<CWiFiPromise> promise = claimPromise(mSelfTestPromise, created);
+    if (created && !startSelfTest(cfg))
+        completePromise(mSelfTestPromise, ESP_ERR_INVALID_STATE);
+    return CWiFiFuture(promise);
+}
+
+bool WiFiStation::getSelfTestResult(SSelfTestResult &result)
+{
+    std::lock_guard<std::mutex> lock(mAsyncMutex);
+    result = mSelfTestResult;
+    return mSelfTestValid;
+}
+
+bool WiFiStation::stopSelfTest()
+{
+    CSelfTestTask *test;
+    bool running;
+    {
+        std::lock_guard<std::mutex> lock(mSelfTestMutex);
+        if ((mSelfTest == nullptr) || mSelfTest->isOwnTask())
+            return false;
+        test = mSelfTest;
+        mSelfTest = nullptr;
+        running = !test->isFinished();
+    }
+    delete test; // прерванный тест завершает операцию с ошибкой
+    return running;
+}
+#endif
+
 uint16_t WiFiStation::initFromFile(const char *fileName)
 {
+#if CONFIG_WIFICHN_FAST_CONNECT
+    if ((esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED) && CFastConnect::loadConfig(m_wifi_config))
+        return 0;
+#endif
     try
     {
         std::string str = "/spiffs/";
@@ -504,18 +1002,15 @@ void WiFiStation::time_sync_notification_cb(struct timeval *tv)
     ESP_LOGI(TAG, "Notification of a time synchronization event");
     if (!CDateTimeSystem::isSync())
         CDateTimeSystem::saveDateTime();
-    esp_netif_sntp_deinit();
-    WiFiStation::Instance()->mStartSyncTime = false;
+    CTimeCache::save();
+    mEventStream.push(EWiFiEvent::TimeSync, 0);
+    xEventGroupSetBits(mEvents, TIME_SYNC_BIT);
 }
 
 void WiFiStation::syncTime()
 {
-    // ESP_LOGI(TAG, "Initializing SNTP");
-    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG("pool.ntp.org");
-    config.sync_cb = time_sync_notification_cb; // only if we need the notification function
-    esp_netif_sntp_init(&config);
-
-    esp_netif_sntp_start();
-    mStartSyncTime = true;
+    // Задача однократная: после успешной синхронизации объект остаётся до stop().
+    if (mTimeSync == nullptr)
+        mTimeSync = new CTimeSyncTask(this);
 }
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+/*!
+	\file
+	\brief Пул буферов фиксированного размера.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Все блоки выделяются одним куском при создании пула, поэтому сетевые каналы
+	компонента не фрагментируют кучу и не конкурируют за неё со стеком WiFi/lwIP:
+	при исчерпании пула пакет отбрасывается, а не отнимает память у основного канала.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include <cstdint>
+#include <cstddef>
+
+class CBufferPool
+{
+protected:
+	uint8_t *mSlab = nullptr;						  ///< Память всех блоков.
+	uint16_t *mFree = nullptr;						  ///< Стек индексов свободных блоков.
+	size_t mBlockSize;								  ///< Размер блока.
+	uint16_t mCount;								  ///< Число блоков.
+	uint16_t mTop = 0;								  ///< Число свободных блоков.
+	uint16_t mMinFree = 0;							  ///< Минимум свободных блоков за время работы.
+	portMUX_TYPE mMux = portMUX_INITIALIZER_UNLOCKED; ///< Защита стека.
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] blockSize - Размер блока.
+	  \param[in] count - Число блоков.
+	  \param[in] caps - Тип памяти (MALLOC_CAP_...).
+	*/
+	CBufferPool(size_t blockSize, uint16_t count, uint32_t caps);
+	/// Деструктор.
+	~CBufferPool();
+
+	/// Взять блок.
+	/*!
+	  \return Указатель на блок или nullptr, если пул исчерпан.
+	*/
+	uint8_t *alloc();
+	/// Вернуть блок.
+	/*!
+	  \param[in] buf - Указатель на блок, полученный из alloc().
+	*/
+	void free(uint8_t *buf);
+
+	/// Размер блока.
+	inline size_t blockSize() { return mBlockSize; };
+	/// Пул создан успешно.
+	inline bool isValid() { return mSlab != nullptr; };
+	/// Минимум свободных блоков за время работы.
+	inline uint16_t minFree() { return mMinFree; };
+};
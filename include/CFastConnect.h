@@ -0,0 +1,105 @@
+/*!
+	\file
+	\brief Контекст быстрого подключения в RTC-памяти (пробуждение из deep sleep).
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	В RTC-памяти (переживает deep sleep и программный сброс) хранятся ssid/пароль,
+	BSSID, канал и режим аутентификации точки доступа, а также адрес, маска, шлюз
+	и DNS последней аренды DHCP. После пробуждения initFromFile() не разбирает
+	JSON, подключение идёт сразу к известной точке на известном канале (без
+	сканирования), а пока аренда свежая (CONFIG_WIFICHN_FAST_LEASE_S) - со
+	статическим адресом без обмена DHCP. Время восстанавливает CTimeCache.
+	Неудачная попытка возвращает станцию к обычному подключению.
+
+	Метки фаз (от старта приложения) позволяют сравнить путь "пробуждение - IP"
+	с обычным; итог - запись FastConnect потока событий.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include <cstdint>
+
+/// Фаза подключения.
+enum class EFastPhase : uint8_t
+{
+	Start,	///< Вызов WiFiStation::start() (конфигурация готова).
+	Init,	///< Драйвер WiFi запущен.
+	Assoc,	///< Станция подключена к точке доступа.
+	Ip,		///< IP адрес получен.
+	Count	///< Число фаз.
+};
+
+class CFastConnect
+{
+protected:
+	static uint32_t mPhase[(size_t)EFastPhase::Count]; ///< Метки фаз, мс от старта приложения.
+	static bool mFast;								  ///< Текущее подключение использует сохранённую точку доступа.
+	static bool mStatic;							  ///< Текущий адрес взят из сохранённой аренды.
+
+public:
+	/// Взять ssid/пароль из RTC-памяти.
+	/*!
+	  \param[out] cfg - Конфигурация станции (заполняются ssid и password).
+	  \return true - контекст валиден, конфигурация заполнена.
+	*/
+	static bool loadConfig(wifi_config_t &cfg);
+
+	/// Подготовить конфигурацию к подключению.
+	/*!
+	  Если ssid/пароль совпадают с сохранёнными, в конфигурацию подставляются BSSID
+	  и канал (подключение без сканирования). Иначе сохраняются новые ssid/пароль,
+	  а данные прежней сети забываются.
+	  \param[in,out] cfg - Конфигурация станции.
+	  \return true - подключение пойдёт по быстрому пути.
+	*/
+	static bool prepare(wifi_config_t &cfg);
+
+	/// Станция подключена к точке доступа (WIFI_EVENT_STA_CONNECTED).
+	/*!
+	  Сохраняет BSSID и канал; если аренда свежая - останавливает DHCP клиент и
+	  назначает сохранённый адрес (IP_EVENT_STA_GOT_IP придёт сразу).
+	  \param[in] evt - Данные события.
+	  \param[in] netif - Интерфейс станции.
+	*/
+	static void onConnected(const wifi_event_sta_connected_t *evt, esp_netif_t *netif);
+
+	/// IP адрес получен (IP_EVENT_STA_GOT_IP).
+	/*!
+	  Аренда, полученная по DHCP, сохраняется вместе с DNS и временем получения.
+	  \param[in] ip - Адрес, маска, шлюз.
+	  \param[in] netif - Интерфейс станции.
+	*/
+	static void onGotIp(const esp_netif_ip_info_t &ip, esp_netif_t *netif);
+
+	/// Неудачная попытка подключения или потеря соединения.
+	/*!
+	  Сохранённые BSSID, канал и аренда забываются, конфигурация и DHCP клиент
+	  возвращаются к обычному подключению.
+	  \param[in,out] cfg - Конфигурация станции.
+	  \param[in] netif - Интерфейс станции.
+	  \return true - быстрый путь был активен (конфигурацию нужно применить заново).
+	*/
+	static bool onFail(wifi_config_t &cfg, esp_netif_t *netif);
+
+	/// Забыть весь контекст (например, после смены настроек в файле).
+	static void invalidate();
+
+	/// Отметить фазу подключения.
+	static void mark(EFastPhase phase);
+	/// Метка фазы.
+	/*!
+	  \param[in] phase - Фаза.
+	  \return Время от старта приложения, мс (0 - фаза не отмечена).
+	*/
+	static uint32_t phaseMs(EFastPhase phase);
+
+	/// Текущее подключение использует сохранённую точку доступа.
+	static inline bool isFast() { return mFast; };
+	/// Текущий адрес взят из сохранённой аренды (без DHCP).
+	static inline bool isStatic() { return mStatic; };
+};
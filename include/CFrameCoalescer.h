@@ -0,0 +1,196 @@
+/*!
+	\file
+	\brief Упаковка мелких записей в кадры размером до MTU и разбор кадров без копирования.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Кадр: 2 байта длины (little-endian, без учёта самих 2 байт), затем записи
+	подряд, каждая - длина в формате varint (1 байт до 127 байт данных) и данные.
+	Запись 8..40 байт стоит 1 байт заголовка вместо пакета UDP/TCP на запись.
+
+	CFrameCoalescer копит записи и отдаёт кадр, когда следующая запись не
+	помещается или первая запись кадра ждёт дольше срока. Время передаётся
+	параметром (мс), как в CReliableChannel. Если получатель кадра не готов
+	(вернул false), кадр остаётся и отдаётся повторно при следующем poll()/add().
+
+	CFrameView перебирает записи принятого кадра: SFrameRecord указывает прямо в
+	буфер приёма. CFrameSplitter выделяет кадры из потока TCP: кадр, целиком
+	лежащий в принятом куске, отдаётся на месте, копируется только разрезанный.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#define FRAME_HEADER_SIZE (2)	///< Заголовок кадра (длина).
+#define FRAME_MAX_SIZE (0xffff) ///< Наибольший кадр вместе с заголовком.
+
+/// Запись принятого кадра (указывает в буфер кадра).
+struct SFrameRecord
+{
+	const uint8_t *data; ///< Данные записи.
+	size_t len;			 ///< Длина записи.
+};
+
+/// Статистика упаковки.
+struct SFrameStats
+{
+	uint32_t frames;		  ///< Отдано кадров.
+	uint32_t records;		  ///< Упаковано записей.
+	uint32_t bytes;			  ///< Данных записей, байт.
+	uint32_t wire;			  ///< Кадров с заголовками, байт.
+	uint16_t fillAvg;		  ///< Средняя заполненность кадра, 1/1000 MTU.
+	uint16_t fillMin;		  ///< Наименьшая заполненность кадра, 1/1000 MTU.
+	uint32_t latencyAvg;	  ///< Среднее ожидание записи в кадре, мс.
+	uint32_t latencyMax;	  ///< Наибольшее ожидание записи в кадре, мс.
+	uint32_t deadlineFlushes; ///< Кадров, отданных по сроку.
+	uint32_t fullFlushes;	  ///< Кадров, отданных заполненными.
+	uint32_t rejected;		  ///< Записей, не принятых (велика или получатель кадров занят).
+};
+
+class CFrameCoalescer
+{
+public:
+	/// Отправка кадра.
+	/*!
+	  \param[in] frame - Кадр.
+	  \param[in] len - Длина кадра.
+	  \return true - кадр принят, false - повторить позже.
+	*/
+	typedef std::function<bool(const uint8_t *frame, size_t len)> TFlush;
+
+protected:
+	TFlush mFlush;				 ///< Получатель кадров.
+	size_t mMtu;				 ///< Наибольший кадр.
+	uint32_t mDeadline;			 ///< Наибольшее ожидание первой записи кадра, мс.
+	uint8_t *mBuf = nullptr;	 ///< Собираемый кадр.
+	size_t mLen = FRAME_HEADER_SIZE; ///< Заполнено байт кадра.
+	uint16_t mCount = 0;		 ///< Записей в кадре.
+	uint32_t mFirstAt = 0;		 ///< Время первой записи кадра, мс.
+	uint64_t mAddSum = 0;		 ///< Сумма времён записей кадра, мс.
+	SFrameStats mStats = {};	 ///< Статистика.
+	uint64_t mFillSum = 0;		 ///< Сумма заполненности кадров, 1/1000.
+	uint64_t mLatencySum = 0;	 ///< Сумма ожиданий записей, мс.
+
+	/// Отдать кадр.
+	/*!
+	  \param[in] now - Текущее время, мс.
+	  \param[in] counter - Счётчик причины в mStats (nullptr - по запросу).
+	  \return true - кадр принят или пуст.
+	*/
+	bool emit(uint32_t now, uint32_t *counter);
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] flush - Получатель кадров.
+	  \param[in] mtu - Наибольший кадр вместе с заголовком.
+	  \param[in] deadline - Наибольшее ожидание записи в кадре, мс (0 - кадр на каждую запись).
+	  \param[in] caps - Тип памяти буфера (MALLOC_CAP_...).
+	*/
+	CFrameCoalescer(TFlush flush, size_t mtu = CONFIG_WIFICHN_FRAME_MTU, uint32_t deadline = CONFIG_WIFICHN_FRAME_DEADLINE_MS, uint32_t caps = MALLOC_CAP_DEFAULT);
+	/// Деструктор.
+	~CFrameCoalescer();
+
+	/// Добавить запись.
+	/*!
+	  \param[in] data - Запись.
+	  \param[in] len - Длина (не больше maxRecord()).
+	  \param[in] now - Текущее время, мс.
+	  \return true - запись в кадре, false - велика или предыдущий кадр ещё не принят.
+	*/
+	bool add(const uint8_t *data, size_t len, uint32_t now);
+	/// Отдать собираемый кадр, не дожидаясь срока.
+	/*!
+	  \param[in] now - Текущее время, мс.
+	  \return true - кадр принят или пуст.
+	*/
+	bool flush(uint32_t now);
+	/// Отдать кадр, если срок первой записи истёк.
+	/*!
+	  \param[in] now - Текущее время, мс.
+	  \return Через сколько мс вызвать снова.
+	*/
+	uint32_t poll(uint32_t now);
+
+	/// Записей в собираемом кадре.
+	inline uint16_t pending() { return mCount; };
+	/// Наибольшая запись.
+	size_t maxRecord();
+	/// Статистика.
+	SFrameStats stats();
+	/// Буфер создан успешно.
+	inline bool isValid() { return mBuf != nullptr; };
+};
+
+class CFrameView
+{
+protected:
+	const uint8_t *mPos; ///< Следующая запись.
+	const uint8_t *mEnd; ///< Конец кадра.
+	bool mValid;		 ///< Заголовок кадра корректен.
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] frame - Кадр вместе с заголовком.
+	  \param[in] len - Длина буфера.
+	*/
+	CFrameView(const uint8_t *frame, size_t len);
+
+	/// Следующая запись.
+	/*!
+	  \param[out] rec - Запись (указывает в буфер кадра).
+	  \return false - записи кончились или кадр повреждён (см. isValid()).
+	*/
+	bool next(SFrameRecord &rec);
+	/// Кадр корректен (после перебора - все записи в его границах).
+	inline bool isValid() { return mValid; };
+	/// Длина кадра по заголовку (0 - заголовка ещё нет).
+	static size_t frameSize(const uint8_t *data, size_t len);
+};
+
+class CFrameSplitter
+{
+public:
+	/// Обработка выделенного кадра.
+	typedef std::function<void(const uint8_t *frame, size_t len)> TFrame;
+
+protected:
+	TFrame mOnFrame;		 ///< Получатель кадров.
+	size_t mMtu;			 ///< Наибольший кадр.
+	uint8_t *mBuf = nullptr; ///< Начало разрезанного кадра.
+	size_t mHave = 0;		 ///< Байт разрезанного кадра.
+	bool mBroken = false;	 ///< Встречен кадр длиннее MTU (поток рассинхронизирован).
+
+	/// Отметить поток рассинхронизированным.
+	bool broken();
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] onFrame - Получатель кадров.
+	  \param[in] mtu - Наибольший кадр вместе с заголовком.
+	  \param[in] caps - Тип памяти буфера (MALLOC_CAP_...).
+	*/
+	CFrameSplitter(TFrame onFrame, size_t mtu = CONFIG_WIFICHN_FRAME_MTU, uint32_t caps = MALLOC_CAP_DEFAULT);
+	/// Деструктор.
+	~CFrameSplitter();
+
+	/// Принять кусок потока.
+	/*!
+	  \param[in] data - Данные.
+	  \param[in] len - Длина.
+	  \return false - в потоке кадр длиннее MTU, дальнейший разбор невозможен (закройте соединение).
+	*/
+	bool feed(const uint8_t *data, size_t len);
+	/// Сбросить разрезанный кадр (новое соединение).
+	void reset();
+	/// Буфер создан успешно.
+	inline bool isValid() { return mBuf != nullptr; };
+};
@@ -0,0 +1,117 @@
+/*!
+	\file
+	\brief Пул постоянных HTTP(S) соединений.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Клиент esp_http_client после полностью прочитанного ответа сохраняет TCP/TLS
+	соединение, и следующий запрос к тому же серверу (схема, хост, порт) уходит
+	без разрешения имени и TLS-рукопожатия. Пул хранит такие клиенты между
+	запросами OTA и приложения. Закрытое сервером соединение обнаруживается
+	при первом запросе и переоткрывается (см. isWarm()).
+	Повторно выдаётся только клиент с теми же настройками (обработчик событий,
+	метод, таймаут, авторизация, проверка сертификата сервера и т.д.):
+	esp_http_client не позволяет сменить их у созданного клиента, обработчик
+	прошлого владельца разобрал бы чужой user_data, а соединение, открытое с
+	пакетом CA, не проверялось по закреплённому сертификату.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_http_client.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class CHttpPool
+{
+protected:
+	/// Элемент пула.
+	struct SEntry
+	{
+		esp_http_client_handle_t client = nullptr; ///< Клиент.
+		std::string origin;						   ///< Сервер (схема://хост:порт).
+		std::string settings;					   ///< Настройки клиента кроме URL (см. settings()).
+		std::vector<std::string> headers;		   ///< Заголовки, заданные setHeader().
+		int bufferSize = 0;						   ///< Размер буфера приёма клиента.
+		int64_t used = 0;						   ///< Время освобождения, мкс.
+		bool busy = false;						   ///< Клиент выдан.
+		bool stale = false;						   ///< Закрыть при возврате (пул сброшен).
+		bool warm = false;						   ///< Соединение открыто предыдущим запросом.
+	};
+
+	SEntry mEntries[CONFIG_WIFICHN_HTTP_POOL_SIZE]; ///< Клиенты.
+	std::mutex mMutex;								///< Защита пула.
+	uint32_t mHits = 0;								///< Выдано клиентов с открытым соединением.
+	uint32_t mMisses = 0;							///< Создано новых клиентов.
+
+	/// Сервер из URL.
+	/*!
+	  \param[in] url - URL.
+	  \return схема://хост:порт (порт по умолчанию для схемы, если не указан).
+	*/
+	static std::string origin(const char *url);
+	/// Настройки клиента, которые нельзя сменить после esp_http_client_init().
+	/*!
+	  \param[in] cfg - Настройки HTTP клиента.
+	  \return Ключ сравнения (URL, user_data и размер буфера приёма не входят).
+	*/
+	static std::string settings(const esp_http_client_config_t &cfg);
+	/// Найти элемент по клиенту.
+	SEntry *find(esp_http_client_handle_t client);
+	/// Закрыть клиент элемента.
+	static void close(SEntry &entry);
+
+public:
+	/// Деструктор.
+	~CHttpPool();
+
+	/// Взять клиент для запроса.
+	/*!
+	  Если в пуле есть свободный клиент того же сервера с теми же настройками
+	  (см. settings()) и буфером приёма не меньше cfg.buffer_size, ему задаются
+	  cfg.url и cfg.user_data. Иначе создаётся новый клиент; если пул занят,
+	  возвращается клиент вне пула, release() его удалит. Заголовки запроса
+	  задаются через setHeader(), иначе они достанутся следующему владельцу.
+	  \param[in] cfg - Настройки HTTP клиента.
+	  \return Клиент или nullptr.
+	*/
+	esp_http_client_handle_t acquire(const esp_http_client_config_t &cfg);
+	/// Вернуть клиент.
+	/*!
+	  \param[in] client - Клиент из acquire().
+	  \param[in] keep - true - ответ прочитан целиком, соединение можно использовать
+	  повторно; false - закрыть соединение (ошибка, ответ прочитан частично).
+	*/
+	void release(esp_http_client_handle_t client, bool keep);
+	/// Задать заголовок запроса (удаляется при возврате клиента в пул).
+	/*!
+	  \param[in] client - Клиент из acquire().
+	  \param[in] key - Имя заголовка.
+	  \param[in] value - Значение.
+	  \return Код ошибки esp_http_client_set_header().
+	*/
+	esp_err_t setHeader(esp_http_client_handle_t client, const char *key, const char *value);
+	/// Соединение клиента открыто предыдущим запросом (могло быть закрыто сервером).
+	bool isWarm(esp_http_client_handle_t client);
+	/// Отправить запрос и принять заголовки ответа.
+	/*!
+	  Аналог esp_http_client_open() + esp_http_client_fetch_headers(): если сохранённое
+	  соединение оказалось закрыто сервером, запрос повторяется по новому соединению.
+	  \param[in] client - Клиент из acquire().
+	  \param[in] writeLen - Длина тела запроса.
+	  \param[out] contentLength - Длина тела ответа (0 - неизвестна).
+	  \return Код ошибки.
+	*/
+	esp_err_t open(esp_http_client_handle_t client, int writeLen, int64_t &contentLength);
+	/// Закрыть все соединения (при потере связи). Выданные клиенты закрываются при возврате.
+	void flush();
+
+	/// Выдано клиентов с открытым соединением.
+	inline uint32_t hits() { return mHits; };
+	/// Создано новых клиентов.
+	inline uint32_t misses() { return mMisses; };
+};
@@ -0,0 +1,123 @@
+/*!
+	\file
+	\brief Монитор качества канала WiFi: RSSI, режим PHY, потери маяков, причины отключений.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Пока есть IP адрес, таймер esp_timer раз в CONFIG_WIFICHN_LINK_MON_PERIOD_MS
+	опрашивает драйвер (RSSI, согласованный режим PHY, канал) и пишет отсчёт в
+	кольцевой буфер. Сглаженный RSSI, оценка качества и ожидаемой скорости
+	хранятся в атомарных переменных: приложение и планирование OTA читают их
+	без вызовов драйвера. Потери маяков и отключения приходят из обработчика
+	событий WiFiStation.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#define LINKMON_EWMA_SHIFT (3)		  ///< Сглаживание RSSI: вес нового отсчёта 1/8.
+#define LINKMON_RSSI_MIN (-90)		  ///< RSSI, при котором качество 0%.
+#define LINKMON_RSSI_MAX (-50)		  ///< RSSI, при котором качество 100%.
+#define LINKMON_EFFICIENCY_PCT (50)	  ///< Доля канальной скорости, доступная TCP.
+#define LINKMON_BEACON_PENALTY (20)	  ///< Снижение качества за каждую потерю маяков в окне, %.
+#define LINKMON_BEACON_WINDOW_S (60)  ///< Окно учёта потерь маяков, с.
+
+/// Отсчёт монитора канала.
+struct SLinkSample
+{
+	uint32_t time_ms; ///< Время от старта, мс.
+	int8_t rssi;	  ///< RSSI, дБм.
+	uint8_t phy;	  ///< Режим PHY (wifi_phy_mode_t).
+	uint8_t channel;  ///< Основной канал.
+	uint8_t quality;  ///< Качество, %.
+	uint32_t kbps;	  ///< Ожидаемая скорость, кбит/с.
+};
+
+class CLinkMonitor
+{
+protected:
+	SLinkSample mRing[CONFIG_WIFICHN_LINK_MON_SAMPLES];	///< Кольцевой буфер отсчётов.
+	size_t mHead = 0;									///< Индекс записи.
+	size_t mCount = 0;									///< Число отсчётов в буфере.
+	portMUX_TYPE mMux = portMUX_INITIALIZER_UNLOCKED;	///< Защита буфера.
+	esp_timer_handle_t mTimer = nullptr;				///< Таймер опроса.
+
+	int32_t mRssiAcc = 0;								///< Сглаженный RSSI << LINKMON_EWMA_SHIFT.
+	bool mFirst = true;									///< Нет отсчётов после подключения.
+	std::atomic<int8_t> mRssi{0};						///< Сглаженный RSSI, дБм.
+	std::atomic<uint8_t> mQuality{0};					///< Качество, %.
+	std::atomic<uint32_t> mKbps{0};						///< Ожидаемая скорость, кбит/с.
+	std::atomic<uint8_t> mPhy{0};						///< Режим PHY.
+	std::atomic<uint32_t> mBeaconLoss{0};				///< Потерь маяков с момента запуска.
+	std::atomic<uint32_t> mLastBeaconLoss{0};			///< Время последней потери маяков, мс.
+	std::atomic<uint32_t> mRecentBeaconLoss{0};			///< Потерь маяков в окне LINKMON_BEACON_WINDOW_S.
+	std::atomic<uint32_t> mDisconnects{0};				///< Отключений с момента запуска.
+	std::atomic<uint8_t> mLastReason{0};				///< Причина последнего отключения.
+
+	/// Callback таймера.
+	static void timer_cb(void *arg);
+	/// Добавить отсчёт.
+	/*!
+	  \param[in] rssi - RSSI, дБм.
+	  \param[in] phy - Режим PHY (wifi_phy_mode_t).
+	  \param[in] channel - Основной канал.
+	*/
+	void addSample(int8_t rssi, uint8_t phy, uint8_t channel);
+
+public:
+	/// Конструктор.
+	CLinkMonitor();
+	/// Деструктор.
+	~CLinkMonitor();
+
+	/// Запуск опроса (IP адрес получен).
+	void start();
+	/// Остановка опроса.
+	void stop();
+	/// Потеря маяков точки доступа (WIFI_EVENT_STA_BEACON_TIMEOUT).
+	void onBeaconTimeout();
+	/// Отключение от точки доступа.
+	/*!
+	  \param[in] reason - Причина (wifi_err_reason_t).
+	*/
+	void onDisconnect(uint8_t reason);
+
+	/// Сглаженный RSSI, дБм (0 - нет данных).
+	inline int8_t rssi() { return mRssi.load(std::memory_order_relaxed); };
+	/// Качество канала, % (0 - нет связи).
+	inline uint8_t quality() { return mQuality.load(std::memory_order_relaxed); };
+	/// Ожидаемая скорость TCP, кбит/с.
+	inline uint32_t expectedKbps() { return mKbps.load(std::memory_order_relaxed); };
+	/// Согласованный режим PHY (wifi_phy_mode_t).
+	inline uint8_t phy() { return mPhy.load(std::memory_order_relaxed); };
+	/// Потерь маяков с момента запуска.
+	inline uint32_t beaconLosses() { return mBeaconLoss.load(std::memory_order_relaxed); };
+	/// Отключений с момента запуска.
+	inline uint32_t disconnects() { return mDisconnects.load(std::memory_order_relaxed); };
+	/// Причина последнего отключения (wifi_err_reason_t).
+	inline uint8_t lastReason() { return mLastReason.load(std::memory_order_relaxed); };
+
+	/// Последние отсчёты (от старых к новым).
+	/*!
+	  \param[out] buf - Буфер отсчётов.
+	  \param[in] max - Размер буфера в отсчётах.
+	  \return Число скопированных отсчётов.
+	*/
+	size_t history(SLinkSample *buf, size_t max);
+
+	/// Канальная скорость по режиму PHY и RSSI.
+	/*!
+	  \param[in] phy - Режим PHY (wifi_phy_mode_t).
+	  \param[in] rssi - RSSI, дБм.
+	  \return Скорость, кбит/с (0 - связь при таком RSSI маловероятна).
+	*/
+	static uint32_t phyRate(uint8_t phy, int8_t rssi);
+};
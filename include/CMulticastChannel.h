@@ -0,0 +1,207 @@
+/*!
+	\file
+	\brief Групповая рассылка датаграмм одному множеству узлов: номера, NACK, разбиение и сборка.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Протокол не зависит от транспорта: рассылка уходит через TTransmit (адрес
+	группы), ответ источнику последнего принятого пакета - через TReply, принятые
+	пакеты подаются в input(), таймеры обслуживает poll(). Время передаётся
+	параметром (мс), поэтому отправителя и несколько получателей можно соединить
+	в памяти с независимыми потерями.
+
+	Отправитель нумерует фрагменты сквозным номером и хранит последние
+	CONFIG_WIFICHN_MCAST_HISTORY из них для повторов. Получатель не подтверждает
+	каждый пакет (иначе ответы всего парка забьют эфир), а сообщает о пропусках:
+	NACK с первым пропущенным номером и картой следующих 32. NACK уходит после
+	случайной задержки, повтор рассылается всей группе, и отправитель не повторяет
+	один номер чаще MCAST_REPAIR_HOLDOFF_MS - так пропуск, общий для многих
+	получателей, исправляется одним пакетом. Потеря хвоста рассылки обнаруживается
+	по нескольким пакетам-маякам с номером следующего фрагмента; без рассылки маяк
+	уходит раз в MCAST_IDLE_BEACON_MS, чтобы получатели знали сеанс отправителя до
+	первой команды.
+
+	Сообщение больше MCAST_CHUNK разбивается на фрагменты и собирается получателем
+	в заранее выделенный буфер (CONFIG_WIFICHN_MCAST_REASM буферов по
+	CONFIG_WIFICHN_MCAST_MAX_MSG байт). Сообщения доставляются по мере сборки, без
+	упорядочивания. Получатель начинает с первого услышанного пакета: команды,
+	разосланные до его включения, не повторяются. Новый сеанс отправителя
+	(перезагрузка) сбрасывает состояние приёма; краткий обрыв связи - нет, и
+	пропущенное за обрыв запрашивается, пока оно есть в истории отправителя.
+	Экземпляр не потокобезопасен.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "CBufferPool.h"
+#include "esp_heap_caps.h"
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#define MCAST_CHUNK CONFIG_WIFICHN_MCAST_CHUNK										///< Данных во фрагменте, байт.
+#define MCAST_HEADER_SIZE (20)														///< Заголовок пакета.
+#define MCAST_MAX_CHUNKS ((CONFIG_WIFICHN_MCAST_MAX_MSG + MCAST_CHUNK - 1) / MCAST_CHUNK) ///< Фрагментов в сообщении.
+#define MCAST_NACK_DELAY_MS (20)													///< Наибольшая случайная задержка NACK.
+#define MCAST_NACK_INTERVAL_MS (60)													///< Пауза между повторными NACK одного пропуска.
+#define MCAST_REPAIR_HOLDOFF_MS (20)												///< Пауза между повторами одного номера.
+#define MCAST_HEARTBEAT_MS (30)														///< Первая пауза перед маяком (дальше - удвоение).
+#define MCAST_HEARTBEATS (3)														///< Маяков после каждой рассылки.
+#define MCAST_IDLE_BEACON_MS (2000)													///< Период маяка без рассылки.
+
+static_assert(MCAST_MAX_CHUNKS <= 0xffff, "CONFIG_WIFICHN_MCAST_MAX_MSG / CONFIG_WIFICHN_MCAST_CHUNK is too large");
+
+/// Тип пакета.
+enum class EMcastType : uint8_t
+{
+	Data = 1,	  ///< Фрагмент сообщения.
+	Nack = 2,	  ///< Запрос повтора (получатель -> отправитель).
+	Heartbeat = 3 ///< Номер следующего фрагмента (потеря хвоста).
+};
+
+/// Статистика канала.
+struct SMcastStats
+{
+	uint32_t sent;		   ///< Отправлено сообщений.
+	uint32_t chunks;	   ///< Отправлено фрагментов (без повторов).
+	uint32_t repairs;	   ///< Повторено фрагментов по NACK.
+	uint32_t heartbeats;   ///< Отправлено маяков.
+	uint32_t nacksSent;	   ///< Отправлено NACK.
+	uint32_t nacksRecv;	   ///< Принято NACK.
+	uint32_t delivered;	   ///< Доставлено сообщений приложению.
+	uint32_t duplicates;   ///< Принято повторов.
+	uint32_t lost;		   ///< Фрагментов, не полученных за все NACK.
+	uint32_t incomplete;   ///< Сообщений, вытесненных несобранными.
+	uint32_t dropped;	   ///< Отброшено (формат, размер).
+};
+
+class CMulticastChannel
+{
+public:
+	/// Рассылка пакета группе.
+	typedef std::function<void(const uint8_t *data, size_t len)> TTransmit;
+	/// Ответ источнику последнего принятого пакета.
+	typedef std::function<void(const uint8_t *data, size_t len)> TReply;
+	/// Доставка собранного сообщения приложению.
+	typedef std::function<void(uint16_t id, const uint8_t *data, size_t len)> TDeliver;
+
+protected:
+	/// Отправленный фрагмент, хранимый для повтора.
+	struct SHistory
+	{
+		uint8_t *buf;	   ///< Пакет с заголовком (nullptr - слот свободен).
+		uint16_t len;	   ///< Длина пакета.
+		uint16_t seq;	   ///< Номер фрагмента.
+		uint32_t repaired; ///< Время последнего повтора, мс.
+		bool wasRepaired;  ///< Повтор уже был.
+	};
+	/// Собираемое сообщение.
+	struct SReasm
+	{
+		uint8_t *buf;							 ///< Буфер пула (nullptr - слот свободен).
+		uint16_t id;							 ///< Номер сообщения.
+		uint16_t count;							 ///< Фрагментов в сообщении.
+		uint16_t have;							 ///< Принято фрагментов.
+		uint32_t len;							 ///< Длина сообщения.
+		uint32_t started;						 ///< Время первого фрагмента, мс.
+		uint8_t map[(MCAST_MAX_CHUNKS + 7) / 8]; ///< Принятые фрагменты.
+	};
+
+	TTransmit mTransmit;								  ///< Рассылка.
+	TReply mReply;										  ///< Ответ источнику.
+	TDeliver mDeliver;									  ///< Получатель сообщений.
+	uint16_t mHistorySize;								  ///< Фрагментов в истории (0 - только приём).
+	CBufferPool mTxPool;								  ///< Буферы истории.
+	CBufferPool mRxPool;								  ///< Буферы сборки.
+	SMcastStats mStats = {};							  ///< Статистика.
+	uint32_t mRand;										  ///< Состояние генератора задержек NACK.
+
+	SHistory *mHistory = nullptr;						  ///< История (индекс - seq % mHistorySize).
+	uint32_t mTxSession;								  ///< Сеанс отправителя.
+	uint16_t mTxNext = 0;								  ///< Номер следующего фрагмента.
+	uint16_t mMsgId = 0;								  ///< Номер следующего сообщения.
+	uint8_t mBeacons = 0;								  ///< Осталось маяков.
+	uint32_t mBeaconAt = 0;								  ///< Время следующего маяка, мс.
+	uint32_t mLastTx = 0;								  ///< Время последней рассылки, мс.
+	bool mAnnounced = false;							  ///< Первый маяк отправлен.
+
+	bool mSynced = false;								  ///< Сеанс отправителя известен.
+	uint32_t mRxSession = 0;							  ///< Сеанс отправителя.
+	uint16_t mRxNext = 0;								  ///< Первый не принятый номер.
+	uint32_t mRxMask = 0;								  ///< Приняты mRxNext+1+i (бит i).
+	uint16_t mRxEnd = 0;								  ///< Номер за последним известным фрагментом.
+	bool mNackPending = false;							  ///< NACK запланирован.
+	uint32_t mNackAt = 0;								  ///< Время NACK, мс.
+	uint8_t mNackTries = 0;								  ///< NACK для mRxNext.
+	SReasm mReasm[CONFIG_WIFICHN_MCAST_REASM] = {};		  ///< Собираемые сообщения.
+
+	/// Случайная задержка 0..max, мс.
+	uint32_t jitter(uint32_t max);
+	/// Заполнить заголовок.
+	void header(uint8_t *p, EMcastType type, uint32_t session, uint16_t seq);
+	/// Старейший номер в истории.
+	uint16_t oldest();
+	/// Разослать маяк.
+	void sendBeacon(uint32_t now);
+	/// Отправить NACK.
+	void sendNack();
+	/// Сдвинуть начало окна приёма за принятые номера.
+	void stepRx();
+	/// Номер принят (или больше не ожидается).
+	bool isReceived(uint16_t seq);
+	/// Отметить номер принятым.
+	void markReceived(uint16_t seq);
+	/// Сбросить состояние приёма (новый сеанс отправителя).
+	void resync(uint32_t session, uint16_t first);
+	/// Освободить слот сборки.
+	void release(SReasm &r);
+
+	/// Обработка NACK.
+	void onNack(uint16_t base, uint32_t map, uint32_t now);
+	/// Обработка фрагмента.
+	void onChunk(uint16_t id, uint16_t index, uint16_t count, uint32_t total, const uint8_t *data, size_t len, uint32_t now);
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] transmit - Рассылка группе.
+	  \param[in] reply - Ответ источнику последнего принятого пакета.
+	  \param[in] deliver - Получатель сообщений.
+	  \param[in] history - Фрагментов в истории повторов (0 - узел только принимает).
+	  \param[in] caps - Тип памяти буферов (MALLOC_CAP_...).
+	*/
+	CMulticastChannel(TTransmit transmit, TReply reply, TDeliver deliver, uint16_t history = CONFIG_WIFICHN_MCAST_HISTORY, uint32_t caps = MALLOC_CAP_DEFAULT);
+	/// Деструктор.
+	~CMulticastChannel();
+
+	/// Разослать сообщение.
+	/*!
+	  \param[in] data - Сообщение.
+	  \param[in] len - Длина (не больше CONFIG_WIFICHN_MCAST_MAX_MSG и истории повторов).
+	  \param[in] now - Текущее время, мс.
+	  \return Номер сообщения или -1 (слишком длинное, узел только принимает).
+	*/
+	int32_t send(const uint8_t *data, size_t len, uint32_t now);
+	/// Обработать принятый пакет.
+	/*!
+	  \param[in] data - Пакет.
+	  \param[in] len - Длина пакета.
+	  \param[in] now - Текущее время, мс.
+	*/
+	void input(const uint8_t *data, size_t len, uint32_t now);
+	/// Обслуживание таймеров (NACK, маяки, устаревшие сборки).
+	/*!
+	  \param[in] now - Текущее время, мс.
+	  \return Через сколько мс вызвать снова.
+	*/
+	uint32_t poll(uint32_t now);
+	/// Забыть отправителя: приём начнётся заново со следующего услышанного сообщения.
+	void reset();
+
+	/// Статистика.
+	inline SMcastStats stats() { return mStats; };
+	/// Буферы созданы успешно.
+	inline bool isValid() { return mRxPool.isValid() && ((mHistorySize == 0) || ((mHistory != nullptr) && mTxPool.isValid())); };
+};
@@ -0,0 +1,161 @@
+/*!
+	\file
+	\brief Конвейер закачки образа: HTTP(S) источник, проверка, буферизация и запись в приёмник.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Общая часть OTA для любых приёмников (COtaSink): повторы подключения и переадресация,
+	манифест и потоковая проверка (COtaVerifier), накопление в PSRAM и запись пакетами
+	в окнах writeEvent, прогресс. Данные можно подавать и без HTTP - через feed().
+	С манифестом буфер накопления не меньше порции манифеста, и в приёмник уходят
+	только сверенные порции: данные подменённой порции не попадают ни во flash,
+	ни в обработчик приёмника.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "COtaSink.h"
+#include "COtaVerifier.h"
+#include "COtaTuner.h"
+#include "CTlsStats.h"
+#include "esp_http_client.h"
+#if CONFIG_WIFICHN_HTTP_POOL
+#include "CHttpPool.h"
+#endif
+#include <atomic>
+#include <functional>
+
+#if CONFIG_WIFICHN_QOS
+class CTrafficTask;
+#endif
+
+class COtaPipeline
+{
+public:
+	/// Обработчик статуса.
+	/*!
+	  \param[in] progress - Прогресс, %.
+	  \param[in] status - Статус (EOtaStatus).
+	  \param[in] written - Принято байт.
+	*/
+	typedef std::function<void(uint16_t progress, int16_t status, uint32_t written)> TNotify;
+
+protected:
+	COtaSink *mSink;			 ///< Приёмник.
+	std::atomic<bool> &mCancel;	 ///< Флаг отмены.
+	TNotify mNotify;			 ///< Обработчик статуса.
+	uint32_t mCaps;				 ///< Тип памяти буферов.
+	size_t mReadSize;			 ///< Размер одного чтения.
+	COtaVerifier mVerifier;		 ///< Проверка образа.
+	uint8_t *mBuf = nullptr;	 ///< Буфер накопления.
+	size_t mBufSize = 0;		 ///< Размер буфера накопления.
+	size_t mFill = 0;			 ///< Заполнено байт в буфере.
+	uint32_t mSize = 0;			 ///< Размер образа.
+	uint32_t mWritten = 0;		 ///< Принято байт.
+	uint16_t mProgress = 0xffff; ///< Последний сообщённый прогресс.
+#if CONFIG_WIFICHN_HTTP_POOL
+	CHttpPool *mPool = nullptr; ///< Пул соединений (nullptr - новое соединение на каждый запрос).
+#endif
+	COtaTuner *mTuner = nullptr; ///< Подбор размера чтения (nullptr - всегда readSize).
+	CTlsStats *mTls = nullptr;	 ///< Замер первого TLS подключения (nullptr - нет).
+#if CONFIG_WIFICHN_QOS
+	CTrafficTask *mQos = nullptr; ///< Очереди классов трафика (закачка уступает старшим классам).
+#endif
+
+	/// Сообщить статус.
+	void notify(uint16_t progress, int16_t status);
+	/// Принять mFill + len байт буфера (данные уже в mBuf).
+	/*!
+	  \param[in] len - Число новых байт в буфере.
+	  \return Статус (EOtaStatus).
+	*/
+	int16_t commit(size_t len);
+	/// Запись первых len байт буфера пакетами по OTATASK_BURST_SIZE (остаток сдвигается в начало).
+	int16_t flushStage(size_t len);
+	/// HTTP клиент для запроса (из пула, если он задан).
+	esp_http_client_handle_t connect(esp_http_client_config_t &cfg);
+	/// Освободить HTTP клиент.
+	/*!
+	  \param[in] client - Клиент из connect().
+	  \param[in] keep - Ответ прочитан целиком, соединение можно сохранить.
+	*/
+	void disconnect(esp_http_client_handle_t client, bool keep);
+	/// Отправить GET запрос и принять заголовки ответа.
+	/*!
+	  \param[in] client - Клиент из connect().
+	  \param[out] len - Длина тела ответа.
+	  \return Код ошибки.
+	*/
+	esp_err_t request(esp_http_client_handle_t client, int64_t &len);
+	/// Открыть HTTP(S) поток (с повторами и переадресацией).
+	esp_err_t open(esp_http_client_handle_t client);
+	/// Загрузить манифест.
+	/*!
+	  \param[in] cfg - Настройки HTTP клиента (url - адрес манифеста).
+	  \param[in] key - Открытый ключ PEM (nullptr - без подписи).
+	  \return false - закачку не начинать.
+	*/
+	bool loadManifest(esp_http_client_config_t &cfg, const char *key);
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] sink - Приёмник.
+	  \param[in] event - Обработчик начала/конца записи во flash.
+	  \param[in] cancel - Флаг отмены.
+	  \param[in] notify - Обработчик статуса (может быть пустым).
+	  \param[in] caps - Тип памяти буферов (MALLOC_CAP_...).
+	  \param[in] readSize - Размер одного чтения.
+	*/
+	COtaPipeline(COtaSink *sink, onWriteEvent *event, std::atomic<bool> &cancel, TNotify notify, uint32_t caps, size_t readSize);
+	/// Деструктор.
+	~COtaPipeline();
+
+	/// Начало образа.
+	/*!
+	  \param[in] size - Размер образа.
+	  \return Статус (EOtaStatus).
+	*/
+	int16_t begin(uint32_t size);
+	/// Очередная порция образа.
+	/*!
+	  \param[in] data - Данные.
+	  \param[in] len - Длина данных.
+	  \return Статус (EOtaStatus).
+	*/
+	int16_t feed(const uint8_t *data, size_t len);
+	/// Завершение образа (вызывается после приёма size байт или при ошибке).
+	/*!
+	  \param[in] res - Статус приёма.
+	  \return Итоговый статус (EOtaStatus).
+	*/
+	int16_t end(int16_t res);
+
+	/// Закачка по HTTP(S).
+	/*!
+	  \param[in] cfg - Настройки HTTP клиента.
+	  \param[in] manifest - URL манифеста (nullptr - без манифеста).
+	  \param[in] key - Открытый ключ PEM подписи манифеста (nullptr - без подписи).
+	  \return Итоговый статус (EOtaStatus).
+	*/
+	int16_t download(esp_http_client_config_t &cfg, const char *manifest = nullptr, const char *key = nullptr);
+
+#if CONFIG_WIFICHN_HTTP_POOL
+	/// Брать HTTP соединения из пула (манифест и образ идут по одному соединению).
+	inline void setPool(CHttpPool *pool) { mPool = pool; };
+#endif
+	/// Подбирать размер чтения (readSize конструктора - не меньше наибольшего варианта).
+	inline void setTuner(COtaTuner *tuner) { mTuner = tuner; };
+	/// Замерять первое TLS подключение (в cfg должны быть event_handler = CTlsStats::handler, user_data = tls).
+	inline void setTlsStats(CTlsStats *tls) { mTls = tls; };
+#if CONFIG_WIFICHN_QOS
+	/// Закачка - фоновый трафик: перед каждым чтением ждать, пока заняты старшие классы.
+	inline void setQos(CTrafficTask *qos) { mQos = qos; };
+#endif
+	/// Проверка образа (манифест можно загрузить вручную до begin()).
+	inline COtaVerifier &verifier() { return mVerifier; };
+	/// Принято байт.
+	inline uint32_t written() { return mWritten; };
+};
@@ -0,0 +1,223 @@
+/*!
+	\file
+	\brief Приёмники образа OTA: раздел приложения, произвольный раздел, файл, обработчик.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Приёмник получает образ от COtaPipeline, которая отвечает за закачку, буферизацию,
+	проверку, прогресс и повторы. Запись во flash (раздел, файл на SPIFFS) выполняется
+	внутри окон writeEvent, как и обновление приложения.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "COtaWriter.h"
+#include "CWiFiEventStream.h"
+#include "esp_app_format.h"
+#include "esp_heap_caps.h"
+#include <cstdio>
+#include <string>
+
+/// Статистика записи приёмника.
+struct SOtaSinkStats
+{
+	uint32_t sectors = 0;	///< Обработано секторов.
+	uint32_t skipped = 0;	///< Пропущено неизменённых секторов.
+	int64_t writeTime = 0;	///< Время записи, мкс.
+	int64_t savedTime = 0;	///< Оценка сэкономленного времени, мкс.
+	uint32_t locks = 0;		///< Число окон writeEvent.
+	int64_t lockTime = 0;	///< Суммарная длительность окон writeEvent, мкс.
+	int64_t maxLock = 0;	///< Наибольшая длительность окна writeEvent, мкс.
+};
+
+/// Приёмник образа.
+class COtaSink
+{
+protected:
+	onWriteEvent *mEvent = nullptr; ///< Обработчик начала/конца записи во flash.
+
+public:
+	/// Деструктор.
+	virtual ~COtaSink() {};
+
+	/// Задать обработчик начала/конца записи во flash (вызывается COtaPipeline до begin()).
+	inline void setWriteEvent(onWriteEvent *event) { mEvent = event; };
+
+	/// Начало приёма.
+	/*!
+	  \param[in] size - Размер образа.
+	  \return Статус (EOtaStatus).
+	*/
+	virtual int16_t begin(uint32_t size) = 0;
+	/// Просмотр данных сразу по приёму, до буферизации (например, проверка заголовка).
+	/*!
+	  \param[in] offset - Смещение данных в образе.
+	  \param[in] data - Данные.
+	  \param[in] len - Длина данных.
+	  \return Статус (EOtaStatus), ошибка прерывает закачку.
+	*/
+	virtual int16_t inspect(uint32_t offset, const uint8_t *data, size_t len) { return OTA_STATUS_OK; };
+	/// Запись очередной порции.
+	/*!
+	  \param[in] data - Данные.
+	  \param[in] len - Длина данных.
+	  \return Статус (EOtaStatus).
+	*/
+	virtual int16_t write(const uint8_t *data, size_t len) = 0;
+	/// Образ принят и проверен - зафиксировать.
+	/*!
+	  \return Статус (EOtaStatus).
+	*/
+	virtual int16_t finish() = 0;
+	/// Приём прерван.
+	virtual void abort() {};
+
+	/// Начало пакета записей (одно окно writeEvent на пакет).
+	virtual void beginBurst() {};
+	/// Конец пакета записей.
+	virtual void endBurst() {};
+
+	/// Образ содержит дописанный в конец SHA-256 (проверяется COtaVerifier).
+	virtual bool hashAppended() { return false; };
+	/// Статистика записи.
+	virtual void stats(SOtaSinkStats &st) { st = SOtaSinkStats(); };
+};
+
+/// Запись в раздел flash (по умолчанию - с пропуском неизменённых секторов).
+class COtaPartitionSink : public COtaSink
+{
+protected:
+	const esp_partition_t *mPart; ///< Раздел назначения.
+	bool mSkip;					  ///< Пропускать неизменённые сектора.
+	uint32_t mCaps;				  ///< Тип памяти буфера сектора.
+	COtaWriter *mWriter = nullptr; ///< Запись секторов.
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] part - Раздел назначения.
+	  \param[in] skipUnchanged - Пропускать неизменённые сектора.
+	  \param[in] caps - Тип памяти буфера сектора (MALLOC_CAP_...).
+	*/
+	COtaPartitionSink(const esp_partition_t *part, bool skipUnchanged = true, uint32_t caps = MALLOC_CAP_DEFAULT);
+	/// Конструктор.
+	/*!
+	  \param[in] label - Метка раздела данных.
+	  \param[in] skipUnchanged - Пропускать неизменённые сектора.
+	  \param[in] caps - Тип памяти буфера сектора (MALLOC_CAP_...).
+	*/
+	COtaPartitionSink(const char *label, bool skipUnchanged = true, uint32_t caps = MALLOC_CAP_DEFAULT);
+	/// Деструктор.
+	virtual ~COtaPartitionSink();
+
+	virtual int16_t begin(uint32_t size) override;
+	virtual int16_t write(const uint8_t *data, size_t len) override;
+	virtual int16_t finish() override;
+	virtual void abort() override;
+	virtual void beginBurst() override;
+	virtual void endBurst() override;
+	virtual void stats(SOtaSinkStats &st) override;
+};
+
+/// Обновление приложения: неактивный OTA раздел + проверка заголовка + смена загрузочного раздела.
+class COtaAppSink : public COtaPartitionSink
+{
+public:
+	/// Обработчик описания образа.
+	typedef void onImageDesc(esp_app_desc_t &desc);
+
+protected:
+	onImageDesc *mDesc;			  ///< Обработчик описания образа (nullptr - нет).
+	alignas(4) uint8_t mHead[sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t)]; ///< Заголовок образа и описание приложения.
+	bool mHashAppended = false;	  ///< В заголовке образа указан дописанный SHA-256.
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] skipUnchanged - Пропускать неизменённые сектора.
+	  \param[in] caps - Тип памяти буфера сектора (MALLOC_CAP_...).
+	  \param[in] desc - Обработчик описания образа.
+	*/
+	COtaAppSink(bool skipUnchanged = true, uint32_t caps = MALLOC_CAP_DEFAULT, onImageDesc *desc = nullptr);
+
+	virtual int16_t inspect(uint32_t offset, const uint8_t *data, size_t len) override;
+	virtual int16_t finish() override;
+	virtual bool hashAppended() override;
+};
+
+/// Запись в файл (SPIFFS и т.п.): во временный файл, переименование после проверки.
+/*!
+  Прежний файл до появления нового переименовывается в резервный (имя + ".bak") и
+  удаляется последним, поэтому при пропадании питания на диске остаётся прежний или
+  новый образ. Если после сбоя остался только резервный, конструктор возвращает его.
+*/
+class COtaFileSink : public COtaSink
+{
+protected:
+	std::string mPath;		///< Имя файла.
+	std::string mTemp;		///< Имя временного файла.
+	std::string mBackup;	///< Имя резервной копии прежнего файла.
+	FILE *mFile = nullptr;	///< Временный файл.
+	COtaLock mLock;			///< Окна writeEvent (создаётся в begin()).
+	bool mBurst = false;	///< Идёт пакетная запись.
+	int64_t mWriteTime = 0; ///< Время записи, мкс.
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] path - Имя файла.
+	*/
+	COtaFileSink(const char *path);
+	/// Деструктор.
+	virtual ~COtaFileSink();
+
+	virtual int16_t begin(uint32_t size) override;
+	virtual int16_t write(const uint8_t *data, size_t len) override;
+	virtual int16_t finish() override;
+	virtual void abort() override;
+	virtual void beginBurst() override;
+	virtual void endBurst() override;
+	virtual void stats(SOtaSinkStats &st) override;
+};
+
+/// Передача образа обработчику (например, в сопроцессор по UART/SPI).
+class COtaCallbackSink : public COtaSink
+{
+public:
+	/// Обработчик данных.
+	/*!
+	  \param[in] data - Данные.
+	  \param[in] len - Длина данных.
+	  \param[in] arg - Параметр обработчика.
+	  \return true - данные приняты.
+	*/
+	typedef bool onData(const uint8_t *data, size_t len, void *arg);
+	/// Обработчик завершения.
+	/*!
+	  \param[in] ok - true - образ принят и проверен, false - прерван.
+	  \param[in] arg - Параметр обработчика.
+	  \return true - образ зафиксирован (для ok == false не используется).
+	*/
+	typedef bool onEnd(bool ok, void *arg);
+
+protected:
+	onData *mData; ///< Обработчик данных.
+	onEnd *mEnd;   ///< Обработчик завершения (nullptr - нет).
+	void *mArg;	   ///< Параметр обработчиков.
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] data - Обработчик данных.
+	  \param[in] end - Обработчик завершения.
+	  \param[in] arg - Параметр обработчиков.
+	*/
+	COtaCallbackSink(onData *data, onEnd *end = nullptr, void *arg = nullptr) : mData(data), mEnd(end), mArg(arg) {};
+
+	virtual int16_t begin(uint32_t size) override { return OTA_STATUS_OK; };
+	virtual int16_t write(const uint8_t *data, size_t len) override;
+	virtual int16_t finish() override;
+	virtual void abort() override;
+};
@@ -0,0 +1,77 @@
+/*!
+	\file
+	\brief Подбор размера буфера HTTP(S) чтения по измеренной скорости.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	esp_http_client читает из сокета порциями не больше buffer_size (внутренняя RAM),
+	и лучший размер зависит от платы и точки доступа. При первой закачке начало
+	образа читается порциями разного размера (от OTATASK_TUNE_MIN до OTATASK_TUNE_MAX,
+	в пределах свободной кучи), выбирается самый быстрый, и он сохраняется в NVS
+	для следующих закачек. Повторный подбор - после reset(); для замера без записи
+	образа достаточно downloadAsync() с COtaCallbackSink, отбрасывающим данные.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include <cstdint>
+#include <cstddef>
+
+#define OTATUNER_MAX_STEPS (8) ///< Максимальное число вариантов размера.
+
+class COtaTuner
+{
+protected:
+	size_t mSizes[OTATUNER_MAX_STEPS];	///< Варианты размера.
+	uint32_t mRates[OTATUNER_MAX_STEPS]; ///< Измеренная скорость вариантов, байт/с.
+	uint8_t mCount = 0;					///< Число вариантов.
+	uint8_t mStep = 0;					///< Текущий вариант.
+	bool mWarmup = true;				///< Разгон TCP: первое окно не учитывается.
+	bool mActive = false;				///< Идёт подбор.
+	size_t mBest = 0;					///< Выбранный размер.
+	uint32_t mBestRate = 0;				///< Скорость выбранного варианта, байт/с.
+	size_t mBytes = 0;					///< Принято байт в текущем окне.
+	int64_t mTime = 0;					///< Время чтения в текущем окне, мкс.
+
+	/// Выбрать лучший вариант и сохранить его.
+	void finish();
+
+public:
+	/// Размер буфера для HTTP клиента.
+	/*!
+	  \param[in] def - Размер по умолчанию (если подбирать не из чего).
+	  \param[in] caps - Тип памяти буфера чтения (MALLOC_CAP_...).
+	  \param[in] force - Подбирать, даже если размер сохранён в NVS.
+	  \return Сохранённый размер, либо (на время подбора) наибольший вариант.
+	*/
+	size_t prepare(size_t def, uint32_t caps, bool force = false);
+	/// Размер очередного чтения.
+	inline size_t readSize() { return mActive ? mSizes[mStep] : mBest; };
+	/// Учесть очередное чтение.
+	/*!
+	  \param[in] len - Прочитано байт.
+	  \param[in] time - Длительность чтения, мкс.
+	*/
+	void account(size_t len, int64_t time);
+
+	/// Идёт подбор.
+	inline bool isActive() { return mActive; };
+	/// Выбранный размер (0 - ещё не выбран).
+	inline size_t best() { return mActive ? 0 : mBest; };
+	/// Скорость выбранного варианта, байт/с (0 - размер не подбирался).
+	inline uint32_t bestRate() { return mBestRate; };
+	/// Число вариантов.
+	inline uint8_t count() { return mCount; };
+	/// Скорость варианта, байт/с.
+	inline uint32_t rate(uint8_t i) { return mRates[i]; };
+
+	/// Забыть сохранённый размер (следующая закачка подберёт его заново).
+	static void reset();
+	/// Сохранённый размер.
+	/*!
+	  \return Размер или 0, если не сохранён.
+	*/
+	static size_t stored();
+};
@@ -0,0 +1,102 @@
+/*!
+	\file
+	\brief Потоковая проверка SHA-256 образа OTA с ранним прерыванием.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Хэш считается по мере приёма (mbedtls, на ESP32 - аппаратный SHA). Без манифеста
+	проверяется SHA-256, дописанный в конец образа ESP (esp_image_header_t::hash_appended).
+	С манифестом (JSON, загружается до образа) каждая порция сверяется со своим хэшем
+	сразу по приёму, и подменённая порция прерывает закачку, не дожидаясь конца образа
+	(COtaPipeline отдаёт приёмнику только сверенные порции, см. verified()):
+
+	{"size":N,"chunk":65536,"sha256":"<hex>","chunks":["<hex>",...],"sig":"<hex>"}
+
+	Подпись (ECDSA/RSA, открытый ключ PEM) ставится на SHA-256 двоичной строки
+	size(LE32) | chunk(LE32) | sha256 | chunks[0] | chunks[1] ... (см. tools/ota_manifest.py).
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "mbedtls/sha256.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <array>
+
+#define OTAVERIFIER_HASH_SIZE (32) ///< Размер SHA-256.
+
+class COtaVerifier
+{
+protected:
+	typedef std::array<uint8_t, OTAVERIFIER_HASH_SIZE> THash;
+
+	mbedtls_sha256_context mImage;			///< Хэш образа без последних 32 байт.
+	mbedtls_sha256_context mChunk;			///< Хэш текущей порции.
+	uint8_t mTail[OTAVERIFIER_HASH_SIZE];	///< Последние принятые 32 байта (кандидат на дописанный хэш).
+	size_t mTailLen = 0;					///< Заполнено байт в mTail.
+	uint32_t mReceived = 0;					///< Принято байт.
+	uint32_t mChunkFill = 0;				///< Принято байт текущей порции.
+	size_t mIndex = 0;						///< Номер текущей порции.
+	uint8_t mHash[OTAVERIFIER_HASH_SIZE];	///< Итоговый SHA-256 всего образа.
+
+	bool mManifest = false;					///< Манифест загружен.
+	uint32_t mSize = 0;						///< Размер образа по манифесту.
+	uint32_t mChunkSize = 0;				///< Размер порции по манифесту.
+	THash mImageHash;						///< SHA-256 образа по манифесту.
+	std::vector<THash> mChunks;				///< Хэши порций по манифесту.
+
+	/// Сверить завершённую порцию.
+	bool checkChunk();
+	/// Разбор hex строки хэша.
+	static bool parseHex(const char *str, uint8_t *out, size_t len);
+
+public:
+	/// Конструктор.
+	COtaVerifier();
+	/// Деструктор.
+	~COtaVerifier();
+
+	/// Загрузить манифест.
+	/*!
+	  \param[in] text - Текст манифеста (JSON).
+	  \param[in] len - Длина текста.
+	  \param[in] keyPem - Открытый ключ PEM для проверки подписи (nullptr - подпись не проверяется).
+	  \return true - манифест разобран (и подпись верна, если задан ключ).
+	*/
+	bool loadManifest(const char *text, size_t len, const char *keyPem = nullptr);
+
+	/// Очередная порция образа.
+	/*!
+	  \param[in] data - Данные.
+	  \param[in] len - Длина данных.
+	  \return false - порция не совпала с манифестом (закачку прервать).
+	*/
+	bool update(const uint8_t *data, size_t len);
+
+	/// Завершение образа.
+	/*!
+	  \param[in] appended - Сверить SHA-256, дописанный в конец образа.
+	  \return true - образ верен.
+	*/
+	bool finish(bool appended);
+
+	/// Манифест загружен.
+	inline bool hasManifest() { return mManifest; };
+	/// SHA-256 всего образа (после finish()).
+	inline const uint8_t *hash() { return mHash; };
+	/// Принято байт.
+	inline uint32_t received() { return mReceived; };
+	/// Размер порции манифеста (0 - манифеста нет).
+	inline uint32_t chunkSize() { return mManifest ? mChunkSize : 0; };
+	/// Сверено с манифестом байт с начала образа (без манифеста - все принятые).
+	inline uint32_t verified()
+	{
+		if (!mManifest)
+			return mReceived;
+		uint64_t n = (uint64_t)mIndex * mChunkSize;
+		return (n < mSize) ? (uint32_t)n : mSize;
+	};
+};
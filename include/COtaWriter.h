@@ -0,0 +1,132 @@
+/*!
+	\file
+	\brief Посекторная запись образа в раздел flash с пропуском неизменённых секторов.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	При A/B обновлении неактивный раздел обычно содержит предыдущую, почти совпадающую
+	версию образа. Каждый принятый сектор (4 КБ) сравнивается с содержимым раздела,
+	и стирание+запись выполняются только для изменившихся секторов. Это сокращает время
+	записи, число и длительность окон writeEvent (приостановки радио) и износ flash.
+
+	В пакетном режиме (beginBurst()/endBurst()) окно writeEvent открывается один раз
+	на пакет секторов (и только если в пакете есть изменённые сектора).
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_partition.h"
+#include "CWriteEvent.h"
+#include <cstdint>
+#include <cstddef>
+
+#define OTAWRITER_CMP_CHUNK (256) ///< Порция чтения раздела при сравнении сектора.
+
+/// Окно writeEvent (приостановка подписчиков на время записи во flash) с учётом числа и длительности окон.
+class COtaLock
+{
+protected:
+	onWriteEvent *mEvent;	///< Обработчик начала/конца записи во flash (nullptr - нет).
+	bool mLocked = false;	///< Окно открыто.
+	int64_t mStart = 0;		///< Время открытия окна, мкс.
+	uint32_t mLocks = 0;	///< Число окон.
+	int64_t mTime = 0;		///< Суммарная длительность окон, мкс.
+	int64_t mMaxTime = 0;	///< Наибольшая длительность окна, мкс.
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] event - Обработчик начала/конца записи во flash (nullptr - только учёт).
+	*/
+	COtaLock(onWriteEvent *event = nullptr) : mEvent(event) {};
+	/// Деструктор.
+	~COtaLock() { unlock(); };
+
+	/// Открыть окно (повторный вызов при открытом окне ничего не делает).
+	void lock();
+	/// Закрыть окно.
+	void unlock();
+
+	/// Число окон.
+	inline uint32_t locks() { return mLocks; };
+	/// Суммарная длительность окон, мкс.
+	inline int64_t time() { return mTime; };
+	/// Наибольшая длительность окна, мкс.
+	inline int64_t maxTime() { return mMaxTime; };
+};
+
+class COtaWriter
+{
+protected:
+	const esp_partition_t *mPart; ///< Раздел назначения.
+	COtaLock mLock;				  ///< Окно writeEvent.
+	bool mSkip;					  ///< Пропускать неизменённые сектора.
+	uint8_t *mSector = nullptr;	  ///< Буфер текущего сектора.
+	size_t mFill = 0;			  ///< Заполнено байт в буфере сектора.
+	size_t mOffset = 0;			  ///< Смещение текущего сектора в разделе.
+	uint32_t mSectors = 0;		  ///< Обработано секторов.
+	uint32_t mSkipped = 0;		  ///< Пропущено секторов.
+	int64_t mWriteTime = 0;		  ///< Суммарное время стирания+записи, мкс.
+	bool mBurst = false;		  ///< Идёт пакетная запись.
+
+	/// Сектор во flash совпадает с буфером.
+	/*!
+	  \param[in] len - Длина данных в буфере.
+	  \return true - если совпадает.
+	*/
+	bool same(size_t len);
+	/// Записать буфер сектора.
+	/*!
+	  \return Код ошибки.
+	*/
+	esp_err_t flush();
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] part - Раздел назначения.
+	  \param[in] lock - Обработчик начала/конца записи во flash (nullptr - нет).
+	  \param[in] skipUnchanged - Пропускать неизменённые сектора.
+	  \param[in] caps - Тип памяти буфера сектора (MALLOC_CAP_...).
+	*/
+	COtaWriter(const esp_partition_t *part, onWriteEvent *lock, bool skipUnchanged, uint32_t caps);
+	/// Деструктор.
+	~COtaWriter();
+
+	/// Записать очередной фрагмент образа.
+	/*!
+	  \param[in] data - Данные.
+	  \param[in] len - Длина данных.
+	  \return Код ошибки.
+	*/
+	esp_err_t write(const uint8_t *data, size_t len);
+	/// Записать неполный последний сектор.
+	/*!
+	  \return Код ошибки.
+	*/
+	esp_err_t finish();
+
+	/// Начало пакета: окно writeEvent откроется при первой записи и будет держаться до endBurst().
+	void beginBurst();
+	/// Конец пакета.
+	void endBurst();
+
+	/// Буфер сектора выделен.
+	inline bool isValid() { return mSector != nullptr; };
+	/// Число обработанных секторов.
+	inline uint32_t sectors() { return mSectors; };
+	/// Число пропущенных секторов.
+	inline uint32_t skipped() { return mSkipped; };
+	/// Суммарное время стирания+записи, мкс.
+	inline int64_t writeTime() { return mWriteTime; };
+	/// Окна writeEvent.
+	inline COtaLock &lock() { return mLock; };
+	/// Оценка сэкономленного времени (пропущенные сектора по среднему времени записи), мкс.
+	inline int64_t savedTime()
+	{
+		uint32_t written = mSectors - mSkipped;
+		return (written > 0) ? (mWriteTime * mSkipped / written) : 0;
+	};
+};
@@ -0,0 +1,192 @@
+/*!
+	\file
+	\brief Надёжная доставка датаграмм: номера, выборочные подтверждения, окно, RTO, XOR FEC.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Протокол не зависит от транспорта: пакеты уходят через TTransmit, принятые
+	подаются в input(), таймеры обслуживает poll(); время передаётся параметром
+	(мс), поэтому два экземпляра можно соединить в памяти с имитацией потерь.
+	Сообщения доставляются сразу по приёму, без упорядочивания: потеря одного не
+	задерживает остальные (в отличие от TCP). Подтверждение - на каждый пакет:
+	накопительный номер плюс битовая карта следующих 32 пакетов. Повтор - по RTO
+	(RFC 6298, удвоение для каждого повтора) или по трём подтверждённым более
+	поздним пакетам. После CONFIG_WIFICHN_RUDP_MAX_RETRIES повторов сообщение
+	считается потерянным, и получатель перестаёт его ждать.
+	При fecGroup > 0 после каждых fecGroup пакетов (или паузы) отправляется
+	XOR-пакет, восстанавливающий одну потерю группы без повтора.
+
+	Все буферы - из собственного CBufferPool; экземпляр не потокобезопасен.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "CBufferPool.h"
+#include "esp_heap_caps.h"
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#define RUDP_WINDOW CONFIG_WIFICHN_RUDP_WINDOW ///< Окно, пакетов (степень двойки, не больше 32).
+#define RUDP_HEADER_SIZE (8)					///< Заголовок пакета.
+#define RUDP_ACK_SIZE (RUDP_HEADER_SIZE + 4)	///< Пакет подтверждения.
+#define RUDP_RTO_INIT_MS (300)					///< RTO до первого замера RTT.
+#define RUDP_RTO_MIN_MS (20)					///< Нижняя граница RTO.
+#define RUDP_RTO_MAX_MS (3000)					///< Верхняя граница RTO.
+#define RUDP_DUP_THRESH (3)						///< Подтверждённых более поздних пакетов для быстрого повтора.
+#define RUDP_FEC_FLUSH_MS (2)					///< Пауза, после которой неполная группа FEC закрывается.
+
+static_assert((RUDP_WINDOW >= 2) && (RUDP_WINDOW <= 32) && ((RUDP_WINDOW & (RUDP_WINDOW - 1)) == 0),
+			  "CONFIG_WIFICHN_RUDP_WINDOW must be a power of two in 2..32");
+
+/// Тип пакета.
+enum class ERudpType : uint8_t
+{
+	Data = 1, ///< Сообщение.
+	Ack = 2,  ///< Подтверждение.
+	Fec = 3	  ///< XOR группы сообщений.
+};
+
+/// Статистика канала.
+struct SRudpStats
+{
+	uint32_t sent;			  ///< Отправлено сообщений.
+	uint32_t retransmits;	  ///< Повторов по RTO.
+	uint32_t fastRetransmits; ///< Повторов по выборочным подтверждениям.
+	uint32_t fecSent;		  ///< Отправлено пакетов FEC.
+	uint32_t fecRecovered;	  ///< Восстановлено сообщений по FEC.
+	uint32_t delivered;		  ///< Доставлено сообщений приложению.
+	uint32_t duplicates;	  ///< Принято повторов.
+	uint32_t dropped;		  ///< Отброшено (вне окна, нет буфера).
+	uint32_t lost;			  ///< Сообщений, не подтверждённых за все повторы.
+	uint16_t srtt;			  ///< Сглаженный RTT, мс.
+	uint16_t rto;			  ///< Текущий RTO, мс.
+};
+
+class CReliableChannel
+{
+public:
+	/// Отправка пакета транспортом.
+	typedef std::function<void(const uint8_t *data, size_t len)> TTransmit;
+	/// Доставка сообщения приложению.
+	typedef std::function<void(const uint8_t *data, size_t len)> TDeliver;
+
+protected:
+	/// Отправленный, ещё не подтверждённый пакет.
+	struct STxSlot
+	{
+		uint8_t *buf;  ///< Пакет с заголовком (nullptr - слот свободен).
+		uint16_t len;  ///< Длина пакета.
+		uint32_t sent; ///< Время последней отправки, мс.
+		uint8_t tries; ///< Число отправок.
+		bool fast;	   ///< Быстрый повтор уже был.
+	};
+	/// Копия принятого сообщения для восстановления по FEC.
+	struct SRxKeep
+	{
+		uint8_t *buf; ///< Сообщение (nullptr - нет копии).
+		uint16_t len; ///< Длина сообщения.
+		uint16_t seq; ///< Номер сообщения.
+	};
+
+	TTransmit mTransmit;				 ///< Транспорт.
+	TDeliver mDeliver;					 ///< Получатель сообщений.
+	uint8_t mFecGroup;					 ///< Размер группы FEC (0 - без FEC).
+	CBufferPool mPool;					 ///< Буферы пакетов.
+	SRudpStats mStats = {};				 ///< Статистика.
+
+	STxSlot mTx[RUDP_WINDOW] = {};		 ///< Окно передачи (индекс - seq % RUDP_WINDOW).
+	uint16_t mTxBase = 0;				 ///< Старейший неподтверждённый номер.
+	uint16_t mTxNext = 0;				 ///< Номер следующего сообщения.
+	int32_t mSrtt = -1;					 ///< Сглаженный RTT, 1/8 мс (-1 - замеров не было).
+	int32_t mRttVar = 0;				 ///< Разброс RTT, 1/4 мс.
+	uint32_t mRto = RUDP_RTO_INIT_MS;	 ///< Текущий RTO, мс.
+
+	uint8_t *mFecBuf = nullptr;			 ///< Накопитель XOR группы (с заголовком).
+	uint8_t mFecCount = 0;				 ///< Сообщений в текущей группе.
+	uint16_t mFecFirst = 0;				 ///< Первый номер текущей группы.
+	uint16_t mFecMax = 0;				 ///< Наибольшая длина сообщения группы.
+	uint16_t mFecLenXor = 0;			 ///< XOR длин сообщений группы.
+	uint32_t mFecTime = 0;				 ///< Время последнего сообщения группы, мс.
+
+	uint16_t mRxNext = 0;				 ///< Первый не принятый номер.
+	uint32_t mRxMask = 0;				 ///< Приняты mRxNext+1+i (бит i).
+	SRxKeep mKeep[2 * RUDP_WINDOW] = {}; ///< Копии принятых сообщений для FEC.
+
+	/// Отправить (повторно) пакет окна.
+	void transmit(STxSlot &slot, uint32_t now);
+	/// Отправить подтверждение.
+	void sendAck();
+	/// Отправить накопленную группу FEC.
+	void flushFec();
+	/// Сдвинуть начало окна передачи за подтверждённые пакеты.
+	void advanceTx();
+	/// Учесть замер RTT.
+	void updateRtt(int32_t rtt);
+	/// Сдвинуть начало окна приёма за принятые номера.
+	void stepRx();
+	/// Перестать ждать номера до base (отправитель их больше не повторит).
+	void skipTo(uint16_t base);
+	/// Освободить копию сообщения.
+	void releaseKeep(uint16_t seq);
+	/// Номер принят (или больше не ожидается).
+	bool isReceived(uint16_t seq);
+	/// Принять сообщение.
+	/*!
+	  \param[in] seq - Номер.
+	  \param[in] data - Сообщение.
+	  \param[in] len - Длина.
+	  \param[in] owned - Блок пула, который переходит каналу (копия для FEC).
+	*/
+	void accept(uint16_t seq, const uint8_t *data, size_t len, uint8_t *owned);
+
+	/// Обработка подтверждения.
+	void onAck(uint16_t cum, uint32_t sack, uint32_t now);
+	/// Обработка сообщения.
+	void onData(uint16_t seq, const uint8_t *data, size_t len);
+	/// Обработка пакета FEC.
+	void onFec(uint16_t first, uint8_t count, uint16_t lenXor, const uint8_t *data, size_t len);
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] transmit - Транспорт.
+	  \param[in] deliver - Получатель сообщений.
+	  \param[in] fecGroup - Размер группы FEC, 0 - без FEC (должен совпадать на обеих сторонах).
+	  \param[in] caps - Тип памяти буферов (MALLOC_CAP_...).
+	*/
+	CReliableChannel(TTransmit transmit, TDeliver deliver, uint8_t fecGroup = CONFIG_WIFICHN_RUDP_FEC_GROUP, uint32_t caps = MALLOC_CAP_DEFAULT);
+
+	/// Отправить сообщение.
+	/*!
+	  \param[in] data - Сообщение.
+	  \param[in] len - Длина (не больше CONFIG_WIFICHN_RUDP_MTU).
+	  \param[in] now - Текущее время, мс.
+	  \return true - сообщение в окне передачи, false - окно заполнено или нет буфера.
+	*/
+	bool send(const uint8_t *data, size_t len, uint32_t now);
+	/// Обработать принятый пакет.
+	/*!
+	  \param[in] data - Пакет.
+	  \param[in] len - Длина пакета.
+	  \param[in] now - Текущее время, мс.
+	*/
+	void input(const uint8_t *data, size_t len, uint32_t now);
+	/// Обслуживание таймеров (повторы, закрытие группы FEC).
+	/*!
+	  \param[in] now - Текущее время, мс.
+	  \return Через сколько мс вызвать снова.
+	*/
+	uint32_t poll(uint32_t now);
+
+	/// Есть место в окне передачи.
+	inline bool canSend() { return (uint16_t)(mTxNext - mTxBase) < RUDP_WINDOW; };
+	/// Неподтверждённых сообщений.
+	inline uint16_t inFlight() { return mTxNext - mTxBase; };
+	/// Статистика.
+	SRudpStats stats();
+	/// Буферы созданы успешно.
+	inline bool isValid() { return mPool.isValid(); };
+};
@@ -0,0 +1,197 @@
+/*!
+	\file
+	\brief Защищённые датаграммы: AES-GCM, ключи из PSK или ECDH (X25519) через HKDF, окно повторов.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Облегчённая замена TLS для обмена с узлом в своей сети: без сертификатов,
+	рукопожатие - один обмен открытыми ключами или, при PSK, случайными nonce
+	сессии (setSessionKey()).
+	Запись: 8 байт номера (little-endian, он же дополнительные данные AEAD),
+	шифротекст той же длины, что и данные, и 16 байт метки - 24 байта сверх
+	данных против 29 у записи TLS 1.2 AES-GCM. Nonce - IV направления XOR номер
+	(как в TLS 1.3), номер записи никогда не повторяется, поэтому повтор
+	пакета протоколом выше уходит новой записью.
+
+	Шифрование и проверка - на месте: данные лежат в буфере сразу за местом
+	под заголовок, метка дописывается следом (буфер из пула вызывающего).
+	Ключи направлений разные (роль Initiator/Responder), поэтому обе стороны
+	нумеруют свои записи с нуля. Номера не сохраняются между вызовами
+	setKey(), поэтому ключи каждого вызова должны быть новыми: секрет обмена
+	ключами новый сам по себе, а PSK без nonce сессии - одноразовый (после
+	перезагрузки тот же PSK дал бы те же ключи и nonce GCM, а это раскрывает
+	данные). Принятые номера проверяются окном на 64 записи (RFC 4303): повтор
+	и слишком старая запись отбрасываются до расшифровки, окно сдвигается
+	только после проверки метки.
+
+	Криптография - mbedtls компонента: при CONFIG_MBEDTLS_HARDWARE_AES и
+	CONFIG_MBEDTLS_HARDWARE_SHA GCM и HKDF идут на аппаратных AES/SHA.
+	ECDH без PSK не защищает от подмены ключей посредником: открытые ключи
+	нужно сверить иначе (например, при провизионинге), либо подмешать PSK.
+	Экземпляр не потокобезопасен.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/ecdh.h"
+#include <cstdint>
+#include <cstddef>
+
+#define SECURE_HEADER_SIZE (8)								 ///< Заголовок записи (номер).
+#define SECURE_TAG_SIZE (16)								 ///< Метка AES-GCM.
+#define SECURE_OVERHEAD (SECURE_HEADER_SIZE + SECURE_TAG_SIZE) ///< Запись длиннее данных на столько.
+#define SECURE_IV_SIZE (12)									 ///< IV направления (nonce GCM).
+#define SECURE_SECRET_SIZE (32)								 ///< Секрет после обмена ключами.
+#define SECURE_PUBLIC_SIZE (33)								 ///< Открытый ключ X25519 (байт длины и 32 байта).
+#define SECURE_REPLAY_WINDOW (64)							 ///< Окно принятых номеров.
+#define SECURE_NONCE_SIZE (16)								 ///< Случайный nonce сессии.
+#if CONFIG_WIFICHN_SECURE_AES256
+#define SECURE_KEY_SIZE (32) ///< Ключ AES.
+#else
+#define SECURE_KEY_SIZE (16) ///< Ключ AES.
+#endif
+
+/// Роль стороны (задаёт ключи направлений и порядок ключей в обмене).
+enum class ESecureRole : uint8_t
+{
+	Initiator = 0, ///< Устройство (клиент).
+	Responder = 1  ///< Шлюз (сервер).
+};
+
+/// Статистика канала.
+struct SSecureStats
+{
+	uint32_t sealed;	 ///< Зашифровано записей.
+	uint32_t opened;	 ///< Принято записей.
+	uint32_t authFailed; ///< Отброшено: метка не сошлась.
+	uint32_t replayed;	 ///< Отброшено: номер уже принят или старше окна.
+	uint32_t malformed;	 ///< Отброшено: короче заголовка с меткой.
+	uint32_t noKey;		 ///< Не обработано: ключ не задан.
+};
+
+class CSecureChannel
+{
+protected:
+	mbedtls_gcm_context mTx;		 ///< Шифр передачи.
+	mbedtls_gcm_context mRx;		 ///< Шифр приёма.
+	uint8_t mTxIv[SECURE_IV_SIZE];	 ///< IV передачи.
+	uint8_t mRxIv[SECURE_IV_SIZE];	 ///< IV приёма.
+	uint64_t mTxSeq = 0;			 ///< Номер следующей записи.
+	uint64_t mRxTop = 0;			 ///< Наибольший принятый номер.
+	uint64_t mRxMask = 0;			 ///< Приняты mRxTop - i (бит i).
+	bool mKeyed = false;			 ///< Ключи заданы.
+	SSecureStats mStats = {};		 ///< Статистика.
+
+	/// Nonce записи.
+	static void nonce(const uint8_t *iv, uint64_t seq, uint8_t *out);
+	/// Вывести ключи и IV направлений (HKDF-SHA256).
+	esp_err_t derive(const uint8_t *secret, size_t len, ESecureRole role, const uint8_t *salt, size_t saltLen, const uint8_t *context, size_t contextLen);
+
+public:
+	/// Конструктор (без ключа записи не обрабатываются).
+	CSecureChannel();
+	/// Деструктор (ключи стираются).
+	~CSecureChannel();
+	CSecureChannel(const CSecureChannel &) = delete;
+	CSecureChannel &operator=(const CSecureChannel &) = delete;
+
+	/// Задать ключи.
+	/*!
+	  Ключи и IV направлений выводятся HKDF-SHA256 из секрета; номера и окно
+	  начинаются заново. Один и тот же секрет даёт те же ключи, поэтому каждый
+	  секрет - на одну сессию: секрет CSecureKeyExchange или одноразовый PSK.
+	  Постоянный PSK задаётся через setSessionKey().
+	  \param[in] secret - Секрет CSecureKeyExchange или одноразовый PSK (не короче 16 байт).
+	  \param[in] len - Длина секрета.
+	  \param[in] role - Роль этой стороны.
+	  \param[in] context - Привязка ключей (например, идентификаторы сторон), может быть nullptr.
+	  \param[in] contextLen - Длина привязки.
+	  \return ESP_OK, ESP_ERR_INVALID_ARG или ESP_FAIL (ошибка mbedtls).
+	*/
+	esp_err_t setKey(const uint8_t *secret, size_t len, ESecureRole role, const uint8_t *context = nullptr, size_t contextLen = 0);
+	/// Задать ключи сессии из постоянного PSK.
+	/*!
+	  Перед вызовом стороны обмениваются nonce из makeNonce(); оба nonce входят в
+	  соль HKDF, поэтому ключи и nonce GCM новой сессии (после перезагрузки или
+	  повторного вызова) не повторяют прежних, даже если номера начались с нуля.
+	  \param[in] psk - PSK (не короче 16 байт).
+	  \param[in] len - Длина PSK.
+	  \param[in] role - Роль этой стороны.
+	  \param[in] nonceI - Nonce стороны Initiator (SECURE_NONCE_SIZE байт).
+	  \param[in] nonceR - Nonce стороны Responder (SECURE_NONCE_SIZE байт).
+	  \param[in] context - Привязка ключей, может быть nullptr.
+	  \param[in] contextLen - Длина привязки.
+	  \return ESP_OK, ESP_ERR_INVALID_ARG или ESP_FAIL (ошибка mbedtls).
+	*/
+	esp_err_t setSessionKey(const uint8_t *psk, size_t len, ESecureRole role, const uint8_t *nonceI, const uint8_t *nonceR,
+							const uint8_t *context = nullptr, size_t contextLen = 0);
+	/// Новый случайный nonce сессии.
+	/*!
+	  \param[out] nonce - Nonce (SECURE_NONCE_SIZE байт) для передачи узлу.
+	*/
+	static void makeNonce(uint8_t *nonce);
+	/// Стереть ключи.
+	void clear();
+
+	/// Зашифровать запись на месте.
+	/*!
+	  \param[in,out] buf - Буфер: данные с buf + SECURE_HEADER_SIZE, на выходе - запись.
+	  \param[in] len - Длина данных.
+	  \param[in] size - Размер буфера (не меньше len + SECURE_OVERHEAD).
+	  \return Длина записи или 0 (нет ключа, мал буфер, номера исчерпаны).
+	*/
+	size_t seal(uint8_t *buf, size_t len, size_t size);
+	/// Проверить и расшифровать запись на месте.
+	/*!
+	  \param[in,out] buf - Запись; на выходе данные с buf + SECURE_HEADER_SIZE.
+	  \param[in,out] len - Длина записи; на выходе длина данных.
+	  \return true - запись подлинная и принята впервые.
+	*/
+	bool open(uint8_t *buf, size_t &len);
+
+	/// Ключи заданы.
+	inline bool isKeyed() { return mKeyed; };
+	/// Статистика.
+	inline SSecureStats stats() { return mStats; };
+};
+
+/// Обмен ключами X25519 (ECDHE, по желанию с подмешанным PSK).
+class CSecureKeyExchange
+{
+protected:
+	mbedtls_ecdh_context mCtx;			///< Ключевая пара.
+	uint8_t mPublic[SECURE_PUBLIC_SIZE]; ///< Свой открытый ключ.
+	bool mReady = false;				///< Пара создана.
+
+public:
+	/// Конструктор.
+	CSecureKeyExchange();
+	/// Деструктор (закрытый ключ стирается).
+	~CSecureKeyExchange();
+	CSecureKeyExchange(const CSecureKeyExchange &) = delete;
+	CSecureKeyExchange &operator=(const CSecureKeyExchange &) = delete;
+
+	/// Создать ключевую пару.
+	/*!
+	  \param[out] pub - Свой открытый ключ (SECURE_PUBLIC_SIZE байт) для передачи узлу.
+	  \return ESP_OK или ESP_FAIL.
+	*/
+	esp_err_t begin(uint8_t *pub);
+	/// Вычислить общий секрет.
+	/*!
+	  Секрет - HKDF-Extract(соль - открытые ключи Initiator и Responder,
+	  материал - общий секрет ECDH и PSK), его передают CSecureChannel::setKey().
+	  Закрытый ключ после вызова стирается: на каждый обмен - новая пара.
+	  \param[in] peer - Открытый ключ узла (SECURE_PUBLIC_SIZE байт).
+	  \param[in] role - Роль этой стороны.
+	  \param[in] psk - PSK для защиты от посредника или nullptr.
+	  \param[in] pskLen - Длина PSK.
+	  \param[out] secret - Секрет (SECURE_SECRET_SIZE байт).
+	  \return ESP_OK, ESP_ERR_INVALID_STATE (нет begin()), ESP_ERR_INVALID_ARG (неверный ключ узла) или ESP_FAIL.
+	*/
+	esp_err_t finish(const uint8_t *peer, ESecureRole role, const uint8_t *psk, size_t pskLen, uint8_t *secret);
+};
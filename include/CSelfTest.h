@@ -0,0 +1,178 @@
+/*!
+	\file
+	\brief Протокол и замер самопроверки канала (пропускная способность, джиттер, потери).
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Самопроверка в духе iperf: устройство открывает TCP соединение управления с
+	сервером (tools/selftest_server.py) и передаёт запрос SSelfTestConfig.
+	TCP тесты идут по этому же соединению: при передаче устройство пишет блоки
+	до конца теста, закрывает запись и получает отчёт получателя; при приёме
+	сервер пишет блоки и закрывает соединение. UDP тесты идут датаграммами с
+	заголовком (номер, время отправителя, мкс); по окончании отправитель пишет в
+	управление свой отчёт (сколько отправлено), получатель считает потери по нему,
+	поэтому учитываются и датаграммы, потерянные в конце теста. Джиттер - оценка RFC 3550 по
+	разности времени доставки соседних датаграмм.
+
+	Все числа протокола - little endian. Время передаётся параметром (мкс), как в
+	CReliableChannel, поэтому замер проверяется без сети.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include <cstdint>
+#include <cstddef>
+
+#define SELFTEST_MAGIC (0x54534357u)	///< "WCST": метка запроса и отчёта.
+#define SELFTEST_REQUEST_SIZE (20)		///< Размер запроса.
+#define SELFTEST_REPORT_SIZE (32)		///< Размер отчёта.
+#define SELFTEST_HEADER_SIZE (8)		///< Заголовок UDP датаграммы (номер, время).
+#define SELFTEST_UDP_MAX (1472)		///< Наибольшая датаграмма без фрагментации IP.
+#define SELFTEST_CORES (2)				///< Наибольшее число ядер в отчёте.
+#define SELFTEST_CPU_UNKNOWN (0xff)		///< Загрузка ядра не измерялась.
+
+/// Режим самопроверки (направление - со стороны устройства).
+enum class ESelfTestMode : uint8_t
+{
+	TcpSend = 1, ///< Устройство передаёт по TCP.
+	TcpRecv = 2, ///< Устройство принимает по TCP.
+	UdpSend = 3, ///< Устройство передаёт датаграммы.
+	UdpRecv = 4	 ///< Устройство принимает датаграммы.
+};
+
+/// Параметры самопроверки.
+struct SSelfTestConfig
+{
+	ESelfTestMode mode = ESelfTestMode::TcpSend;	   ///< Режим.
+	uint32_t peer = 0;								   ///< IP адрес сервера (сетевой порядок байт).
+	uint16_t port = CONFIG_WIFICHN_SELFTEST_PORT;	   ///< Порт сервера (TCP управление и UDP данные); UDP приём - на том же локальном порту.
+	uint32_t durationMs = 10000;					   ///< Длительность.
+	uint32_t rateKbps = 20000;						   ///< Скорость UDP передачи, кбит/с (0 - без ограничения).
+	uint16_t block = CONFIG_WIFICHN_SELFTEST_BLOCK;	   ///< Размер записи TCP или датаграммы UDP.
+};
+
+/// Отчёт стороны теста (передаётся по соединению управления).
+struct SSelfTestReport
+{
+	uint64_t bytes;		///< Байт передано (отправитель) или принято (получатель).
+	uint32_t elapsedUs; ///< Длительность передачи или приёма, мкс.
+	uint32_t packets;	///< Датаграмм передано или принято.
+	uint32_t lost;		///< Потеряно датаграмм (получатель).
+	uint32_t reordered; ///< Пришло не по порядку (получатель).
+	uint32_t jitterUs;	///< Джиттер, мкс (получатель).
+};
+
+/// Результат самопроверки.
+struct SSelfTestResult
+{
+	ESelfTestMode mode;			  ///< Режим.
+	uint64_t bytes;				  ///< Байт принято получателем.
+	uint32_t elapsedUs;			  ///< Длительность приёма у получателя, мкс.
+	uint32_t goodputKbps;		  ///< Полезная скорость у получателя, кбит/с.
+	uint32_t sent;				  ///< Датаграмм отправлено (UDP).
+	uint32_t packets;			  ///< Датаграмм принято (UDP).
+	uint32_t lost;				  ///< Датаграмм потеряно (UDP).
+	uint32_t reordered;			  ///< Датаграмм не по порядку (UDP).
+	uint32_t jitterUs;			  ///< Джиттер, мкс (UDP).
+	uint8_t cpu[SELFTEST_CORES];  ///< Загрузка ядер устройства за тест, % (SELFTEST_CPU_UNKNOWN - не измерялась).
+};
+
+/// Записать запрос.
+/*!
+  \param[out] buf - Буфер (SELFTEST_REQUEST_SIZE байт).
+  \param[in] cfg - Параметры.
+  \return Размер запроса.
+*/
+size_t selfTestPackRequest(uint8_t *buf, const SSelfTestConfig &cfg);
+/// Записать отчёт.
+/*!
+  \param[out] buf - Буфер (SELFTEST_REPORT_SIZE байт).
+  \param[in] report - Отчёт.
+  \return Размер отчёта.
+*/
+size_t selfTestPackReport(uint8_t *buf, const SSelfTestReport &report);
+/// Разобрать отчёт.
+/*!
+  \param[in] buf - Отчёт.
+  \param[in] len - Длина.
+  \param[out] report - Отчёт.
+  \return true - метка и длина верны.
+*/
+bool selfTestParseReport(const uint8_t *buf, size_t len, SSelfTestReport &report);
+/// Записать заголовок датаграммы.
+/*!
+  \param[out] buf - Датаграмма (не меньше SELFTEST_HEADER_SIZE байт).
+  \param[in] seq - Номер.
+  \param[in] ts - Время отправки, мкс.
+*/
+void selfTestStamp(uint8_t *buf, uint32_t seq, uint32_t ts);
+
+/// Замер на стороне получателя.
+class CSelfTestMeter
+{
+protected:
+	uint64_t mBytes = 0;	 ///< Принято байт.
+	uint32_t mFirst = 0;	 ///< Время первого приёма, мкс.
+	uint32_t mLast = 0;		 ///< Время последнего приёма, мкс.
+	bool mStarted = false;	 ///< Что-то принято.
+	uint32_t mPackets = 0;	 ///< Принято датаграмм.
+	uint32_t mNext = 0;		 ///< Ожидаемый номер датаграммы.
+	uint32_t mReordered = 0; ///< Датаграмм не по порядку.
+	uint32_t mTransit = 0;	 ///< Время доставки предыдущей датаграммы (по разным часам), мкс.
+	uint32_t mJitter16 = 0;	 ///< Джиттер x16, мкс.
+
+	/// Учесть принятые байты.
+	void account(size_t len, uint32_t now);
+
+public:
+	/// Принят кусок TCP потока.
+	/*!
+	  \param[in] len - Длина.
+	  \param[in] now - Время приёма, мкс.
+	*/
+	inline void onBytes(size_t len, uint32_t now) { account(len, now); };
+	/// Принята датаграмма.
+	/*!
+	  \param[in] data - Датаграмма.
+	  \param[in] len - Длина.
+	  \param[in] now - Время приёма, мкс.
+	  \return false - датаграмма короче заголовка.
+	*/
+	bool onDatagram(const uint8_t *data, size_t len, uint32_t now);
+	/// Отчёт получателя.
+	/*!
+	  \param[in] sent - Датаграмм отправлено по отчёту отправителя (0 - неизвестно: потери по номерам).
+	  \return Отчёт.
+	*/
+	SSelfTestReport report(uint32_t sent = 0);
+};
+
+/// Темп UDP передачи.
+class CSelfTestPacer
+{
+protected:
+	uint32_t mInterval; ///< Интервал между датаграммами, мкс (0 - без ограничения).
+	uint32_t mSlack;	///< Наибольшее отставание от темпа, которое догоняется, мкс.
+	uint32_t mNext = 0; ///< Время следующей датаграммы, мкс.
+	bool mStarted = false; ///< Темп задан (первая датаграмма).
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] rateKbps - Скорость, кбит/с (0 - без ограничения).
+	  \param[in] block - Размер датаграммы.
+	  \param[in] slack - Наибольшее отставание, которое догоняется пачкой, мкс (пауза задачи
+	  не короче тика: отставание на тик должно догоняться).
+	*/
+	CSelfTestPacer(uint32_t rateKbps, uint16_t block, uint32_t slack = 20000);
+	/// Сколько ждать до следующей датаграммы.
+	/*!
+	  \param[in] now - Текущее время, мкс.
+	  \return Пауза, мкс (0 - отправлять).
+	*/
+	uint32_t wait(uint32_t now);
+	/// Датаграмма отправлена.
+	void sent();
+};
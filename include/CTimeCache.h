@@ -0,0 +1,61 @@
+/*!
+	\file
+	\brief Кэш последнего достоверного времени (RTC + NVS).
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Последнее синхронизированное время хранится в RTC-памяти вместе с показанием
+	монотонных RTC-часов, а также (реже) в NVS. После перезагрузки или deep sleep
+	время восстанавливается как сохранённое + прошедшее по RTC - его точности
+	достаточно для проверки сроков действия TLS-сертификатов до завершения
+	NTP-синхронизации. После пропадания питания остаётся только нижняя граница
+	из NVS (она может отставать на месяцы): часы устанавливаются по ней, но для
+	TLS такое время непригодно (isValid() - false до синхронизации).
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include <cstdint>
+#include <ctime>
+
+#define TIMECACHE_MIN_EPOCH (1704067200) ///< Минимально правдоподобное время (01.01.2024), всё что раньше - не установлено.
+#define TIMECACHE_NVS_STEP (3600)		 ///< Минимальный шаг обновления NVS, с (бережём ресурс flash).
+
+/// Источник текущего системного времени.
+enum class ETimeSource : uint8_t
+{
+	None,	///< Время не установлено.
+	System, ///< Системные часы уже шли (deep sleep, программный сброс).
+	Rtc,	///< Восстановлено из RTC-кэша.
+	Nvs,	///< Нижняя граница из NVS (после пропадания питания).
+	Sync	///< Синхронизировано с сервером.
+};
+
+class CTimeCache
+{
+protected:
+	static ETimeSource mSource; ///< Источник времени.
+
+public:
+	/// Восстановить системное время из кэша, если оно не установлено.
+	/*!
+	  \return true - время пригодно для проверки TLS (часы шли или восстановлены по RTC);
+	  false - не установлено или установлено по нижней границе из NVS.
+	*/
+	static bool restore();
+
+	/// Сохранить текущее системное время как достоверное (после синхронизации).
+	static void save();
+
+	/// Время пригодно для проверки TLS.
+	/*!
+	  \return true - если время синхронизировано, часы шли или восстановлены по RTC
+	  (нижняя граница из NVS не годится).
+	*/
+	static bool isValid();
+
+	/// Источник текущего времени.
+	static inline ETimeSource source() { return mSource; };
+};
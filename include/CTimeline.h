@@ -0,0 +1,144 @@
+/*!
+	\file
+	\brief Шкала времени: интервалы фаз WiFi/OTA в кольцевом буфере с выгрузкой в Chrome trace.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Запись - метка времени (мкс), имя (строковая константа), фаза, задача и ядро.
+	Место в кольце занимается атомарным счётчиком без блокировок, поэтому писать
+	можно из любой задачи на любом ядре; старые записи затираются новыми. Номер
+	записи в слоте публикуется последним, выгрузка пропускает слоты, которые в
+	этот момент перезаписываются.
+
+	TIMELINE_BEGIN/TIMELINE_END (или TIMELINE_SCOPE) - интервал в одной задаче,
+	TIMELINE_ASYNC_BEGIN/TIMELINE_ASYNC_END - интервал, начатый в одной задаче и
+	законченный в другой (например, в обработчике событий WiFi),
+	TIMELINE_INSTANT - отметка с числом. Без CONFIG_WIFICHN_TIMELINE макросы
+	пустые; с ним запись в выключенную шкалу (enable(false)) - одна проверка флага.
+
+	exportJson() выдаёт формат Chrome trace (chrome://tracing, ui.perfetto.dev):
+	задачи - отдельные дорожки (tid - адрес задачи), ядро - в аргументах записи.
+	Имена - названия фаз: не путать с CTrace/TRACE компонента task (отладочный
+	вывод значений).
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include <cstdint>
+#include <cstddef>
+
+#if CONFIG_WIFICHN_TIMELINE
+#include <atomic>
+#include <functional>
+
+/// Фаза записи (буква поля "ph" Chrome trace).
+enum class ETimelinePhase : char
+{
+	Begin = 'B',	  ///< Начало интервала задачи.
+	End = 'E',		  ///< Конец интервала задачи.
+	AsyncBegin = 'b', ///< Начало интервала между задачами.
+	AsyncEnd = 'e',	  ///< Конец интервала между задачами.
+	Instant = 'i'	  ///< Отметка.
+};
+
+/// Запись шкалы.
+struct STimelineEvent
+{
+	int64_t ts;			  ///< Время, мкс от старта.
+	const char *name;	  ///< Имя (строковая константа).
+	uint32_t task;		  ///< Задача (адрес TCB).
+	int32_t arg;		  ///< Число отметки или номер асинхронного интервала.
+	ETimelinePhase phase; ///< Фаза.
+	uint8_t core;		  ///< Ядро.
+};
+
+class CTimeline
+{
+public:
+	/// Приём куска выгрузки.
+	typedef std::function<void(const char *data, size_t len)> TWrite;
+
+protected:
+	/// Слот кольца.
+	struct SSlot
+	{
+		std::atomic<uint32_t> seq; ///< Номер записи + 1 (0 - слот пишется).
+		STimelineEvent ev;		   ///< Запись.
+	};
+
+	static SSlot mRing[CONFIG_WIFICHN_TIMELINE_SIZE]; ///< Кольцо записей.
+	static std::atomic<uint32_t> mHead;				 ///< Число занятых мест за всё время.
+	static std::atomic<bool> mEnabled;				 ///< Запись включена.
+
+public:
+	/// Добавить запись.
+	/*!
+	  \param[in] phase - Фаза.
+	  \param[in] name - Имя (строковая константа: хранится указатель).
+	  \param[in] arg - Число отметки или номер асинхронного интервала.
+	*/
+	static void record(ETimelinePhase phase, const char *name, int32_t arg = 0);
+
+	/// Включить/выключить запись.
+	static inline void enable(bool on) { mEnabled.store(on, std::memory_order_relaxed); };
+	/// Запись включена.
+	static inline bool isEnabled() { return mEnabled.load(std::memory_order_relaxed); };
+	/// Очистить шкалу.
+	static void clear();
+	/// Записей в кольце.
+	static size_t count();
+	/// Записей затёрто новыми.
+	static uint32_t lost();
+
+	/// Копия записей (от старых к новым).
+	/*!
+	  \param[out] out - Буфер записей.
+	  \param[in] max - Размер буфера.
+	  \return Число скопированных записей.
+	*/
+	static size_t snapshot(STimelineEvent *out, size_t max);
+	/// Выгрузка в формате Chrome trace (JSON).
+	/*!
+	  Выгрузка идёт кусками (одна запись - один кусок), запись на время выгрузки
+	  не останавливается.
+	  \param[in] write - Приёмник кусков.
+	  \return Число выгруженных записей.
+	*/
+	static size_t exportJson(TWrite write);
+	/// Выгрузка в файл (например, "/spiffs/trace.json").
+	/*!
+	  \param[in] path - Путь к файлу.
+	  \return true - файл записан.
+	*/
+	static bool save(const char *path);
+};
+
+/// Интервал задачи на время жизни объекта.
+class CTimelineScope
+{
+protected:
+	const char *mName; ///< Имя интервала.
+
+public:
+	inline CTimelineScope(const char *name) : mName(name) { CTimeline::record(ETimelinePhase::Begin, name); };
+	inline ~CTimelineScope() { CTimeline::record(ETimelinePhase::End, mName); };
+};
+
+#define TIMELINE_CAT2(a, b) a##b
+#define TIMELINE_CAT(a, b) TIMELINE_CAT2(a, b)
+#define TIMELINE_BEGIN(name) CTimeline::record(ETimelinePhase::Begin, name)
+#define TIMELINE_END(name) CTimeline::record(ETimelinePhase::End, name)
+#define TIMELINE_SCOPE(name) CTimelineScope TIMELINE_CAT(timeline_scope_, __LINE__)(name)
+#define TIMELINE_ASYNC_BEGIN(name, id) CTimeline::record(ETimelinePhase::AsyncBegin, name, id)
+#define TIMELINE_ASYNC_END(name, id) CTimeline::record(ETimelinePhase::AsyncEnd, name, id)
+#define TIMELINE_INSTANT(name, arg) CTimeline::record(ETimelinePhase::Instant, name, arg)
+#else
+#define TIMELINE_BEGIN(name) ((void)0)
+#define TIMELINE_END(name) ((void)0)
+#define TIMELINE_SCOPE(name) ((void)0)
+#define TIMELINE_ASYNC_BEGIN(name, id) ((void)(id))
+#define TIMELINE_ASYNC_END(name, id) ((void)(id))
+#define TIMELINE_INSTANT(name, arg) ((void)(arg))
+#endif
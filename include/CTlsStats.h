@@ -0,0 +1,47 @@
+/*!
+	\file
+	\brief Замер установки TLS соединения esp_http_client: время и память.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	begin() вызывается перед esp_http_client_open(), handler() - обработчик
+	событий клиента (user_data - объект CTlsStats). По событию HTTP_EVENT_ON_CONNECTED
+	фиксируются длительность подключения с рукопожатием, память внутренней RAM,
+	занятая сессией, и оценка пика за время рукопожатия (по минимуму свободной
+	памяти). Соединение из пула (CHttpPool) рукопожатия не требует - замера нет.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_http_client.h"
+#include <cstdint>
+#include <cstddef>
+
+class CTlsStats
+{
+protected:
+	int64_t mStart = 0;		  ///< Время начала подключения, мкс (0 - замер не идёт).
+	size_t mFreeBefore = 0;	  ///< Свободно внутренней RAM до подключения.
+	size_t mMinBefore = 0;	  ///< Минимум свободной внутренней RAM до подключения.
+	int64_t mHandshake = 0;	  ///< Длительность подключения с рукопожатием, мкс.
+	size_t mRetained = 0;	  ///< Занято сессией после рукопожатия, байт.
+	size_t mPeak = 0;		  ///< Оценка пика за рукопожатие, байт.
+	bool mDone = false;		  ///< Замер выполнен.
+
+public:
+	/// Начать замер (перед esp_http_client_open()); после первого замера ничего не делает.
+	void begin();
+	/// Обработчик событий esp_http_client (esp_http_client_config_t::event_handler).
+	static esp_err_t handler(esp_http_client_event_t *evt);
+
+	/// Замер выполнен.
+	inline bool isDone() { return mDone; };
+	/// Длительность подключения с рукопожатием, мкс.
+	inline int64_t handshake() { return mHandshake; };
+	/// Занято сессией после рукопожатия, байт.
+	inline size_t retained() { return mRetained; };
+	/// Оценка пика за рукопожатие, байт (не меньше retained()).
+	inline size_t peak() { return mPeak; };
+};
@@ -0,0 +1,166 @@
+/*!
+	\file
+	\brief Классы трафика (DSCP/WMM) и планировщик отправки со строгим приоритетом.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Каждый канал отправляет пакеты в своём классе трафика. Класс задаёт DSCP в
+	заголовке IP, а по нему драйвер WiFi выбирает категорию доступа WMM (очередь
+	EDCA в радио). Драйвер берёт приоритет 802.1D из трёх старших бит DSCP, поэтому
+	для голоса выбран CS6 (UP 6, AC_VO): EF (46) попал бы в UP 5, то есть в AC_VI.
+
+	У каждого класса своя очередь. Пакет уходит в стек сразу, если в его классе и
+	выше очередь пуста и стек его принял; иначе копируется в очередь (блок пула).
+	pump() отдаёт очереди строго по приоритету: класс ниже ждёт, пока выше не
+	опустеет. Кроме того, обычный и фоновый классы придерживаются ещё holdoff
+	после последнего пакета голоса или видео: обмен реального времени (запрос -
+	ответ) не делит эфир с закачкой. Задержка в очереди (от send() до передачи
+	в стек) считается по классам. Время передаётся параметром (мкс), как в
+	CReliableChannel.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "CBufferPool.h"
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+/// Класс трафика (по возрастанию приоритета).
+enum class ETrafficClass : uint8_t
+{
+	Background = 0, ///< Фон (OTA, выгрузка данных): DSCP CS1, AC_BK.
+	BestEffort = 1, ///< Обычный: DSCP 0, AC_BE.
+	Video = 2,		///< Поток реального времени: DSCP AF41, AC_VI.
+	Voice = 3		///< Управление, короткие запросы: DSCP CS6, AC_VO.
+};
+
+#define TRAFFIC_CLASSES (4) ///< Число классов трафика.
+
+/// Код DSCP класса.
+constexpr uint8_t trafficDscp(ETrafficClass cls)
+{
+	return (cls == ETrafficClass::Voice) ? 48 : ((cls == ETrafficClass::Video) ? 34 : ((cls == ETrafficClass::Background) ? 8 : 0));
+}
+
+/// Значение поля TOS заголовка IP для класса.
+constexpr uint8_t trafficTos(ETrafficClass cls)
+{
+	return (uint8_t)(trafficDscp(cls) << 2);
+}
+
+/// Статистика класса трафика.
+struct STrafficStats
+{
+	uint32_t sent;		///< Передано в стек.
+	uint32_t direct;	///< Из них сразу, без очереди.
+	uint32_t queued;	///< Поставлено в очередь.
+	uint32_t dropped;	///< Отброшено (очередь полна, пакет велик, канал закрыт).
+	uint16_t depth;		///< Пакетов в очереди сейчас.
+	uint16_t depthMax;	///< Наибольшая длина очереди.
+	uint32_t delayAvg;	///< Среднее ожидание пакета (прямые - 0), мкс.
+	uint32_t delayMax;	///< Наибольшее ожидание пакета, мкс.
+};
+
+class CTrafficScheduler
+{
+public:
+	/// Передача пакета в стек.
+	/*!
+	  \param[in] cls - Класс трафика.
+	  \param[in] ctx - Канал отправителя (как передан в send()).
+	  \param[in] ip - IP адрес получателя.
+	  \param[in] port - Порт получателя.
+	  \param[in] data - Пакет.
+	  \param[in] len - Длина.
+	  \return true - пакет принят, false - стек занят (повторить позже).
+	*/
+	typedef std::function<bool(ETrafficClass cls, void *ctx, uint32_t ip, uint16_t port, const uint8_t *data, size_t len)> TSend;
+
+protected:
+	/// Пакет в очереди.
+	struct SPacket
+	{
+		uint8_t *buf;  ///< Блок пула.
+		void *ctx;	   ///< Канал отправителя.
+		uint32_t ip;   ///< IP адрес получателя.
+		uint16_t port; ///< Порт получателя.
+		uint16_t len;  ///< Длина.
+		uint32_t at;   ///< Время постановки, мкс.
+	};
+
+	/// Очередь класса.
+	struct SQueue
+	{
+		SPacket *ring;		   ///< Кольцо пакетов.
+		uint16_t head;		   ///< Первый пакет.
+		uint16_t count;		   ///< Пакетов в очереди.
+		uint32_t lastAt;	   ///< Время последнего пакета класса, мкс.
+		bool active;		   ///< Класс отправлял пакеты.
+		uint64_t delaySum;	   ///< Сумма ожиданий, мкс.
+		STrafficStats stats;   ///< Статистика.
+	};
+
+	TSend mSend;					 ///< Передача в стек.
+	CBufferPool mPool;				 ///< Блоки пакетов всех очередей.
+	uint16_t mDepth;				 ///< Длина очереди класса.
+	uint32_t mHoldoff;				 ///< Пауза обычного и фонового классов после пакета реального времени, мкс.
+	SPacket *mRings = nullptr;		 ///< Кольца всех очередей.
+	SQueue mQueue[TRAFFIC_CLASSES] = {}; ///< Очереди по классам.
+
+	/// Учесть переданный пакет.
+	void account(SQueue &q, uint32_t delay);
+	/// Есть пакеты в очередях класса cls и выше.
+	bool pending(ETrafficClass cls);
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] send - Передача пакетов в стек.
+	  \param[in] depth - Длина очереди каждого класса.
+	  \param[in] mtu - Наибольший пакет.
+	  \param[in] holdoff - Пауза обычного и фонового классов после пакета голоса или видео, мкс.
+	  \param[in] caps - Тип памяти очередей (MALLOC_CAP_...).
+	*/
+	CTrafficScheduler(TSend send, uint16_t depth = CONFIG_WIFICHN_QOS_DEPTH, size_t mtu = CONFIG_WIFICHN_QOS_MTU,
+					  uint32_t holdoff = CONFIG_WIFICHN_QOS_HOLDOFF_MS * 1000, uint32_t caps = MALLOC_CAP_DEFAULT);
+	/// Деструктор.
+	~CTrafficScheduler();
+
+	/// Отправить пакет.
+	/*!
+	  \param[in] cls - Класс трафика.
+	  \param[in] ctx - Канал отправителя (передаётся в TSend, см. cancel()).
+	  \param[in] ip - IP адрес получателя.
+	  \param[in] port - Порт получателя.
+	  \param[in] data - Пакет.
+	  \param[in] len - Длина (не больше mtu).
+	  \param[in] now - Текущее время, мкс.
+	  \return true - пакет передан в стек или поставлен в очередь.
+	*/
+	bool send(ETrafficClass cls, void *ctx, uint32_t ip, uint16_t port, const uint8_t *data, size_t len, uint32_t now);
+	/// Передать в стек пакеты из очередей.
+	/*!
+	  \param[in] now - Текущее время, мкс.
+	  \param[in] min - Наименьший обслуживаемый класс.
+	  \return Число переданных пакетов.
+	*/
+	uint32_t pump(uint32_t now, ETrafficClass min = ETrafficClass::Background);
+	/// Класс должен уступить эфир (в очереди выше есть пакеты или идёт обмен реального времени).
+	/*!
+	  \param[in] cls - Класс трафика.
+	  \param[in] now - Текущее время, мкс.
+	*/
+	bool busy(ETrafficClass cls, uint32_t now);
+	/// Удалить из очередей пакеты канала (канал закрывается).
+	void cancel(void *ctx);
+
+	/// Пакетов во всех очередях.
+	uint16_t backlog();
+	/// Статистика класса.
+	STrafficStats stats(ETrafficClass cls);
+	/// Очереди созданы успешно.
+	inline bool isValid() { return mPool.isValid() && (mRings != nullptr); };
+};
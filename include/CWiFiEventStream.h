@@ -0,0 +1,129 @@
+/*!
+	\file
+	\brief Кольцевой буфер событий WiFi и OTA для пакетного чтения.
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Записи фиксированного размера (16 байт) пишутся из задачи событий и задачи OTA
+	без вызова обработчиков. Потребитель забирает их пачкой (read()) и может
+	передавать как есть в бинарном виде; ожидание пачки - waitBatch().
+	Повторяющиеся записи хода операции (прогресс OTA, ожидание синхронизации
+	времени) не копятся: новая заменяет непрочитанную предыдущую того же вида,
+	поэтому закачка не вытесняет из буфера записи о состоянии связи.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <cstdint>
+#include <cstddef>
+
+#ifndef CONFIG_WIFICHN_EVENT_STREAM_SIZE
+#define CONFIG_WIFICHN_EVENT_STREAM_SIZE 64
+#endif
+
+/// Тип записи потока событий.
+enum class EWiFiEvent : uint8_t
+{
+	LinkUp = 1,		///< Получен IP адрес (bytes - IP адрес).
+	LinkDown = 2,	///< Соединение потеряно (code - причина отключения).
+	ConnectFail = 3, ///< Неудачная попытка подключения (code - причина).
+	TimeSync = 4,	///< Время синхронизировано.
+	FastConnect = 5, ///< Итог подключения (code - 1: сохранённая точка доступа, 2: сохранённая аренда; bytes - от start() до IP, мс; rate - от start() до подключения к точке, мс).
+	SelfTest = 6,	///< Итог самопроверки (code - ESelfTestMode, отрицательный - ошибка; bytes - скорость, кбит/с; rate - потеряно датаграмм).
+	OtaStatus = 16,	///< Смена статуса OTA (code - EOtaStatus).
+	OtaProgress = 17, ///< Прогресс OTA (code - проценты).
+	OtaWriteStats = 18, ///< Итог записи OTA (code - доля пропущенных секторов, %; bytes - пропущено байт; rate - сэкономлено мс).
+	OtaLockStats = 19, ///< Окна writeEvent за OTA (code - число окон; bytes - суммарно мс; rate - наибольшее мс).
+	OtaTune = 20, ///< Подобран размер буфера чтения OTA (code - число вариантов; bytes - размер; rate - скорость, байт/с).
+	OtaTls = 21 ///< TLS подключение OTA (code - подключение с рукопожатием, мс; bytes - пик памяти; rate - память сессии, байт).
+};
+
+/// Статус OTA (значения совпадают с параметром status onOtaProgress).
+enum EOtaStatus : int16_t
+{
+	OTA_STATUS_ABORT = -1,			///< esp_https_ota прервана.
+	OTA_STATUS_OK = 0,				///< Итог: успешно.
+	OTA_STATUS_START = 1,			///< Начало OTA.
+	OTA_STATUS_CONNECTED = 2,		///< Соединение с сервером установлено.
+	OTA_STATUS_WRITE = 3,			///< Запись образа (progress - проценты).
+	OTA_STATUS_FINISH = 4,			///< Образ записан.
+	OTA_STATUS_SYNC_TIME = 10,		///< Ожидание синхронизации времени.
+	OTA_STATUS_CANCEL = 100,		///< Итог: отменено.
+	OTA_STATUS_ERR_HANDLER = 101,	///< Итог: ошибка регистрации обработчика событий.
+	OTA_STATUS_ERR_BEGIN = 102,		///< Итог: ошибка подключения к серверу.
+	OTA_STATUS_ERR_PERFORM = 103,	///< Итог: ошибка закачки/записи.
+	OTA_STATUS_ERR_FINISH = 104,	///< Итог: ошибка проверки/активации образа.
+	OTA_STATUS_ERR_IMAGE_SIZE = 112, ///< Итог: неизвестен размер образа.
+	OTA_STATUS_ERR_IMAGE_DESC = 113, ///< Итог: ошибка чтения описания образа.
+	OTA_STATUS_ERR_VERIFY = 114,	///< Итог: хэш образа не совпал.
+	OTA_STATUS_ERR_CHIP = 115		///< Итог: образ для другого чипа или ревизии.
+};
+
+/// Запись потока событий.
+struct SWiFiEventRecord
+{
+	uint32_t time_ms; ///< Время от старта, мс.
+	uint8_t type;	  ///< Тип записи (EWiFiEvent).
+	uint8_t seq;	  ///< Счётчик записей (младший байт) - для обнаружения потерь.
+	int16_t code;	  ///< Статус/код ошибки/причина.
+	uint32_t bytes;	  ///< Число байт (передано/записано).
+	uint32_t rate;	  ///< Скорость, байт/с.
+};
+static_assert(sizeof(SWiFiEventRecord) == 16, "SWiFiEventRecord must stay 16 bytes");
+
+class CWiFiEventStream
+{
+protected:
+	static constexpr EventBits_t BATCH_BIT = BIT0; ///< Накоплено не меньше mThreshold записей.
+
+	SWiFiEventRecord mRing[CONFIG_WIFICHN_EVENT_STREAM_SIZE]; ///< Кольцевой буфер.
+	size_t mHead = 0;										  ///< Индекс записи.
+	size_t mCount = 0;										  ///< Число непрочитанных записей.
+	uint32_t mSeq = 0;										  ///< Счётчик записей.
+	uint32_t mDropped = 0;									  ///< Число затёртых непрочитанных записей.
+	size_t mThreshold = 1;									  ///< Порог пробуждения потребителя.
+	portMUX_TYPE mMux = portMUX_INITIALIZER_UNLOCKED;		  ///< Защита буфера.
+	EventGroupHandle_t mEvents;								  ///< Событие накопления пачки.
+
+public:
+	/// Конструктор.
+	CWiFiEventStream();
+	/// Деструктор.
+	~CWiFiEventStream();
+
+	/// Добавить запись (при переполнении затирается самая старая).
+	/*!
+	  Прогресс OTA и ожидание синхронизации времени обновляют последнюю
+	  непрочитанную запись того же вида (номер seq не расходуется).
+	  \param[in] type - Тип записи.
+	  \param[in] code - Статус/код ошибки.
+	  \param[in] bytes - Число байт.
+	  \param[in] rate - Скорость, байт/с.
+	*/
+	void push(EWiFiEvent type, int16_t code, uint32_t bytes = 0, uint32_t rate = 0);
+
+	/// Забрать пачку записей.
+	/*!
+	  \param[out] buf - Буфер записей.
+	  \param[in] max - Размер буфера в записях.
+	  \return Число прочитанных записей.
+	*/
+	size_t read(SWiFiEventRecord *buf, size_t max);
+
+	/// Ожидание накопления пачки.
+	/*!
+	  \param[in] count - Размер пачки (порог пробуждения).
+	  \param[in] xTicksToWait - Время ожидания.
+	  \return true - если накоплено не меньше count записей.
+	*/
+	bool waitBatch(size_t count, TickType_t xTicksToWait);
+
+	/// Число непрочитанных записей.
+	size_t available();
+	/// Число потерянных (затёртых) записей с момента запуска.
+	inline uint32_t dropped() { return mDropped; };
+};
@@ -0,0 +1,127 @@
+/*!
+	\file
+	\brief Результат асинхронной операции WiFiStation (подключение, сканирование, OTA).
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Ожидающая задача блокируется на своём task notification (индекс
+	CONFIG_WIFICHN_NOTIFY_INDEX) и просыпается сразу по завершении операции,
+	без циклов vTaskDelay().
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <memory>
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <cstdlib>
+#endif
+
+#ifndef CONFIG_WIFICHN_NOTIFY_INDEX
+#define CONFIG_WIFICHN_NOTIFY_INDEX 0
+#endif
+static_assert(CONFIG_WIFICHN_NOTIFY_INDEX < configTASK_NOTIFICATION_ARRAY_ENTRIES, "CONFIG_WIFICHN_NOTIFY_INDEX out of range");
+
+/// Состояние асинхронной операции (разделяется между WiFiStation и ожидающей задачей).
+class CWiFiPromise
+{
+protected:
+	std::atomic<bool> mClaimed{false};			///< Результат уже устанавливается.
+	std::atomic<bool> mDone{false};				///< Операция завершена.
+	std::atomic<TaskHandle_t> mWaiter{nullptr}; ///< Ожидающая задача.
+	int32_t mResult = 0;						///< Результат операции.
+
+public:
+	/// Завершить операцию (повторные вызовы игнорируются).
+	/*!
+	  \param[in] result - Результат операции.
+	  \return true - если операция завершена этим вызовом.
+	*/
+	bool complete(int32_t result);
+
+	/// Ожидание завершения (только одна ожидающая задача).
+	/*!
+	  \param[in] xTicksToWait - Время ожидания.
+	  \return true - если операция завершена.
+	*/
+	bool wait(TickType_t xTicksToWait);
+
+	/// Операция завершена.
+	inline bool isDone() { return mDone.load(std::memory_order_acquire); };
+	/// Результат операции (действителен после isDone()).
+	inline int32_t result() { return mResult; };
+};
+
+/// Дескриптор асинхронной операции.
+class CWiFiFuture
+{
+protected:
+	std::shared_ptr<CWiFiPromise> mPromise; ///< Общее состояние операции.
+
+public:
+	CWiFiFuture() = default;
+	/// Конструктор.
+	/*!
+	  \param[in] promise - Общее состояние операции.
+	*/
+	explicit CWiFiFuture(std::shared_ptr<CWiFiPromise> promise) : mPromise(promise) {};
+
+	/// Дескриптор связан с операцией.
+	inline bool isValid() { return mPromise != nullptr; };
+	/// Операция завершена.
+	inline bool isDone() { return (mPromise == nullptr) || mPromise->isDone(); };
+	/// Ожидание завершения.
+	/*!
+	  \param[in] xTicksToWait - Время ожидания.
+	  \return true - если операция завершена.
+	*/
+	inline bool wait(TickType_t xTicksToWait = portMAX_DELAY) { return (mPromise == nullptr) || mPromise->wait(xTicksToWait); };
+	/// Результат операции: ESP_OK/код ошибки (подключение), число точек доступа (сканирование), статус OTA.
+	inline int32_t result() { return (mPromise == nullptr) ? -1 : mPromise->result(); };
+};
+
+#if defined(__cpp_impl_coroutine)
+/// Адаптер co_await: сопрограмма выполняется в контексте задачи (CBaseTask),
+/// ожидание блокирует эту задачу на task notification.
+struct CWiFiAwaiter
+{
+	CWiFiFuture future;
+	bool await_ready() { return future.isDone(); };
+	bool await_suspend(std::coroutine_handle<>)
+	{
+		future.wait();
+		return false;
+	};
+	int32_t await_resume() { return future.result(); };
+};
+inline CWiFiAwaiter operator co_await(CWiFiFuture future) { return CWiFiAwaiter{future}; }
+
+/// Тип сопрограммы для цепочек connect->probe->OTA внутри CBaseTask::run().
+/*!
+  Сопрограмма выполняется сразу и целиком в вызывающей задаче:
+  \code
+  CWiFiRoutine update(const char *url)
+  {
+	  if (co_await WiFiStation::Instance()->connectAsync(pdMS_TO_TICKS(10000)) != ESP_OK)
+		  co_return;
+	  co_await WiFiStation::Instance()->otaAsync(url);
+  }
+  \endcode
+*/
+struct CWiFiRoutine
+{
+	struct promise_type
+	{
+		CWiFiRoutine get_return_object() { return {}; };
+		std::suspend_never initial_suspend() noexcept { return {}; };
+		std::suspend_never final_suspend() noexcept { return {}; };
+		void return_void() {};
+		void unhandled_exception() { abort(); };
+	};
+};
+#endif
@@ -11,7 +11,30 @@
 #include "stdint.h"
 #include "sdkconfig.h"
 #include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
 #include <cstring>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "CWiFiFuture.h"
+#if CONFIG_WIFICHN_HTTP_POOL
+#include "CHttpPool.h"
+#endif
+#if CONFIG_WIFICHN_LINK_MONITOR
+#include "CLinkMonitor.h"
+#endif
+#if CONFIG_WIFICHN_FAST_CONNECT
+#include "CFastConnect.h"
+#endif
+#if CONFIG_WIFICHN_MCAST
+#include "CMulticastChannel.h"
+#endif
+#if CONFIG_WIFICHN_SELFTEST
+#include "CSelfTest.h"
+#endif
+#include "CWiFiEventStream.h"
 
 #include <fstream>
 #include "CJsonType.h"
@@ -34,13 +57,47 @@ typedef void onWiFiEvent(uint16_t id, const char* message);
 
 typedef void onWiFiScan(wifi_ap_record_t *ap_list, uint16_t ap_count);
 
+/// Состояние станции.
+enum class EWiFiState : uint8_t
+{
+	Idle,		///< Остановлена.
+	Scanning,	///< Сканирование точек доступа.
+	Connecting, ///< Запущена, IP адрес ещё не получен (или соединение потеряно).
+	Connected,	///< Подключена, IP адрес получен.
+	Stopping	///< Идёт остановка — обработчики событий не вызывают esp_wifi_connect().
+};
+
 #ifdef CONFIG_WIFICHN_OTA
 typedef void onOtaProgress(uint16_t progress, int16_t status);
 typedef void onOtaImageDesc(esp_app_desc_t& desc);
 #endif
+#if CONFIG_WIFICHN_SELFTEST
+/// Обработчик завершения самопроверки (в контексте задачи теста).
+/*
+ *  \param[in] err - ESP_OK или код ошибки (результат тогда частичный).
+ *  \param[in] result - Результат.
+ */
+typedef void onSelfTest(esp_err_t err, const SSelfTestResult *result);
+#endif
 
 #if CONFIG_WIFICHN_OTA
 class COTATask;
+class COtaSink;
+#endif
+#if (CONFIG_WIFICHN_SYNC_TIME == 1)
+class CTimeSyncTask;
+#endif
+#if CONFIG_WIFICHN_APSTA
+class CProvisionTask;
+#endif
+#if CONFIG_WIFICHN_MCAST
+class CMulticastTask;
+#endif
+#if CONFIG_WIFICHN_QOS
+class CTrafficTask;
+#endif
+#if CONFIG_WIFICHN_SELFTEST
+class CSelfTestTask;
 #endif
 
 class WiFiStation
@@ -48,41 +105,162 @@ class WiFiStation
 #if CONFIG_WIFICHN_OTA
 	friend class COTATask;
 #endif
+#if (CONFIG_WIFICHN_SYNC_TIME == 1)
+	friend class CTimeSyncTask;
+#endif
+#if CONFIG_WIFICHN_APSTA
+	friend class CProvisionTask;
+#endif
+
+public:
+	static constexpr EventBits_t TIME_SYNC_BIT = BIT0;	  ///< Время синхронизировано.
+	static constexpr EventBits_t CONNECTED_BIT = BIT1;	  ///< IP адрес получен.
+	static constexpr EventBits_t DISCONNECTED_BIT = BIT2; ///< IP адреса нет.
+	static constexpr EventBits_t SCAN_DONE_BIT = BIT3;	  ///< Сканирование завершено.
+	static constexpr EventBits_t IDLE_BIT = BIT4;		  ///< Станция остановлена.
 
 protected:
-	static WiFiStation *theSingleInstance; ///< Указатель на единственный экземпляр
+	static std::atomic<WiFiStation *> theSingleInstance; ///< Указатель на единственный экземпляр
+	static std::mutex mInstanceMutex;					 ///< Защита создания/удаления экземпляра.
+	EventGroupHandle_t mEvents;							 ///< События состояния (TIME_SYNC_BIT ...).
+	std::atomic<EWiFiState> mState{EWiFiState::Idle};	 ///< Состояние станции.
 #if (CONFIG_WIFICHN_SYNC_TIME == 1)
-	bool mStartSyncTime = false; ///< Флаг запуска синхронизации времени
+	CTimeSyncTask *mTimeSync = nullptr; ///< Задача синхронизации времени (nullptr - не запускалась).
 
-	/// Callback функция для синхронизации времени.
+	/// Обработка завершения синхронизации времени (вызывается из CTimeSyncTask).
 	/*
 	 *  \param[in] tv - Указатель на структуру timeval (текущее время).
 	 */
-	static void time_sync_notification_cb(struct timeval *tv);
-	/// Запуск синхронизации времени не из DHCP
+	void time_sync_notification_cb(struct timeval *tv);
+	/// Запуск синхронизации времени (параллельный опрос SNTP серверов, затем HTTP Date).
 	void syncTime();
 #endif
 
 	wifi_config_t m_wifi_config; ///< Структура WiFi конфигурации.
 	wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
 
-	/// Callback функция для обработки событий WiFi.
-	static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+	/// Маршрут события к обработчику.
+	struct SEventRoute
+	{
+		const esp_event_base_t *base; ///< База события (WIFI_EVENT, IP_EVENT).
+		int32_t id;					  ///< Событие.
+		esp_event_handler_t handler;  ///< Обработчик.
+	};
+	static constexpr size_t MAX_ROUTES = 6; ///< Наибольшее число маршрутов режима.
+
+	const SEventRoute *mRoutes = nullptr;						  ///< Маршруты текущего режима (таблица времени компиляции).
+	size_t mRouteCount = 0;										  ///< Число маршрутов.
+	esp_event_handler_instance_t mHandlers[MAX_ROUTES] = {};	  ///< Регистрации обработчиков.
+
+	/// Подписка на события режима.
+	/*
+	* Каждый обработчик регистрируется на своё событие: цикл событий вызывает его
+	* без промежуточного разбора, события отключённых функций не подписываются.
+	* \param[in] routes - Таблица маршрутов.
+	* \param[in] count - Число маршрутов (не больше MAX_ROUTES).
+	*/
+	void subscribe(const SEventRoute *routes, size_t count);
+	/// Отписка от событий текущего режима.
+	void unsubscribe();
+
+	/// WIFI_EVENT_STA_START: первое подключение.
+	static void on_sta_start(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+	/// WIFI_EVENT_STA_DISCONNECTED: обрыв соединения или неудачная попытка.
+	static void on_sta_disconnected(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+	/// IP_EVENT_STA_GOT_IP: IP адрес получен.
+	static void on_got_ip(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+#if CONFIG_WIFICHN_FAST_CONNECT || CONFIG_WIFICHN_TIMELINE
+	/// WIFI_EVENT_STA_CONNECTED: ассоциация завершена.
+	static void on_sta_connected(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+#endif
+#if CONFIG_WIFICHN_LINK_MONITOR
+	/// WIFI_EVENT_STA_BEACON_TIMEOUT: пропуск маяков точки доступа.
+	static void on_beacon_timeout(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+#endif
+#if CONFIG_WIFICHN_SCAN
+	/// WIFI_EVENT_SCAN_DONE: результаты сканирования.
+	static void on_scan_done(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+#endif
 
 	onWiFiConnect *mConnectCallback = nullptr; ///< Событие на подсоединение/отсоединения к WiFi.
 	onWiFiEvent *mEventCallback = nullptr;
+#if CONFIG_WIFICHN_SCAN
 	onWiFiScan* mWiFiScanCallback = nullptr;
+#endif
 	esp_netif_t *m_net_if;					   ///< esp_netif_object server
 
-	uint32_t mSrcIP = 0;					///< IP адрес устройства.
-	bool mConnecting = false;				///< Флаг подключения.
-	bool mStopping = false;					///< Флаг остановки — блокирует event_handler от вызова esp_wifi_connect().
+	std::atomic<uint32_t> mSrcIP{0};		///< IP адрес устройства.
+	CWiFiEventStream mEventStream;			///< Поток событий подключения и OTA.
+#if CONFIG_WIFICHN_LINK_MONITOR
+	CLinkMonitor mLink; ///< Монитор качества канала.
+#endif
+#if CONFIG_WIFICHN_HTTP_POOL
+	CHttpPool mHttpPool; ///< Постоянные HTTP(S) соединения OTA и приложения (сбрасываются при потере связи).
+#endif
+#if CONFIG_WIFICHN_MCAST
+	std::atomic<CMulticastTask *> mMulticast{nullptr}; ///< Канал групповой рассылки (nullptr - не запущен).
+#endif
+#if CONFIG_WIFICHN_QOS
+	CTrafficTask *mQos = nullptr; ///< Очереди отправки по классам трафика.
+#endif
+#if CONFIG_WIFICHN_SELFTEST
+	std::mutex mSelfTestMutex;					   ///< Защита запуска/остановки самопроверки.
+	CSelfTestTask *mSelfTest = nullptr;			   ///< Задача самопроверки (nullptr - не запускалась).
+	SSelfTestResult mSelfTestResult = {};		   ///< Результат последней самопроверки.
+	bool mSelfTestValid = false;				   ///< Результат есть.
+	std::shared_ptr<CWiFiPromise> mSelfTestPromise; ///< Ожидаемое завершение самопроверки.
+#endif
+
+	/// Установка состояния с выставлением событий.
+	/*
+	* \param[in] state - Новое состояние.
+	*/
+	void setState(EWiFiState state);
+
+	std::mutex mAsyncMutex;							 ///< Защита ожидаемых операций и кэша сканирования.
+	std::shared_ptr<CWiFiPromise> mConnectPromise;	 ///< Ожидаемое подключение.
+	esp_timer_handle_t mConnectTimer = nullptr;		 ///< Таймаут ожидаемого подключения.
+	uint32_t mConnectGen = 0;						 ///< Номер ожидаемого подключения.
+	uint32_t mConnectArmed = 0;						 ///< Номер подключения, для которого взведён таймаут.
+	int64_t mConnectDeadline = 0;					 ///< Срок взведённого таймаута, мкс.
+#if CONFIG_WIFICHN_SCAN
+	std::shared_ptr<CWiFiPromise> mScanPromise;		 ///< Ожидаемое сканирование.
+	std::vector<wifi_ap_record_t> mScanResults;		 ///< Результаты последнего сканирования.
+#endif
+
+	/// Завершить ожидаемую операцию и освободить слот.
+	/*
+	* \param[in] slot - Слот операции.
+	* \param[in] result - Результат.
+	*/
+	void completePromise(std::shared_ptr<CWiFiPromise> &slot, int32_t result);
+	/// Занять слот ожидаемой операции (если операция уже ожидается - вернуть её).
+	/*
+	* \param[in] slot - Слот операции.
+	* \param[out] created - true, если создана новая операция.
+	* \return Операция.
+	*/
+	std::shared_ptr<CWiFiPromise> claimPromise(std::shared_ptr<CWiFiPromise> &slot, bool &created);
+	/// Callback таймаута подключения.
+	static void connect_timeout_cb(void *arg);
+
+#if CONFIG_WIFICHN_APSTA
+	esp_netif_t *m_ap_if = nullptr;		  ///< esp_netif точки доступа.
+	CProvisionTask *mProvision = nullptr; ///< Сервис провижининга (nullptr - точка доступа не запущена).
+
+	/// Применить текущую конфигурацию станции без перезапуска WiFi (вызывается из CProvisionTask).
+	void applyConfig();
+#endif
 
 #ifdef CONFIG_WIFICHN_OTA
-	COTATask* mOTA = nullptr;
+	std::atomic<COTATask *> mOTA{nullptr};
+	std::atomic<bool> mOtaBusy{false}; ///< Слот OTA занят (от startOta() до stopOta()).
 
 	onOtaProgress *mOtaProgressCallback = nullptr;
 	onOtaImageDesc *mOtaImageDesc = nullptr;
+	const char *mOtaKey = nullptr; ///< Открытый ключ PEM подписи манифеста OTA (nullptr - подпись не проверяется).
+	const char *mOtaCert = nullptr; ///< Сертификат(ы) PEM сервера OTA (nullptr - пакет корневых сертификатов).
+	std::shared_ptr<CWiFiPromise> mOtaPromise; ///< Ожидаемое завершение OTA.
 
 	/// Очередь обработчиков события записи HTTPS OTA во flash (используется для приостановки радио на время закачки)
 	static std::list<onWriteEvent *> mWriteQueue;
@@ -103,55 +281,252 @@ public:
 	*/
 	static WiFiStation *Instance()
 	{
-		if (theSingleInstance == nullptr)
-			theSingleInstance = new WiFiStation();
-		return theSingleInstance;
+		WiFiStation *res = theSingleInstance.load(std::memory_order_acquire);
+		if (res == nullptr)
+		{
+			std::lock_guard<std::mutex> lock(mInstanceMutex);
+			res = theSingleInstance.load(std::memory_order_relaxed);
+			if (res == nullptr)
+			{
+				res = new WiFiStation();
+				theSingleInstance.store(res, std::memory_order_release);
+			}
+		}
+		return res;
 	};
 	/// Освобождение ресурсов.
 	static void free()
 	{
-		if (theSingleInstance != nullptr)
-		{
-			delete theSingleInstance;
-			theSingleInstance = nullptr;
-		}
+		std::lock_guard<std::mutex> lock(mInstanceMutex);
+		WiFiStation *res = theSingleInstance.exchange(nullptr);
+		if (res != nullptr)
+			delete res;
 	};
 
 	/// Подключение к WiFi.
 	/*
 	* \return true - если работает, false - если нет.
 	*/
-	static inline bool isRun(){return (theSingleInstance != nullptr);}; 
+	static inline bool isRun(){return (theSingleInstance.load() != nullptr);}; 
 
 	/// Подключение к WiFi.
 	/*
 	* \param[in] connectCallback - Указатель на функцию обработки события подключения к WiFi.
-	* \return true - если подключение успешно, false - если не удалось подключиться.
+	* \return true - если подключение запущено, false - если станция уже запущена (в т.ч. из другой задачи).
 	*/
 	bool start(onWiFiConnect *connectCallback, onWiFiEvent* eventCallback = nullptr, const char* ssid = nullptr, const char* password = nullptr);
 
+#if CONFIG_WIFICHN_SCAN
 	bool startScan(onWiFiScan *scanCallback);
+#endif
+
+	/// Асинхронное подключение к WiFi.
+	/*
+	* Запускает станцию (если не запущена) с ранее заданными обработчиками.
+	* По истечении таймаута операция завершается с ESP_ERR_TIMEOUT, подключение при этом продолжается.
+	* \param[in] timeout - Таймаут подключения (portMAX_DELAY - без таймаута).
+	* \param[in] ssid - Имя сети (nullptr - из конфигурации).
+	* \param[in] password - Пароль (nullptr - из конфигурации).
+	* \return Дескриптор операции, результат - ESP_OK или код ошибки.
+	*/
+	CWiFiFuture connectAsync(TickType_t timeout, const char *ssid = nullptr, const char *password = nullptr);
+
+#if CONFIG_WIFICHN_SCAN
+	/// Асинхронное сканирование точек доступа.
+	/*
+	* \return Дескриптор операции, результат - число найденных точек доступа (-1 - ошибка).
+	*/
+	CWiFiFuture scanAsync();
+
+	/// Результаты последнего сканирования.
+	/*
+	* \param[out] list - Список точек доступа.
+	* \return Число точек доступа.
+	*/
+	size_t getScanResults(std::vector<wifi_ap_record_t> &list);
+#endif
 
 	/// Отключение от WiFi.
 	/*
-	* \return true - если отключение успешно, false - если не удалось отключиться.
+	* Как и прежде, останавливает драйвер и удаляет default event loop в любом
+	* состоянии, включая Idle.
+	* \return true - если отключение выполнено, false - если его уже выполняет другой вызов stop().
 	*/
 	bool stop();
 	
-	inline bool isConnecting(){return mConnecting;};
+	inline bool isConnecting()
+	{
+		EWiFiState st = mState.load();
+		return (st == EWiFiState::Connecting) || (st == EWiFiState::Connected);
+	};
+
+	/// Текущее состояние станции.
+	inline EWiFiState getState() { return mState.load(); };
+
+	/// IP адрес устройства (0 - не подключено).
+	inline uint32_t getIP() { return mSrcIP.load(); };
+
+	/// Поток событий подключения и OTA для пакетного чтения.
+	inline CWiFiEventStream &events() { return mEventStream; };
+
+	/// Ожидание событий состояния.
+	/*
+	* \param[in] bits - Ожидаемые события (TIME_SYNC_BIT ...).
+	* \param[in] xTicksToWait - Время ожидания.
+	* \return true - если все события наступили.
+	*/
+	inline bool wait(EventBits_t bits, TickType_t xTicksToWait = portMAX_DELAY)
+	{
+		return (xEventGroupWaitBits(mEvents, bits, pdFALSE, pdTRUE, xTicksToWait) & bits) == bits;
+	};
+
+#if CONFIG_WIFICHN_APSTA
+	/// Запуск точки доступа параллельно станции (режим APSTA) с сервисом провижининга.
+	/*
+	* Станция должна быть запущена (start()). Канал точки доступа совпадает с каналом станции.
+	* Открытая точка доступа не поднимается: без пароля WPA2 провижининг доступен любому в радиусе.
+	* \param[in] ssid - Имя точки доступа.
+	* \param[in] password - Пароль WPA2 (не короче 8 символов).
+	* \param[in] token - Секрет провижининга (не короче 8 символов): команда "set" без него отклоняется.
+	* \return true - если точка доступа запущена, false - состояние станции или неверный пароль/секрет.
+	*/
+	bool startAp(const char *ssid, const char *password, const char *token);
+	/// Остановка точки доступа (станция продолжает работу).
+	/*
+	* \return true - если точка доступа была запущена.
+	*/
+	bool stopAp();
+	/// Точка доступа запущена.
+	inline bool isApRun() { return mProvision != nullptr; };
+#endif
+
+#if CONFIG_WIFICHN_MCAST
+	/// Запуск канала групповой рассылки.
+	/*
+	* Вход в группу - при каждом получении IP адреса, выход - при потере соединения.
+	* \param[in] group - IP адрес группы (сетевой порядок байт, например, ESP_IP4TOADDR(239, 1, 2, 3)).
+	* \param[in] port - Порт группы.
+	* \param[in] deliver - Обработчик собранных сообщений (в контексте задачи канала).
+	* \return true - если канал запущен.
+	*/
+	bool startMulticast(uint32_t group, uint16_t port, CMulticastChannel::TDeliver deliver);
+	/// Остановка канала групповой рассылки.
+	/*
+	* \return true - если канал был запущен.
+	*/
+	bool stopMulticast();
+	/// Канал групповой рассылки (nullptr - не запущен).
+	inline CMulticastTask *multicast() { return mMulticast.load(); };
+#endif
+#if CONFIG_WIFICHN_QOS
+	/// Очереди отправки по классам трафика (каналы RUDP и групповой рассылки, фоновая закачка OTA).
+	inline CTrafficTask *qos() { return mQos; };
+#endif
+
+#if CONFIG_WIFICHN_SELFTEST
+	/// Запуск самопроверки канала против tools/selftest_server.py.
+	/*
+	* Станция должна быть подключена. Одновременно идёт один тест; из обработчика
+	* завершения новый тест не запускается (его задача ещё не завершилась).
+	* \param[in] cfg - Параметры теста (режим, сервер, длительность, скорость UDP).
+	* \param[in] callback - Обработчик завершения (nullptr - только getSelfTestResult()).
+	* \return true - тест запущен.
+	*/
+	bool startSelfTest(const SSelfTestConfig &cfg, onSelfTest *callback = nullptr);
+	/// Асинхронная самопроверка канала.
+	/*
+	* \param[in] cfg - Параметры теста.
+	* \return Дескриптор операции, результат - ESP_OK или код ошибки; замер - getSelfTestResult().
+	*/
+	CWiFiFuture selfTestAsync(const SSelfTestConfig &cfg);
+	/// Результат последней самопроверки.
+	/*
+	* \param[out] result - Результат.
+	* \return true - самопроверка выполнялась.
+	*/
+	bool getSelfTestResult(SSelfTestResult &result);
+	/// Прервать самопроверку.
+	/*
+	* \return true - если тест шёл.
+	*/
+	bool stopSelfTest();
+#endif
 
 	/// Настройки WiFi из файла.
 	/*
+	* При CONFIG_WIFICHN_FAST_CONNECT после пробуждения из deep sleep настройки
+	* берутся из RTC-памяти без чтения файла (после правки файла - CFastConnect::invalidate()).
 	* \param[in] fileName - имя файла.
 	*/
 	uint16_t initFromFile(const char *fileName);
 	/// Настройки WiFi из json.
 	uint16_t initFromJson(json& config);
 
+#if CONFIG_WIFICHN_LINK_MONITOR
+	/// Монитор качества канала.
+	/*
+	* Сглаженный RSSI, качество и ожидаемая скорость читаются без вызовов драйвера,
+	* например, чтобы отложить OTA при плохой связи.
+	* \return Монитор.
+	*/
+	inline CLinkMonitor &linkMonitor() { return mLink; };
+#endif
+
+#if CONFIG_WIFICHN_HTTP_POOL
+	/// Пул HTTP(S) соединений.
+	/*
+	* Общий для OTA и запросов приложения к тому же серверу: клиент из acquire()
+	* после полностью прочитанного ответа возвращается release(client, true),
+	* и следующий запрос идёт без разрешения имени и TLS-рукопожатия.
+	* \return Пул.
+	*/
+	inline CHttpPool &httpPool() { return mHttpPool; };
+#endif
+
 #ifdef CONFIG_WIFICHN_OTA
 	bool startOta(onOtaProgress *otaProgressCallback, const char* file, onOtaImageDesc* otaImageDesc=nullptr);
 	bool stopOta();
 
+	/// Асинхронное обновление HTTPS OTA.
+	/*
+	* \param[in] file - URL образа.
+	* \param[in] otaImageDesc - Обработчик описания образа.
+	* \return Дескриптор операции, результат - итоговый статус OTA (0 - успешно).
+	*/
+	CWiFiFuture otaAsync(const char *file, onOtaImageDesc *otaImageDesc = nullptr);
+
+	/// Закачка образа в произвольный приёмник (файл, раздел данных, сопроцессор).
+	/*
+	* Занимает тот же слот, что и startOta(): одновременно идёт только одна закачка.
+	* \param[in] otaProgressCallback - Обработчик статуса.
+	* \param[in] file - URL образа.
+	* \param[in] sink - Приёмник (должен существовать до конца закачки).
+	* \return true - задача закачки запущена.
+	*/
+	bool startDownload(onOtaProgress *otaProgressCallback, const char *file, COtaSink *sink);
+	/// Асинхронная закачка образа в произвольный приёмник.
+	/*
+	* \param[in] file - URL образа.
+	* \param[in] sink - Приёмник (должен существовать до конца закачки).
+	* \return Дескриптор операции, результат - итоговый статус (0 - успешно).
+	*/
+	CWiFiFuture downloadAsync(const char *file, COtaSink *sink);
+
+	/// Открытый ключ подписи манифеста OTA (CONFIG_WIFICHN_OTA_VERIFY).
+	/*
+	* Если ключ задан, манифест обязателен и должен быть подписан.
+	* \param[in] pem - Ключ PEM (строка должна существовать до конца OTA, nullptr - без подписи).
+	*/
+	inline void setOtaKey(const char *pem) { mOtaKey = pem; };
+
+	/// Сертификат сервера OTA вместо пакета корневых сертификатов.
+	/*
+	* CA сервера (можно несколько, подряд) или самоподписанный сертификат сервера.
+	* При CONFIG_WIFICHN_OTA_TLS_PINNED обязателен: пакет не подключается к прошивке.
+	* \param[in] pem - Сертификат(ы) PEM (строка должна существовать до конца OTA).
+	*/
+	inline void setOtaCert(const char *pem) { mOtaCert = pem; };
+
 	/// @brief Добавить обработчик события записи HTTPS OTA (вызывается при начале/конце записи очередного блока во flash)
 	/// @param event Указатель на функцию-обработчик
 	static void addWriteEvent(onWriteEvent *event);
@@ -0,0 +1,204 @@
+/*!
+    \file
+    \brief Класс задачи групповой рассылки (CMulticastChannel поверх WiFiStation).
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CMulticastTask.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/api.h"
+#if CONFIG_WIFICHN_QOS
+#include "CTrafficTask.h"
+#endif
+
+#if CONFIG_WIFICHN_MCAST
+static const char *TAG = "mcast";
+
+#if CONFIG_SPIRAM
+#define MCAST_BUFFER_CAPS MALLOC_CAP_SPIRAM ///< Буферы сборки - во внешней памяти.
+#else
+#define MCAST_BUFFER_CAPS MALLOC_CAP_DEFAULT
+#endif
+
+static inline uint32_t now_ms()
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+CMulticastTask::CMulticastTask(uint32_t group, uint16_t port, CMulticastChannel::TDeliver deliver)
+    : CBaseTask(), mGroup(group), mPort(port),
+      mChannel([this](const uint8_t *data, size_t len)
+               { output(data, len); },
+               [this](const uint8_t *data, size_t len)
+               { reply(data, len); },
+               deliver, CONFIG_WIFICHN_MCAST_HISTORY, MCAST_BUFFER_CAPS)
+{
+    CBaseTask::init(MCASTTASK_NAME, MCASTTASK_STACKSIZE, MCASTTASK_PRIOR, MCASTTASK_LENGTH, MCASTTASK_CPU, MCASTTASK_PSRAM);
+}
+
+CMulticastTask::~CMulticastTask()
+{
+    mCancel = true;
+    do
+    {
+        vTaskDelay(1);
+    } while (mTaskQueue != nullptr);
+}
+
+static void send_to(struct netconn *conn, uint32_t ip, uint16_t port, const uint8_t *data, size_t len)
+{
+    if ((conn == nullptr) || (ip == 0))
+        return;
+#if CONFIG_WIFICHN_QOS
+    if (CTrafficTask *qos = WiFiStation::Instance()->qos())
+    {
+        qos->send(MCASTTASK_CLASS, conn, ip, port, data, len);
+        return;
+    }
+#endif
+    struct netbuf *buf = netbuf_new();
+    if (buf == nullptr)
+        return;
+    ip_addr_t addr;
+    ip_addr_set_ip4_u32_val(addr, ip);
+    if (ERR_OK == netbuf_ref(buf, data, len))
+        netconn_sendto(conn, buf, &addr, port);
+    netbuf_delete(buf);
+}
+
+void CMulticastTask::output(const uint8_t *data, size_t len)
+{
+    // Без членства в группе интерфейса для рассылки нет: повтор придёт по NACK.
+    if (mJoined != 0)
+        send_to(mConn, mGroup, mPort, data, len);
+}
+
+void CMulticastTask::reply(const uint8_t *data, size_t len)
+{
+    if (mJoined != 0)
+        send_to(mConn, mFromIP, mFromPort, data, len);
+}
+
+int32_t CMulticastTask::send(const uint8_t *data, size_t len)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    if (mConn == nullptr)
+        return -1;
+    return mChannel.send(data, len, now_ms());
+}
+
+SMcastStats CMulticastTask::stats()
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    return mChannel.stats();
+}
+
+void CMulticastTask::updateMembership()
+{
+    uint32_t ip = mLinkIP.load();
+    if (ip == mJoined)
+        return;
+    ip_addr_t group;
+    ip_addr_set_ip4_u32_val(group, mGroup);
+    if (mJoined != 0)
+    {
+        // Адрес интерфейса после обрыва уже сброшен: выход - со всех интерфейсов.
+        netconn_join_leave_group(mConn, &group, IP_ADDR_ANY, NETCONN_LEAVE);
+        mJoined = 0;
+        ESP_LOGI(TAG, "left group");
+    }
+    if (ip != 0)
+    {
+        ip_addr_t netif;
+        ip_addr_set_ip4_u32_val(netif, ip);
+        if (ERR_OK == netconn_join_leave_group(mConn, &group, &netif, NETCONN_JOIN))
+        {
+            mJoined = ip;
+            ESP_LOGI(TAG, "joined group");
+        }
+        else
+        {
+            ESP_LOGW(TAG, "IGMP join failed");
+        }
+    }
+}
+
+void CMulticastTask::run()
+{
+    if (!mChannel.isValid())
+    {
+        ESP_LOGE(TAG, "no memory for buffers");
+        return;
+    }
+    struct netconn *conn = netconn_new(NETCONN_UDP);
+    if (conn == nullptr)
+        return;
+    if (ERR_OK != netconn_bind(conn, IP_ADDR_ANY, mPort))
+    {
+        ESP_LOGE(TAG, "bind failed");
+        netconn_delete(conn);
+        return;
+    }
+#if CONFIG_WIFICHN_QOS
+    CTrafficTask::mark(conn, MCASTTASK_CLASS);
+#endif
+    {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        mConn = conn;
+    }
+
+    uint32_t wait = MCASTTASK_POLL_MS;
+    uint8_t *copy = nullptr;
+    while (!mCancel)
+    {
+        {
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+            updateMembership();
+        }
+        netconn_set_recvtimeout(conn, (wait == 0) ? 1 : wait);
+        struct netbuf *buf = nullptr;
+        err_t err = netconn_recv(conn, &buf);
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        if (err == ERR_OK)
+        {
+            void *data = nullptr;
+            u16_t len = 0;
+            if (buf->p->next == nullptr)
+            {
+                netbuf_data(buf, &data, &len); // пакет в одном pbuf - читаем на месте
+            }
+            else
+            {
+                if (copy == nullptr)
+                    copy = new uint8_t[MCAST_HEADER_SIZE + MCAST_CHUNK];
+                len = netbuf_copy(buf, copy, MCAST_HEADER_SIZE + MCAST_CHUNK);
+                data = copy;
+            }
+            // NACK по этому пакету уйдёт его источнику.
+            mFromIP = ip4_addr_get_u32(ip_2_ip4(netbuf_fromaddr(buf)));
+            mFromPort = netbuf_fromport(buf);
+            mChannel.input((const uint8_t *)data, len, now_ms());
+        }
+        if (buf != nullptr)
+            netbuf_delete(buf);
+        wait = mChannel.poll(now_ms());
+        if (wait > MCASTTASK_POLL_MS)
+            wait = MCASTTASK_POLL_MS;
+    }
+    {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        mLinkIP.store(0);
+        updateMembership();
+        mConn = nullptr;
+    }
+#if CONFIG_WIFICHN_QOS
+    if (CTrafficTask *qos = WiFiStation::Instance()->qos())
+        qos->cancel(conn);
+#endif
+    netconn_delete(conn);
+    delete[] copy;
+}
+#endif
@@ -0,0 +1,82 @@
+/*!
+	\file
+	\brief Класс задачи групповой рассылки (CMulticastChannel поверх WiFiStation).
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Задача слушает порт группы на интерфейсе станции. Вход в группу IGMP
+	выполняется при получении IP адреса, выход - при потере соединения (оба
+	события передаёт WiFiStation, сами запросы IGMP идут из цикла задачи).
+	Рассылка и повторы уходят на адрес группы, NACK - адресу, с которого пришёл
+	последний пакет отправителя. Сообщения доставляются обработчиком в контексте
+	задачи; из обработчика можно вызывать send().
+	При CONFIG_WIFICHN_QOS пакеты идут в классе MCASTTASK_CLASS через
+	WiFiStation::qos() (см. CTrafficTask).
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "WiFiStation.h"
+
+#include "CBaseTask.h"
+#include "CMulticastChannel.h"
+#include "task_settings.h"
+#include <atomic>
+#include <mutex>
+
+struct netconn;
+
+class CMulticastTask : public CBaseTask
+{
+protected:
+	uint32_t mGroup;				 ///< IP адрес группы.
+	uint16_t mPort;					 ///< Порт группы.
+	CMulticastChannel mChannel;		 ///< Протокол.
+	std::recursive_mutex mMutex;	 ///< Защита канала (обработчик сообщений может вызвать send()).
+	struct netconn *mConn = nullptr; ///< UDP соединение.
+	std::atomic<uint32_t> mLinkIP{0}; ///< IP адрес станции (0 - соединения нет).
+	uint32_t mJoined = 0;			 ///< Адрес интерфейса, на котором выполнен вход в группу.
+	uint32_t mFromIP = 0;			 ///< Источник последнего принятого пакета.
+	uint16_t mFromPort = 0;			 ///< Порт источника.
+
+	/// Рассылка пакета группе.
+	void output(const uint8_t *data, size_t len);
+	/// Ответ источнику последнего пакета.
+	void reply(const uint8_t *data, size_t len);
+	/// Привести членство в группе к состоянию соединения.
+	void updateMembership();
+
+	/// Функция задачи.
+	virtual void run() override;
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] group - IP адрес группы (сетевой порядок байт, как esp_ip4_addr_t).
+	  \param[in] port - Порт группы.
+	  \param[in] deliver - Обработчик собранных сообщений.
+	*/
+	CMulticastTask(uint32_t group, uint16_t port, CMulticastChannel::TDeliver deliver);
+	/// Деструктор.
+	virtual ~CMulticastTask();
+
+	/// Станция получила IP адрес (вызывается из WiFiStation).
+	inline void linkUp(uint32_t ip) { mLinkIP.store(ip); };
+	/// Соединение потеряно (вызывается из WiFiStation).
+	inline void linkDown() { mLinkIP.store(0); };
+
+	/// Разослать сообщение группе.
+	/*!
+	  \param[in] data - Сообщение.
+	  \param[in] len - Длина (не больше CONFIG_WIFICHN_MCAST_MAX_MSG).
+	  \return Номер сообщения или -1.
+	*/
+	int32_t send(const uint8_t *data, size_t len);
+
+	/// Статистика канала.
+	SMcastStats stats();
+
+	std::atomic<bool> mCancel{false}; ///< Флаг остановки канала.
+};
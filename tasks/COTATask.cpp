@@ -9,15 +9,23 @@
 #include "COTATask.h"
 #include "CTrace.h"
 #include "esp_https_ota.h"
+#if !CONFIG_WIFICHN_OTA_TLS_PINNED
 #include "esp_crt_bundle.h"
+#endif
 #include <cstring>
 #include "esp_pm.h"
 #include "CDateTimeSystem.h"
+#include "CTimeCache.h"
+#include "CTimeline.h"
+#include "esp_timer.h"
+#if CONFIG_WIFICHN_QOS
+#include "CTrafficTask.h"
+#endif
 
 #if CONFIG_WIFICHN_OTA
 static const char *TAG = "ota";
 
-COTATask::COTATask(WiFiStation *parent, const char *file) : CBaseTask(), mParent(parent), mPath(file)
+COTATask::COTATask(WiFiStation *parent, const char *file, COtaSink *sink) : CBaseTask(), mParent(parent), mPath(file), mSink(sink)
 {
     CBaseTask::init(OTATASK_NAME, OTATASK_STACKSIZE, OTATASK_PRIOR, OTATASK_LENGTH, OTATASK_CPU, OTATASK_PSRAM);
 }
@@ -31,6 +39,18 @@ COTATask::~COTATask()
     } while (mTaskQueue != nullptr);
 }
 
+void COTATask::notify(uint16_t progress, int16_t status)
+{
+    uint32_t rate = 0;
+    int64_t dt = esp_timer_get_time() - mStartTime;
+    if (dt > 0)
+        rate = (uint32_t)(((int64_t)mWritten * 1000000) / dt);
+    mParent->mEventStream.push((status == OTA_STATUS_WRITE) ? EWiFiEvent::OtaProgress : EWiFiEvent::OtaStatus,
+                               (status == OTA_STATUS_WRITE) ? (int16_t)progress : status, mWritten, rate);
+    if (mParent->mOtaProgressCallback != nullptr)
+        mParent->mOtaProgressCallback(progress, status);
+}
+
 void COTATask::event_ota_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
     if (event_base == ESP_HTTPS_OTA_EVENT)
@@ -39,13 +59,11 @@ void COTATask::event_ota_handler(void *arg, esp_event_base_t event_base, int32_t
         switch (event_id)
         {
         case ESP_HTTPS_OTA_START:
-            if (ota->mParent->mOtaProgressCallback != nullptr)
-                ota->mParent->mOtaProgressCallback(0, 1);
+            ota->notify(0, OTA_STATUS_START);
             // ESP_LOGI(TAG, "OTA started");
             break;
         case ESP_HTTPS_OTA_CONNECTED:
-            if (ota->mParent->mOtaProgressCallback != nullptr)
-                ota->mParent->mOtaProgressCallback(0, 2);
+            ota->notify(0, OTA_STATUS_CONNECTED);
             // ESP_LOGI(TAG, "Connected to server");
             break;
         case ESP_HTTPS_OTA_GET_IMG_DESC:
@@ -61,38 +79,90 @@ void COTATask::event_ota_handler(void *arg, esp_event_base_t event_base, int32_t
             // ESP_LOGW(TAG, "Callback to decrypt function");
             break;
         case ESP_HTTPS_OTA_WRITE_FLASH:
-            if (ota->mParent->mOtaProgressCallback != nullptr)
+        {
+            ota->mWritten = *(int *)event_data;
+            uint16_t prg = (ota->mImageSize > 0) ? ((ota->mWritten * 100) / ota->mImageSize) : 0;
+            // Запись в поток и обработчик - только при смене процента, а не на каждый блок.
+            if (ota->mProgress != prg)
             {
-                uint16_t prg = ((*(int *)event_data) * 100) / ota->mImageSize;
-                if (ota->mProgress != prg)
-                {
-                    ota->mProgress = prg;
-                    ota->mParent->mOtaProgressCallback(prg, 3);
-                }
+                ota->mProgress = prg;
+                ota->notify(prg, OTA_STATUS_WRITE);
             }
             // ESP_LOGW(TAG, "Writing to flash: %d written", *(int *)event_data);
             break;
+        }
         case ESP_HTTPS_OTA_UPDATE_BOOT_PARTITION:
             // ESP_LOGW(TAG, "Boot partition updated. Next Partition: %d", *(esp_partition_subtype_t *)event_data);
             break;
         case ESP_HTTPS_OTA_FINISH:
-            if (ota->mParent->mOtaProgressCallback != nullptr)
-            {
-                ota->mParent->mOtaProgressCallback(100, 4);
-            }
+            ota->notify(100, OTA_STATUS_FINISH);
             // ESP_LOGI(TAG, "OTA finish");
             break;
         case ESP_HTTPS_OTA_ABORT:
-            if (ota->mParent->mOtaProgressCallback != nullptr)
-            {
-                ota->mParent->mOtaProgressCallback(ota->mProgress, -1);
-            }
+            ota->notify(ota->mProgress, OTA_STATUS_ABORT);
             // ESP_LOGW(TAG, "OTA abort");
             break;
         }
     }
 }
 
+int16_t COTATask::runSink(COtaSink *sink, esp_http_client_config_t &cfg, uint32_t caps)
+{
+    auto progress = [this](uint16_t prg, int16_t status, uint32_t written)
+    {
+        mWritten = written;
+        mProgress = prg;
+        notify(prg, status);
+    };
+#if CONFIG_WIFICHN_OTA_TUNE
+    // Буфер клиента - под наибольший вариант подбора, либо сохранённый прошлым подбором.
+    COtaTuner tuner;
+    cfg.buffer_size = tuner.prepare(cfg.buffer_size, caps);
+#endif
+    COtaPipeline pipe(sink, WiFiStation::writeEvent, mCancel, progress, caps, cfg.buffer_size);
+#if CONFIG_WIFICHN_HTTP_POOL
+    pipe.setPool(&mParent->mHttpPool);
+#endif
+    pipe.setTlsStats(&mTls);
+#if CONFIG_WIFICHN_QOS
+    pipe.setQos(mParent->qos());
+#endif
+#if CONFIG_WIFICHN_OTA_TUNE
+    if (tuner.isActive())
+        pipe.setTuner(&tuner);
+#endif
+#if CONFIG_WIFICHN_OTA_VERIFY
+    std::string manifest = mPath + CONFIG_WIFICHN_OTA_MANIFEST_SUFFIX;
+    int16_t res = pipe.download(cfg, manifest.c_str(), mParent->mOtaKey);
+#else
+    int16_t res = pipe.download(cfg);
+#endif
+
+#if CONFIG_WIFICHN_OTA_TUNE
+    if (tuner.bestRate() != 0)
+        mParent->mEventStream.push(EWiFiEvent::OtaTune, tuner.count(), tuner.best(), tuner.bestRate());
+#endif
+
+    SOtaSinkStats st;
+    sink->stats(st);
+    if (st.sectors > 0)
+    {
+        uint32_t saved = (uint32_t)(st.savedTime / 1000);
+        mParent->mEventStream.push(EWiFiEvent::OtaWriteStats, (int16_t)(st.skipped * 100 / st.sectors),
+                                   st.skipped * SPI_FLASH_SEC_SIZE, saved);
+        ESP_LOGI(TAG, "sectors %lu, skipped %lu, write %lu ms, saved ~%lu ms", (unsigned long)st.sectors,
+                 (unsigned long)st.skipped, (unsigned long)(st.writeTime / 1000), (unsigned long)saved);
+    }
+    if (st.locks > 0)
+    {
+        mParent->mEventStream.push(EWiFiEvent::OtaLockStats, (st.locks > INT16_MAX) ? INT16_MAX : (int16_t)st.locks,
+                                   (uint32_t)(st.lockTime / 1000), (uint32_t)(st.maxLock / 1000));
+        ESP_LOGI(TAG, "writeEvent windows %lu, total %lu ms, max %lu ms", (unsigned long)st.locks,
+                 (unsigned long)(st.lockTime / 1000), (unsigned long)(st.maxLock / 1000));
+    }
+    return res;
+}
+
 void COTATask::run()
 {
     // Временная диагностика TLS-рукопожатия при OTA.
@@ -125,8 +195,15 @@ void COTATask::run()
     // cfgHTTPS.addr_type = HTTP_ADDR_TYPE_INET;
     cfgHTTPS.url = mPath.c_str();
     // cfgHTTPS.skip_cert_common_name_check = true;
-    // cfgHTTPS.cert_pem = (char *)server_cert_pem_start;
-    cfgHTTPS.crt_bundle_attach = esp_crt_bundle_attach;
+    // Свой сертификат (CA сервера или самоподписанный сертификат сервера) проверяется
+    // быстрее и требует меньше памяти, чем поиск по полному пакету корневых сертификатов.
+    cfgHTTPS.cert_pem = mParent->mOtaCert;
+#if !CONFIG_WIFICHN_OTA_TLS_PINNED
+    if (mParent->mOtaCert == nullptr)
+        cfgHTTPS.crt_bundle_attach = esp_crt_bundle_attach;
+#endif
+    cfgHTTPS.event_handler = CTlsStats::handler;
+    cfgHTTPS.user_data = &mTls;
     cfgHTTPS.buffer_size_tx = 2048;
     // Эти буферы esp_http_client создаёт обычным malloc() (esp_http_client.c),
     // без capability-флагов, поэтому при CONFIG_SPIRAM_USE_CAPS_ALLOC (как в этом проекте)
@@ -150,36 +227,53 @@ void COTATask::run()
     };
 
 #ifdef CONFIG_WIFICHN_SYNC_TIME
-    if (!CDateTimeSystem::isSync() && mParent->mStartSyncTime)
+    if (!CTimeCache::isValid() && (mParent->mTimeSync != nullptr))
     {
-        // Проверка TLS-сертификата сервера требует верного системного времени,
-        // поэтому ждём завершения NTP-синхронизации по WiFi (WiFiStation::mStartSyncTime),
-        // запущенной при подключении, прежде чем начинать HTTPS OTA.
+        // Проверка TLS-сертификата сервера требует верного системного времени.
+        // Если его не удалось восстановить по RTC (CTimeCache: не установлено или
+        // взято по нижней границе из NVS после пропадания питания), ждём события
+        // синхронизации (WiFiStation::TIME_SYNC_BIT), но не дольше CONFIG_WIFICHN_SYNC_TIME_WAIT_S:
+        // раз в секунду сообщаем статус 10 и проверяем отмену.
         // ESP_LOGI(TAG, "Waiting for time sync before HTTPS OTA");
-        uint16_t cnt = 5;
-        while (mParent->mStartSyncTime && !mCancel)
+        for (uint16_t t = 0; (t < CONFIG_WIFICHN_SYNC_TIME_WAIT_S) && !mCancel; t++)
         {
-            if(cnt == 5)
-            {
-                if (mParent->mOtaProgressCallback != nullptr)
-                    mParent->mOtaProgressCallback(0, 10);
-                cnt = 0;
-            }
-            vTaskDelay(pdMS_TO_TICKS(200));
-            cnt++;
+            notify(0, OTA_STATUS_SYNC_TIME);
+            if (mParent->wait(WiFiStation::TIME_SYNC_BIT, pdMS_TO_TICKS(1000)))
+                break;
         }
     }
 #endif 
 
-    int16_t res = 0;
+    COtaSink *sink = mSink;
+#if OTATASK_DIRECT
+#if CONFIG_WIFICHN_OTA_SKIP_UNCHANGED
+    COtaAppSink app(true, ota_config.buffer_caps, mParent->mOtaImageDesc);
+#else
+    COtaAppSink app(false, ota_config.buffer_caps, mParent->mOtaImageDesc);
+#endif
+    if (sink == nullptr)
+        sink = &app;
+#endif
+
+    mStartTime = esp_timer_get_time();
+    int16_t res = OTA_STATUS_OK;
     if (mCancel)
-        res = 100;
+        res = OTA_STATUS_CANCEL;
+#if CONFIG_WIFICHN_OTA_TLS_PINNED
+    else if (cfgHTTPS.cert_pem == nullptr)
+    {
+        ESP_LOGE(TAG, "no pinned certificate (WiFiStation::setOtaCert)");
+        res = OTA_STATUS_ERR_BEGIN;
+    }
+#endif
+    else if (sink != nullptr)
+        res = runSink(sink, cfgHTTPS, ota_config.buffer_caps);
     else
         while (true)
         {
             if (ESP_OK != esp_event_handler_register(ESP_HTTPS_OTA_EVENT, ESP_EVENT_ANY_ID, &event_ota_handler, this))
             {
-                res = 101;
+                res = OTA_STATUS_ERR_HANDLER;
                 break;
             }
 
@@ -192,7 +286,10 @@ void COTATask::run()
 				// ESP_LOGW(TAG,"(12)free mem %d(%d)",esp_get_free_internal_heap_size(),heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
             for (uint8_t attempt = 0; attempt < OTATASK_BEGIN_RETRIES; attempt++)
             {
+                mTls.begin();
+                TIMELINE_BEGIN("ota.begin");
                 begin_err = esp_https_ota_begin(&ota_config, &https_ota_handle);
+                TIMELINE_END("ota.begin");
                 if (ESP_OK == begin_err || mCancel)
                     break;
                 ESP_LOGW(TAG, "esp_https_ota_begin failed: %s (attempt %d/%d)", esp_err_to_name(begin_err), attempt + 1, OTATASK_BEGIN_RETRIES);
@@ -200,13 +297,13 @@ void COTATask::run()
             }
             if (mCancel)
             {
-                res = 100;
+                res = OTA_STATUS_CANCEL;
                 break;
             }
             if (ESP_OK != begin_err)
             {
                 ESP_LOGE(TAG, "esp_https_ota_begin failed after %d attempts: %s", OTATASK_BEGIN_RETRIES, esp_err_to_name(begin_err));
-                res = 102;
+                res = OTA_STATUS_ERR_BEGIN;
                 break;
             }
 
@@ -214,7 +311,7 @@ void COTATask::run()
             mImageSize = esp_https_ota_get_image_size(https_ota_handle);
             if (mImageSize < 0)
             {
-                res = 112;
+                res = OTA_STATUS_ERR_IMAGE_SIZE;
                 break;
             }
 
@@ -223,7 +320,7 @@ void COTATask::run()
                 esp_app_desc_t desc;
                 if (ESP_OK != esp_https_ota_get_img_desc(https_ota_handle, &desc))
                 {
-                    res = 113;
+                    res = OTA_STATUS_ERR_IMAGE_DESC;
                     break;
                 }
                 mParent->mOtaImageDesc(desc);
@@ -234,48 +331,60 @@ void COTATask::run()
             {
                 if (mCancel)
                 {
-                    res = 100;
+                    res = OTA_STATUS_CANCEL;
                     esp_https_ota_abort(https_ota_handle);
                     break;
                 }
 
+#if CONFIG_WIFICHN_QOS
+                if (CTrafficTask *qos = mParent->qos())
+                    qos->yield(ETrafficClass::Background);
+#endif
                 WiFiStation::writeEvent(true); // приостановить радио на время чтения/записи очередного блока
+                TIMELINE_BEGIN("ota.perform");
                 esp_err_t err = esp_https_ota_perform(https_ota_handle);
+                TIMELINE_END("ota.perform");
                 WiFiStation::writeEvent(false);
                 vTaskDelay(pdMS_TO_TICKS(10));
                 if (ESP_OK == err)
                     break;
                 if (err != ESP_ERR_HTTPS_OTA_IN_PROGRESS)
                 {
-                    res = 103;
+                    res = OTA_STATUS_ERR_PERFORM;
                     esp_https_ota_abort(https_ota_handle);
                     break;
                 }
             }
-            if (res != 0)
+            if (res != OTA_STATUS_OK)
                 break;
 
             if (mCancel)
             {
-                res = 100;
+                res = OTA_STATUS_CANCEL;
                 esp_https_ota_abort(https_ota_handle);
                 break;
             }
 
             WiFiStation::writeEvent(true); // приостановить радио на время завершающей записи (esp_ota_end/set_boot_partition)
+            TIMELINE_BEGIN("ota.finish");
             esp_err_t finish_err = esp_https_ota_finish(https_ota_handle);
+            TIMELINE_END("ota.finish");
             WiFiStation::writeEvent(false);
             if (ESP_OK != finish_err)
             {
-                res = 104;
+                res = OTA_STATUS_ERR_FINISH;
             }
 
             break;
         }
-    if (mParent->mOtaProgressCallback != nullptr)
+    if (mTls.isDone())
     {
-        mParent->mOtaProgressCallback(100, res);
+        int64_t ms = mTls.handshake() / 1000;
+        mParent->mEventStream.push(EWiFiEvent::OtaTls, (ms > INT16_MAX) ? INT16_MAX : (int16_t)ms, mTls.peak(), mTls.retained());
+        ESP_LOGI(TAG, "TLS connect %lu ms, heap peak ~%u, session %u", (unsigned long)ms, (unsigned)mTls.peak(), (unsigned)mTls.retained());
     }
+    notify(100, res);
+    mParent->completePromise(mParent->mOtaPromise, res);
 
     esp_wifi_set_ps(prevPsType);
 
@@ -12,8 +12,16 @@
 #include "WiFiStation.h"
 
 #include "CBaseTask.h"
+#include "esp_http_client.h"
 #include "task_settings.h"
 #include <string>
+#include <atomic>
+
+#include "COtaPipeline.h"
+
+#if CONFIG_WIFICHN_OTA_SKIP_UNCHANGED || CONFIG_WIFICHN_OTA_PSRAM_BURST || CONFIG_WIFICHN_OTA_VERIFY || CONFIG_WIFICHN_OTA_TUNE
+#define OTATASK_DIRECT (1) ///< Обновление приложения через COtaPipeline + COtaAppSink вместо esp_https_ota.
+#endif
 
 class COTATask : public CBaseTask
 {
@@ -23,16 +31,42 @@ private:
 protected:
 	WiFiStation *mParent; ///< Родительский объект
 	const std::string mPath;
+	COtaSink *mSink;		 ///< Приёмник образа (nullptr - обновление приложения).
 	int mImageSize = 0;
 	uint16_t mProgress = 0xffff;
+	uint32_t mWritten = 0;	 ///< Записано байт образа.
+	int64_t mStartTime = 0; ///< Время начала закачки, мкс.
+	CTlsStats mTls;			///< Замер TLS подключения.
+
+	/// Сообщить статус OTA: запись в поток событий WiFiStation и обработчик onOtaProgress.
+	/*!
+	  \param[in] progress - Прогресс, %.
+	  \param[in] status - Статус (EOtaStatus).
+	*/
+	void notify(uint16_t progress, int16_t status);
+
+	/// Закачка через COtaPipeline в приёмник.
+	/*!
+	  \param[in] sink - Приёмник.
+	  \param[in] cfg - Настройки HTTP клиента.
+	  \param[in] caps - Тип памяти буферов (MALLOC_CAP_...).
+	  \return Итоговый статус (EOtaStatus).
+	*/
+	int16_t runSink(COtaSink *sink, esp_http_client_config_t &cfg, uint32_t caps);
 
 	/// Функция задачи.
 	virtual void run() override;
 
 public:
-	COTATask(WiFiStation *parent, const char *file);
+	/// Конструктор.
+	/*!
+	  \param[in] parent - Родительский объект.
+	  \param[in] file - URL образа.
+	  \param[in] sink - Приёмник образа (nullptr - обновление приложения).
+	*/
+	COTATask(WiFiStation *parent, const char *file, COtaSink *sink = nullptr);
 	/// Деструктор.
 	virtual ~COTATask();
 
-	bool mCancel = false;
+	std::atomic<bool> mCancel{false}; ///< Флаг отмены OTA.
 };
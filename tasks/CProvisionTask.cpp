@@ -0,0 +1,186 @@
+/*!
+    \file
+    \brief Класс задачи локального UDP сервиса провижининга на точке доступа (режим APSTA).
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CProvisionTask.h"
+#include "esp_log.h"
+#include "lwip/api.h"
+#include <cstring>
+#include <cstdio>
+#include <vector>
+
+#if CONFIG_WIFICHN_APSTA
+static const char *TAG = "prov";
+
+/// Копирование строки в JSON без спецсимволов (кавычки, '\' и управляющие заменяются на '_').
+static size_t json_str(char *out, size_t size, const uint8_t *str, size_t max)
+{
+    size_t n = 0;
+    for (size_t i = 0; (i < max) && (str[i] != 0) && (n + 1 < size); i++)
+    {
+        char c = (char)str[i];
+        out[n++] = ((c == '"') || (c == '\\') || ((uint8_t)c < 0x20)) ? '_' : c;
+    }
+    if (size > 0)
+        out[n] = 0;
+    return n;
+}
+
+CProvisionTask::CProvisionTask(WiFiStation *parent, uint32_t ip, const char *token) : CBaseTask(), mParent(parent), mBindIP(ip),
+                                                                                      mPool(CONFIG_WIFICHN_PROV_BUFFER_SIZE, CONFIG_WIFICHN_PROV_BUFFERS, MALLOC_CAP_DEFAULT),
+                                                                                      mToken(token)
+{
+    CBaseTask::init(PROVTASK_NAME, PROVTASK_STACKSIZE, PROVTASK_PRIOR, PROVTASK_LENGTH, PROVTASK_CPU, PROVTASK_PSRAM);
+}
+
+CProvisionTask::~CProvisionTask()
+{
+    mCancel = true;
+    do
+    {
+        vTaskDelay(1);
+    } while (mTaskQueue != nullptr);
+}
+
+bool CProvisionTask::checkToken(const std::string &token)
+{
+    if (token.size() != mToken.size())
+        return false;
+    uint8_t diff = 0;
+    for (size_t i = 0; i < token.size(); i++)
+        diff |= (uint8_t)(token[i] ^ mToken[i]);
+    return diff == 0;
+}
+
+size_t CProvisionTask::process(const char *data, size_t len, char *out, size_t size)
+{
+    json cmd = json::parse(data, data + len, nullptr, false, true);
+    if (cmd.is_discarded() || !cmd.contains("cmd") || !cmd["cmd"].is_string())
+        return snprintf(out, size, "{\"res\":-1}");
+
+    std::string name = cmd["cmd"].template get<std::string>();
+    if (name == "set")
+    {
+        if (!cmd.contains("token") || !cmd["token"].is_string() || !checkToken(cmd["token"].template get<std::string>()))
+        {
+            ESP_LOGW(TAG, "set rejected: bad token");
+            return snprintf(out, size, "{\"res\":-3}");
+        }
+        uint16_t res = mParent->initFromJson(cmd);
+        // Без ssid применять нечего: пароль сохранён и будет использован при следующем подключении.
+        if ((res & 0x01) == 0)
+            mParent->applyConfig();
+        return snprintf(out, size, "{\"res\":%d}", res);
+    }
+    else if (name == "status")
+    {
+        uint32_t ip = mParent->getIP();
+        return snprintf(out, size, "{\"res\":0,\"state\":%d,\"ip\":\"%d.%d.%d.%d\"}", (int)mParent->getState(),
+                        (int)(ip & 0xff), (int)((ip >> 8) & 0xff), (int)((ip >> 16) & 0xff), (int)(ip >> 24));
+    }
+    else if (name == "scan")
+    {
+        if (cmd.contains("refresh") && cmd["refresh"].is_boolean() && cmd["refresh"].template get<bool>())
+            esp_wifi_scan_start(nullptr, false); // результат попадёт в кэш к следующему запросу
+
+        std::vector<wifi_ap_record_t> list;
+        mParent->getScanResults(list);
+        size_t n = snprintf(out, size, "{\"res\":0,\"ap\":[");
+        for (size_t i = 0; i < list.size(); i++)
+        {
+            char ssid[sizeof(list[i].ssid)];
+            json_str(ssid, sizeof(ssid), list[i].ssid, sizeof(list[i].ssid));
+            // Запас 4 байта под закрывающие "]}" - список усекается по размеру буфера.
+            int r = snprintf(out + n, size - n, "%s{\"ssid\":\"%s\",\"rssi\":%d,\"ch\":%d,\"auth\":%d}",
+                             (i == 0) ? "" : ",", ssid, list[i].rssi, list[i].primary, (int)list[i].authmode);
+            if ((r < 0) || (n + r + 4 > size))
+                break;
+            n += r;
+        }
+        n += snprintf(out + n, size - n, "]}");
+        return n;
+    }
+    return snprintf(out, size, "{\"res\":-2}");
+}
+
+void CProvisionTask::handle(struct netbuf *buf)
+{
+    void *data = nullptr;
+    u16_t len = 0;
+    uint8_t *copy = nullptr;
+    if (buf->p->next == nullptr)
+    {
+        netbuf_data(buf, &data, &len); // датаграмма в одном pbuf - читаем на месте
+    }
+    else
+    {
+        copy = mPool.alloc();
+        if (copy == nullptr)
+            return;
+        len = netbuf_copy(buf, copy, mPool.blockSize());
+        data = copy;
+    }
+
+    uint8_t *out = mPool.alloc();
+    if (out != nullptr)
+    {
+        size_t n = process((const char *)data, len, (char *)out, mPool.blockSize());
+        if (n >= mPool.blockSize())
+            n = mPool.blockSize() - 1;
+        struct netbuf *reply = netbuf_new();
+        if (reply != nullptr)
+        {
+            if (ERR_OK == netbuf_ref(reply, out, n))
+                netconn_sendto(mConn, reply, netbuf_fromaddr(buf), netbuf_fromport(buf));
+            netbuf_delete(reply);
+        }
+        mPool.free(out);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "pool exhausted, request dropped");
+    }
+    mPool.free(copy);
+}
+
+void CProvisionTask::run()
+{
+    if (!mPool.isValid())
+    {
+        ESP_LOGE(TAG, "no memory for pool");
+        return;
+    }
+    mConn = netconn_new(NETCONN_UDP);
+    if (mConn == nullptr)
+        return;
+    ip_addr_t addr;
+    ip_addr_set_ip4_u32_val(addr, mBindIP);
+    if (ERR_OK != netconn_bind(mConn, &addr, CONFIG_WIFICHN_PROV_PORT))
+    {
+        ESP_LOGE(TAG, "bind failed");
+        netconn_delete(mConn);
+        mConn = nullptr;
+        return;
+    }
+    netconn_set_recvtimeout(mConn, PROVTASK_POLL_MS);
+#if LWIP_SO_RCVBUF
+    // Очередь приёма ограничена: поток запросов не съест pbuf-ы основного канала.
+    netconn_set_recvbufsize(mConn, CONFIG_WIFICHN_PROV_BUFFERS * CONFIG_WIFICHN_PROV_BUFFER_SIZE);
+#endif
+
+    while (!mCancel)
+    {
+        struct netbuf *buf = nullptr;
+        if (ERR_OK != netconn_recv(mConn, &buf))
+            continue;
+        handle(buf);
+        netbuf_delete(buf);
+    }
+    netconn_delete(mConn);
+    mConn = nullptr;
+}
+#endif
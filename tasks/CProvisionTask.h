@@ -0,0 +1,78 @@
+/*!
+	\file
+	\brief Класс задачи локального UDP сервиса провижининга на точке доступа (режим APSTA).
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Протокол: одна JSON датаграмма - один ответ.
+	  {"cmd":"set","token":"...","ssid":"...","password":"..."} - новые настройки станции без перезагрузки;
+	  {"cmd":"scan","refresh":false}             - кэш результатов сканирования;
+	  {"cmd":"status"}                           - состояние станции.
+	Приём без копирования (данные читаются прямо из pbuf), ответ формируется в
+	блоке собственного пула и отправляется по ссылке (netbuf_ref).
+	Команда "set" выполняется только с секретом провижининга (token), заданным
+	в WiFiStation::startAp(); без него ответ {"res":-3}.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "WiFiStation.h"
+
+#include "CBaseTask.h"
+#include "CBufferPool.h"
+#include "task_settings.h"
+#include <atomic>
+#include <string>
+
+struct netconn;
+struct netbuf;
+
+class CProvisionTask : public CBaseTask
+{
+protected:
+	WiFiStation *mParent;	 ///< Родительский объект
+	uint32_t mBindIP;		 ///< IP адрес точки доступа.
+	CBufferPool mPool;		 ///< Пул буферов сервиса (отдельно от основного канала).
+	struct netconn *mConn = nullptr; ///< UDP соединение.
+	std::string mToken;				 ///< Секрет провижининга.
+
+	/// Проверка секрета провижининга (время сравнения не зависит от совпавшего префикса).
+	/*!
+	  \param[in] token - Секрет из запроса.
+	  \return true - секрет совпал.
+	*/
+	bool checkToken(const std::string &token);
+
+	/// Обработка запроса.
+	/*!
+	  \param[in] buf - Принятая датаграмма.
+	*/
+	void handle(struct netbuf *buf);
+	/// Выполнение команды.
+	/*!
+	  \param[in] data - Текст запроса.
+	  \param[in] len - Длина запроса.
+	  \param[out] out - Буфер ответа.
+	  \param[in] size - Размер буфера ответа.
+	  \return Длина ответа (0 - не отвечать).
+	*/
+	size_t process(const char *data, size_t len, char *out, size_t size);
+
+	/// Функция задачи.
+	virtual void run() override;
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] parent - Родительский объект.
+	  \param[in] ip - IP адрес точки доступа, на котором принимаются запросы.
+	  \param[in] token - Секрет провижининга для команды "set".
+	*/
+	CProvisionTask(WiFiStation *parent, uint32_t ip, const char *token);
+	/// Деструктор.
+	virtual ~CProvisionTask();
+
+	std::atomic<bool> mCancel{false}; ///< Флаг остановки сервиса.
+};
@@ -0,0 +1,264 @@
+/*!
+    \file
+    \brief Класс задачи надёжного UDP канала (CReliableChannel поверх WiFiStation).
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CReliableUdpTask.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/api.h"
+#include <cstring>
+#if CONFIG_WIFICHN_QOS
+#include "CTrafficTask.h"
+#endif
+
+#if CONFIG_WIFICHN_RUDP
+static const char *TAG = "rudp";
+
+static inline uint32_t now_ms()
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+#if CONFIG_WIFICHN_QOS
+CReliableUdpTask::CReliableUdpTask(uint16_t port, uint32_t peerIP, uint16_t peerPort, CReliableChannel::TDeliver deliver)
+    : CReliableUdpTask(port, peerIP, peerPort, deliver, ETrafficClass::Voice)
+{
+}
+
+CReliableUdpTask::CReliableUdpTask(uint16_t port, uint32_t peerIP, uint16_t peerPort, CReliableChannel::TDeliver deliver, ETrafficClass cls)
+#else
+CReliableUdpTask::CReliableUdpTask(uint16_t port, uint32_t peerIP, uint16_t peerPort, CReliableChannel::TDeliver deliver)
+#endif
+    : CBaseTask(), mPort(port), mPeerIP(peerIP), mPeerPort(peerPort),
+      mChannel([this](const uint8_t *data, size_t len)
+               { output(data, len); }, deliver)
+#if CONFIG_WIFICHN_FRAMING
+      ,
+      mFramer([this](const uint8_t *frame, size_t len)
+              { return mChannel.send(frame, len, now_ms()); }, CONFIG_WIFICHN_RUDP_MTU)
+#endif
+#if CONFIG_WIFICHN_QOS
+      ,
+      mClass(cls)
+#endif
+#if CONFIG_WIFICHN_SECURE
+      ,
+      mSealPool(RUDP_PACKET_MAX, 1, MALLOC_CAP_INTERNAL)
+#endif
+{
+    CBaseTask::init(RUDPTASK_NAME, RUDPTASK_STACKSIZE, RUDPTASK_PRIOR, RUDPTASK_LENGTH, RUDPTASK_CPU, RUDPTASK_PSRAM);
+}
+
+CReliableUdpTask::~CReliableUdpTask()
+{
+    mCancel = true;
+    do
+    {
+        vTaskDelay(1);
+    } while (mTaskQueue != nullptr);
+}
+
+void CReliableUdpTask::output(const uint8_t *data, size_t len)
+{
+    if (mConn == nullptr)
+        return;
+#if CONFIG_WIFICHN_SECURE
+    // Окно канала хранит открытый текст для повторов: шифруется копия в блоке пула.
+    uint8_t *rec = mSealPool.alloc();
+    if (rec == nullptr)
+        return;
+    std::memcpy(rec + SECURE_HEADER_SIZE, data, len);
+    size_t size = mSecure.seal(rec, len, mSealPool.blockSize());
+    if (size != 0)
+        transmit(rec, size);
+    mSealPool.free(rec);
+#else
+    transmit(data, len);
+#endif
+}
+
+void CReliableUdpTask::transmit(const uint8_t *data, size_t len)
+{
+#if CONFIG_WIFICHN_QOS
+    if (CTrafficTask *qos = WiFiStation::Instance()->qos())
+    {
+        qos->send(mClass, mConn, mPeerIP, mPeerPort, data, len);
+        return;
+    }
+#endif
+    struct netbuf *buf = netbuf_new();
+    if (buf == nullptr)
+        return;
+    ip_addr_t addr;
+    ip_addr_set_ip4_u32_val(addr, mPeerIP);
+    if (ERR_OK == netbuf_ref(buf, data, len))
+        netconn_sendto(mConn, buf, &addr, mPeerPort);
+    netbuf_delete(buf);
+}
+
+bool CReliableUdpTask::send(const uint8_t *data, size_t len, TickType_t wait)
+{
+    TickType_t start = xTaskGetTickCount();
+    while (true)
+    {
+        {
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+            if ((mConn != nullptr) && mChannel.send(data, len, now_ms()))
+                return true;
+        }
+        if ((len > CONFIG_WIFICHN_RUDP_MTU) || (xTaskGetTickCount() - start >= wait))
+            return false;
+        vTaskDelay(1);
+    }
+}
+
+SRudpStats CReliableUdpTask::stats()
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    return mChannel.stats();
+}
+
+#if CONFIG_WIFICHN_SECURE
+esp_err_t CReliableUdpTask::setKey(const uint8_t *secret, size_t len, ESecureRole role, const uint8_t *context, size_t contextLen)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    return mSecure.setKey(secret, len, role, context, contextLen);
+}
+
+esp_err_t CReliableUdpTask::setSessionKey(const uint8_t *psk, size_t len, ESecureRole role, const uint8_t *nonceI, const uint8_t *nonceR,
+                                          const uint8_t *context, size_t contextLen)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    return mSecure.setSessionKey(psk, len, role, nonceI, nonceR, context, contextLen);
+}
+
+SSecureStats CReliableUdpTask::secureStats()
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    return mSecure.stats();
+}
+#endif
+
+#if CONFIG_WIFICHN_FRAMING
+bool CReliableUdpTask::sendRecord(const uint8_t *data, size_t len, TickType_t wait)
+{
+    TickType_t start = xTaskGetTickCount();
+    while (true)
+    {
+        {
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+            if ((mConn != nullptr) && mFramer.add(data, len, now_ms()))
+                return true;
+            if (len > mFramer.maxRecord())
+                return false;
+        }
+        if (xTaskGetTickCount() - start >= wait)
+            return false;
+        vTaskDelay(1);
+    }
+}
+
+SFrameStats CReliableUdpTask::frameStats()
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    return mFramer.stats();
+}
+#endif
+
+void CReliableUdpTask::run()
+{
+#if CONFIG_WIFICHN_SECURE
+    if (!mChannel.isValid() || !mSealPool.isValid())
+#else
+    if (!mChannel.isValid())
+#endif
+    {
+        ESP_LOGE(TAG, "no memory for pool");
+        return;
+    }
+    WiFiStation *wifi = WiFiStation::Instance();
+    while (!mCancel && !wifi->wait(WiFiStation::CONNECTED_BIT, pdMS_TO_TICKS(RUDPTASK_POLL_MS)))
+    {
+    }
+    if (mCancel)
+        return;
+
+    struct netconn *conn = netconn_new(NETCONN_UDP);
+    if (conn == nullptr)
+        return;
+    if (ERR_OK != netconn_bind(conn, IP_ADDR_ANY, mPort))
+    {
+        ESP_LOGE(TAG, "bind failed");
+        netconn_delete(conn);
+        return;
+    }
+#if LWIP_SO_RCVBUF
+    // Больше окна приёма в очереди не нужно: лишнее всё равно будет отброшено протоколом.
+    netconn_set_recvbufsize(conn, 2 * RUDP_WINDOW * RUDP_PACKET_MAX);
+#endif
+#if CONFIG_WIFICHN_QOS
+    CTrafficTask::mark(conn, mClass);
+#endif
+    {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        mConn = conn;
+    }
+
+    uint32_t wait = RUDPTASK_POLL_MS;
+    uint8_t *copy = nullptr;
+    while (!mCancel)
+    {
+        netconn_set_recvtimeout(conn, (wait == 0) ? 1 : wait);
+        struct netbuf *buf = nullptr;
+        err_t err = netconn_recv(conn, &buf);
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        if ((err == ERR_OK) && (ip4_addr_get_u32(ip_2_ip4(netbuf_fromaddr(buf))) == mPeerIP) && (netbuf_fromport(buf) == mPeerPort))
+        {
+            void *data = nullptr;
+            u16_t len = 0;
+            if (buf->p->next == nullptr)
+            {
+                netbuf_data(buf, &data, &len); // пакет в одном pbuf - читаем на месте
+            }
+            else
+            {
+                if (copy == nullptr)
+                    copy = new uint8_t[RUDP_PACKET_MAX];
+                len = netbuf_copy(buf, copy, RUDP_PACKET_MAX);
+                data = copy;
+            }
+#if CONFIG_WIFICHN_SECURE
+            size_t plain = len;
+            if (mSecure.open((uint8_t *)data, plain)) // расшифровка на месте, в pbuf
+                mChannel.input((const uint8_t *)data + SECURE_HEADER_SIZE, plain, now_ms());
+#else
+            mChannel.input((const uint8_t *)data, len, now_ms());
+#endif
+        }
+        if (buf != nullptr)
+            netbuf_delete(buf);
+        wait = mChannel.poll(now_ms());
+#if CONFIG_WIFICHN_FRAMING
+        uint32_t frame = mFramer.poll(now_ms());
+        if (frame < wait)
+            wait = frame;
+#endif
+        if (wait > RUDPTASK_POLL_MS)
+            wait = RUDPTASK_POLL_MS;
+    }
+    {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        mConn = nullptr;
+    }
+#if CONFIG_WIFICHN_QOS
+    if (CTrafficTask *qos = wifi->qos())
+        qos->cancel(conn);
+#endif
+    netconn_delete(conn);
+    delete[] copy;
+}
+#endif
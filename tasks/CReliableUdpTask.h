@@ -0,0 +1,164 @@
+/*!
+	\file
+	\brief Класс задачи надёжного UDP канала (CReliableChannel поверх WiFiStation).
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Задача ждёт подключения станции, открывает UDP соединение на локальном порту
+	и обменивается пакетами с одним узлом. Приём без копирования (данные
+	протокола читаются прямо из pbuf), отправка по ссылке (netbuf_ref) из блоков
+	пула канала. Сообщения доставляются обработчиком в контексте задачи; из
+	обработчика можно вызывать send().
+	При CONFIG_WIFICHN_QOS пакеты идут в классе трафика канала через
+	WiFiStation::qos() (см. CTrafficTask); по умолчанию - голос.
+	При CONFIG_WIFICHN_FRAMING мелкие записи sendRecord() упаковываются в
+	сообщения по CONFIG_WIFICHN_RUDP_MTU (см. CFrameCoalescer); получатель
+	разбирает принятое сообщение через CFrameView.
+	При CONFIG_WIFICHN_SECURE каждый пакет протокола (и повтор, и подтверждение)
+	уходит записью CSecureChannel: копия в блоке пула шифруется на месте,
+	принятый пакет проверяется и расшифровывается прямо в pbuf. Пока ключ не
+	задан setKey() или setSessionKey(), канал не отправляет и не принимает пакеты.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "WiFiStation.h"
+
+#include "CBaseTask.h"
+#include "CReliableChannel.h"
+#if CONFIG_WIFICHN_FRAMING
+#include "CFrameCoalescer.h"
+#endif
+#if CONFIG_WIFICHN_QOS
+#include "CTrafficScheduler.h"
+#endif
+#if CONFIG_WIFICHN_SECURE
+#include "CSecureChannel.h"
+#endif
+#include "task_settings.h"
+#include <atomic>
+#include <mutex>
+
+#if CONFIG_WIFICHN_SECURE
+#define RUDP_PACKET_MAX (SECURE_OVERHEAD + RUDP_HEADER_SIZE + CONFIG_WIFICHN_RUDP_MTU) ///< Наибольший пакет на линии.
+static_assert(RUDP_PACKET_MAX <= 1472, "CONFIG_WIFICHN_RUDP_MTU must not exceed 1440 with CONFIG_WIFICHN_SECURE");
+#else
+#define RUDP_PACKET_MAX (RUDP_HEADER_SIZE + CONFIG_WIFICHN_RUDP_MTU) ///< Наибольший пакет на линии.
+#endif
+
+struct netconn;
+
+class CReliableUdpTask : public CBaseTask
+{
+protected:
+	uint16_t mPort;					 ///< Локальный порт.
+	uint32_t mPeerIP;				 ///< IP адрес узла.
+	uint16_t mPeerPort;				 ///< Порт узла.
+	CReliableChannel mChannel;		 ///< Протокол.
+#if CONFIG_WIFICHN_FRAMING
+	CFrameCoalescer mFramer;		 ///< Упаковка записей в сообщения.
+#endif
+#if CONFIG_WIFICHN_QOS
+	ETrafficClass mClass;			 ///< Класс трафика.
+#endif
+#if CONFIG_WIFICHN_SECURE
+	CSecureChannel mSecure;			 ///< Шифрование пакетов.
+	CBufferPool mSealPool;			 ///< Блоки для шифрования отправляемых пакетов.
+#endif
+	std::recursive_mutex mMutex;	 ///< Защита канала (обработчик сообщений может вызвать send()).
+	struct netconn *mConn = nullptr; ///< UDP соединение.
+
+	/// Отправка пакета протокола.
+	void output(const uint8_t *data, size_t len);
+	/// Передача пакета в стек.
+	void transmit(const uint8_t *data, size_t len);
+
+	/// Функция задачи.
+	virtual void run() override;
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] port - Локальный порт.
+	  \param[in] peerIP - IP адрес узла.
+	  \param[in] peerPort - Порт узла.
+	  \param[in] deliver - Обработчик принятых сообщений.
+	*/
+	CReliableUdpTask(uint16_t port, uint32_t peerIP, uint16_t peerPort, CReliableChannel::TDeliver deliver);
+#if CONFIG_WIFICHN_QOS
+	/// Конструктор.
+	/*!
+	  \param[in] port - Локальный порт.
+	  \param[in] peerIP - IP адрес узла.
+	  \param[in] peerPort - Порт узла.
+	  \param[in] deliver - Обработчик принятых сообщений.
+	  \param[in] cls - Класс трафика канала.
+	*/
+	CReliableUdpTask(uint16_t port, uint32_t peerIP, uint16_t peerPort, CReliableChannel::TDeliver deliver, ETrafficClass cls);
+#endif
+	/// Деструктор.
+	virtual ~CReliableUdpTask();
+
+	/// Отправить сообщение.
+	/*!
+	  \param[in] data - Сообщение.
+	  \param[in] len - Длина (не больше CONFIG_WIFICHN_RUDP_MTU).
+	  \param[in] wait - Сколько ждать места в окне.
+	  \return true - сообщение принято к отправке.
+	*/
+	bool send(const uint8_t *data, size_t len, TickType_t wait = 0);
+
+	/// Статистика канала.
+	SRudpStats stats();
+
+#if CONFIG_WIFICHN_FRAMING
+	/// Добавить запись в очередное сообщение.
+	/*!
+	  Сообщение уходит заполненным или через CONFIG_WIFICHN_FRAME_DEADLINE_MS
+	  после первой записи.
+	  \param[in] data - Запись.
+	  \param[in] len - Длина.
+	  \param[in] wait - Сколько ждать места в окне, если сообщение заполнено.
+	  \return true - запись принята к отправке.
+	*/
+	bool sendRecord(const uint8_t *data, size_t len, TickType_t wait = 0);
+	/// Статистика упаковки записей.
+	SFrameStats frameStats();
+#endif
+
+#if CONFIG_WIFICHN_SECURE
+	/// Задать ключ канала.
+	/*!
+	  Обе стороны задают один секрет и разные роли (см. CSecureChannel::setKey()).
+	  Секрет - на одну сессию; постоянный PSK - через setSessionKey().
+	  \param[in] secret - Секрет CSecureKeyExchange::finish() или одноразовый PSK.
+	  \param[in] len - Длина секрета.
+	  \param[in] role - Роль этой стороны.
+	  \param[in] context - Привязка ключей (например, идентификаторы сторон), может быть nullptr.
+	  \param[in] contextLen - Длина привязки.
+	  \return Результат CSecureChannel::setKey().
+	*/
+	esp_err_t setKey(const uint8_t *secret, size_t len, ESecureRole role, const uint8_t *context = nullptr, size_t contextLen = 0);
+	/// Задать ключ сессии из постоянного PSK.
+	/*!
+	  Nonce сторон (CSecureChannel::makeNonce()) передаются до вызова тем же путём,
+	  что и открытые ключи обмена (см. CSecureChannel::setSessionKey()).
+	  \param[in] psk - PSK.
+	  \param[in] len - Длина PSK.
+	  \param[in] role - Роль этой стороны.
+	  \param[in] nonceI - Nonce стороны Initiator.
+	  \param[in] nonceR - Nonce стороны Responder.
+	  \param[in] context - Привязка ключей, может быть nullptr.
+	  \param[in] contextLen - Длина привязки.
+	  \return Результат CSecureChannel::setSessionKey().
+	*/
+	esp_err_t setSessionKey(const uint8_t *psk, size_t len, ESecureRole role, const uint8_t *nonceI, const uint8_t *nonceR,
+							const uint8_t *context = nullptr, size_t contextLen = 0);
+	/// Статистика шифрования.
+	SSecureStats secureStats();
+#endif
+
+	std::atomic<bool> mCancel{false}; ///< Флаг остановки канала.
+};
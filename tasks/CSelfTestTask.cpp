@@ -0,0 +1,347 @@
+/*!
+    \file
+    \brief Класс задачи самопроверки канала (CSelfTestMeter поверх lwIP).
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CSelfTestTask.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/api.h"
+#include <cstring>
+
+#if CONFIG_WIFICHN_SELFTEST
+static const char *TAG = "selftest";
+
+static inline uint32_t now_us()
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+/// Время задач простоя по ядрам.
+struct SCpuSample
+{
+    configRUN_TIME_COUNTER_TYPE idle[SELFTEST_CORES]; ///< Время простоя ядер.
+    configRUN_TIME_COUNTER_TYPE total;                ///< Общее время.
+};
+
+static void cpu_sample(SCpuSample &s)
+{
+    for (BaseType_t c = 0; c < SELFTEST_CORES; c++)
+        s.idle[c] = (c < portNUM_PROCESSORS) ? ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(c)) : 0;
+    s.total = portGET_RUN_TIME_COUNTER_VALUE();
+}
+
+static void cpu_load(const SCpuSample &from, const SCpuSample &to, uint8_t *cpu)
+{
+    configRUN_TIME_COUNTER_TYPE total = to.total - from.total;
+    for (BaseType_t c = 0; c < SELFTEST_CORES; c++)
+    {
+        if ((c >= portNUM_PROCESSORS) || (total == 0))
+            continue;
+        configRUN_TIME_COUNTER_TYPE idle = to.idle[c] - from.idle[c];
+        cpu[c] = (idle >= total) ? 0 : (uint8_t)(100 - (uint64_t)idle * 100 / total);
+    }
+}
+#endif
+
+CSelfTestTask::CSelfTestTask(const SSelfTestConfig &cfg, TDone done) : CBaseTask(), mConfig(cfg), mDone(done)
+{
+    CBaseTask::init(SELFTASK_NAME, SELFTASK_STACKSIZE, SELFTASK_PRIOR, SELFTASK_LENGTH, SELFTASK_CPU, SELFTASK_PSRAM);
+}
+
+CSelfTestTask::~CSelfTestTask()
+{
+    mCancel = true;
+    do
+    {
+        vTaskDelay(1);
+    } while (mTaskQueue != nullptr);
+}
+
+esp_err_t CSelfTestTask::write(const void *data, size_t len)
+{
+    size_t done = 0;
+    while (!mCancel && (done < len))
+    {
+        size_t written = 0;
+        err_t err = netconn_write_partly(mCtrl, (const uint8_t *)data + done, len - done, NETCONN_COPY, &written);
+        if ((err != ERR_OK) && (err != ERR_WOULDBLOCK))
+            return ESP_FAIL;
+        done += written;
+    }
+    return (done == len) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t CSelfTestTask::readReport(SSelfTestReport &report, uint32_t timeout)
+{
+    uint8_t buf[SELFTEST_REPORT_SIZE];
+    size_t have = 0;
+    int64_t end = esp_timer_get_time() + (int64_t)timeout * 1000;
+    while (!mCancel && (have < sizeof(buf)) && (esp_timer_get_time() < end))
+    {
+        struct pbuf *p = nullptr;
+        err_t err = netconn_recv_tcp_pbuf(mCtrl, &p);
+        if (err == ERR_TIMEOUT)
+            continue;
+        if (err != ERR_OK)
+            break;
+        have += pbuf_copy_partial(p, buf + have, sizeof(buf) - have, 0);
+        pbuf_free(p);
+    }
+    return selfTestParseReport(buf, have, report) ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
+
+esp_err_t CSelfTestTask::tcpSend(SSelfTestResult &res)
+{
+    int64_t end = esp_timer_get_time() + (int64_t)mConfig.durationMs * 1000;
+    while (esp_timer_get_time() < end)
+    {
+        esp_err_t err = write(mBlock, mConfig.block);
+        if (err != ESP_OK)
+            return err;
+    }
+    // Конец записи - сигнал серверу: он отвечает отчётом о принятом.
+    netconn_shutdown(mCtrl, 0, 1);
+    SSelfTestReport report;
+    esp_err_t err = readReport(report, SELFTASK_REPORT_MS);
+    if (err == ESP_OK)
+    {
+        res.bytes = report.bytes;
+        res.elapsedUs = report.elapsedUs;
+    }
+    return err;
+}
+
+esp_err_t CSelfTestTask::tcpRecv(SSelfTestResult &res)
+{
+    CSelfTestMeter meter;
+    int64_t end = esp_timer_get_time() + (int64_t)(mConfig.durationMs + SELFTASK_REPORT_MS) * 1000;
+    err_t err = ERR_OK;
+    while (!mCancel && (esp_timer_get_time() < end))
+    {
+        struct pbuf *p = nullptr;
+        err = netconn_recv_tcp_pbuf(mCtrl, &p);
+        if (err == ERR_TIMEOUT)
+            continue;
+        if (err != ERR_OK)
+            break;
+        meter.onBytes(p->tot_len, now_us());
+        pbuf_free(p);
+    }
+    SSelfTestReport report = meter.report();
+    res.bytes = report.bytes;
+    res.elapsedUs = report.elapsedUs;
+    if (mCancel)
+        return ESP_ERR_INVALID_STATE;
+    // Сервер закрывает соединение по окончании теста.
+    return (err == ERR_CLSD) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t CSelfTestTask::udpSend(struct netconn *udp, SSelfTestResult &res)
+{
+    struct netbuf *buf = netbuf_new();
+    if (buf == nullptr)
+        return ESP_ERR_NO_MEM;
+    ip_addr_t addr;
+    ip_addr_set_ip4_u32_val(addr, mConfig.peer);
+    // Пауза задачи - не меньше тика: отставание на тик (и один повтор) догоняется пачкой.
+    CSelfTestPacer pacer(mConfig.rateKbps, mConfig.block, 2 * portTICK_PERIOD_MS * 1000);
+    SSelfTestReport sent = {};
+    int64_t start = esp_timer_get_time();
+    int64_t end = start + (int64_t)mConfig.durationMs * 1000;
+    esp_err_t res_err = ESP_OK;
+    while (!mCancel && (esp_timer_get_time() < end))
+    {
+        uint32_t wait = pacer.wait(now_us());
+        if (wait != 0)
+        {
+            vTaskDelay((wait + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000));
+            continue;
+        }
+        selfTestStamp(mBlock, sent.packets, now_us());
+        err_t err = netbuf_ref(buf, mBlock, mConfig.block);
+        if (err == ERR_OK)
+            err = netconn_sendto(udp, buf, &addr, mConfig.port);
+        if (err == ERR_OK)
+        {
+            sent.packets++;
+            sent.bytes += mConfig.block;
+            pacer.sent();
+        }
+        else if ((err == ERR_MEM) || (err == ERR_BUF))
+        {
+            vTaskDelay(1); // стек занят: та же датаграмма повторяется
+        }
+        else
+        {
+            res_err = ESP_FAIL;
+            break;
+        }
+    }
+    netbuf_delete(buf);
+    sent.elapsedUs = (uint32_t)(esp_timer_get_time() - start);
+    res.sent = sent.packets;
+    if (mCancel)
+        return ESP_ERR_INVALID_STATE;
+
+    // Отчёт отправителя: сервер считает потери по числу отправленных.
+    uint8_t out[SELFTEST_REPORT_SIZE];
+    esp_err_t err = write(out, selfTestPackReport(out, sent));
+    SSelfTestReport report;
+    if (err == ESP_OK)
+        err = readReport(report, SELFTASK_REPORT_MS);
+    if (err == ESP_OK)
+    {
+        res.bytes = report.bytes;
+        res.elapsedUs = report.elapsedUs;
+        res.packets = report.packets;
+        res.lost = report.lost;
+        res.reordered = report.reordered;
+        res.jitterUs = report.jitterUs;
+    }
+    return (res_err != ESP_OK) ? res_err : err;
+}
+
+esp_err_t CSelfTestTask::udpRecv(struct netconn *udp, SSelfTestResult &res)
+{
+    CSelfTestMeter meter;
+    netconn_set_recvtimeout(udp, SELFTASK_POLL_MS);
+    int64_t end = esp_timer_get_time() + (int64_t)mConfig.durationMs * 1000;
+    int64_t last = esp_timer_get_time();
+    // Приём - до конца теста и затем до паузы SELFTASK_IDLE_MS (сервер начал позже запроса).
+    while (!mCancel)
+    {
+        int64_t now = esp_timer_get_time();
+        if ((now >= end) && ((now - last >= SELFTASK_IDLE_MS * 1000) || (now >= end + SELFTASK_REPORT_MS * 1000)))
+            break;
+        struct netbuf *buf = nullptr;
+        if (netconn_recv(udp, &buf) != ERR_OK)
+            continue;
+        if (ip4_addr_get_u32(ip_2_ip4(netbuf_fromaddr(buf))) == mConfig.peer)
+        {
+            uint8_t head[SELFTEST_HEADER_SIZE];
+            if (netbuf_copy(buf, head, sizeof(head)) == sizeof(head))
+                meter.onDatagram(head, netbuf_len(buf), now_us());
+            last = esp_timer_get_time();
+        }
+        netbuf_delete(buf);
+    }
+    if (mCancel)
+        return ESP_ERR_INVALID_STATE;
+
+    // Отчёт отправителя: потери считаются и в конце потока.
+    SSelfTestReport sent = {};
+    esp_err_t err = readReport(sent, SELFTASK_REPORT_MS);
+    SSelfTestReport report = meter.report((err == ESP_OK) ? sent.packets : 0);
+    res.sent = sent.packets;
+    res.bytes = report.bytes;
+    res.elapsedUs = report.elapsedUs;
+    res.packets = report.packets;
+    res.lost = report.lost;
+    res.reordered = report.reordered;
+    res.jitterUs = report.jitterUs;
+    return err;
+}
+
+esp_err_t CSelfTestTask::execute(SSelfTestResult &res)
+{
+    bool udp_mode = (mConfig.mode == ESelfTestMode::UdpSend) || (mConfig.mode == ESelfTestMode::UdpRecv);
+    if ((mConfig.block == 0) || (udp_mode && ((mConfig.block < SELFTEST_HEADER_SIZE) || (mConfig.block > SELFTEST_UDP_MAX))))
+        return ESP_ERR_INVALID_ARG;
+    mBlock = new uint8_t[mConfig.block];
+    for (uint16_t i = 0; i < mConfig.block; i++)
+        mBlock[i] = (uint8_t)i;
+
+    // Приёмник датаграмм открывается до запроса: сервер начинает передачу сразу.
+    struct netconn *udp = nullptr;
+    if (udp_mode)
+    {
+        udp = netconn_new(NETCONN_UDP);
+        if (udp == nullptr)
+            return ESP_ERR_NO_MEM;
+        if (ERR_OK != netconn_bind(udp, IP_ADDR_ANY, (mConfig.mode == ESelfTestMode::UdpRecv) ? mConfig.port : 0))
+        {
+            netconn_delete(udp);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    esp_err_t err = ESP_ERR_NO_MEM;
+    mCtrl = netconn_new(NETCONN_TCP);
+    if (mCtrl != nullptr)
+    {
+        ip_addr_t addr;
+        ip_addr_set_ip4_u32_val(addr, mConfig.peer);
+        err = (ERR_OK == netconn_connect(mCtrl, &addr, mConfig.port)) ? ESP_OK : ESP_ERR_NOT_FOUND;
+    }
+    if (err == ESP_OK)
+    {
+        netconn_set_recvtimeout(mCtrl, SELFTASK_POLL_MS);
+        netconn_set_sendtimeout(mCtrl, SELFTASK_POLL_MS);
+        uint8_t request[SELFTEST_REQUEST_SIZE];
+        err = write(request, selfTestPackRequest(request, mConfig));
+    }
+    if (err == ESP_OK)
+    {
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        SCpuSample from, to;
+        cpu_sample(from);
+#endif
+        switch (mConfig.mode)
+        {
+        case ESelfTestMode::TcpSend:
+            err = tcpSend(res);
+            break;
+        case ESelfTestMode::TcpRecv:
+            err = tcpRecv(res);
+            break;
+        case ESelfTestMode::UdpSend:
+            err = udpSend(udp, res);
+            break;
+        case ESelfTestMode::UdpRecv:
+            err = udpRecv(udp, res);
+            break;
+        default:
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        cpu_sample(to);
+        cpu_load(from, to, res.cpu);
+#endif
+    }
+    if (udp != nullptr)
+        netconn_delete(udp);
+    return err;
+}
+
+void CSelfTestTask::run()
+{
+    mTask.store(xTaskGetCurrentTaskHandle());
+    SSelfTestResult res = {};
+    res.mode = mConfig.mode;
+    std::memset(res.cpu, SELFTEST_CPU_UNKNOWN, sizeof(res.cpu));
+    esp_err_t err = execute(res);
+    if (mCtrl != nullptr)
+    {
+        netconn_close(mCtrl);
+        netconn_delete(mCtrl);
+        mCtrl = nullptr;
+    }
+    delete[] mBlock;
+    mBlock = nullptr;
+    if (res.elapsedUs != 0)
+        res.goodputKbps = (uint32_t)(res.bytes * 8000 / res.elapsedUs);
+    ESP_LOGI(TAG, "mode %u: %s, %lu kbit/s, lost %lu/%lu, jitter %lu us, cpu %u%%/%u%%", (unsigned)res.mode, esp_err_to_name(err),
+             (unsigned long)res.goodputKbps, (unsigned long)res.lost, (unsigned long)(res.lost + res.packets),
+             (unsigned long)res.jitterUs, res.cpu[0], res.cpu[1]);
+    // Завершение публикуется до обработчика: ожидающий результата может сразу запустить следующий тест.
+    mFinished = true;
+    if (mDone)
+        mDone(err, res);
+}
+#endif
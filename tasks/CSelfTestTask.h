@@ -0,0 +1,80 @@
+/*!
+	\file
+	\brief Класс задачи самопроверки канала (CSelfTestMeter поверх lwIP).
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Задача выполняет один тест SSelfTestConfig против tools/selftest_server.py
+	и завершается, передав результат обработчику (в контексте задачи).
+	Загрузка ядер считается по времени задач простоя за тест и требует
+	CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS; без неё - SELFTEST_CPU_UNKNOWN.
+	Тест идёт мимо очередей CTrafficTask: измеряется сам канал.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#include "CBaseTask.h"
+#include "CSelfTest.h"
+#include "task_settings.h"
+#include <atomic>
+#include <functional>
+
+struct netconn;
+
+class CSelfTestTask : public CBaseTask
+{
+public:
+	/// Обработчик завершения теста.
+	/*!
+	  \param[in] err - ESP_OK или код ошибки (результат тогда частичный).
+	  \param[in] result - Результат.
+	*/
+	typedef std::function<void(esp_err_t err, const SSelfTestResult &result)> TDone;
+
+protected:
+	SSelfTestConfig mConfig;		 ///< Параметры теста.
+	TDone mDone;					 ///< Обработчик завершения.
+	uint8_t *mBlock = nullptr;		 ///< Блок данных.
+	struct netconn *mCtrl = nullptr; ///< Соединение управления (и данных TCP).
+	std::atomic<bool> mFinished{false}; ///< Тест завершён.
+	std::atomic<TaskHandle_t> mTask{nullptr}; ///< Задача теста.
+
+	/// Отправить по соединению управления.
+	esp_err_t write(const void *data, size_t len);
+	/// Принять отчёт сервера.
+	esp_err_t readReport(SSelfTestReport &report, uint32_t timeout);
+	/// Передача по TCP.
+	esp_err_t tcpSend(SSelfTestResult &res);
+	/// Приём по TCP.
+	esp_err_t tcpRecv(SSelfTestResult &res);
+	/// Передача датаграмм.
+	esp_err_t udpSend(struct netconn *udp, SSelfTestResult &res);
+	/// Приём датаграмм.
+	esp_err_t udpRecv(struct netconn *udp, SSelfTestResult &res);
+	/// Выполнить тест.
+	esp_err_t execute(SSelfTestResult &res);
+
+	/// Функция задачи.
+	virtual void run() override;
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] cfg - Параметры теста.
+	  \param[in] done - Обработчик завершения.
+	*/
+	CSelfTestTask(const SSelfTestConfig &cfg, TDone done);
+	/// Деструктор (прерывает незавершённый тест).
+	virtual ~CSelfTestTask();
+
+	/// Тест завершён (выставляется до вызова обработчика завершения).
+	inline bool isFinished() { return mFinished.load(); };
+	/// Вызов из задачи теста (из обработчика завершения): удалять объект здесь нельзя.
+	inline bool isOwnTask() { return mTask.load() == xTaskGetCurrentTaskHandle(); };
+
+	std::atomic<bool> mCancel{false}; ///< Флаг остановки теста.
+};
@@ -0,0 +1,239 @@
+/*!
+    \file
+    \brief Класс задачи синхронизации времени (параллельный SNTP + HTTP Date).
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CTimeSyncTask.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_sntp.h"
+#include "esp_http_client.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include "CTimeCache.h"
+#include "CTimeline.h"
+#include <cstring>
+#include <strings.h>
+#include <cinttypes>
+
+#if (CONFIG_WIFICHN_SYNC_TIME == 1)
+static const char *TAG = "tsync";
+
+#define NTP_PACKET_SIZE (48)          ///< Размер SNTP пакета.
+#define NTP_UNIX_OFFSET (2208988800LL) ///< Секунд от 1900 до 1970.
+
+static inline uint32_t be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/// Разбор даты формата RFC 7231 ("Sun, 06 Nov 1994 08:49:37 GMT").
+/*!
+  \param[in] str - строка заголовка Date.
+  \return время от 1970 в секундах, 0 - ошибка разбора.
+*/
+static time_t parseHttpDate(const char *str)
+{
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    const char *p = strchr(str, ',');
+    if (p == nullptr)
+        return 0;
+    char mon[4] = {};
+    int d, y, hh, mm, ss;
+    if (6 != sscanf(p + 1, "%d %3s %d %d:%d:%d", &d, mon, &y, &hh, &mm, &ss))
+        return 0;
+    const char *m = strstr(months, mon);
+    if ((m == nullptr) || (mon[0] == 0) || ((m - months) % 3 != 0) || (y < 1970))
+        return 0;
+    int month = (m - months) / 3 + 1;
+
+    // Число дней от 1970 по григорианскому календарю (алгоритм days_from_civil).
+    y -= (month <= 2) ? 1 : 0;
+    int era = y / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+    return (time_t)(days * 86400 + hh * 3600 + mm * 60 + ss);
+}
+
+static esp_err_t http_date_handler(esp_http_client_event_t *evt)
+{
+    if ((evt->event_id == HTTP_EVENT_ON_HEADER) && (strcasecmp(evt->header_key, "Date") == 0))
+    {
+        *(time_t *)evt->user_data = parseHttpDate(evt->header_value);
+    }
+    return ESP_OK;
+}
+
+CTimeSyncTask::CTimeSyncTask(WiFiStation *parent) : CBaseTask(), mParent(parent)
+{
+    CBaseTask::init(TIMESYNCTASK_NAME, TIMESYNCTASK_STACKSIZE, TIMESYNCTASK_PRIOR, TIMESYNCTASK_LENGTH, TIMESYNCTASK_CPU, TIMESYNCTASK_PSRAM);
+}
+
+CTimeSyncTask::~CTimeSyncTask()
+{
+    mCancel = true;
+    do
+    {
+        vTaskDelay(1);
+    } while (mTaskQueue != nullptr);
+}
+
+bool CTimeSyncTask::sntpQuery(struct timeval &tv)
+{
+    struct sockaddr_in addr[TIMESYNC_MAX_SERVERS];
+    uint8_t n = 0;
+
+#if (CONFIG_LWIP_DHCP_GET_NTP_SRV == 1)
+    // Сервер, предложенный DHCP, обычно ближайший - опрашиваем его вместе с остальными.
+    const ip_addr_t *dhcp = esp_sntp_getserver(0);
+    if ((dhcp != nullptr) && IP_IS_V4(dhcp) && !ip_addr_isany(dhcp))
+    {
+        std::memset(&addr[n], 0, sizeof(addr[n]));
+        addr[n].sin_family = AF_INET;
+        addr[n].sin_port = htons(123);
+        addr[n].sin_addr.s_addr = ip_2_ip4(dhcp)->addr;
+        n++;
+    }
+#endif
+
+    char list[] = CONFIG_WIFICHN_SNTP_SERVERS;
+    char *save = nullptr;
+    for (char *name = strtok_r(list, " ,;", &save); (name != nullptr) && (n < TIMESYNC_MAX_SERVERS) && !mCancel; name = strtok_r(nullptr, " ,;", &save))
+    {
+        struct addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo *res = nullptr;
+        if ((0 == getaddrinfo(name, "123", &hints, &res)) && (res != nullptr))
+        {
+            std::memcpy(&addr[n], res->ai_addr, sizeof(addr[n]));
+            n++;
+        }
+        if (res != nullptr)
+            freeaddrinfo(res);
+    }
+    if (n == 0)
+        return false;
+
+    int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s < 0)
+        return false;
+
+    // Случайный transmit timestamp запроса сервер возвращает в originate timestamp:
+    // по нему отбрасываем чужие и запоздавшие ответы.
+    uint8_t pkt[NTP_PACKET_SIZE];
+    std::memset(pkt, 0, sizeof(pkt));
+    pkt[0] = 0x23; // LI=0, VN=4, Mode=3 (client)
+    uint32_t nonce[2] = {esp_random(), esp_random()};
+    std::memcpy(&pkt[40], nonce, sizeof(nonce));
+
+    int64_t t0 = esp_timer_get_time();
+    for (uint8_t i = 0; i < n; i++)
+        sendto(s, pkt, sizeof(pkt), 0, (struct sockaddr *)&addr[i], sizeof(addr[i]));
+
+    bool res = false;
+    while (!res && !mCancel)
+    {
+        int64_t left = (int64_t)CONFIG_WIFICHN_SNTP_TIMEOUT_MS * 1000 - (esp_timer_get_time() - t0);
+        if (left <= 0)
+            break;
+        if (left > 100000)
+            left = 100000; // не реже раз в 100 мс проверяем mCancel
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(s, &rfds);
+        struct timeval to = {.tv_sec = 0, .tv_usec = (suseconds_t)left};
+        if (select(s + 1, &rfds, nullptr, nullptr, &to) <= 0)
+            continue;
+
+        uint8_t rx[NTP_PACKET_SIZE];
+        if (recv(s, rx, sizeof(rx), 0) < NTP_PACKET_SIZE)
+            continue;
+        // Mode=4 (server), LI!=3 (не синхронизирован), stratum 1..15, наш nonce.
+        if (((rx[0] & 0x07) != 4) || ((rx[0] >> 6) == 3) || (rx[1] == 0) || (rx[1] > 15))
+            continue;
+        if (std::memcmp(&rx[24], nonce, sizeof(nonce)) != 0)
+            continue;
+        uint32_t sec = be32(&rx[40]);
+        uint32_t frac = be32(&rx[44]);
+        if (sec == 0)
+            continue;
+
+        int64_t secs = sec;
+        if (sec < 0x80000000u)
+            secs += 0x100000000LL; // эра 1 (после 07.02.2036)
+        int64_t rtt = esp_timer_get_time() - t0;
+        int64_t us = (secs - NTP_UNIX_OFFSET) * 1000000LL + (int64_t)(((uint64_t)frac * 1000000ULL) >> 32) + rtt / 2;
+        tv.tv_sec = us / 1000000LL;
+        tv.tv_usec = us % 1000000LL;
+        res = true;
+    }
+    close(s);
+    return res;
+}
+
+bool CTimeSyncTask::httpDate(struct timeval &tv)
+{
+    if (sizeof(CONFIG_WIFICHN_TIME_HTTP_URL) <= 1)
+        return false;
+
+    time_t t = 0;
+    esp_http_client_config_t cfg;
+    std::memset(&cfg, 0, sizeof(cfg));
+    cfg.url = CONFIG_WIFICHN_TIME_HTTP_URL;
+    cfg.method = HTTP_METHOD_HEAD;
+    cfg.timeout_ms = CONFIG_WIFICHN_SNTP_TIMEOUT_MS * 2;
+    cfg.event_handler = http_date_handler;
+    cfg.user_data = &t;
+    esp_http_client_handle_t client = esp_http_client_init(&cfg);
+    if (client == nullptr)
+        return false;
+    esp_http_client_perform(client);
+    esp_http_client_cleanup(client);
+    if (t < TIMECACHE_MIN_EPOCH)
+        return false;
+
+    // Точность заголовка - 1 с, берём середину секунды.
+    tv.tv_sec = t;
+    tv.tv_usec = 500000;
+    return true;
+}
+
+void CTimeSyncTask::run()
+{
+    uint32_t delay = TIMESYNC_RETRY_MIN_MS;
+    while (!mCancel)
+    {
+        struct timeval tv;
+        TIMELINE_BEGIN("sntp");
+        bool res = sntpQuery(tv);
+        TIMELINE_END("sntp");
+        if (!res && !mCancel)
+        {
+            TIMELINE_BEGIN("http date");
+            res = httpDate(tv);
+            TIMELINE_END("http date");
+        }
+        if (res)
+        {
+            settimeofday(&tv, nullptr);
+            mParent->time_sync_notification_cb(&tv);
+            break;
+        }
+
+        ESP_LOGW(TAG, "time sync failed, retry in %" PRIu32 " ms", delay);
+        for (uint32_t t = 0; (t < delay) && !mCancel; t += 100)
+            vTaskDelay(pdMS_TO_TICKS(100));
+        delay *= 2;
+        if (delay > TIMESYNC_RETRY_MAX_MS)
+            delay = TIMESYNC_RETRY_MAX_MS;
+    }
+}
+#endif
@@ -0,0 +1,50 @@
+/*!
+	\file
+	\brief Класс задачи синхронизации времени (параллельный SNTP + HTTP Date).
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "WiFiStation.h"
+
+#include "CBaseTask.h"
+#include "task_settings.h"
+#include <sys/time.h>
+#include <atomic>
+
+class CTimeSyncTask : public CBaseTask
+{
+protected:
+	WiFiStation *mParent; ///< Родительский объект
+
+	/// Одновременный запрос всех SNTP серверов, результат - первый валидный ответ.
+	/*!
+	  \param[out] tv - полученное время.
+	  \return true - если получен валидный ответ.
+	*/
+	bool sntpQuery(struct timeval &tv);
+	/// Время из заголовка Date HTTP-ответа (если UDP/123 заблокирован).
+	/*!
+	  \param[out] tv - полученное время.
+	  \return true - если заголовок получен и разобран.
+	*/
+	bool httpDate(struct timeval &tv);
+
+	/// Функция задачи.
+	virtual void run() override;
+
+public:
+	/// Конструктор.
+	/*!
+	  \param[in] parent - Родительский объект.
+	*/
+	CTimeSyncTask(WiFiStation *parent);
+	/// Деструктор.
+	virtual ~CTimeSyncTask();
+
+	std::atomic<bool> mCancel{false}; ///< Флаг отмены синхронизации.
+};
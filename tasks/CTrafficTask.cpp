@@ -0,0 +1,131 @@
+/*!
+    \file
+    \brief Класс задачи очередей отправки по классам трафика (CTrafficScheduler поверх lwIP).
+    \authors Близнец Р.А. (r.bliznets@gmail.com)
+    \version 0.0.0.1
+    \date 19.10.2026
+*/
+
+#include "CTrafficTask.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/api.h"
+#include "lwip/ip.h"
+#include "lwip/tcpip.h"
+
+#if CONFIG_WIFICHN_QOS
+static const char *TAG = "qos";
+
+static inline uint32_t now_us()
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+CTrafficTask::CTrafficTask()
+    : CBaseTask(),
+      mScheduler([](ETrafficClass cls, void *ctx, uint32_t ip, uint16_t port, const uint8_t *data, size_t len)
+                 { return output(ctx, ip, port, data, len); })
+{
+    CBaseTask::init(QOSTASK_NAME, QOSTASK_STACKSIZE, QOSTASK_PRIOR, QOSTASK_LENGTH, QOSTASK_CPU, QOSTASK_PSRAM);
+}
+
+CTrafficTask::~CTrafficTask()
+{
+    mCancel = true;
+    if (TaskHandle_t task = mTask.load())
+        xTaskNotifyGiveIndexed(task, CONFIG_WIFICHN_NOTIFY_INDEX);
+    do
+    {
+        vTaskDelay(1);
+    } while (mTaskQueue != nullptr);
+}
+
+bool CTrafficTask::output(void *ctx, uint32_t ip, uint16_t port, const uint8_t *data, size_t len)
+{
+    struct netbuf *buf = netbuf_new();
+    if (buf == nullptr)
+        return false;
+    ip_addr_t addr;
+    ip_addr_set_ip4_u32_val(addr, ip);
+    err_t err = netbuf_ref(buf, data, len);
+    if (err == ERR_OK)
+        err = netconn_sendto((struct netconn *)ctx, buf, &addr, port);
+    netbuf_delete(buf);
+    // Прочие ошибки (нет маршрута, соединение закрыто) повтором не исправить - пакет потерян.
+    return (err != ERR_MEM) && (err != ERR_BUF);
+}
+
+void CTrafficTask::mark(struct netconn *conn, ETrafficClass cls)
+{
+    if ((conn == nullptr) || (conn->pcb.ip == nullptr))
+        return;
+    LOCK_TCPIP_CORE();
+    conn->pcb.ip->tos = trafficTos(cls);
+    UNLOCK_TCPIP_CORE();
+}
+
+bool CTrafficTask::send(ETrafficClass cls, struct netconn *conn, uint32_t ip, uint16_t port, const uint8_t *data, size_t len)
+{
+    if ((conn == nullptr) || (ip == 0))
+        return false;
+    bool res;
+    uint16_t backlog;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        res = mScheduler.send(cls, conn, ip, port, data, len, now_us());
+        backlog = mScheduler.backlog();
+    }
+    TaskHandle_t task = mTask.load();
+    if ((backlog != 0) && (task != nullptr))
+        xTaskNotifyGiveIndexed(task, CONFIG_WIFICHN_NOTIFY_INDEX);
+    return res;
+}
+
+void CTrafficTask::cancel(struct netconn *conn)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mScheduler.cancel(conn);
+}
+
+void CTrafficTask::yield(ETrafficClass cls)
+{
+    TickType_t start = xTaskGetTickCount();
+    while (xTaskGetTickCount() - start < pdMS_TO_TICKS(CONFIG_WIFICHN_QOS_BULK_WAIT_MS))
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mScheduler.busy(cls, now_us()))
+                return;
+        }
+        vTaskDelay(1);
+    }
+}
+
+STrafficStats CTrafficTask::stats(ETrafficClass cls)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mScheduler.stats(cls);
+}
+
+void CTrafficTask::run()
+{
+    if (!mScheduler.isValid())
+    {
+        ESP_LOGE(TAG, "no memory for queues");
+        return;
+    }
+    mTask.store(xTaskGetCurrentTaskHandle());
+    while (!mCancel)
+    {
+        uint16_t backlog;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mScheduler.pump(now_us());
+            backlog = mScheduler.backlog();
+        }
+        // Очередь не пуста - стек занят или класс ждёт паузы выше: повтор через тик.
+        ulTaskNotifyTakeIndexed(CONFIG_WIFICHN_NOTIFY_INDEX, pdTRUE, (backlog != 0) ? 1 : pdMS_TO_TICKS(QOSTASK_POLL_MS));
+    }
+    mTask.store(nullptr);
+}
+#endif
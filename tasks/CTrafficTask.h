@@ -0,0 +1,75 @@
+/*!
+	\file
+	\brief Класс задачи очередей отправки по классам трафика (CTrafficScheduler поверх lwIP).
+	\authors Близнец Р.А. (r.bliznets@gmail.com)
+	\version 0.0.0.1
+	\date 19.10.2026
+
+	Одна задача на станцию (создаётся WiFiStation). Каналы передают пакеты через
+	send() со своим соединением netconn: пакет уходит сразу из задачи канала, а
+	если стек занят (ERR_MEM - очередь драйвера WiFi полна) или класс выше
+	активен - ждёт в очереди своего класса, и задача отдаёт очереди по мере
+	освобождения стека, старшие классы первыми. Класс трафика соединения (поле
+	TOS) выставляет mark() при открытии соединения.
+	Фоновые передачи, идущие мимо очередей (закачка OTA через esp_http_client),
+	уступают эфир вызовом yield() перед каждой порцией.
+*/
+
+#pragma once
+
+#include "sdkconfig.h"
+
+#include "CBaseTask.h"
+#include "CTrafficScheduler.h"
+#include "task_settings.h"
+#include <atomic>
+#include <mutex>
+
+struct netconn;
+
+class CTrafficTask : public CBaseTask
+{
+protected:
+	CTrafficScheduler mScheduler;			 ///< Очереди классов.
+	std::mutex mMutex;						 ///< Защита очередей.
+	std::atomic<TaskHandle_t> mTask{nullptr}; ///< Задача (для пробуждения при постановке в очередь).
+
+	/// Передача пакета в стек.
+	static bool output(void *ctx, uint32_t ip, uint16_t port, const uint8_t *data, size_t len);
+
+	/// Функция задачи.
+	virtual void run() override;
+
+public:
+	/// Конструктор.
+	CTrafficTask();
+	/// Деструктор.
+	virtual ~CTrafficTask();
+
+	/// Отправить пакет.
+	/*!
+	  \param[in] cls - Класс трафика.
+	  \param[in] conn - UDP соединение отправителя.
+	  \param[in] ip - IP адрес получателя.
+	  \param[in] port - Порт получателя.
+	  \param[in] data - Пакет.
+	  \param[in] len - Длина (не больше CONFIG_WIFICHN_QOS_MTU).
+	  \return true - пакет передан в стек или поставлен в очередь.
+	*/
+	bool send(ETrafficClass cls, struct netconn *conn, uint32_t ip, uint16_t port, const uint8_t *data, size_t len);
+	/// Удалить из очередей пакеты соединения (перед netconn_delete()).
+	void cancel(struct netconn *conn);
+	/// Уступить эфир классам выше.
+	/*!
+	  Ждёт, пока классы выше заняты, но не дольше CONFIG_WIFICHN_QOS_BULK_WAIT_MS.
+	  \param[in] cls - Класс вызывающей передачи.
+	*/
+	void yield(ETrafficClass cls = ETrafficClass::Background);
+	/// Статистика класса.
+	STrafficStats stats(ETrafficClass cls);
+
+	/// Выставить класс трафика соединения (DSCP в поле TOS исходящих пакетов).
+	static void mark(struct netconn *conn, ETrafficClass cls);
+
+	std::atomic<bool> mCancel{false}; ///< Флаг остановки задачи.
+};
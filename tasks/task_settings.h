@@ -39,3 +39,77 @@
 
 #define OTATASK_BEGIN_RETRIES (1)			   ///< Число попыток esp_https_ota_begin() при обрыве связи.
 #define OTATASK_RETRY_DELAY_MS (1000)		   ///< Пауза между попытками esp_https_ota_begin().
+#define OTATASK_MAX_REDIRECTS (3)			   ///< Максимальное число HTTP переадресаций при прямой записи образа.
+#ifdef CONFIG_WIFICHN_OTA_BURST_KB
+#define OTATASK_BURST_SIZE (CONFIG_WIFICHN_OTA_BURST_KB * 1024) ///< Объём записи во flash за одно окно writeEvent.
+#else
+#define OTATASK_BURST_SIZE (4096)			   ///< Объём записи во flash за одно окно writeEvent.
+#endif
+#define OTATASK_BURST_GAP_MS (20)			   ///< Пауза между пакетами записи во flash.
+#define OTATASK_PSRAM_RESERVE (64 * 1024)  ///< Сколько PSRAM оставить свободной при размещении образа.
+#define OTATASK_MANIFEST_MAX (16 * 1024)	   ///< Максимальный размер манифеста OTA.
+#define OTATASK_TUNE_MIN (2048)			   ///< Наименьший вариант буфера чтения при подборе.
+#define OTATASK_TUNE_MAX (16 * 1024)		   ///< Наибольший вариант буфера чтения при подборе.
+#define OTATASK_TUNE_WINDOW (32 * 1024)	   ///< Объём замера одного варианта, байт.
+#define OTATASK_TUNE_RESERVE (48 * 1024)	   ///< Сколько внутренней RAM оставить свободной (TLS, WiFi).
+
+#define TIMESYNCTASK_NAME "tsync"			   ///< Имя задачи для отладки.
+#define TIMESYNCTASK_STACKSIZE (4 * 1024) ///< Размер стека задачи.
+#define TIMESYNCTASK_PRIOR (1)				   ///< Приоритет задачи.
+#define TIMESYNCTASK_LENGTH (1)			   ///< Длина приемной очереди задачи.
+#define TIMESYNCTASK_CPU CPU_CORE			   ///< Номер ядра процессора.
+#define TIMESYNCTASK_PSRAM false
+
+#define TIMESYNC_MAX_SERVERS (6)			   ///< Максимальное число одновременно опрашиваемых SNTP серверов.
+#define TIMESYNC_RETRY_MIN_MS (2000)		   ///< Начальная пауза между попытками синхронизации.
+#define TIMESYNC_RETRY_MAX_MS (60000)		   ///< Максимальная пауза между попытками синхронизации.
+
+#define WIFI_STOP_TIMEOUT_MS (3000)		   ///< Максимальное ожидание события отключения в WiFiStation::stop().
+
+#define PROVTASK_NAME "prov"				   ///< Имя задачи для отладки.
+#define PROVTASK_STACKSIZE (4 * 1024)	   ///< Размер стека задачи.
+#define PROVTASK_PRIOR (1)				   ///< Приоритет задачи.
+#define PROVTASK_LENGTH (1)				   ///< Длина приемной очереди задачи.
+#define PROVTASK_CPU CPU_CORE			   ///< Номер ядра процессора.
+#define PROVTASK_PSRAM false
+
+#define PROVTASK_POLL_MS (500)			   ///< Период проверки флага остановки сервиса провижининга.
+
+#define RUDPTASK_NAME "rudp"				   ///< Имя задачи для отладки.
+#define RUDPTASK_STACKSIZE (4 * 1024)	   ///< Размер стека задачи.
+#define RUDPTASK_PRIOR (2)				   ///< Приоритет задачи (повторы не должны ждать фоновых задач).
+#define RUDPTASK_LENGTH (1)				   ///< Длина приемной очереди задачи.
+#define RUDPTASK_CPU CPU_CORE			   ///< Номер ядра процессора.
+#define RUDPTASK_PSRAM false
+
+#define RUDPTASK_POLL_MS (20)			   ///< Наибольшая пауза между проверками таймеров и флага остановки.
+
+#define MCASTTASK_NAME "mcast"			   ///< Имя задачи для отладки.
+#define MCASTTASK_STACKSIZE (4 * 1024)	   ///< Размер стека задачи.
+#define MCASTTASK_PRIOR (1)				   ///< Приоритет задачи.
+#define MCASTTASK_LENGTH (1)			   ///< Длина приемной очереди задачи.
+#define MCASTTASK_CPU CPU_CORE			   ///< Номер ядра процессора.
+#define MCASTTASK_PSRAM false
+
+#define MCASTTASK_POLL_MS (50)			   ///< Наибольшая пауза между проверками таймеров, членства в группе и флага остановки.
+#define MCASTTASK_CLASS ETrafficClass::BestEffort ///< Класс трафика рассылки при CONFIG_WIFICHN_QOS.
+
+#define QOSTASK_NAME "qos"				   ///< Имя задачи для отладки.
+#define QOSTASK_STACKSIZE (3 * 1024)	   ///< Размер стека задачи.
+#define QOSTASK_PRIOR (3)				   ///< Приоритет задачи (очередь голоса не должна ждать задач каналов).
+#define QOSTASK_LENGTH (1)				   ///< Длина приемной очереди задачи.
+#define QOSTASK_CPU CPU_CORE			   ///< Номер ядра процессора.
+#define QOSTASK_PSRAM false
+
+#define QOSTASK_POLL_MS (100)			   ///< Пауза проверки флага остановки при пустых очередях.
+
+#define SELFTASK_NAME "selftest"			   ///< Имя задачи для отладки.
+#define SELFTASK_STACKSIZE (4 * 1024)	   ///< Размер стека задачи.
+#define SELFTASK_PRIOR (1)				   ///< Приоритет задачи.
+#define SELFTASK_LENGTH (1)				   ///< Длина приемной очереди задачи.
+#define SELFTASK_CPU CPU_CORE			   ///< Номер ядра процессора.
+#define SELFTASK_PSRAM false
+
+#define SELFTASK_POLL_MS (20)			   ///< Таймаут операций соединения между проверками флага остановки.
+#define SELFTASK_IDLE_MS (300)			   ///< Пауза потока датаграмм после конца теста, завершающая приём.
+#define SELFTASK_REPORT_MS (3000)		   ///< Ожидание отчёта сервера (и конца потока TCP после теста).
@@ -0,0 +1,45 @@
+/*!
+    \file
+    \brief Test for CWiFiEventStream: OTA progress records are merged in place,
+           so a full download does not push link records out of the ring.
+           Runs without WiFi.
+*/
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "CWiFiEventStream.h"
+
+TEST_CASE("CWiFiEventStream merges OTA progress records", "[wifi_chn]")
+{
+    CWiFiEventStream stream;
+    SWiFiEventRecord recs[CONFIG_WIFICHN_EVENT_STREAM_SIZE];
+
+    stream.push(EWiFiEvent::LinkUp, 0, 0x0101a8c0);
+    stream.push(EWiFiEvent::OtaStatus, OTA_STATUS_START);
+    for (int i = 0; i < 5; i++)
+        stream.push(EWiFiEvent::OtaStatus, OTA_STATUS_SYNC_TIME);
+    for (int p = 0; p <= 100; p++)
+        stream.push(EWiFiEvent::OtaProgress, p, p * 1000);
+    stream.push(EWiFiEvent::OtaStatus, OTA_STATUS_OK);
+
+    TEST_ASSERT_EQUAL(5, stream.available());
+    TEST_ASSERT_EQUAL(0, stream.dropped());
+    TEST_ASSERT_EQUAL(5, stream.read(recs, CONFIG_WIFICHN_EVENT_STREAM_SIZE));
+    TEST_ASSERT_EQUAL((uint8_t)EWiFiEvent::LinkUp, recs[0].type);
+    TEST_ASSERT_EQUAL(OTA_STATUS_SYNC_TIME, recs[2].code);
+    // The merged record carries the latest values and keeps its own sequence number.
+    TEST_ASSERT_EQUAL((uint8_t)EWiFiEvent::OtaProgress, recs[3].type);
+    TEST_ASSERT_EQUAL(100, recs[3].code);
+    TEST_ASSERT_EQUAL(100000, recs[3].bytes);
+    for (int i = 1; i < 5; i++)
+        TEST_ASSERT_EQUAL((uint8_t)(recs[0].seq + i), recs[i].seq);
+
+    // A record already read is not updated: the next progress gets a new one.
+    stream.push(EWiFiEvent::OtaProgress, 1);
+    stream.push(EWiFiEvent::OtaStatus, OTA_STATUS_FINISH);
+    stream.push(EWiFiEvent::OtaProgress, 2);
+    TEST_ASSERT_EQUAL(3, stream.read(recs, CONFIG_WIFICHN_EVENT_STREAM_SIZE));
+    TEST_ASSERT_EQUAL(1, recs[0].code);
+    TEST_ASSERT_EQUAL(2, recs[2].code);
+}
@@ -0,0 +1,81 @@
+/*!
+    \file
+    \brief Unit test for CFastConnect: the RTC context keeps credentials and the AP,
+           and a failed attempt falls back to a full connect. Runs without WiFi.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_FAST_CONNECT
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "unity.h"
+#include <cstring>
+#include "CFastConnect.h"
+
+static void make_config(wifi_config_t &cfg, const char *ssid, const char *password)
+{
+    std::memset(&cfg, 0, sizeof(cfg));
+    strlcpy((char *)cfg.sta.ssid, ssid, sizeof(cfg.sta.ssid));
+    strlcpy((char *)cfg.sta.password, password, sizeof(cfg.sta.password));
+}
+
+TEST_CASE("CFastConnect context round trip", "[wifi_chn]")
+{
+    wifi_config_t cfg;
+    CFastConnect::invalidate();
+    make_config(cfg, "test_ap", "secret123");
+    TEST_ASSERT_FALSE(CFastConnect::loadConfig(cfg));
+
+    // First connect: credentials are kept, no AP yet.
+    TEST_ASSERT_FALSE(CFastConnect::prepare(cfg));
+    wifi_config_t restored;
+    std::memset(&restored, 0, sizeof(restored));
+    TEST_ASSERT_TRUE(CFastConnect::loadConfig(restored));
+    TEST_ASSERT_EQUAL_STRING("test_ap", (char *)restored.sta.ssid);
+    TEST_ASSERT_EQUAL_STRING("secret123", (char *)restored.sta.password);
+
+    // Association stores the AP; the next connect targets it directly.
+    wifi_event_sta_connected_t evt;
+    std::memset(&evt, 0, sizeof(evt));
+    const uint8_t bssid[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+    std::memcpy(evt.bssid, bssid, sizeof(bssid));
+    evt.channel = 11;
+    evt.authmode = WIFI_AUTH_WPA2_PSK;
+    CFastConnect::onConnected(&evt, nullptr);
+    TEST_ASSERT_FALSE(CFastConnect::isStatic()); // no lease yet
+
+    TEST_ASSERT_TRUE(CFastConnect::prepare(cfg));
+    TEST_ASSERT_TRUE(CFastConnect::isFast());
+    TEST_ASSERT_TRUE(cfg.sta.bssid_set);
+    TEST_ASSERT_EQUAL(11, cfg.sta.channel);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(bssid, cfg.sta.bssid, sizeof(bssid));
+
+    // A failed attempt clears the AP but keeps the credentials.
+    TEST_ASSERT_TRUE(CFastConnect::onFail(cfg, nullptr));
+    TEST_ASSERT_FALSE(cfg.sta.bssid_set);
+    TEST_ASSERT_EQUAL(0, cfg.sta.channel);
+    TEST_ASSERT_FALSE(CFastConnect::onFail(cfg, nullptr));
+    TEST_ASSERT_FALSE(CFastConnect::prepare(cfg));
+    TEST_ASSERT_TRUE(CFastConnect::loadConfig(restored));
+
+    // New credentials drop the stored AP.
+    CFastConnect::onConnected(&evt, nullptr);
+    make_config(cfg, "test_ap", "other_pass");
+    TEST_ASSERT_FALSE(CFastConnect::prepare(cfg));
+
+    CFastConnect::invalidate();
+    TEST_ASSERT_FALSE(CFastConnect::loadConfig(restored));
+}
+
+TEST_CASE("CFastConnect phase marks", "[wifi_chn]")
+{
+    CFastConnect::mark(EFastPhase::Start);
+    TEST_ASSERT_EQUAL(0, CFastConnect::phaseMs(EFastPhase::Ip));
+    vTaskDelay(pdMS_TO_TICKS(20));
+    CFastConnect::mark(EFastPhase::Ip);
+    TEST_ASSERT_GREATER_OR_EQUAL(CFastConnect::phaseMs(EFastPhase::Start) + 15, CFastConnect::phaseMs(EFastPhase::Ip));
+}
+
+#endif // CONFIG_WIFICHN_FAST_CONNECT
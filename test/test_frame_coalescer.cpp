@@ -0,0 +1,235 @@
+/*!
+    \file
+    \brief Test for CFrameCoalescer / CFrameView / CFrameSplitter: packing of small
+           records into MTU frames, flush deadline, backpressure, zero-copy unpacking
+           and stream splitting, plus a packing benchmark. Runs without WiFi.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_FRAMING
+
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "CFrameCoalescer.h"
+#include <vector>
+#include <cstring>
+
+static const char *TAG = "test_frame";
+
+#define TEST_MTU (1400)
+
+/// Record i: 8..40 bytes derived from its index.
+static std::vector<uint8_t> make_record(uint32_t i)
+{
+    std::vector<uint8_t> rec(8 + (i * 7) % 33);
+    for (size_t k = 0; k < rec.size(); k++)
+        rec[k] = (uint8_t)(i + k * 13);
+    return rec;
+}
+
+/// Check that a frame holds records first.. in order; returns the number found.
+static uint32_t check_frame(const uint8_t *frame, size_t len, uint32_t first)
+{
+    CFrameView view(frame, len);
+    SFrameRecord rec;
+    uint32_t n = 0;
+    while (view.next(rec))
+    {
+        std::vector<uint8_t> expect = make_record(first + n);
+        TEST_ASSERT_EQUAL(expect.size(), rec.len);
+        TEST_ASSERT_EQUAL(0, std::memcmp(expect.data(), rec.data, rec.len));
+        // Zero-copy: the view points into the frame buffer.
+        TEST_ASSERT_TRUE((rec.data >= frame) && (rec.data + rec.len <= frame + len));
+        n++;
+    }
+    TEST_ASSERT_TRUE(view.isValid());
+    return n;
+}
+
+TEST_CASE("CFrameCoalescer packs small records into full frames", "[wifi_chn]")
+{
+    std::vector<std::vector<uint8_t>> frames;
+    CFrameCoalescer co([&frames](const uint8_t *f, size_t l)
+                       { frames.emplace_back(f, f + l); return true; }, TEST_MTU, 10);
+    TEST_ASSERT_TRUE(co.isValid());
+    const uint32_t count = 2000;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::vector<uint8_t> rec = make_record(i);
+        TEST_ASSERT_TRUE(co.add(rec.data(), rec.size(), 0));
+    }
+    TEST_ASSERT_TRUE(co.flush(0));
+
+    uint32_t got = 0;
+    for (auto &f : frames)
+    {
+        TEST_ASSERT_LESS_OR_EQUAL(TEST_MTU, f.size());
+        got += check_frame(f.data(), f.size(), got);
+    }
+    TEST_ASSERT_EQUAL(count, got);
+    SFrameStats st = co.stats();
+    TEST_ASSERT_EQUAL(count, st.records);
+    TEST_ASSERT_EQUAL(frames.size(), st.frames);
+    TEST_ASSERT_EQUAL(frames.size() - 1, st.fullFlushes);
+    // A full frame wastes less than one record (41 bytes with its length); only the last is partial.
+    TEST_ASSERT_GREATER_OR_EQUAL((frames.size() - 1) * (TEST_MTU - 41), st.wire - frames.back().size());
+    TEST_ASSERT_LESS_OR_EQUAL(st.fillMin, 1000 * frames.back().size() / TEST_MTU);
+}
+
+TEST_CASE("CFrameCoalescer flushes a partial frame on deadline", "[wifi_chn]")
+{
+    uint32_t flushed = 0;
+    CFrameCoalescer co([&flushed](const uint8_t *f, size_t l)
+                       { flushed++; return true; }, TEST_MTU, 10);
+    uint8_t rec[16] = {};
+    TEST_ASSERT_TRUE(co.add(rec, sizeof(rec), 100));
+    TEST_ASSERT_TRUE(co.add(rec, sizeof(rec), 104));
+    TEST_ASSERT_EQUAL(4, co.poll(106));
+    TEST_ASSERT_EQUAL(0, flushed);
+    co.poll(110);
+    TEST_ASSERT_EQUAL(1, flushed);
+    SFrameStats st = co.stats();
+    TEST_ASSERT_EQUAL(1, st.deadlineFlushes);
+    TEST_ASSERT_EQUAL(10, st.latencyMax);
+    TEST_ASSERT_EQUAL(8, st.latencyAvg); // (10 + 6) / 2
+    TEST_ASSERT_EQUAL(0, co.pending());
+}
+
+TEST_CASE("CFrameCoalescer keeps the frame while the channel is busy", "[wifi_chn]")
+{
+    bool ready = false;
+    uint32_t got = 0;
+    CFrameCoalescer co([&](const uint8_t *f, size_t l)
+                       {
+                           if (!ready)
+                               return false;
+                           got += check_frame(f, l, got);
+                           return true; }, 64, 5);
+    uint32_t added = 0;
+    std::vector<uint8_t> rec;
+    while (true)
+    {
+        rec = make_record(added);
+        if (!co.add(rec.data(), rec.size(), 0))
+            break;
+        added++;
+    }
+    TEST_ASSERT_GREATER_THAN(0, added);
+    TEST_ASSERT_EQUAL(1, co.stats().rejected);
+    co.poll(50);
+    TEST_ASSERT_EQUAL(0, got);
+    ready = true;
+    TEST_ASSERT_TRUE(co.add(rec.data(), rec.size(), 50));
+    added++;
+    co.poll(100);
+    TEST_ASSERT_EQUAL(added, got);
+    // Records larger than a frame are refused outright.
+    std::vector<uint8_t> big(co.maxRecord() + 1);
+    TEST_ASSERT_FALSE(co.add(big.data(), big.size(), 100));
+    big.pop_back();
+    TEST_ASSERT_TRUE(co.add(big.data(), big.size(), 100));
+}
+
+TEST_CASE("CFrameView rejects damaged frames", "[wifi_chn]")
+{
+    std::vector<uint8_t> frame;
+    CFrameCoalescer co([&frame](const uint8_t *f, size_t l)
+                       { frame.assign(f, f + l); return true; }, TEST_MTU, 10);
+    uint8_t rec[40] = {};
+    co.add(rec, sizeof(rec), 0);
+    co.add(rec, sizeof(rec), 0);
+    co.flush(0);
+
+    SFrameRecord r;
+    CFrameView cut(frame.data(), frame.size() - 1); // header promises more than received
+    TEST_ASSERT_FALSE(cut.isValid());
+    TEST_ASSERT_FALSE(cut.next(r));
+
+    frame[FRAME_HEADER_SIZE + 1 + sizeof(rec)] = 0x7f; // second record runs past the end
+    CFrameView bad(frame.data(), frame.size());
+    TEST_ASSERT_TRUE(bad.next(r));
+    TEST_ASSERT_FALSE(bad.next(r));
+    TEST_ASSERT_FALSE(bad.isValid());
+}
+
+TEST_CASE("CFrameSplitter restores frames from a TCP stream", "[wifi_chn]")
+{
+    std::vector<uint8_t> stream;
+    CFrameCoalescer co([&stream](const uint8_t *f, size_t l)
+                       { stream.insert(stream.end(), f, f + l); return true; }, 300, 10);
+    const uint32_t count = 500;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::vector<uint8_t> rec = make_record(i);
+        co.add(rec.data(), rec.size(), 0);
+    }
+    co.flush(0);
+
+    uint32_t got = 0;
+    uint32_t inPlace = 0;
+    const uint8_t *chunk = nullptr;
+    size_t chunkLen = 0;
+    CFrameSplitter sp([&](const uint8_t *f, size_t l)
+                      {
+                          if ((f >= chunk) && (f + l <= chunk + chunkLen))
+                              inPlace++;
+                          got += check_frame(f, l, got); }, 300);
+    TEST_ASSERT_TRUE(sp.isValid());
+    // Segment sizes unrelated to frame boundaries.
+    uint32_t seed = 7;
+    for (size_t pos = 0; pos < stream.size();)
+    {
+        seed = seed * 1103515245 + 12345;
+        chunkLen = 1 + (seed >> 16) % 700;
+        if (chunkLen > stream.size() - pos)
+            chunkLen = stream.size() - pos;
+        chunk = stream.data() + pos;
+        TEST_ASSERT_TRUE(sp.feed(chunk, chunkLen));
+        pos += chunkLen;
+    }
+    TEST_ASSERT_EQUAL(count, got);
+    TEST_ASSERT_GREATER_THAN(0, inPlace);
+
+    const uint8_t garbage[4] = {0xff, 0xff, 0, 0}; // frame longer than MTU
+    TEST_ASSERT_FALSE(sp.feed(garbage, sizeof(garbage)));
+    TEST_ASSERT_FALSE(sp.feed(stream.data(), stream.size()));
+    sp.reset();
+    got = 0;
+    TEST_ASSERT_TRUE(sp.feed(stream.data(), stream.size()));
+    TEST_ASSERT_EQUAL(count, got);
+}
+
+TEST_CASE("CFrameCoalescer benchmark", "[wifi_chn]")
+{
+    uint32_t frames = 0;
+    CFrameCoalescer co([&frames](const uint8_t *f, size_t l)
+                       { frames++; return true; }, TEST_MTU, 10);
+    const uint32_t count = 100000;
+    std::vector<std::vector<uint8_t>> recs;
+    for (uint32_t i = 0; i < 64; i++)
+        recs.push_back(make_record(i));
+    size_t payload = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const std::vector<uint8_t> &r = recs[i & 63];
+        co.add(r.data(), r.size(), i / 100); // 100 records per ms
+        payload += r.size();
+    }
+    co.flush(count / 100);
+    int64_t cpu = esp_timer_get_time() - t0;
+    SFrameStats st = co.stats();
+    // 28 bytes of IP/UDP headers per packet; per-frame MAC overhead comes on top of that.
+    ESP_LOGI(TAG, "%u records (%u bytes) -> %u frames, fill %u/1000, latency avg %u max %u ms, "
+                  "headers %u bytes vs %u per record, %u ns/record",
+             (unsigned)count, (unsigned)payload, (unsigned)frames, st.fillAvg, (unsigned)st.latencyAvg,
+             (unsigned)st.latencyMax, (unsigned)(frames * 28 + st.wire - payload), (unsigned)(count * 28),
+             (unsigned)(cpu * 1000 / count));
+    TEST_ASSERT_EQUAL(count, st.records);
+    TEST_ASSERT_LESS_THAN(count / 30, frames);
+}
+
+#endif // CONFIG_WIFICHN_FRAMING
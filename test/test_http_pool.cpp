@@ -0,0 +1,117 @@
+/*!
+    \file
+    \brief Test for CHttpPool: a free client is handed out again only to a
+           request with the same server, client settings and server
+           verification (pinned certificate vs CA bundle). Clients are
+           created but never connected, so it runs without WiFi.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_HTTP_POOL
+
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "CHttpPool.h"
+#include <cstring>
+#include <string>
+
+static esp_err_t handlerA(esp_http_client_event_t *evt)
+{
+    return ESP_OK;
+}
+
+static esp_err_t handlerB(esp_http_client_event_t *evt)
+{
+    return ESP_OK;
+}
+
+static esp_http_client_config_t make_cfg(const char *url, http_event_handle_cb handler)
+{
+    esp_http_client_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.url = url;
+    cfg.event_handler = handler;
+    cfg.buffer_size = 1024;
+    cfg.timeout_ms = 5000;
+    return cfg;
+}
+
+TEST_CASE("CHttpPool reuses clients only with the same settings", "[wifi_chn]")
+{
+    CHttpPool pool;
+    esp_http_client_config_t a = make_cfg("http://example.com/a", handlerA);
+    esp_http_client_handle_t first = pool.acquire(a);
+    TEST_ASSERT_NOT_NULL(first);
+    pool.release(first, true);
+
+    // Same server, same settings, another path: the kept client comes back.
+    a.url = "http://example.com/b?x=1";
+    esp_http_client_handle_t again = pool.acquire(a);
+    TEST_ASSERT_EQUAL_PTR(first, again);
+    TEST_ASSERT_EQUAL(1, pool.hits());
+    pool.release(again, true);
+
+    // Another event handler would get the previous owner's client and parse a foreign user_data.
+    esp_http_client_config_t b = make_cfg("http://example.com/a", handlerB);
+    esp_http_client_handle_t other = pool.acquire(b);
+    TEST_ASSERT_NOT_NULL(other);
+    TEST_ASSERT_TRUE(other != first);
+    pool.release(other, true);
+
+    // Method and timeout cannot be changed on a kept client either.
+    esp_http_client_config_t post = make_cfg("http://example.com/a", handlerA);
+    post.method = HTTP_METHOD_POST;
+    esp_http_client_handle_t p = pool.acquire(post);
+    TEST_ASSERT_TRUE((p != first) && (p != other));
+    pool.release(p, false);
+    esp_http_client_config_t slow = make_cfg("http://example.com/a", handlerA);
+    slow.timeout_ms = 30000;
+    esp_http_client_handle_t s = pool.acquire(slow);
+    TEST_ASSERT_TRUE((s != first) && (s != other));
+    pool.release(s, false);
+
+    TEST_ASSERT_EQUAL(1, pool.hits());
+}
+
+static esp_err_t bundle_attach(void *conf)
+{
+    return ESP_OK;
+}
+
+static const char *PINNED = "-----BEGIN CERTIFICATE-----\nPINNED\n-----END CERTIFICATE-----\n";
+
+/// A connection verified against the CA bundle (or not at all) must not satisfy a pinned request.
+TEST_CASE("CHttpPool keeps pinned and bundle connections apart", "[wifi_chn]")
+{
+    CHttpPool pool;
+    esp_http_client_config_t app = make_cfg("https://ota.example.com/fw.bin", handlerA);
+    app.crt_bundle_attach = bundle_attach;
+    esp_http_client_handle_t bundle = pool.acquire(app);
+    pool.release(bundle, true);
+
+    esp_http_client_config_t pinned = make_cfg("https://ota.example.com/fw.bin", handlerA);
+    pinned.cert_pem = PINNED;
+    esp_http_client_handle_t pin = pool.acquire(pinned);
+    TEST_ASSERT_TRUE(pin != bundle);
+    pool.release(pin, true);
+
+    esp_http_client_config_t noCheck = pinned;
+    noCheck.skip_cert_common_name_check = true;
+    esp_http_client_handle_t loose = pool.acquire(noCheck);
+    TEST_ASSERT_TRUE((loose != bundle) && (loose != pin));
+    pool.release(loose, false);
+
+    // The same certificate text from another buffer still matches.
+    std::string copy(PINNED);
+    pinned.cert_pem = copy.c_str();
+    TEST_ASSERT_EQUAL_PTR(pin, pool.acquire(pinned));
+    pool.release(pin, true);
+    copy[30] ^= 1;
+    pinned.cert_pem = copy.c_str();
+    esp_http_client_handle_t otherCert = pool.acquire(pinned);
+    TEST_ASSERT_TRUE(otherCert != pin);
+    pool.release(otherCert, false);
+}
+
+#endif // CONFIG_WIFICHN_HTTP_POOL
@@ -0,0 +1,80 @@
+/*!
+    \file
+    \brief Unit test for CLinkMonitor: RSSI smoothing, quality/throughput estimates
+           and history order, driven with synthetic samples. Runs without WiFi.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_LINK_MONITOR
+
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "esp_log.h"
+#include "CLinkMonitor.h"
+
+static const char *TAG = "test_link_monitor";
+
+/// Exposes the sample input that the timer normally feeds from the driver.
+class CTestLinkMonitor : public CLinkMonitor
+{
+public:
+    inline void sample(int8_t rssi, uint8_t phy = WIFI_PHY_MODE_HT20, uint8_t channel = 6) { addSample(rssi, phy, channel); };
+};
+
+TEST_CASE("CLinkMonitor rate table", "[wifi_chn]")
+{
+    // A stronger signal never predicts a lower rate.
+    for (int rssi = -95; rssi <= -40; rssi++)
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL(CLinkMonitor::phyRate(WIFI_PHY_MODE_11B, rssi - 1), CLinkMonitor::phyRate(WIFI_PHY_MODE_11B, rssi));
+        TEST_ASSERT_GREATER_OR_EQUAL(CLinkMonitor::phyRate(WIFI_PHY_MODE_HT20, rssi - 1), CLinkMonitor::phyRate(WIFI_PHY_MODE_HT20, rssi));
+        TEST_ASSERT_GREATER_OR_EQUAL(CLinkMonitor::phyRate(WIFI_PHY_MODE_HE20, rssi - 1), CLinkMonitor::phyRate(WIFI_PHY_MODE_HE20, rssi));
+    }
+    TEST_ASSERT_EQUAL(65000, CLinkMonitor::phyRate(WIFI_PHY_MODE_HT20, -50));
+    TEST_ASSERT_EQUAL(0, CLinkMonitor::phyRate(WIFI_PHY_MODE_HT20, -95));
+}
+
+TEST_CASE("CLinkMonitor smoothing and history", "[wifi_chn]")
+{
+    CTestLinkMonitor mon;
+    mon.sample(-50);
+    TEST_ASSERT_EQUAL(-50, mon.rssi());
+    TEST_ASSERT_EQUAL(100, mon.quality());
+    uint32_t good = mon.expectedKbps();
+    TEST_ASSERT_GREATER_THAN(0, good);
+
+    // A single deep fade moves the smoothed value by 1/8 of the step only.
+    mon.sample(-90);
+    TEST_ASSERT_EQUAL(-55, mon.rssi());
+
+    // A sustained drop converges and lowers quality and throughput.
+    for (int i = 0; i < 40; i++)
+        mon.sample(-80);
+    TEST_ASSERT_INT_WITHIN(1, -80, mon.rssi());
+    TEST_ASSERT_LESS_THAN(50, mon.quality());
+    TEST_ASSERT_LESS_THAN(good, mon.expectedKbps());
+    ESP_LOGI(TAG, "-50 dBm: %lu kbps, -80 dBm: %lu kbps, quality %u%%", (unsigned long)good,
+             (unsigned long)mon.expectedKbps(), mon.quality());
+
+    // Beacon losses penalize quality on top of RSSI.
+    uint8_t q = mon.quality();
+    mon.onBeaconTimeout();
+    mon.sample(-80);
+    TEST_ASSERT_LESS_THAN(q, mon.quality() + 1);
+    TEST_ASSERT_EQUAL(1, mon.beaconLosses());
+
+    // History returns the newest samples, oldest first.
+    SLinkSample buf[4];
+    TEST_ASSERT_EQUAL(4, mon.history(buf, 4));
+    for (int i = 1; i < 4; i++)
+        TEST_ASSERT_GREATER_OR_EQUAL(buf[i - 1].time_ms, buf[i].time_ms);
+    TEST_ASSERT_EQUAL(-80, buf[3].rssi);
+
+    mon.onDisconnect(8);
+    TEST_ASSERT_EQUAL(1, mon.disconnects());
+    TEST_ASSERT_EQUAL(8, mon.lastReason());
+    TEST_ASSERT_EQUAL(0, mon.quality());
+}
+
+#endif // CONFIG_WIFICHN_LINK_MONITOR
@@ -0,0 +1,243 @@
+/*!
+    \file
+    \brief Fleet test for CMulticastChannel: one sender and several receivers joined
+           in memory, each receiver with its own loss, on a simulated clock. Checks
+           NACK repair, reassembly of chunked messages and repair sharing between
+           receivers. Runs without WiFi.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_MCAST
+
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "esp_log.h"
+#include "CMulticastChannel.h"
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstring>
+
+static const char *TAG = "test_mcast";
+
+#define FLEET_SIZE (8)
+
+/// Simulated group: node 0 sends, nodes 1..N receive.
+class CFleet
+{
+public:
+    typedef std::function<bool(int to, const uint8_t *data, size_t len)> TDrop;
+
+    struct SPacket
+    {
+        uint32_t at;
+        int to;
+        std::vector<uint8_t> data;
+    };
+    /// Message as seen by one receiver.
+    struct SGot
+    {
+        uint16_t id;
+        std::vector<uint8_t> data;
+    };
+
+    std::vector<std::unique_ptr<CMulticastChannel>> mNodes;
+    std::vector<std::vector<SGot>> mGot;
+    std::vector<SPacket> mQueue;
+    uint32_t mNow = 0;
+    uint32_t mSeed = 4321;
+    uint32_t mLossPct = 0;
+    uint32_t mDelay = 2;
+    TDrop mDrop;
+    uint32_t mAir = 0; ///< Packets put on the air (a multicast counts once).
+
+    uint32_t rnd()
+    {
+        mSeed = mSeed * 1103515245 + 12345;
+        return (mSeed >> 16) & 0x7fff;
+    }
+
+    void deliver(int to, const uint8_t *data, size_t len)
+    {
+        if ((mLossPct != 0) && (rnd() % 100 < mLossPct))
+            return;
+        if (mDrop && mDrop(to, data, len))
+            return;
+        mQueue.push_back({mNow + mDelay, to, std::vector<uint8_t>(data, data + len)});
+    }
+
+    explicit CFleet(int receivers, uint16_t history = CONFIG_WIFICHN_MCAST_HISTORY)
+    {
+        mGot.resize(receivers + 1);
+        for (int i = 0; i <= receivers; i++)
+        {
+            mNodes.emplace_back(new CMulticastChannel(
+                [this, i, receivers](const uint8_t *d, size_t l)
+                {
+                    mAir++;
+                    for (int to = 0; to <= receivers; to++)
+                        if (to != i)
+                            deliver(to, d, l);
+                },
+                [this](const uint8_t *d, size_t l)
+                {
+                    mAir++;
+                    deliver(0, d, l); // every packet in this test comes from node 0
+                },
+                [this, i](uint16_t id, const uint8_t *d, size_t l)
+                { mGot[i].push_back({id, std::vector<uint8_t>(d, d + l)}); },
+                (i == 0) ? history : 0));
+            TEST_ASSERT_TRUE(mNodes.back()->isValid());
+        }
+    }
+
+    void step()
+    {
+        mNow++;
+        std::vector<SPacket> due;
+        for (size_t i = 0; i < mQueue.size();)
+        {
+            if ((int32_t)(mQueue[i].at - mNow) <= 0)
+            {
+                due.push_back(std::move(mQueue[i]));
+                mQueue.erase(mQueue.begin() + i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+        for (auto &p : due)
+            mNodes[p.to]->input(p.data.data(), p.data.size(), mNow);
+        for (auto &n : mNodes)
+            n->poll(mNow);
+    }
+
+    void run(uint32_t ms)
+    {
+        for (uint32_t i = 0; i < ms; i++)
+            step();
+    }
+
+    /// Every receiver has every message exactly once.
+    bool complete(const std::vector<std::vector<uint8_t>> &sent)
+    {
+        for (size_t r = 1; r < mGot.size(); r++)
+        {
+            if (mGot[r].size() != sent.size())
+                return false;
+            for (auto &g : mGot[r])
+                if ((g.id >= sent.size()) || (g.data != sent[g.id]))
+                    return false;
+        }
+        return true;
+    }
+};
+
+static std::vector<uint8_t> make_message(size_t len, uint8_t salt)
+{
+    std::vector<uint8_t> res(len);
+    for (size_t i = 0; i < len; i++)
+        res[i] = (uint8_t)(i * 31 + salt);
+    return res;
+}
+
+TEST_CASE("CMulticastChannel delivers chunked messages to every receiver under loss", "[wifi_chn]")
+{
+    CFleet fleet(FLEET_SIZE);
+    // Receivers learn the sender's session from its first heartbeat, so even the
+    // first command is repaired if lost.
+    fleet.run(10);
+    fleet.mLossPct = 10;
+    // Commands (one chunk) mixed with config pushes that need reassembly.
+    std::vector<std::vector<uint8_t>> sent;
+    const size_t sizes[] = {40, CONFIG_WIFICHN_MCAST_MAX_MSG, 0, 3 * MCAST_CHUNK + 7, 200, MCAST_CHUNK, 5000};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        sent.push_back(make_message(sizes[i], (uint8_t)i));
+        TEST_ASSERT_EQUAL((int32_t)i, fleet.mNodes[0]->send(sent.back().data(), sent.back().size(), fleet.mNow));
+        fleet.run(100);
+    }
+    for (uint32_t t = 0; (t < 20000) && !fleet.complete(sent); t += 10)
+        fleet.run(10);
+    TEST_ASSERT_TRUE(fleet.complete(sent));
+
+    SMcastStats tx = fleet.mNodes[0]->stats();
+    uint32_t nacks = 0;
+    for (int r = 1; r <= FLEET_SIZE; r++)
+    {
+        SMcastStats rx = fleet.mNodes[r]->stats();
+        TEST_ASSERT_EQUAL(0, rx.lost);
+        TEST_ASSERT_EQUAL(0, rx.incomplete);
+        nacks += rx.nacksSent;
+    }
+    TEST_ASSERT_GREATER_THAN(0, tx.repairs);
+    ESP_LOGI(TAG, "%d receivers, 10%% loss: %u chunks, %u repairs, %u nacks, %u heartbeats, %u packets on air",
+             FLEET_SIZE, (unsigned)tx.chunks, (unsigned)tx.repairs, (unsigned)nacks, (unsigned)tx.heartbeats,
+             (unsigned)fleet.mAir);
+}
+
+TEST_CASE("CMulticastChannel repairs a common loss once for the whole fleet", "[wifi_chn]")
+{
+    CFleet fleet(FLEET_SIZE);
+    // Chunk 1 of the message is lost by every receiver on first transmission.
+    bool dropped[FLEET_SIZE + 1] = {};
+    fleet.mDrop = [&dropped](int to, const uint8_t *d, size_t l)
+    {
+        if ((to == 0) || (d[0] != (uint8_t)EMcastType::Data) || ((d[2] | (d[3] << 8)) != 1) || dropped[to])
+            return false;
+        dropped[to] = true;
+        return true;
+    };
+    std::vector<std::vector<uint8_t>> sent = {make_message(4 * MCAST_CHUNK, 7)};
+    fleet.mNodes[0]->send(sent[0].data(), sent[0].size(), fleet.mNow);
+    fleet.run(500);
+    TEST_ASSERT_TRUE(fleet.complete(sent));
+    SMcastStats tx = fleet.mNodes[0]->stats();
+    // Receivers whose NACK delay has not expired hear the repair and stay silent.
+    TEST_ASSERT_GREATER_THAN(0, tx.nacksRecv);
+    TEST_ASSERT_LESS_OR_EQUAL(FLEET_SIZE, tx.nacksRecv);
+    TEST_ASSERT_EQUAL(1, tx.repairs);
+}
+
+TEST_CASE("CMulticastChannel detects tail loss by heartbeat", "[wifi_chn]")
+{
+    CFleet fleet(2);
+    // The last chunk never reaches receiver 1 on first transmission.
+    bool dropped = false;
+    fleet.mDrop = [&dropped](int to, const uint8_t *d, size_t l)
+    {
+        if ((to != 1) || (d[0] != (uint8_t)EMcastType::Data) || ((d[2] | (d[3] << 8)) != 2) || dropped)
+            return false;
+        dropped = true;
+        return true;
+    };
+    std::vector<std::vector<uint8_t>> sent = {make_message(2 * MCAST_CHUNK + 1, 9)};
+    fleet.mNodes[0]->send(sent[0].data(), sent[0].size(), fleet.mNow);
+    fleet.run(500);
+    TEST_ASSERT_TRUE(fleet.complete(sent));
+    TEST_ASSERT_GREATER_THAN(0, fleet.mNodes[0]->stats().heartbeats);
+    TEST_ASSERT_EQUAL(1, fleet.mNodes[1]->stats().nacksSent);
+}
+
+TEST_CASE("CMulticastChannel stops waiting for chunks gone from history", "[wifi_chn]")
+{
+    CFleet fleet(1, 4);
+    // Receiver misses message 1 entirely; the burst pushes it out of the sender's history.
+    fleet.mDrop = [](int to, const uint8_t *d, size_t l)
+    { return (to == 1) && (d[0] == (uint8_t)EMcastType::Data) && ((d[8] | (d[9] << 8)) == 1); };
+    std::vector<std::vector<uint8_t>> sent;
+    for (uint8_t i = 0; i < 7; i++)
+    {
+        sent.push_back(make_message(MCAST_CHUNK, i));
+        fleet.mNodes[0]->send(sent.back().data(), sent.back().size(), fleet.mNow);
+    }
+    fleet.run(1000);
+    SMcastStats rx = fleet.mNodes[1]->stats();
+    TEST_ASSERT_EQUAL(6, rx.delivered);
+    TEST_ASSERT_EQUAL(1, rx.lost);
+    TEST_ASSERT_EQUAL(-1, fleet.mNodes[0]->send(nullptr, 5 * MCAST_CHUNK, fleet.mNow));
+}
+
+#endif // CONFIG_WIFICHN_MCAST
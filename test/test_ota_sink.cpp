@@ -0,0 +1,253 @@
+/*!
+    \file
+    \brief Unit test for COtaPipeline with pluggable sinks: an image streamed into a
+           file on SPIFFS and into a callback, with writeEvent windows counted.
+           Runs without WiFi; needs a "spiffs" data partition for the file sink.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_OTA
+
+#include <cstdio>
+#include <string>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_spiffs.h"
+#include "mbedtls/sha256.h"
+#include "hal/efuse_hal.h"
+#include "COtaPipeline.h"
+
+static const char *TAG = "test_ota_sink";
+static const char *BASE_PATH = "/ota_test";
+static const char *FILE_PATH = "/ota_test/image.bin";
+static const size_t IMAGE_SIZE = 96 * 1024;
+static const size_t CHUNK_SIZE = 32 * 1024;
+static const size_t READ_SIZE = 4096; // as COTATask reads from esp_http_client
+
+static uint32_t s_locks = 0;
+static int s_depth = 0;
+static size_t s_received = 0;
+static uint8_t s_hash[32];
+static mbedtls_sha256_context s_ctx;
+static int s_end = -1;
+
+static void countWriteEvent(bool lock)
+{
+    if (lock)
+    {
+        s_locks++;
+        s_depth++;
+    }
+    else
+    {
+        s_depth--;
+    }
+}
+
+static bool onData(const uint8_t *data, size_t len, void *arg)
+{
+    mbedtls_sha256_update(&s_ctx, data, len);
+    s_received += len;
+    return true;
+}
+
+static bool onEnd(bool ok, void *arg)
+{
+    s_end = ok ? 1 : 0;
+    mbedtls_sha256_finish(&s_ctx, s_hash);
+    return true;
+}
+
+static uint8_t *makeImage()
+{
+    uint8_t *img = (uint8_t *)heap_caps_malloc(IMAGE_SIZE, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(img);
+    for (size_t i = 0; i < IMAGE_SIZE; i++)
+        img[i] = (uint8_t)(i * 13 + i / 511);
+    return img;
+}
+
+static std::string makeManifest(const uint8_t *img)
+{
+    char hex[65];
+    uint8_t hash[32];
+    auto toHex = [&hex](const uint8_t *h)
+    {
+        for (int i = 0; i < 32; i++)
+            snprintf(hex + 2 * i, 3, "%02x", h[i]);
+        return std::string(hex);
+    };
+    mbedtls_sha256(img, IMAGE_SIZE, hash, 0);
+    std::string manifest = "{\"size\":" + std::to_string(IMAGE_SIZE) + ",\"chunk\":" + std::to_string(CHUNK_SIZE) +
+                           ",\"sha256\":\"" + toHex(hash) + "\",\"chunks\":[";
+    for (size_t pos = 0; pos < IMAGE_SIZE; pos += CHUNK_SIZE)
+    {
+        mbedtls_sha256(img + pos, CHUNK_SIZE, hash, 0);
+        manifest += ((pos == 0) ? "\"" : ",\"") + toHex(hash) + "\"";
+    }
+    return manifest + "]}";
+}
+
+static int16_t stream(COtaSink *sink, const uint8_t *img, const std::string *manifest)
+{
+    std::atomic<bool> cancel{false};
+    COtaPipeline pipe(sink, countWriteEvent, cancel, nullptr, MALLOC_CAP_DEFAULT, READ_SIZE);
+    if (manifest != nullptr)
+        TEST_ASSERT_TRUE(pipe.verifier().loadManifest(manifest->data(), manifest->size()));
+    int16_t res = pipe.begin(IMAGE_SIZE);
+    for (size_t pos = 0; (pos < IMAGE_SIZE) && (res == OTA_STATUS_OK); pos += READ_SIZE)
+        res = pipe.feed(img + pos, READ_SIZE);
+    return pipe.end(res);
+}
+
+/// The image must land in the target file only after it is complete, inside writeEvent windows.
+TEST_CASE("COtaFileSink via pipeline", "[wifi_chn]")
+{
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = BASE_PATH,
+        .partition_label = nullptr,
+        .max_files = 2,
+        .format_if_mount_failed = true,
+    };
+    if (ESP_OK != esp_vfs_spiffs_register(&conf))
+        TEST_IGNORE_MESSAGE("no spiffs partition");
+
+    uint8_t *img = makeImage();
+    std::string manifest = makeManifest(img);
+    remove(FILE_PATH);
+
+    s_locks = 0;
+    s_depth = 0;
+    COtaFileSink sink(FILE_PATH);
+    int64_t t = esp_timer_get_time();
+    TEST_ASSERT_EQUAL(OTA_STATUS_OK, stream(&sink, img, &manifest));
+    t = esp_timer_get_time() - t;
+    TEST_ASSERT_EQUAL(0, s_depth);
+    TEST_ASSERT_GREATER_THAN(0, s_locks);
+
+    SOtaSinkStats st;
+    sink.stats(st);
+    TEST_ASSERT_EQUAL_UINT32(s_locks, st.locks);
+    ESP_LOGI(TAG, "file: %lu KB/s, windows %lu, max %lu us", (unsigned long)((IMAGE_SIZE * 1000) / (t * 1024 / 1000 + 1)),
+             (unsigned long)st.locks, (unsigned long)st.maxLock);
+
+    FILE *f = fopen(FILE_PATH, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    uint8_t buf[READ_SIZE];
+    for (size_t pos = 0; pos < IMAGE_SIZE; pos += READ_SIZE)
+    {
+        TEST_ASSERT_EQUAL(READ_SIZE, fread(buf, 1, READ_SIZE, f));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(img + pos, buf, READ_SIZE);
+    }
+    fclose(f);
+
+    // An existing image is replaced without a window where neither file is present.
+    COtaFileSink again(FILE_PATH);
+    TEST_ASSERT_EQUAL(OTA_STATUS_OK, stream(&again, img, &manifest));
+    TEST_ASSERT_NULL(fopen((std::string(FILE_PATH) + ".bak").c_str(), "rb"));
+    TEST_ASSERT_EQUAL(0, rename(FILE_PATH, (std::string(FILE_PATH) + ".bak").c_str()));
+    // Power lost after the old image was moved aside: the sink brings it back.
+    COtaFileSink restored(FILE_PATH);
+    f = fopen(FILE_PATH, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    fclose(f);
+
+    // A corrupted chunk aborts the stream and leaves neither the temporary nor a new target file.
+    remove(FILE_PATH);
+    img[CHUNK_SIZE + 10] ^= 0x01;
+    COtaFileSink bad(FILE_PATH);
+    TEST_ASSERT_EQUAL(OTA_STATUS_ERR_VERIFY, stream(&bad, img, &manifest));
+    TEST_ASSERT_EQUAL(0, s_depth);
+    TEST_ASSERT_NULL(fopen(FILE_PATH, "rb"));
+    TEST_ASSERT_NULL(fopen((std::string(FILE_PATH) + ".tmp").c_str(), "rb"));
+
+    heap_caps_free(img);
+    esp_vfs_spiffs_unregister(nullptr);
+}
+
+/// A callback sink receives the whole image and is told the outcome.
+TEST_CASE("COtaCallbackSink via pipeline", "[wifi_chn]")
+{
+    uint8_t *img = makeImage();
+    std::string manifest = makeManifest(img);
+    uint8_t hash[32];
+    mbedtls_sha256(img, IMAGE_SIZE, hash, 0);
+
+    COtaCallbackSink sink(onData, onEnd);
+    s_received = 0;
+    s_end = -1;
+    mbedtls_sha256_init(&s_ctx);
+    mbedtls_sha256_starts(&s_ctx, 0);
+    TEST_ASSERT_EQUAL(OTA_STATUS_OK, stream(&sink, img, &manifest));
+    TEST_ASSERT_EQUAL(IMAGE_SIZE, s_received);
+    TEST_ASSERT_EQUAL(1, s_end);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(hash, s_hash, sizeof(hash));
+    mbedtls_sha256_free(&s_ctx);
+
+    // The corrupted chunk is rejected before any byte of it reaches the callback.
+    img[2 * CHUNK_SIZE + 10] ^= 0x01;
+    s_received = 0;
+    s_end = -1;
+    mbedtls_sha256_init(&s_ctx);
+    mbedtls_sha256_starts(&s_ctx, 0);
+    TEST_ASSERT_EQUAL(OTA_STATUS_ERR_VERIFY, stream(&sink, img, &manifest));
+    TEST_ASSERT_EQUAL(0, s_end);
+    TEST_ASSERT_EQUAL(2 * CHUNK_SIZE, s_received);
+    mbedtls_sha256_free(&s_ctx);
+
+    heap_caps_free(img);
+}
+
+/// An image built for another chip or revision range is refused from its header, before any write,
+/// with the bootloader's rules for an unset maximum revision.
+TEST_CASE("COtaAppSink checks chip id and revision", "[wifi_chn]")
+{
+    uint16_t rev = (uint16_t)efuse_hal_chip_revision();
+    uint8_t head[sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t)] = {};
+    esp_image_header_t *img = (esp_image_header_t *)head;
+    esp_app_desc_t *desc = (esp_app_desc_t *)(head + sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t));
+    img->magic = ESP_IMAGE_HEADER_MAGIC;
+    img->chip_id = CONFIG_IDF_FIRMWARE_CHIP_ID;
+    img->min_chip_rev_full = 0;
+    img->max_chip_rev_full = rev;
+    desc->magic_word = ESP_APP_DESC_MAGIC_WORD;
+
+    COtaAppSink ok;
+    // The header may arrive split across reads: nothing is decided until it is complete.
+    TEST_ASSERT_EQUAL(OTA_STATUS_OK, ok.inspect(0, head, 10));
+    TEST_ASSERT_EQUAL(OTA_STATUS_OK, ok.inspect(10, head + 10, sizeof(head) - 10));
+
+    img->chip_id = CONFIG_IDF_FIRMWARE_CHIP_ID + 1;
+    COtaAppSink chip;
+    TEST_ASSERT_EQUAL(OTA_STATUS_ERR_CHIP, chip.inspect(0, head, sizeof(head)));
+
+    img->chip_id = CONFIG_IDF_FIRMWARE_CHIP_ID;
+    img->min_chip_rev_full = rev + 1;
+    img->max_chip_rev_full = rev + 100;
+    COtaAppSink newer;
+    TEST_ASSERT_EQUAL(OTA_STATUS_ERR_CHIP, newer.inspect(0, head, sizeof(head)));
+
+    // No maximum in the header (older IDF images): any revision from the minimum up is accepted.
+    img->min_chip_rev_full = 0;
+    for (uint16_t unset : {(uint16_t)0, (uint16_t)0xFFFF})
+    {
+        img->max_chip_rev_full = unset;
+        COtaAppSink open;
+        TEST_ASSERT_EQUAL(OTA_STATUS_OK, open.inspect(0, head, sizeof(head)));
+    }
+
+    // A maximum below this chip is enforced unless the efuse lifts the major version limit.
+    if ((rev > 1) && !efuse_hal_get_disable_wafer_version_major())
+    {
+        img->max_chip_rev_full = rev - 1;
+        COtaAppSink older;
+        TEST_ASSERT_EQUAL(OTA_STATUS_ERR_CHIP, older.inspect(0, head, sizeof(head)));
+    }
+}
+
+#endif // CONFIG_WIFICHN_OTA
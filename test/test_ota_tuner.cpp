@@ -0,0 +1,74 @@
+/*!
+    \file
+    \brief Unit test for COtaTuner: the read size with the best simulated throughput
+           is chosen and kept in NVS. Runs without WiFi.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_OTA
+
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "nvs_flash.h"
+#include "COtaTuner.h"
+
+static const char *TAG = "test_ota_tuner";
+
+/// Simulated link: per-read overhead dominates small reads, large reads stall on the TCP window.
+static int64_t readTime(size_t len)
+{
+    int64_t t = 1000 + (int64_t)len * 1000000 / (1000 * 1024);
+    if (len > 8192)
+        t += (int64_t)(len - 8192) * 1000000 / (200 * 1024);
+    return t;
+}
+
+TEST_CASE("COtaTuner picks and stores the fastest read size", "[wifi_chn]")
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
+    COtaTuner::reset();
+    TEST_ASSERT_EQUAL(0, COtaTuner::stored());
+
+    COtaTuner tuner;
+    size_t bufSize = tuner.prepare(4096, MALLOC_CAP_DEFAULT);
+    if (!tuner.isActive())
+        TEST_IGNORE_MESSAGE("not enough heap for two read sizes");
+    TEST_ASSERT_EQUAL(tuner.readSize(), bufSize);
+
+    size_t total = 0;
+    while (tuner.isActive())
+    {
+        size_t n = tuner.readSize();
+        TEST_ASSERT_LESS_OR_EQUAL(bufSize, n);
+        tuner.account(n, readTime(n));
+        total += n;
+        TEST_ASSERT_LESS_THAN(2 * 1024 * 1024, total);
+    }
+    for (uint8_t i = 0; i < tuner.count(); i++)
+        ESP_LOGI(TAG, "variant %u: %lu B/s", i, (unsigned long)tuner.rate(i));
+    ESP_LOGI(TAG, "tuned after %u bytes", (unsigned)total);
+
+    size_t expected = (bufSize >= 8192) ? 8192 : bufSize;
+    TEST_ASSERT_EQUAL(expected, tuner.best());
+    TEST_ASSERT_EQUAL(expected, COtaTuner::stored());
+
+    // The next transfer takes the stored size without tuning.
+    COtaTuner next;
+    TEST_ASSERT_EQUAL(expected, next.prepare(4096, MALLOC_CAP_DEFAULT));
+    TEST_ASSERT_FALSE(next.isActive());
+    TEST_ASSERT_EQUAL(expected, next.readSize());
+
+    COtaTuner::reset();
+    TEST_ASSERT_EQUAL(0, COtaTuner::stored());
+}
+
+#endif // CONFIG_WIFICHN_OTA
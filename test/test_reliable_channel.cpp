@@ -0,0 +1,229 @@
+/*!
+    \file
+    \brief Loopback test for CReliableChannel: two channels joined by a simulated link
+           with injected loss, delay and jitter on a simulated clock, plus a
+           latency/throughput benchmark. Runs without WiFi.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_RUDP
+
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "CReliableChannel.h"
+#include <vector>
+#include <functional>
+#include <cstring>
+
+static const char *TAG = "test_rudp";
+
+/// Simulated link between two channels.
+class CLoopback
+{
+public:
+    typedef std::function<bool(int to, const uint8_t *data, size_t len)> TDrop;
+
+    struct SPacket
+    {
+        uint32_t at;
+        int to;
+        std::vector<uint8_t> data;
+    };
+
+    CReliableChannel *mPeer[2] = {nullptr, nullptr};
+    std::vector<SPacket> mQueue;
+    uint32_t mNow = 0;
+    uint32_t mSeed = 12345;
+    uint32_t mLossPct = 0;
+    uint32_t mDelay = 1;
+    uint32_t mJitter = 0;
+    TDrop mDrop;
+    uint32_t mPackets = 0;
+
+    uint32_t rnd()
+    {
+        mSeed = mSeed * 1103515245 + 12345;
+        return (mSeed >> 16) & 0x7fff;
+    }
+
+    void send(int to, const uint8_t *data, size_t len)
+    {
+        mPackets++;
+        if ((mLossPct != 0) && (rnd() % 100 < mLossPct))
+            return;
+        if (mDrop && mDrop(to, data, len))
+            return;
+        uint32_t delay = mDelay + ((mJitter != 0) ? rnd() % (mJitter + 1) : 0);
+        mQueue.push_back({mNow + delay, to, std::vector<uint8_t>(data, data + len)});
+    }
+
+    void step()
+    {
+        mNow++;
+        // Packets due now are delivered in queue order; reordering comes from jitter only.
+        std::vector<SPacket> due;
+        for (size_t i = 0; i < mQueue.size();)
+        {
+            if ((int32_t)(mQueue[i].at - mNow) <= 0)
+            {
+                due.push_back(std::move(mQueue[i]));
+                mQueue.erase(mQueue.begin() + i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+        for (auto &p : due)
+            mPeer[p.to]->input(p.data.data(), p.data.size(), mNow);
+        mPeer[0]->poll(mNow);
+        mPeer[1]->poll(mNow);
+    }
+};
+
+/// Message: index and send time.
+struct SMsg
+{
+    uint32_t index;
+    uint32_t sent;
+};
+
+struct SResult
+{
+    uint32_t delivered = 0;
+    uint32_t duplicates = 0;
+    uint32_t latencySum = 0;
+    uint32_t latencyMax = 0;
+    uint32_t elapsed = 0;
+    SRudpStats tx = {};
+    SRudpStats rx = {};
+};
+
+/// Send count messages of size bytes from channel 0 to channel 1.
+static SResult run_transfer(CLoopback &link, uint8_t fecGroup, uint32_t count, size_t size, uint32_t limit_ms)
+{
+    SResult res;
+    std::vector<uint8_t> seen(count, 0);
+    CReliableChannel a([&link](const uint8_t *d, size_t l)
+                       { link.send(1, d, l); }, [](const uint8_t *, size_t) {}, fecGroup);
+    CReliableChannel b([&link](const uint8_t *d, size_t l)
+                       { link.send(0, d, l); }, [&](const uint8_t *d, size_t l)
+                       {
+                           SMsg m;
+                           std::memcpy(&m, d, sizeof(m));
+                           TEST_ASSERT_EQUAL(size, l);
+                           TEST_ASSERT_LESS_THAN(count, m.index);
+                           if (seen[m.index]++ != 0)
+                               res.duplicates++;
+                           uint32_t lat = link.mNow - m.sent;
+                           res.latencySum += lat;
+                           if (lat > res.latencyMax)
+                               res.latencyMax = lat;
+                           res.delivered++; }, fecGroup);
+    TEST_ASSERT_TRUE(a.isValid());
+    TEST_ASSERT_TRUE(b.isValid());
+    link.mPeer[0] = &a;
+    link.mPeer[1] = &b;
+
+    std::vector<uint8_t> payload(size, 0x5a);
+    uint32_t next = 0;
+    uint32_t start = link.mNow;
+    while ((res.delivered < count) && (link.mNow - start < limit_ms))
+    {
+        while ((next < count) && a.canSend())
+        {
+            SMsg m = {next, link.mNow};
+            std::memcpy(payload.data(), &m, sizeof(m));
+            TEST_ASSERT_TRUE(a.send(payload.data(), size, link.mNow));
+            next++;
+        }
+        link.step();
+    }
+    res.elapsed = link.mNow - start;
+    res.tx = a.stats();
+    res.rx = b.stats();
+    link.mPeer[0] = nullptr;
+    link.mPeer[1] = nullptr;
+    link.mQueue.clear();
+    return res;
+}
+
+TEST_CASE("CReliableChannel delivers every message once under loss", "[wifi_chn]")
+{
+    CLoopback link;
+    link.mLossPct = 15;
+    link.mDelay = 3;
+    link.mJitter = 4; // reordering
+    SResult r = run_transfer(link, 0, 500, 64, 120000);
+    TEST_ASSERT_EQUAL(500, r.delivered);
+    TEST_ASSERT_EQUAL(0, r.duplicates);
+    TEST_ASSERT_EQUAL(0, r.tx.lost);
+    TEST_ASSERT_GREATER_THAN(0, r.tx.retransmits + r.tx.fastRetransmits);
+    TEST_ASSERT_GREATER_THAN(0, r.tx.srtt);
+    ESP_LOGI(TAG, "15%% loss: %u ms, rtx %u, fast %u, srtt %u ms, rto %u ms", (unsigned)r.elapsed,
+             (unsigned)r.tx.retransmits, (unsigned)r.tx.fastRetransmits, r.tx.srtt, r.tx.rto);
+}
+
+TEST_CASE("CReliableChannel FEC repairs one loss per group", "[wifi_chn]")
+{
+    CLoopback link;
+    link.mDelay = 2;
+    // Drop the first transmission of every second message of each group of 4.
+    std::vector<uint8_t> dropped(65536, 0);
+    link.mDrop = [&dropped](int to, const uint8_t *d, size_t l)
+    {
+        if ((to != 1) || (d[0] != (uint8_t)ERudpType::Data))
+            return false;
+        uint16_t seq = d[2] | (d[3] << 8);
+        if ((seq % 4 != 1) || dropped[seq])
+            return false;
+        dropped[seq] = 1;
+        return true;
+    };
+    SResult r = run_transfer(link, 4, 200, 100, 10000);
+    TEST_ASSERT_EQUAL(200, r.delivered);
+    TEST_ASSERT_EQUAL(50, r.rx.fecRecovered);
+    TEST_ASSERT_EQUAL(0, r.tx.retransmits);
+    TEST_ASSERT_EQUAL(0, r.tx.fastRetransmits);
+    TEST_ASSERT_EQUAL(50, r.tx.fecSent);
+}
+
+TEST_CASE("CReliableChannel gives up after max retries", "[wifi_chn]")
+{
+    CLoopback link;
+    link.mDelay = 2;
+    // Message 3 never gets through: it is abandoned, the rest still arrive.
+    link.mDrop = [](int to, const uint8_t *d, size_t l)
+    { return (to == 1) && (d[0] == (uint8_t)ERudpType::Data) && ((d[2] | (d[3] << 8)) == 3); };
+    SResult r = run_transfer(link, 0, 50, 32, 60000);
+    TEST_ASSERT_EQUAL(49, r.delivered);
+    TEST_ASSERT_EQUAL(1, r.tx.lost);
+    TEST_ASSERT_GREATER_THAN(0, r.tx.retransmits);
+}
+
+TEST_CASE("CReliableChannel benchmark", "[wifi_chn]")
+{
+    const uint32_t count = 2000;
+    const uint8_t groups[2] = {0, 4};
+    for (uint8_t fec : groups)
+    {
+        CLoopback link;
+        link.mLossPct = 5;
+        link.mDelay = 4;
+        link.mJitter = 2;
+        int64_t t0 = esp_timer_get_time();
+        SResult r = run_transfer(link, fec, count, 200, 600000);
+        int64_t cpu = esp_timer_get_time() - t0;
+        TEST_ASSERT_EQUAL(count, r.delivered);
+        ESP_LOGI(TAG, "fec %u, 5%% loss, 4..6 ms one way: %u msg/s, latency avg %u max %u ms, "
+                      "rtx %u+%u, fec %u/%u, packets %u, cpu %lld us/msg",
+                 fec, (unsigned)(count * 1000ULL / (r.elapsed ? r.elapsed : 1)), (unsigned)(r.latencySum / count),
+                 (unsigned)r.latencyMax, (unsigned)r.tx.retransmits, (unsigned)r.tx.fastRetransmits,
+                 (unsigned)r.rx.fecRecovered, (unsigned)r.tx.fecSent, (unsigned)link.mPackets, (long long)(cpu / count));
+    }
+}
+
+#endif // CONFIG_WIFICHN_RUDP
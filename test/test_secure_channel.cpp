@@ -0,0 +1,353 @@
+/*!
+    \file
+    \brief Test for CSecureChannel and CSecureKeyExchange: round trip, tampering,
+           replay window, PSK session nonces and X25519 keys, plus a per-packet cost and
+           handshake benchmark against mbedtls TLS-PSK over an in-memory pipe.
+           Runs without WiFi.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_SECURE
+
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "CSecureChannel.h"
+#include "mbedtls/ssl.h"
+#include <vector>
+#include <cstring>
+
+static const char *TAG = "test_secure";
+
+static const uint8_t PSK[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+
+/// Device and gateway keyed with the same PSK and fresh session nonces.
+static void make_pair(CSecureChannel &dev, CSecureChannel &gw)
+{
+    uint8_t nonceDev[SECURE_NONCE_SIZE], nonceGw[SECURE_NONCE_SIZE];
+    CSecureChannel::makeNonce(nonceDev);
+    CSecureChannel::makeNonce(nonceGw);
+    TEST_ASSERT_EQUAL(ESP_OK, dev.setSessionKey(PSK, sizeof(PSK), ESecureRole::Initiator, nonceDev, nonceGw));
+    TEST_ASSERT_EQUAL(ESP_OK, gw.setSessionKey(PSK, sizeof(PSK), ESecureRole::Responder, nonceDev, nonceGw));
+}
+
+/// Seals len bytes of pattern into rec; returns the record length.
+static size_t seal_pattern(CSecureChannel &ch, std::vector<uint8_t> &rec, size_t len, uint8_t seed)
+{
+    rec.assign(len + SECURE_OVERHEAD, 0);
+    for (size_t i = 0; i < len; i++)
+        rec[SECURE_HEADER_SIZE + i] = (uint8_t)(seed + i);
+    return ch.seal(rec.data(), len, rec.size());
+}
+
+TEST_CASE("CSecureChannel round trip and tampering", "[wifi_chn]")
+{
+    CSecureChannel dev, gw;
+    std::vector<uint8_t> rec(64);
+    TEST_ASSERT_EQUAL(0, dev.seal(rec.data(), 10, rec.size())); // no key yet
+    make_pair(dev, gw);
+
+    for (size_t len : {0u, 1u, 100u, 1400u})
+    {
+        size_t n = seal_pattern(dev, rec, len, (uint8_t)len);
+        TEST_ASSERT_EQUAL(len + SECURE_OVERHEAD, n);
+        size_t same = 0;
+        for (size_t i = 0; i < len; i++)
+            same += (rec[SECURE_HEADER_SIZE + i] == (uint8_t)(len + i));
+        TEST_ASSERT_LESS_THAN(len / 16 + 2, same); // encrypted in place
+        TEST_ASSERT_TRUE(gw.open(rec.data(), n));
+        TEST_ASSERT_EQUAL(len, n);
+        for (size_t i = 0; i < len; i++)
+            TEST_ASSERT_EQUAL((uint8_t)(len + i), rec[SECURE_HEADER_SIZE + i]);
+    }
+    // The other direction has its own key and numbering.
+    size_t n = seal_pattern(gw, rec, 20, 7);
+    TEST_ASSERT_EQUAL(0, rec[0]);
+    TEST_ASSERT_TRUE(dev.open(rec.data(), n));
+
+    // A flipped bit anywhere (number, data, tag) fails authentication.
+    for (size_t pos : {0u, 9u, 40u})
+    {
+        n = seal_pattern(dev, rec, 20, 1);
+        rec[pos] ^= 0x10;
+        TEST_ASSERT_FALSE(gw.open(rec.data(), n));
+    }
+    TEST_ASSERT_EQUAL(3, gw.stats().authFailed);
+    // Own records are not accepted back (reflection).
+    n = seal_pattern(dev, rec, 20, 1);
+    TEST_ASSERT_FALSE(dev.open(rec.data(), n));
+    n = 5;
+    TEST_ASSERT_FALSE(gw.open(rec.data(), n));
+    TEST_ASSERT_EQUAL(1, gw.stats().malformed);
+    TEST_ASSERT_EQUAL(0, dev.seal(rec.data(), 10, 10 + SECURE_OVERHEAD - 1)); // buffer too small
+
+    CSecureChannel other;
+    TEST_ASSERT_EQUAL(ESP_OK, other.setKey(PSK, sizeof(PSK), ESecureRole::Responder, (const uint8_t *)"gw-2", 4));
+    n = seal_pattern(dev, rec, 20, 1);
+    TEST_ASSERT_FALSE(other.open(rec.data(), n)); // different context, different keys
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, other.setKey(PSK, 8, ESecureRole::Responder));
+    TEST_ASSERT_FALSE(other.isKeyed());
+}
+
+TEST_CASE("CSecureChannel replay window", "[wifi_chn]")
+{
+    CSecureChannel dev, gw;
+    make_pair(dev, gw);
+    std::vector<std::vector<uint8_t>> recs(200);
+    for (auto &r : recs)
+        seal_pattern(dev, r, 16, 0);
+
+    auto deliver = [&gw, &recs](size_t i)
+    {
+        std::vector<uint8_t> r = recs[i]; // open() decrypts in place
+        size_t n = r.size();
+        return gw.open(r.data(), n);
+    };
+    TEST_ASSERT_TRUE(deliver(5));
+    TEST_ASSERT_TRUE(deliver(0)); // late, inside the window
+    TEST_ASSERT_FALSE(deliver(5));
+    TEST_ASSERT_FALSE(deliver(0));
+    TEST_ASSERT_TRUE(deliver(69));
+    TEST_ASSERT_TRUE(deliver(6));   // 63 behind
+    TEST_ASSERT_FALSE(deliver(5));  // 64 behind: out of the window
+    TEST_ASSERT_TRUE(deliver(68));
+    TEST_ASSERT_TRUE(deliver(199)); // jump clears the window
+    TEST_ASSERT_FALSE(deliver(135));
+    TEST_ASSERT_TRUE(deliver(136));
+    TEST_ASSERT_EQUAL(4, gw.stats().replayed);
+
+    // A forged record with a far-ahead number must not move the window.
+    std::vector<uint8_t> forged = recs[150];
+    forged[0] = 0xff;
+    forged[7] = 0x7f;
+    size_t n = forged.size();
+    TEST_ASSERT_FALSE(gw.open(forged.data(), n));
+    TEST_ASSERT_TRUE(deliver(150));
+    TEST_ASSERT_EQUAL(8, gw.stats().opened);
+}
+
+/// Re-keying with the same PSK (e.g. after a reboot) must not reuse GCM keys and nonces.
+TEST_CASE("CSecureChannel PSK sessions do not repeat records", "[wifi_chn]")
+{
+    CSecureChannel dev, gw;
+    std::vector<uint8_t> first, second;
+
+    // Raw PSK keying is single-use: the same secret gives the same keystream.
+    TEST_ASSERT_EQUAL(ESP_OK, dev.setKey(PSK, sizeof(PSK), ESecureRole::Initiator));
+    size_t n1 = seal_pattern(dev, first, 32, 3);
+    TEST_ASSERT_EQUAL(ESP_OK, dev.setKey(PSK, sizeof(PSK), ESecureRole::Initiator));
+    size_t n2 = seal_pattern(dev, second, 32, 3);
+    TEST_ASSERT_EQUAL(n1, n2);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(first.data(), second.data(), n1);
+
+    // Session nonces exchanged before keying give fresh keys for every session.
+    for (int session = 0; session < 2; session++)
+    {
+        uint8_t nonceDev[SECURE_NONCE_SIZE], nonceGw[SECURE_NONCE_SIZE];
+        CSecureChannel::makeNonce(nonceDev);
+        CSecureChannel::makeNonce(nonceGw);
+        TEST_ASSERT_EQUAL(ESP_OK, dev.setSessionKey(PSK, sizeof(PSK), ESecureRole::Initiator, nonceDev, nonceGw));
+        TEST_ASSERT_EQUAL(ESP_OK, gw.setSessionKey(PSK, sizeof(PSK), ESecureRole::Responder, nonceDev, nonceGw));
+        std::vector<uint8_t> &rec = (session == 0) ? first : second;
+        size_t n = seal_pattern(dev, rec, 32, 3);
+        TEST_ASSERT_EQUAL(32 + SECURE_OVERHEAD, n);
+        std::vector<uint8_t> copy = rec;
+        TEST_ASSERT_TRUE(gw.open(copy.data(), n));
+        TEST_ASSERT_EQUAL(32, n);
+    }
+    // Same number and plaintext, different ciphertext and tag.
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(first.data(), second.data(), SECURE_HEADER_SIZE);
+    TEST_ASSERT_NOT_EQUAL(0, memcmp(first.data() + SECURE_HEADER_SIZE, second.data() + SECURE_HEADER_SIZE, 32 + SECURE_TAG_SIZE));
+    // A record of the previous session is not accepted by the new one.
+    size_t n = first.size();
+    TEST_ASSERT_FALSE(gw.open(first.data(), n));
+
+    uint8_t nonce[SECURE_NONCE_SIZE] = {};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dev.setSessionKey(PSK, sizeof(PSK), ESecureRole::Initiator, nonce, nullptr));
+    TEST_ASSERT_FALSE(dev.isKeyed());
+}
+
+TEST_CASE("CSecureKeyExchange derives matching keys", "[wifi_chn]")
+{
+    uint8_t pubDev[SECURE_PUBLIC_SIZE], pubGw[SECURE_PUBLIC_SIZE];
+    uint8_t sDev[SECURE_SECRET_SIZE], sGw[SECURE_SECRET_SIZE];
+    CSecureKeyExchange kDev, kGw;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, kDev.finish(pubGw, ESecureRole::Initiator, nullptr, 0, sDev));
+    TEST_ASSERT_EQUAL(ESP_OK, kDev.begin(pubDev));
+    TEST_ASSERT_EQUAL(ESP_OK, kGw.begin(pubGw));
+    TEST_ASSERT_TRUE(std::memcmp(pubDev, pubGw, SECURE_PUBLIC_SIZE) != 0);
+    TEST_ASSERT_EQUAL(ESP_OK, kDev.finish(pubGw, ESecureRole::Initiator, PSK, sizeof(PSK), sDev));
+    TEST_ASSERT_EQUAL(ESP_OK, kGw.finish(pubDev, ESecureRole::Responder, PSK, sizeof(PSK), sGw));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(sDev, sGw, SECURE_SECRET_SIZE);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, kDev.finish(pubGw, ESecureRole::Initiator, nullptr, 0, sDev)); // one shot
+
+    CSecureChannel dev, gw;
+    TEST_ASSERT_EQUAL(ESP_OK, dev.setKey(sDev, sizeof(sDev), ESecureRole::Initiator));
+    TEST_ASSERT_EQUAL(ESP_OK, gw.setKey(sGw, sizeof(sGw), ESecureRole::Responder));
+    std::vector<uint8_t> rec;
+    size_t n = seal_pattern(dev, rec, 100, 3);
+    TEST_ASSERT_TRUE(gw.open(rec.data(), n));
+
+    // Different PSK (or a substituted public key) gives a different secret.
+    TEST_ASSERT_EQUAL(ESP_OK, kDev.begin(pubDev));
+    TEST_ASSERT_EQUAL(ESP_OK, kGw.begin(pubGw));
+    TEST_ASSERT_EQUAL(ESP_OK, kDev.finish(pubGw, ESecureRole::Initiator, PSK, sizeof(PSK), sDev));
+    TEST_ASSERT_EQUAL(ESP_OK, kGw.finish(pubDev, ESecureRole::Responder, PSK, sizeof(PSK) - 1, sGw));
+    TEST_ASSERT_TRUE(std::memcmp(sDev, sGw, SECURE_SECRET_SIZE) != 0);
+}
+
+/// In-memory byte pipe for the TLS comparison.
+struct SPipe
+{
+    std::vector<uint8_t> data;
+    size_t pos = 0;
+};
+
+static int pipe_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    SPipe *p = (SPipe *)ctx;
+    p->data.insert(p->data.end(), buf, buf + len);
+    return (int)len;
+}
+
+static int pipe_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    SPipe *p = (SPipe *)ctx;
+    size_t n = std::min(len, p->data.size() - p->pos);
+    if (n == 0)
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    std::memcpy(buf, p->data.data() + p->pos, n);
+    p->pos += n;
+    if (p->pos == p->data.size())
+    {
+        p->data.clear();
+        p->pos = 0;
+    }
+    return (int)n;
+}
+
+static int test_rng(void *ctx, unsigned char *buf, size_t len)
+{
+    esp_fill_random(buf, len);
+    return 0;
+}
+
+TEST_CASE("CSecureChannel benchmark vs TLS", "[wifi_chn]")
+{
+    const size_t sizes[] = {64, 512, 1400};
+    const uint32_t count = 2000;
+    std::vector<uint8_t> buf(1400 + SECURE_OVERHEAD);
+
+    CSecureChannel dev, gw;
+    int64_t t0 = esp_timer_get_time();
+    make_pair(dev, gw);
+    ESP_LOGI(TAG, "PSK session keys (both sides): %u us, 1 round trip, %u bytes on air", (unsigned)(esp_timer_get_time() - t0),
+             (unsigned)(2 * SECURE_NONCE_SIZE));
+
+    t0 = esp_timer_get_time();
+    uint8_t pubDev[SECURE_PUBLIC_SIZE], pubGw[SECURE_PUBLIC_SIZE];
+    uint8_t sDev[SECURE_SECRET_SIZE], sGw[SECURE_SECRET_SIZE];
+    CSecureKeyExchange kDev, kGw;
+    TEST_ASSERT_EQUAL(ESP_OK, kDev.begin(pubDev));
+    TEST_ASSERT_EQUAL(ESP_OK, kGw.begin(pubGw));
+    TEST_ASSERT_EQUAL(ESP_OK, kDev.finish(pubGw, ESecureRole::Initiator, PSK, sizeof(PSK), sDev));
+    TEST_ASSERT_EQUAL(ESP_OK, kGw.finish(pubDev, ESecureRole::Responder, PSK, sizeof(PSK), sGw));
+    TEST_ASSERT_EQUAL(ESP_OK, dev.setKey(sDev, sizeof(sDev), ESecureRole::Initiator));
+    TEST_ASSERT_EQUAL(ESP_OK, gw.setKey(sGw, sizeof(sGw), ESecureRole::Responder));
+    int64_t ecdh = esp_timer_get_time() - t0;
+    ESP_LOGI(TAG, "X25519+PSK key exchange (both sides): %u us, 1 round trip, %u bytes on air",
+             (unsigned)ecdh, 2 * SECURE_PUBLIC_SIZE);
+
+    for (size_t len : sizes)
+    {
+        t0 = esp_timer_get_time();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            size_t n = dev.seal(buf.data(), len, buf.size());
+            TEST_ASSERT_TRUE(gw.open(buf.data(), n));
+        }
+        int64_t t = esp_timer_get_time() - t0;
+        ESP_LOGI(TAG, "secure %4u bytes: %u ns/packet (seal+open), overhead %u bytes",
+                 (unsigned)len, (unsigned)(t * 1000 / count), SECURE_OVERHEAD);
+    }
+    TEST_ASSERT_EQUAL(count * 3, gw.stats().opened);
+
+#if defined(MBEDTLS_KEY_EXCHANGE_PSK_ENABLED) && defined(MBEDTLS_SSL_CLI_C) && defined(MBEDTLS_SSL_SRV_C)
+    static const int suites[] = {MBEDTLS_TLS_PSK_WITH_AES_128_GCM_SHA256, 0};
+    mbedtls_ssl_config cconf, sconf;
+    mbedtls_ssl_context cli, srv;
+    SPipe toSrv, toCli;
+    mbedtls_ssl_config_init(&cconf);
+    mbedtls_ssl_config_init(&sconf);
+    mbedtls_ssl_init(&cli);
+    mbedtls_ssl_init(&srv);
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_config_defaults(&cconf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT));
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_config_defaults(&sconf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT));
+    for (mbedtls_ssl_config *conf : {&cconf, &sconf})
+    {
+        mbedtls_ssl_conf_rng(conf, test_rng, nullptr);
+        mbedtls_ssl_conf_ciphersuites(conf, suites);
+        TEST_ASSERT_EQUAL(0, mbedtls_ssl_conf_psk(conf, PSK, sizeof(PSK), (const unsigned char *)"dev", 3));
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+        mbedtls_ssl_conf_max_tls_version(conf, MBEDTLS_SSL_VERSION_TLS1_2);
+#endif
+    }
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_setup(&cli, &cconf));
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_setup(&srv, &sconf));
+    // Each side writes into one pipe and reads the other.
+    struct SDuplex
+    {
+        SPipe *tx, *rx;
+    };
+    SDuplex dc = {&toSrv, &toCli}, ds = {&toCli, &toSrv};
+    auto dsend = [](void *ctx, const unsigned char *b, size_t l)
+    { return pipe_send(((SDuplex *)ctx)->tx, b, l); };
+    auto drecv = [](void *ctx, unsigned char *b, size_t l)
+    { return pipe_recv(((SDuplex *)ctx)->rx, b, l); };
+    mbedtls_ssl_set_bio(&cli, &dc, dsend, drecv, nullptr);
+    mbedtls_ssl_set_bio(&srv, &ds, dsend, drecv, nullptr);
+
+    t0 = esp_timer_get_time();
+    int rc = -1, rs = -1, flights = 0;
+    while ((rc != 0) || (rs != 0))
+    {
+        TEST_ASSERT_LESS_THAN(50, ++flights);
+        if (rc != 0)
+            rc = mbedtls_ssl_handshake(&cli);
+        if (rs != 0)
+            rs = mbedtls_ssl_handshake(&srv);
+        TEST_ASSERT_TRUE((rc == 0) || (rc == MBEDTLS_ERR_SSL_WANT_READ) || (rc == MBEDTLS_ERR_SSL_WANT_WRITE));
+        TEST_ASSERT_TRUE((rs == 0) || (rs == MBEDTLS_ERR_SSL_WANT_READ) || (rs == MBEDTLS_ERR_SSL_WANT_WRITE));
+    }
+    int64_t handshake = esp_timer_get_time() - t0;
+    int expansion = mbedtls_ssl_get_record_expansion(&cli);
+    ESP_LOGI(TAG, "TLS-PSK handshake (both sides): %u us, 2 round trips, record overhead %d bytes",
+             (unsigned)handshake, expansion);
+    TEST_ASSERT_GREATER_THAN(SECURE_OVERHEAD, expansion);
+
+    std::vector<uint8_t> out(1400, 0x5a), in(1400);
+    for (size_t len : sizes)
+    {
+        t0 = esp_timer_get_time();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            TEST_ASSERT_EQUAL((int)len, mbedtls_ssl_write(&cli, out.data(), len));
+            TEST_ASSERT_EQUAL((int)len, mbedtls_ssl_read(&srv, in.data(), in.size()));
+        }
+        int64_t t = esp_timer_get_time() - t0;
+        ESP_LOGI(TAG, "TLS    %4u bytes: %u ns/packet (write+read)", (unsigned)len, (unsigned)(t * 1000 / count));
+    }
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(out.data(), in.data(), 1400);
+    mbedtls_ssl_free(&cli);
+    mbedtls_ssl_free(&srv);
+    mbedtls_ssl_config_free(&cconf);
+    mbedtls_ssl_config_free(&sconf);
+#else
+    ESP_LOGI(TAG, "TLS-PSK comparison skipped: enable CONFIG_MBEDTLS_PSK_MODES and CONFIG_MBEDTLS_KEY_EXCHANGE_PSK");
+#endif
+}
+
+#endif // CONFIG_WIFICHN_SECURE
@@ -0,0 +1,145 @@
+/*!
+    \file
+    \brief Test for the self-test protocol and meters: request/report encoding,
+           loss, reordering and RFC 3550 jitter on a simulated clock, UDP pacing
+           and catch-up after a stall. Runs without WiFi.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_SELFTEST
+
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "esp_log.h"
+#include "CSelfTest.h"
+#include <vector>
+#include <cstring>
+
+static const char *TAG = "test_selftest";
+
+/// Datagram of a simulated sender.
+static std::vector<uint8_t> datagram(uint32_t seq, uint32_t ts, size_t len = 100)
+{
+    std::vector<uint8_t> d(len, 0x5a);
+    selfTestStamp(d.data(), seq, ts);
+    return d;
+}
+
+TEST_CASE("Self-test request and report encoding", "[wifi_chn]")
+{
+    SSelfTestConfig cfg;
+    cfg.mode = ESelfTestMode::UdpRecv;
+    cfg.port = 5300;
+    cfg.durationMs = 12345;
+    cfg.rateKbps = 54000;
+    cfg.block = 1200;
+    uint8_t req[SELFTEST_REQUEST_SIZE];
+    TEST_ASSERT_EQUAL(SELFTEST_REQUEST_SIZE, selfTestPackRequest(req, cfg));
+    const uint8_t expect[SELFTEST_REQUEST_SIZE] = {0x57, 0x43, 0x53, 0x54, 4, 0, 0xb4, 0x14, 0x39, 0x30, 0, 0,
+                                                   0xf0, 0xd2, 0, 0, 0xb0, 0x04, 0, 0};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expect, req, sizeof(req));
+
+    SSelfTestReport report = {0x123456789aull, 2000000, 1500, 7, 3, 450};
+    uint8_t buf[SELFTEST_REPORT_SIZE];
+    TEST_ASSERT_EQUAL(SELFTEST_REPORT_SIZE, selfTestPackReport(buf, report));
+    SSelfTestReport back;
+    TEST_ASSERT_TRUE(selfTestParseReport(buf, sizeof(buf), back));
+    TEST_ASSERT_TRUE(back.bytes == report.bytes);
+    TEST_ASSERT_EQUAL(report.elapsedUs, back.elapsedUs);
+    TEST_ASSERT_EQUAL(report.packets, back.packets);
+    TEST_ASSERT_EQUAL(report.lost, back.lost);
+    TEST_ASSERT_EQUAL(report.reordered, back.reordered);
+    TEST_ASSERT_EQUAL(report.jitterUs, back.jitterUs);
+    TEST_ASSERT_FALSE(selfTestParseReport(buf, sizeof(buf) - 1, back));
+    buf[0] ^= 1;
+    TEST_ASSERT_FALSE(selfTestParseReport(buf, sizeof(buf), back));
+}
+
+TEST_CASE("Self-test meter counts loss, reordering and tail loss", "[wifi_chn]")
+{
+    CSelfTestMeter meter;
+    // Sender clock is 5 s ahead: only the transit difference matters.
+    uint32_t sent = 0;
+    for (uint32_t seq = 0; seq < 100; seq++, sent++)
+    {
+        if ((seq == 10) || (seq == 11) || (seq == 21))
+            continue;
+        auto d = datagram(seq, 5000000 + seq * 1000);
+        TEST_ASSERT_TRUE(meter.onDatagram(d.data(), d.size(), seq * 1000 + 300));
+        if (seq == 22)
+        {
+            auto late = datagram(21, 5000000 + 21 * 1000);
+            meter.onDatagram(late.data(), late.size(), 22 * 1000 + 300);
+        }
+    }
+    uint8_t shorter[4] = {};
+    TEST_ASSERT_FALSE(meter.onDatagram(shorter, sizeof(shorter), 100000));
+
+    SSelfTestReport r = meter.report();
+    TEST_ASSERT_EQUAL(98, r.packets);
+    TEST_ASSERT_EQUAL(2, r.lost);
+    TEST_ASSERT_EQUAL(1, r.reordered);
+    TEST_ASSERT_EQUAL(98 * 100, (uint32_t)r.bytes);
+    TEST_ASSERT_EQUAL(99 * 1000, r.elapsedUs);
+    // Five more were sent but never arrived: only the sender's count shows them.
+    TEST_ASSERT_EQUAL(7, meter.report(sent + 5).lost);
+}
+
+TEST_CASE("Self-test meter jitter follows RFC 3550", "[wifi_chn]")
+{
+    CSelfTestMeter meter;
+    // Transit alternates between 2000 and 2400 us: |D| = 400 on every packet.
+    for (uint32_t seq = 0; seq < 300; seq++)
+    {
+        auto d = datagram(seq, 0xfffff000u + seq * 500); // sender clock wraps
+        meter.onDatagram(d.data(), d.size(), 0xfffff000u + seq * 500 + 2000 + (seq & 1) * 400);
+    }
+    SSelfTestReport r = meter.report(300);
+    ESP_LOGI(TAG, "jitter %u us", (unsigned)r.jitterUs);
+    TEST_ASSERT_UINT32_WITHIN(8, 400, r.jitterUs);
+    TEST_ASSERT_EQUAL(0, r.lost);
+
+    CSelfTestMeter tcp;
+    tcp.onBytes(1460, 1000);
+    tcp.onBytes(1460, 2001000);
+    r = tcp.report();
+    TEST_ASSERT_EQUAL(2920, (uint32_t)r.bytes);
+    TEST_ASSERT_EQUAL(2000000, r.elapsedUs);
+}
+
+TEST_CASE("Self-test pacer keeps the rate and bounds catch-up", "[wifi_chn]")
+{
+    // 1500 bytes at 12 Mbit/s: one datagram per millisecond.
+    CSelfTestPacer pacer(12000, 1500, 5000);
+    uint32_t sent = 0;
+    uint32_t now = 1000;
+    // Task wakes every 2 ms and sends everything due.
+    for (; now < 1000 + 1000000; now += 2000)
+    {
+        while (pacer.wait(now) == 0)
+        {
+            pacer.sent();
+            sent++;
+        }
+    }
+    TEST_ASSERT_UINT32_WITHIN(2, 1000, sent);
+
+    // After a 100 ms stall only the slack (5 datagrams) is sent back to back.
+    now += 100000;
+    uint32_t burst = 0;
+    while (pacer.wait(now) == 0)
+    {
+        pacer.sent();
+        burst++;
+    }
+    TEST_ASSERT_EQUAL(6, burst);
+    TEST_ASSERT_EQUAL(1000, pacer.wait(now));
+
+    CSelfTestPacer unlimited(0, 1500);
+    TEST_ASSERT_EQUAL(0, unlimited.wait(123));
+    unlimited.sent();
+    TEST_ASSERT_EQUAL(0, unlimited.wait(123));
+}
+
+#endif // CONFIG_WIFICHN_SELFTEST
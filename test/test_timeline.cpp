@@ -0,0 +1,153 @@
+/*!
+    \file
+    \brief Test for CTimeline: span recording, Chrome trace export, ring overflow,
+           runtime switch, concurrent writers against a reader, and record cost.
+           Runs without WiFi.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_TIMELINE
+
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "CTimeline.h"
+#include "CJsonType.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstring>
+
+static const char *TAG = "test_timeline";
+
+static json export_json()
+{
+    std::string text;
+    CTimeline::exportJson([&text](const char *data, size_t len)
+                          { text.append(data, len); });
+    return json::parse(text);
+}
+
+TEST_CASE("CTimeline exports spans as Chrome trace", "[wifi_chn]")
+{
+    CTimeline::clear();
+    {
+        TIMELINE_SCOPE("outer");
+        TIMELINE_BEGIN("inner");
+        TIMELINE_INSTANT("mark", 42);
+        TIMELINE_END("inner");
+    }
+    TIMELINE_ASYNC_BEGIN("assoc", 7);
+    TIMELINE_ASYNC_END("assoc", 7);
+    TEST_ASSERT_EQUAL(7, CTimeline::count());
+    TEST_ASSERT_EQUAL(0, CTimeline::lost());
+
+    json trace = export_json();
+    json &ev = trace["traceEvents"];
+    TEST_ASSERT_EQUAL(7, ev.size());
+    const char *names[] = {"outer", "inner", "mark", "inner", "outer", "assoc", "assoc"};
+    const char *phases = "BBiEEbe";
+    int depth = 0;
+    int64_t ts = 0;
+    for (size_t i = 0; i < ev.size(); i++)
+    {
+        TEST_ASSERT_TRUE(ev[i]["name"] == names[i]);
+        std::string ph = ev[i]["ph"];
+        TEST_ASSERT_EQUAL(phases[i], ph[0]);
+        TEST_ASSERT_TRUE(ev[i]["tid"] == ev[0]["tid"]);
+        TEST_ASSERT_GREATER_OR_EQUAL(ts, ev[i]["ts"].get<int64_t>());
+        ts = ev[i]["ts"];
+        depth += (ph == "B") ? 1 : ((ph == "E") ? -1 : 0);
+        TEST_ASSERT_GREATER_OR_EQUAL(0, depth);
+    }
+    TEST_ASSERT_EQUAL(0, depth);
+    TEST_ASSERT_EQUAL(42, ev[2]["args"]["v"].get<int>());
+    TEST_ASSERT_EQUAL(7, ev[5]["id"].get<int>());
+}
+
+TEST_CASE("CTimeline keeps the newest events on overflow", "[wifi_chn]")
+{
+    CTimeline::clear();
+    const int32_t total = CONFIG_WIFICHN_TIMELINE_SIZE + 10;
+    for (int32_t i = 0; i < total; i++)
+        TIMELINE_INSTANT("tick", i);
+    TEST_ASSERT_EQUAL(CONFIG_WIFICHN_TIMELINE_SIZE, CTimeline::count());
+    TEST_ASSERT_EQUAL(10, CTimeline::lost());
+
+    std::vector<STimelineEvent> ev(CONFIG_WIFICHN_TIMELINE_SIZE);
+    TEST_ASSERT_EQUAL(CONFIG_WIFICHN_TIMELINE_SIZE, CTimeline::snapshot(ev.data(), ev.size()));
+    for (size_t i = 0; i < ev.size(); i++)
+        TEST_ASSERT_EQUAL(10 + (int32_t)i, ev[i].arg);
+
+    CTimeline::enable(false);
+    TIMELINE_INSTANT("ignored", 0);
+    CTimeline::enable(true);
+    TEST_ASSERT_EQUAL(10, CTimeline::lost());
+}
+
+TEST_CASE("CTimeline writers on two threads while exporting", "[wifi_chn]")
+{
+    CTimeline::clear();
+    const int32_t count = 20000;
+    auto writer = [count](const char *name)
+    {
+        for (int32_t i = 0; i < count; i++)
+            TIMELINE_INSTANT(name, i);
+    };
+    std::thread a(writer, "a");
+    std::thread b(writer, "b");
+
+    // Every snapshot taken during writing holds whole events in order per writer.
+    std::vector<STimelineEvent> ev(CONFIG_WIFICHN_TIMELINE_SIZE);
+    uint32_t checked = 0;
+    for (int pass = 0; pass < 200; pass++)
+    {
+        size_t n = CTimeline::snapshot(ev.data(), ev.size());
+        int32_t last[2] = {-1, -1};
+        for (size_t i = 0; i < n; i++)
+        {
+            bool isA = (ev[i].name != nullptr) && (std::strcmp(ev[i].name, "a") == 0);
+            bool isB = (ev[i].name != nullptr) && (std::strcmp(ev[i].name, "b") == 0);
+            TEST_ASSERT_TRUE(isA || isB);
+            TEST_ASSERT_TRUE(ev[i].phase == ETimelinePhase::Instant);
+            TEST_ASSERT_GREATER_THAN(last[isB], ev[i].arg);
+            last[isB] = ev[i].arg;
+        }
+        checked += n;
+    }
+    a.join();
+    b.join();
+    TEST_ASSERT_EQUAL(2 * count, CTimeline::count() + CTimeline::lost());
+    TEST_ASSERT_GREATER_THAN(0, checked);
+    TEST_ASSERT_TRUE(export_json()["traceEvents"].size() == CONFIG_WIFICHN_TIMELINE_SIZE);
+}
+
+TEST_CASE("CTimeline record cost", "[wifi_chn]")
+{
+    const uint32_t count = 10000;
+    CTimeline::clear();
+    int64_t t0 = esp_timer_get_time();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        TIMELINE_BEGIN("span");
+        TIMELINE_END("span");
+    }
+    int64_t on = esp_timer_get_time() - t0;
+    CTimeline::enable(false);
+    t0 = esp_timer_get_time();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        TIMELINE_BEGIN("span");
+        TIMELINE_END("span");
+    }
+    int64_t off = esp_timer_get_time() - t0;
+    CTimeline::enable(true);
+    ESP_LOGI(TAG, "record: %u ns enabled, %u ns disabled",
+             (unsigned)(on * 1000 / (2 * count)), (unsigned)(off * 1000 / (2 * count)));
+    TEST_ASSERT_EQUAL(2 * count - CONFIG_WIFICHN_TIMELINE_SIZE, CTimeline::lost());
+    TEST_ASSERT_LESS_OR_EQUAL(on, off);
+}
+
+#endif // CONFIG_WIFICHN_TIMELINE
@@ -0,0 +1,180 @@
+/*!
+    \file
+    \brief Test for CTrafficScheduler: direct sends, strict priority between class
+           queues, holdoff of lower classes, queue limits and per-class queue delay
+           under a saturating background load. Runs without WiFi against a model
+           link that accepts one packet per airtime slot.
+*/
+
+#include "sdkconfig.h"
+
+#if CONFIG_WIFICHN_QOS
+
+#include "freertos/FreeRTOS.h"
+#include "unity.h"
+#include "esp_log.h"
+#include "CTrafficScheduler.h"
+#include <vector>
+
+static const char *TAG = "test_qos";
+
+/// Link model: a packet occupies the radio for `slot` us, meanwhile the stack is busy.
+struct CModelLink
+{
+    uint32_t now = 0;
+    uint32_t freeAt = 0;
+    uint32_t slot = 200;
+    std::vector<ETrafficClass> order;
+    std::vector<const uint8_t *> data;
+
+    bool send(ETrafficClass cls, const uint8_t *buf)
+    {
+        if ((int32_t)(now - freeAt) < 0)
+            return false;
+        freeAt = now + slot;
+        order.push_back(cls);
+        data.push_back(buf);
+        return true;
+    }
+};
+
+#define TEST_HOLDOFF (5000)
+
+static CTrafficScheduler make_scheduler(CModelLink &link, uint16_t depth = 16)
+{
+    return CTrafficScheduler([&link](ETrafficClass cls, void *ctx, uint32_t ip, uint16_t port, const uint8_t *data, size_t len)
+                             { return link.send(cls, data); }, depth, 256, TEST_HOLDOFF);
+}
+
+TEST_CASE("CTrafficScheduler sends directly while the link is idle", "[wifi_chn]")
+{
+    CModelLink link;
+    CTrafficScheduler qos = make_scheduler(link);
+    TEST_ASSERT_TRUE(qos.isValid());
+    uint8_t pkt[64] = {};
+    TEST_ASSERT_TRUE(qos.send(ETrafficClass::BestEffort, nullptr, 1, 1, pkt, sizeof(pkt), 0));
+    TEST_ASSERT_EQUAL(1, link.order.size());
+    TEST_ASSERT_EQUAL_PTR(pkt, link.data[0]); // no copy on the direct path
+    STrafficStats st = qos.stats(ETrafficClass::BestEffort);
+    TEST_ASSERT_EQUAL(1, st.sent);
+    TEST_ASSERT_EQUAL(1, st.direct);
+    TEST_ASSERT_EQUAL(0, st.queued);
+    TEST_ASSERT_EQUAL(0, st.delayMax);
+    TEST_ASSERT_EQUAL(0x88, trafficTos(ETrafficClass::Video));
+    TEST_ASSERT_EQUAL(0xc0, trafficTos(ETrafficClass::Voice));
+}
+
+TEST_CASE("CTrafficScheduler drains queues in strict priority", "[wifi_chn]")
+{
+    CModelLink link;
+    link.freeAt = 1000; // link busy until t = 1000
+    CTrafficScheduler qos = make_scheduler(link);
+    uint8_t pkt[32] = {};
+    for (int i = 0; i < 5; i++)
+        TEST_ASSERT_TRUE(qos.send(ETrafficClass::Background, nullptr, 1, 1, pkt, sizeof(pkt), 0));
+    for (int i = 0; i < 2; i++)
+        TEST_ASSERT_TRUE(qos.send(ETrafficClass::Video, nullptr, 1, 1, pkt, sizeof(pkt), 100));
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT_TRUE(qos.send(ETrafficClass::Voice, nullptr, 1, 1, pkt, sizeof(pkt), 200));
+    TEST_ASSERT_EQUAL(10, qos.backlog());
+    TEST_ASSERT_TRUE(link.order.empty());
+
+    // One packet per slot; the holdoff after real-time classes is waited out before background.
+    for (link.now = 1000; qos.backlog() != 0; link.now += link.slot)
+        qos.pump(link.now);
+    const ETrafficClass expect[] = {ETrafficClass::Voice, ETrafficClass::Voice, ETrafficClass::Voice,
+                                    ETrafficClass::Video, ETrafficClass::Video,
+                                    ETrafficClass::Background, ETrafficClass::Background, ETrafficClass::Background,
+                                    ETrafficClass::Background, ETrafficClass::Background};
+    TEST_ASSERT_EQUAL(10, link.order.size());
+    for (int i = 0; i < 10; i++)
+        TEST_ASSERT_EQUAL((int)expect[i], (int)link.order[i]);
+
+    STrafficStats voice = qos.stats(ETrafficClass::Voice);
+    TEST_ASSERT_EQUAL(3, voice.queued);
+    TEST_ASSERT_EQUAL(3, voice.depthMax);
+    TEST_ASSERT_EQUAL(1000, voice.delayAvg); // queued at 200, sent at 1000, 1200, 1400
+    TEST_ASSERT_EQUAL(1200, voice.delayMax);
+    STrafficStats bk = qos.stats(ETrafficClass::Background);
+    TEST_ASSERT_EQUAL(5, bk.sent);
+    TEST_ASSERT_EQUAL(0, bk.depth);
+    // Video follows voice at once; background starts after the holdoff of the last voice send (t = 200).
+    TEST_ASSERT_EQUAL(1700, qos.stats(ETrafficClass::Video).delayMax);
+    TEST_ASSERT_EQUAL(200 + TEST_HOLDOFF + 4 * link.slot, bk.delayMax);
+}
+
+TEST_CASE("CTrafficScheduler holds lower classes off after real-time traffic", "[wifi_chn]")
+{
+    CModelLink link;
+    link.slot = 0;
+    CTrafficScheduler qos = make_scheduler(link);
+    uint8_t pkt[16] = {};
+    TEST_ASSERT_FALSE(qos.busy(ETrafficClass::Background, 0));
+    TEST_ASSERT_TRUE(qos.send(ETrafficClass::Voice, nullptr, 1, 1, pkt, sizeof(pkt), 10000));
+    TEST_ASSERT_TRUE(qos.busy(ETrafficClass::Background, 11000));
+    TEST_ASSERT_FALSE(qos.busy(ETrafficClass::Voice, 11000));
+    // Link is idle, but the background packet waits for the holdoff.
+    TEST_ASSERT_TRUE(qos.send(ETrafficClass::Background, nullptr, 1, 1, pkt, sizeof(pkt), 11000));
+    TEST_ASSERT_EQUAL(1, link.order.size());
+    TEST_ASSERT_EQUAL(0, qos.pump(14000));
+    TEST_ASSERT_EQUAL(1, qos.pump(10000 + TEST_HOLDOFF));
+    TEST_ASSERT_FALSE(qos.busy(ETrafficClass::Background, 10000 + TEST_HOLDOFF));
+    TEST_ASSERT_EQUAL(TEST_HOLDOFF - 1000, qos.stats(ETrafficClass::Background).delayMax);
+}
+
+TEST_CASE("CTrafficScheduler limits queues and cancels a closed channel", "[wifi_chn]")
+{
+    CModelLink link;
+    link.freeAt = 1000000;
+    CTrafficScheduler qos = make_scheduler(link, 4);
+    uint8_t pkt[300] = {};
+    int a = 0, b = 0;
+    TEST_ASSERT_FALSE(qos.send(ETrafficClass::BestEffort, &a, 1, 1, pkt, sizeof(pkt), 0)); // larger than a block
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_TRUE(qos.send(ETrafficClass::BestEffort, (i & 1) ? (void *)&a : (void *)&b, 1, 1, pkt, 64, 0));
+    TEST_ASSERT_FALSE(qos.send(ETrafficClass::BestEffort, &a, 1, 1, pkt, 64, 0));
+    TEST_ASSERT_TRUE(qos.send(ETrafficClass::Voice, &a, 1, 1, pkt, 64, 0)); // own queue per class
+    TEST_ASSERT_EQUAL(2, qos.stats(ETrafficClass::BestEffort).dropped);
+
+    qos.cancel(&a);
+    TEST_ASSERT_EQUAL(2, qos.backlog());
+    TEST_ASSERT_EQUAL(4, qos.stats(ETrafficClass::BestEffort).dropped);
+    TEST_ASSERT_EQUAL(1, qos.stats(ETrafficClass::Voice).dropped);
+    link.now = link.freeAt;
+    link.slot = 0;
+    TEST_ASSERT_EQUAL(2, qos.pump(link.now));
+    TEST_ASSERT_EQUAL(0, qos.backlog());
+}
+
+TEST_CASE("CTrafficScheduler keeps control latency under a bulk transfer", "[wifi_chn]")
+{
+    CModelLink link; // 200 us per packet: about 1472 bytes at 60 Mbit/s
+    CTrafficScheduler qos = make_scheduler(link, 32);
+    uint8_t pkt[256] = {};
+    // Bulk offers a packet every 150 us (over capacity), control sends a packet every 20 ms.
+    const uint32_t duration = 2000000;
+    for (uint32_t t = 0; t < duration; t += 50)
+    {
+        link.now = t;
+        qos.pump(t);
+        if (t % 150 == 0)
+            qos.send(ETrafficClass::Background, nullptr, 1, 1, pkt, sizeof(pkt), t);
+        if (t % 20000 == 0)
+            qos.send(ETrafficClass::Voice, nullptr, 1, 1, pkt, 32, t);
+    }
+    STrafficStats voice = qos.stats(ETrafficClass::Voice);
+    STrafficStats bk = qos.stats(ETrafficClass::Background);
+    ESP_LOGI(TAG, "voice: sent %u, delay avg %u max %u us; background: sent %u, dropped %u, delay avg %u max %u us",
+             (unsigned)voice.sent, (unsigned)voice.delayAvg, (unsigned)voice.delayMax,
+             (unsigned)bk.sent, (unsigned)bk.dropped, (unsigned)bk.delayAvg, (unsigned)bk.delayMax);
+    TEST_ASSERT_EQUAL(duration / 20000, voice.sent);
+    TEST_ASSERT_EQUAL(0, voice.dropped);
+    // A control packet waits at most for the packet already on the air.
+    TEST_ASSERT_LESS_OR_EQUAL(link.slot, voice.delayMax);
+    TEST_ASSERT_GREATER_THAN(0, bk.dropped);
+    TEST_ASSERT_GREATER_THAN(10 * voice.delayMax, bk.delayAvg);
+    // Bulk still gets most of the airtime between control packets.
+    TEST_ASSERT_GREATER_THAN(duration / link.slot * 2 / 3, bk.sent);
+}
+
+#endif // CONFIG_WIFICHN_QOS
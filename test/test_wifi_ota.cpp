@@ -48,19 +48,19 @@ static void onEvent(uint16_t id, const char *message)
 
 static void handleOtaProgress(uint16_t progress, int16_t status)
 {
-    if (status == 10)
+    if (status == OTA_STATUS_SYNC_TIME)
         ESP_LOGW(TAG, "OTA: sync time");;
-    // status 2/3 = COTATask connected to the server and is writing the image (see COTATask::event_ota_handler).
-    if (status == 2 || status == 3)
+    // COTATask connected to the server and is writing the image (see COTATask::event_ota_handler).
+    if (status == OTA_STATUS_CONNECTED || status == OTA_STATUS_WRITE)
         s_reached_server = true;
-    // status==3: progress is the image write percentage (see COTATask::event_ota_handler, ESP_HTTPS_OTA_WRITE_FLASH).
-    if (status == 3 && (int16_t)progress != s_last_progress_pct)
+    // OTA_STATUS_WRITE: progress is the image write percentage (see COTATask::event_ota_handler, ESP_HTTPS_OTA_WRITE_FLASH).
+    if (status == OTA_STATUS_WRITE && (int16_t)progress != s_last_progress_pct)
     {
         s_last_progress_pct = (int16_t)progress;
         ESP_LOGI(TAG, "OTA: %d%%", progress);
     }
     // The final call from COTATask::run() always uses progress==100.
-    if ((status == 4) || (status == -1))
+    if ((status == OTA_STATUS_FINISH) || (status == OTA_STATUS_ABORT))
         s_final_status = status;
 }
 
@@ -117,7 +117,7 @@ TEST_CASE("WiFiStation wifi_ota connect", "[wifi_chn]")
     {
         TEST_FAIL_MESSAGE("COTATask did not finish OTA within the allotted time");
     }
-    else if (s_final_status != 4)
+    else if (s_final_status != OTA_STATUS_FINISH)
     {
         char msg[96];
         snprintf(msg, sizeof(msg), "OTA finished with an error, status=%d (reached_server=%d)",
@@ -130,4 +130,55 @@ TEST_CASE("WiFiStation wifi_ota connect", "[wifi_chn]")
     vTaskDelay(pdMS_TO_TICKS(100));
 }
 
+/// Same scenario through the awaitable API: the test task blocks on its task
+/// notification until connect/OTA complete instead of polling every 100 ms.
+TEST_CASE("WiFiStation wifi_ota connect async", "[wifi_chn]")
+{
+    esp_err_t nvs_err = nvs_flash_init();
+    if (nvs_err == ESP_ERR_NVS_NO_FREE_PAGES || nvs_err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        nvs_err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(nvs_err);
+
+    CWiFiFuture connect = WiFiStation::Instance()->connectAsync(pdMS_TO_TICKS(30000), TEST_SSID, TEST_PASSWORD);
+    TEST_ASSERT_TRUE(connect.wait());
+    TEST_ASSERT_TRUE_MESSAGE(connect.result() == ESP_OK, "failed to connect to Redmi_9430 within 30s - check that the access point is on and in range");
+
+    CWiFiFuture ota = WiFiStation::Instance()->otaAsync(TEST_OTA_URL);
+    TEST_ASSERT_TRUE_MESSAGE(ota.wait(pdMS_TO_TICKS(1800000)), "COTATask did not finish OTA within the allotted time");
+    if (ota.result() != 0)
+    {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "OTA finished with an error, res=%d", (int)ota.result());
+        TEST_FAIL_MESSAGE(msg);
+    }
+
+    // Progress records of the whole download collapse into one, so the unread LinkUp
+    // from the connect is still in the stream next to the final OTA status.
+    SWiFiEventRecord recs[CONFIG_WIFICHN_EVENT_STREAM_SIZE];
+    bool link_up = false;
+    bool ota_done = false;
+    size_t progress = 0;
+    size_t n;
+    while ((n = WiFiStation::Instance()->events().read(recs, CONFIG_WIFICHN_EVENT_STREAM_SIZE)) > 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            link_up |= (recs[i].type == (uint8_t)EWiFiEvent::LinkUp);
+            ota_done |= (recs[i].type == (uint8_t)EWiFiEvent::OtaStatus) && (recs[i].code == OTA_STATUS_OK);
+            progress += (recs[i].type == (uint8_t)EWiFiEvent::OtaProgress);
+        }
+    }
+    TEST_ASSERT_TRUE(link_up);
+    TEST_ASSERT_TRUE(ota_done);
+    TEST_ASSERT_EQUAL(1, progress);
+    TEST_ASSERT_EQUAL(0, WiFiStation::Instance()->events().dropped());
+
+    WiFiStation::Instance()->stopOta();
+    WiFiStation::free();
+    vTaskDelay(pdMS_TO_TICKS(100));
+}
+
 #endif // CONFIG_WIFICHN_OTA
@@ -0,0 +1,360 @@
+#!/usr/bin/env python3
+"""Групповая рассылка CMulticastChannel (CONFIG_WIFICHN_MCAST) с компьютера.
+
+    mcast_fleet.py send --group 239.1.2.3 --port 5007 (--file config.json | --text reboot)
+    mcast_fleet.py recv --group 239.1.2.3 --port 5007
+    mcast_fleet.py loopback [--receivers 8] [--loss 10] [--size 16384]
+
+send - разослать сообщение устройствам и обслуживать их NACK, пока идут
+запросы; recv - принимать рассылку устройства. loopback - проверка протокола
+без устройств: отправитель и N процессов-получателей на 127.0.0.1 с
+IP_MULTICAST_LOOP и искусственными потерями; каждый получатель должен собрать
+все сообщения. Формат пакета - см. CMulticastChannel.cpp.
+"""
+
+import argparse
+import hashlib
+import os
+import random
+import select
+import socket
+import struct
+import subprocess
+import sys
+import time
+
+DATA, NACK, HEARTBEAT = 1, 2, 3
+HEADER = struct.Struct("<BBHIHHHHI")  # type, flags, index, session, seq, id, count, oldest, len/map
+
+NACK_DELAY_MS = 20
+NACK_INTERVAL_MS = 60
+NACK_RETRIES = 5
+REPAIR_HOLDOFF_MS = 20
+HEARTBEAT_MS = 30
+HEARTBEATS = 3
+IDLE_BEACON_MS = 2000
+
+
+def now_ms():
+    return int(time.monotonic() * 1000)
+
+
+def s16(v):
+    """Разность номеров по модулю 65536 со знаком."""
+    v &= 0xFFFF
+    return v - 0x10000 if v & 0x8000 else v
+
+
+class Sender:
+    def __init__(self, transmit, chunk, history):
+        self.transmit = transmit
+        self.chunk = chunk
+        self.history = history
+        self.session = random.getrandbits(32) | 1
+        self.next = 0
+        self.msg_id = 0
+        self.chunks = 0
+        self.store = {}  # seq -> [packet, repaired_at]
+        self.beacons = 0
+        self.beacon_at = 0
+        self.last_tx = None
+        self.repairs = 0
+        self.nacks = 0
+
+    def oldest(self):
+        return (self.next - min(self.chunks, self.history)) & 0xFFFF
+
+    def send(self, data):
+        count = max(1, (len(data) + self.chunk - 1) // self.chunk)
+        if count > self.history:
+            raise ValueError("сообщение больше истории повторов")
+        msg_id = self.msg_id
+        self.msg_id = (self.msg_id + 1) & 0xFFFF
+        for i in range(count):
+            seq = self.next
+            self.next = (self.next + 1) & 0xFFFF
+            self.chunks += 1
+            part = data[i * self.chunk:(i + 1) * self.chunk]
+            head = HEADER.pack(DATA, 0, i, self.session, seq, msg_id, count, self.oldest(), len(data))
+            self.store[seq] = [bytearray(head + part), None]
+            self.store.pop((seq - self.history) & 0xFFFF, None)
+            self.transmit(bytes(self.store[seq][0]))
+        self.last_tx = now_ms()
+        self.beacons = HEARTBEATS
+        self.beacon_at = now_ms() + HEARTBEAT_MS
+        return msg_id
+
+    def beacon(self):
+        self.transmit(HEADER.pack(HEARTBEAT, 0, 0, self.session, self.next, 0, 0, self.oldest(), 0))
+        self.last_tx = now_ms()
+
+    def on_nack(self, base, bitmap):
+        self.nacks += 1
+        t = now_ms()
+        expired = False
+        for i in range(-1, 32):
+            if i >= 0 and not bitmap & (1 << i):
+                continue
+            seq = (base + 1 + i) & 0xFFFF
+            if s16(seq - self.next) >= 0:
+                break
+            if s16(seq - self.oldest()) < 0:
+                expired = True
+                continue
+            entry = self.store[seq]
+            if entry[1] is not None and t - entry[1] < REPAIR_HOLDOFF_MS:
+                continue
+            struct.pack_into("<H", entry[0], 14, self.oldest())
+            self.transmit(bytes(entry[0]))
+            self.last_tx = t
+            entry[1] = t
+            self.repairs += 1
+        if expired:
+            self.beacon()
+
+    def input(self, pkt):
+        if len(pkt) < HEADER.size:
+            return
+        kind, _, _, session, seq, _, _, _, bitmap = HEADER.unpack_from(pkt)
+        if kind == NACK and session == self.session:
+            self.on_nack(seq, bitmap)
+
+    def poll(self):
+        if self.beacons:
+            if now_ms() >= self.beacon_at:
+                self.beacon()
+                self.beacons -= 1
+                self.beacon_at = now_ms() + (HEARTBEAT_MS << (HEARTBEATS - self.beacons))
+        elif self.last_tx is None or now_ms() - self.last_tx >= IDLE_BEACON_MS:
+            self.beacon()
+
+
+class Receiver:
+    def __init__(self, reply, deliver, chunk):
+        self.reply = reply
+        self.deliver = deliver
+        self.chunk = chunk
+        self.session = None
+        self.next = 0
+        self.end = 0
+        self.received = set()
+        self.nack_at = None
+        self.nack_tries = 0
+        self.reasm = {}  # id -> [count, len, {index: bytes}]
+        self.lost = 0
+        self.nacks = 0
+
+    def step(self):
+        self.next = (self.next + 1) & 0xFFFF
+        while self.next in self.received:
+            self.received.discard(self.next)
+            self.next = (self.next + 1) & 0xFFFF
+        self.nack_tries = 0
+        if s16(self.next - self.end) > 0:
+            self.end = self.next
+
+    def input(self, pkt):
+        if len(pkt) < HEADER.size:
+            return
+        kind, _, index, session, seq, msg_id, count, oldest, total = HEADER.unpack_from(pkt)
+        if kind not in (DATA, HEARTBEAT):
+            return
+        if session != self.session:
+            self.session = session
+            self.next = self.end = (seq - index) & 0xFFFF if kind == DATA else seq
+            self.received.clear()
+            self.reasm.clear()
+            self.nack_at = None
+            self.nack_tries = 0
+        while s16(oldest - self.next) > 0:
+            self.lost += 1
+            self.step()
+        if kind == HEARTBEAT:
+            if s16(seq - self.end) > 0:
+                self.end = seq
+            return
+        if s16(seq - self.next) < 0 or seq in self.received:
+            return
+        while s16(seq - self.next) > 32:
+            self.lost += 1
+            self.step()
+        if seq == self.next:
+            self.step()
+        else:
+            self.received.add(seq)
+        if s16(seq + 1 - self.end) > 0:
+            self.end = (seq + 1) & 0xFFFF
+        part = pkt[HEADER.size:]
+        if count == 1:
+            self.deliver(msg_id, part)
+            return
+        slot = self.reasm.setdefault(msg_id, [count, total, {}])
+        slot[2][index] = part
+        if len(slot[2]) == slot[0]:
+            del self.reasm[msg_id]
+            self.deliver(msg_id, b"".join(slot[2][i] for i in range(slot[0])))
+
+    def poll(self):
+        if self.session is None or s16(self.end - self.next) <= 0:
+            self.nack_at = None
+            return
+        t = now_ms()
+        if self.nack_at is None:
+            self.nack_at = t + random.randint(0, NACK_DELAY_MS)
+        while self.nack_at is not None and t >= self.nack_at:
+            if self.nack_tries < NACK_RETRIES:
+                bitmap = 0
+                for i in range(min(32, s16(self.end - self.next) - 1)):
+                    if ((self.next + 1 + i) & 0xFFFF) not in self.received:
+                        bitmap |= 1 << i
+                self.reply(HEADER.pack(NACK, 0, 0, self.session, self.next, 0, 0, 0, bitmap))
+                self.nacks += 1
+                self.nack_tries += 1
+                self.nack_at = t + NACK_INTERVAL_MS + random.randint(0, NACK_DELAY_MS)
+                break
+            self.lost += 1
+            self.step()
+            if s16(self.end - self.next) <= 0:
+                self.nack_at = None
+
+
+def group_socket(group, port, iface):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if hasattr(socket, "SO_REUSEPORT"):
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+    sock.bind(("", port))
+    mreq = socket.inet_aton(group) + socket.inet_aton(iface)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    return sock
+
+
+def sender_socket(iface, loop):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(iface))
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1 if loop else 0)
+    sock.bind((iface if loop else "", 0))
+    return sock
+
+
+def lossy(func, loss):
+    def wrapped(*args):
+        if random.random() * 100 >= loss:
+            func(*args)
+    return wrapped
+
+
+def run_sender(args, messages, idle_ms):
+    """Разослать сообщения и отвечать на NACK, пока они идут."""
+    sock = sender_socket(args.iface, args.loop)
+    dest = (args.group, args.port)
+    sender = Sender(lossy(lambda p: sock.sendto(p, dest), args.loss), args.chunk, args.history)
+    # Маяки до рассылки: получатели узнают сеанс и запросят даже потерянный первый пакет.
+    for _ in range(10):
+        sender.beacon()
+        time.sleep(HEARTBEAT_MS / 1000)
+    last = now_ms()
+    for data in messages:
+        sender.send(data)
+    while now_ms() - last < idle_ms:
+        ready, _, _ = select.select([sock], [], [], 0.005)
+        if ready:
+            pkt, _ = sock.recvfrom(65536)
+            sender.input(pkt)
+            last = now_ms()
+        sender.poll()
+        if sender.beacons:
+            last = now_ms()
+    return sender
+
+
+def run_receiver(args, expect, deliver):
+    sock = group_socket(args.group, args.port, args.iface)
+    source = [None]
+    got = []
+
+    def on_message(msg_id, data):
+        got.append(msg_id)
+        deliver(msg_id, data)
+
+    receiver = Receiver(lambda p: source[0] and sock.sendto(p, source[0]), on_message, args.chunk)
+    receive = lossy(receiver.input, args.loss)
+    deadline = time.monotonic() + args.timeout if expect else float("inf")
+    while (expect == 0 or len(got) < expect) and time.monotonic() < deadline:
+        ready, _, _ = select.select([sock], [], [], 0.005)
+        if ready:
+            pkt, source[0] = sock.recvfrom(65536)
+            receive(pkt)
+        receiver.poll()
+    return receiver, got
+
+
+def cmd_send(args):
+    data = open(args.file, "rb").read() if args.file else args.text.encode()
+    sender = run_sender(args, [data], 2000)
+    print(f"sent {len(data)} bytes, {sender.chunks} chunks, {sender.repairs} repairs for {sender.nacks} NACKs")
+
+
+def cmd_recv(args):
+    def show(msg_id, data):
+        print(f"#{msg_id}: {len(data)} bytes sha256 {hashlib.sha256(data).hexdigest()[:16]}", flush=True)
+
+    run_receiver(args, args.count, show)
+
+
+def cmd_loopback(args):
+    sizes = [40, args.size, 0, 3 * args.chunk + 7, 200, args.chunk, args.size // 3]
+    messages = [os.urandom(n) for n in sizes]
+    expected = sorted(hashlib.sha256(m).hexdigest() for m in messages)
+    common = ["--group", args.group, "--port", str(args.port), "--iface", args.iface, "--chunk", str(args.chunk),
+              "--loss", str(args.loss), "--timeout", str(args.timeout)]
+    procs = [subprocess.Popen([sys.executable, __file__, "recv", "--count", str(len(messages))] + common,
+                              stdout=subprocess.PIPE, text=True) for _ in range(args.receivers)]
+    time.sleep(0.5)  # получатели должны войти в группу до первого пакета
+    args.loop = True
+    sender = run_sender(args, messages, 1500)
+    failed = 0
+    for i, proc in enumerate(procs):
+        out, _ = proc.communicate(timeout=args.timeout + 5)
+        hashes = sorted(line.split()[-1] for line in out.splitlines() if line.startswith("#"))
+        ok = [h[:16] for h in expected] == hashes
+        failed += not ok
+        print(f"receiver {i}: {len(hashes)}/{len(messages)} messages{'' if ok else ' FAILED'}")
+    print(f"{len(messages)} messages, {sender.chunks} chunks, {sender.repairs} repairs, {sender.nacks} NACKs, "
+          f"loss {args.loss}% each way")
+    return 1 if failed else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    send = sub.add_parser("send")
+    source = send.add_mutually_exclusive_group(required=True)
+    source.add_argument("--file")
+    source.add_argument("--text")
+    recv = sub.add_parser("recv")
+    recv.add_argument("--count", type=int, default=0, help="выйти после N сообщений (0 - не выходить)")
+    loop = sub.add_parser("loopback")
+    loop.add_argument("--receivers", type=int, default=8)
+    loop.add_argument("--size", type=int, default=16384, help="наибольшее сообщение (CONFIG_WIFICHN_MCAST_MAX_MSG)")
+    for p in (send, recv, loop):
+        p.add_argument("--group", default="239.1.2.3")
+        p.add_argument("--port", type=int, default=5007)
+        p.add_argument("--iface", default="127.0.0.1" if p is loop else "0.0.0.0", help="адрес интерфейса")
+        p.add_argument("--chunk", type=int, default=1024, help="CONFIG_WIFICHN_MCAST_CHUNK")
+        p.add_argument("--history", type=int, default=32, help="CONFIG_WIFICHN_MCAST_HISTORY")
+        p.add_argument("--loss", type=float, default=10 if p is loop else 0, help="искусственные потери, %%")
+        p.add_argument("--timeout", type=float, default=20)
+    args = parser.parse_args()
+    args.loop = False
+    if args.cmd == "send":
+        cmd_send(args)
+    elif args.cmd == "recv":
+        cmd_recv(args)
+    else:
+        sys.exit(cmd_loopback(args))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""Манифест образа OTA для COtaVerifier (CONFIG_WIFICHN_OTA_VERIFY).
+
+    ota_manifest.py firmware.bin [--chunk 65536] [--key private.pem]
+
+Пишет firmware.bin.manifest рядом с образом. С ключом (EC или RSA, пакет
+cryptography) добавляет подпись поля "sig"; открытый ключ передаётся в
+WiFiStation::setOtaKey().
+"""
+
+import argparse
+import hashlib
+import json
+import struct
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("image")
+    parser.add_argument("--chunk", type=int, default=65536)
+    parser.add_argument("--key", help="закрытый ключ PEM")
+    parser.add_argument("--out", help="файл манифеста (по умолчанию <image>.manifest)")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        data = f.read()
+    chunks = [hashlib.sha256(data[i:i + args.chunk]).digest() for i in range(0, len(data), args.chunk)]
+    image_hash = hashlib.sha256(data).digest()
+    manifest = {
+        "size": len(data),
+        "chunk": args.chunk,
+        "sha256": image_hash.hex(),
+        "chunks": [h.hex() for h in chunks],
+    }
+
+    if args.key:
+        from cryptography.hazmat.primitives import hashes, serialization
+        from cryptography.hazmat.primitives.asymmetric import ec, padding, rsa
+
+        # Подписывается двоичное представление (см. COtaVerifier.h), а не текст JSON.
+        signed = struct.pack("<II", len(data), args.chunk) + image_hash + b"".join(chunks)
+        with open(args.key, "rb") as f:
+            key = serialization.load_pem_private_key(f.read(), password=None)
+        if isinstance(key, ec.EllipticCurvePrivateKey):
+            sig = key.sign(signed, ec.ECDSA(hashes.SHA256()))
+        elif isinstance(key, rsa.RSAPrivateKey):
+            sig = key.sign(signed, padding.PKCS1v15(), hashes.SHA256())
+        else:
+            parser.error("поддерживаются ключи EC и RSA")
+        manifest["sig"] = sig.hex()
+
+    out = args.out or args.image + ".manifest"
+    with open(out, "w") as f:
+        json.dump(manifest, f, separators=(",", ":"))
+    print(f"{out}: {len(data)} bytes, {len(chunks)} chunks{', signed' if args.key else ''}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,359 @@
+#!/usr/bin/env python3
+"""Сервер самопроверки канала (CONFIG_WIFICHN_SELFTEST, WiFiStation::startSelfTest()).
+
+    selftest_server.py serve [--port 5211] [--bind 0.0.0.0]
+    selftest_server.py client --host 192.168.1.10 --mode udp-recv [--time 10] [--rate 20000] [--block 1460]
+    selftest_server.py loopback [--time 2]
+
+serve - ответная сторона для устройств: каждое TCP соединение - один тест
+(режим задаёт устройство в запросе), итог печатается одной строкой.
+client - сторона устройства на компьютере: опорный замер между двумя
+компьютерами в той же сети. loopback - проверка протокола без устройства:
+сервер на 127.0.0.1 и клиент на 127.0.0.2 (Linux), все четыре режима.
+Формат запроса, отчёта и датаграмм - см. include/CSelfTest.h.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+MAGIC = 0x54534357
+REQUEST = struct.Struct("<IBBHIIHH")  # magic, mode, flags, port, duration_ms, rate_kbps, block, reserved
+REPORT = struct.Struct("<IQIIIII")  # magic, bytes, elapsed_us, packets, lost, reordered, jitter_us
+HEADER = struct.Struct("<II")  # seq, ts_us
+TCP_SEND, TCP_RECV, UDP_SEND, UDP_RECV = 1, 2, 3, 4
+MODES = {"tcp-send": TCP_SEND, "tcp-recv": TCP_RECV, "udp-send": UDP_SEND, "udp-recv": UDP_RECV}
+NAMES = {v: k for k, v in MODES.items()}
+
+REPORT_TIMEOUT_S = 3.0
+IDLE_S = 0.3
+SLACK_US = 20000
+
+
+def now_us():
+    return time.monotonic_ns() // 1000
+
+
+def recv_exact(sock, size):
+    data = b""
+    while len(data) < size:
+        part = sock.recv(size - len(data))
+        if not part:
+            raise ConnectionError("соединение закрыто")
+        data += part
+    return data
+
+
+def pack_report(nbytes, elapsed_us, packets, lost=0, reordered=0, jitter_us=0):
+    return REPORT.pack(MAGIC, nbytes, elapsed_us & 0xFFFFFFFF, packets, lost, reordered, jitter_us)
+
+
+def parse_report(data):
+    magic, nbytes, elapsed_us, packets, lost, reordered, jitter_us = REPORT.unpack(data)
+    if magic != MAGIC:
+        raise ValueError("неверная метка отчёта")
+    return {"bytes": nbytes, "elapsed_us": elapsed_us, "packets": packets, "lost": lost,
+            "reordered": reordered, "jitter_us": jitter_us}
+
+
+class Meter:
+    """Замер получателя, как CSelfTestMeter."""
+
+    def __init__(self):
+        self.bytes = 0
+        self.first = None
+        self.last = None
+        self.packets = 0
+        self.next = 0
+        self.reordered = 0
+        self.transit = None
+        self.jitter = 0.0
+
+    def on_bytes(self, size, now):
+        if self.first is None:
+            self.first = now
+        self.last = now
+        self.bytes += size
+
+    def on_datagram(self, data, now):
+        if len(data) < HEADER.size:
+            return
+        seq, ts = HEADER.unpack_from(data)
+        transit = (now - ts) & 0xFFFFFFFF
+        if self.transit is not None:
+            d = (transit - self.transit) & 0xFFFFFFFF
+            d = d - 0x100000000 if d & 0x80000000 else d
+            self.jitter += (abs(d) - self.jitter) / 16  # RFC 3550
+        self.transit = transit
+        if self.packets == 0 or ((seq - self.next) & 0xFFFFFFFF) < 0x80000000:
+            self.next = (seq + 1) & 0xFFFFFFFF
+        else:
+            self.reordered += 1
+        self.packets += 1
+        self.on_bytes(len(data), now)
+
+    def report(self, sent=0):
+        expected = sent if sent else self.next
+        return {"bytes": self.bytes, "elapsed_us": (self.last - self.first) if self.first is not None else 0,
+                "packets": self.packets, "lost": max(0, expected - self.packets),
+                "reordered": self.reordered, "jitter_us": int(self.jitter)}
+
+
+class Pacer:
+    """Темп передачи датаграмм, как CSelfTestPacer."""
+
+    def __init__(self, rate_kbps, block):
+        self.interval = block * 8000 // rate_kbps if rate_kbps else 0
+        self.next = None
+
+    def wait(self, now):
+        if self.next is None:
+            self.next = now
+        ahead = self.next - now
+        if ahead > 0:
+            return ahead
+        if -ahead > SLACK_US:
+            self.next = now - SLACK_US
+        return 0
+
+    def sent(self):
+        self.next += self.interval
+
+
+def send_datagrams(sock, addr, duration_s, rate_kbps, block):
+    """Поток датаграмм заданной длительности; возвращает отчёт отправителя."""
+    payload = bytearray(i & 0xFF for i in range(block))
+    pacer = Pacer(rate_kbps, block)
+    seq = 0
+    start = now_us()
+    end = start + int(duration_s * 1e6)
+    while True:
+        now = now_us()
+        if now >= end:
+            break
+        wait = pacer.wait(now)
+        if wait:
+            time.sleep(wait / 1e6)
+            continue
+        HEADER.pack_into(payload, 0, seq, now & 0xFFFFFFFF)
+        try:
+            sock.sendto(payload, addr)
+        except (BlockingIOError, OSError):
+            time.sleep(0.001)  # буфер сокета полон: та же датаграмма повторяется
+            continue
+        seq = (seq + 1) & 0xFFFFFFFF
+        pacer.sent()
+    return {"bytes": seq * block, "elapsed_us": now_us() - start, "packets": seq}
+
+
+def kbps(report):
+    return report["bytes"] * 8000 // report["elapsed_us"] if report["elapsed_us"] else 0
+
+
+def summary(mode, report, sent=None):
+    text = "%s: %d kbit/s, %d bytes in %.3f s" % (NAMES.get(mode, mode), kbps(report), report["bytes"],
+                                                 report["elapsed_us"] / 1e6)
+    if mode in (UDP_SEND, UDP_RECV):
+        total = sent if sent is not None else report["packets"] + report["lost"]
+        text += ", lost %d/%d, reordered %d, jitter %d us" % (report["lost"], total, report["reordered"],
+                                                             report["jitter_us"])
+    return text
+
+
+class Server:
+    def __init__(self, bind, port, quiet=False):
+        self.quiet = quiet
+        self.tcp = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.tcp.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.tcp.bind((bind, port))
+        self.tcp.listen(4)
+        self.udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.udp.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 << 20)
+        self.udp.bind((bind, port))
+        self.meters = {}  # IP устройства -> Meter (тест udp-send)
+        self.lock = threading.Lock()
+        self.results = []
+
+    def log(self, text):
+        if not self.quiet:
+            print(text, flush=True)
+
+    def serve_forever(self):
+        threading.Thread(target=self.udp_loop, daemon=True).start()
+        while True:
+            conn, addr = self.tcp.accept()
+            threading.Thread(target=self.handle, args=(conn, addr), daemon=True).start()
+
+    def udp_loop(self):
+        while True:
+            data, addr = self.udp.recvfrom(65536)
+            now = now_us()
+            with self.lock:
+                # Датаграммы могут обогнать запрос по TCP: замер заводится по первой из них.
+                self.meters.setdefault(addr[0], Meter()).on_datagram(data, now)
+
+    def handle(self, conn, addr):
+        with self.lock:
+            meter = self.meters.setdefault(addr[0], Meter())
+        try:
+            with conn:
+                magic, mode, _, port, duration_ms, rate_kbps, block, _ = REQUEST.unpack(recv_exact(conn, REQUEST.size))
+                if magic != MAGIC or mode not in NAMES or block == 0:
+                    raise ValueError("неверный запрос")
+                result = self.run(conn, addr, meter, mode, port, duration_ms / 1000, rate_kbps, block)
+                self.results.append((mode, result))
+                self.log("%s %s" % (addr[0], summary(mode, *result)))
+        except (OSError, ValueError, struct.error) as e:
+            self.log("%s: %s" % (addr[0], e))
+        finally:
+            with self.lock:
+                self.meters.pop(addr[0], None)
+
+    def run(self, conn, addr, udp_meter, mode, port, duration_s, rate_kbps, block):
+        if mode == TCP_SEND:
+            # Устройство пишет до конца теста и закрывает запись; ответ - отчёт получателя.
+            meter = Meter()
+            while True:
+                data = conn.recv(65536)
+                if not data:
+                    break
+                meter.on_bytes(len(data), now_us())
+            report = meter.report()
+            conn.sendall(pack_report(report["bytes"], report["elapsed_us"], 0))
+            return (report,)
+        if mode == TCP_RECV:
+            payload = bytes(i & 0xFF for i in range(block))
+            start = now_us()
+            end = start + int(duration_s * 1e6)
+            total = 0
+            while now_us() < end:
+                conn.sendall(payload)
+                total += block
+            conn.shutdown(socket.SHUT_WR)
+            return ({"bytes": total, "elapsed_us": now_us() - start, "packets": 0, "lost": 0, "reordered": 0,
+                     "jitter_us": 0},)
+        if mode == UDP_SEND:
+            conn.settimeout(duration_s + 10)
+            sent = parse_report(recv_exact(conn, REPORT.size))
+            time.sleep(0.05)  # датаграммы, обогнанные отчётом по TCP
+            with self.lock:
+                report = udp_meter.report(sent["packets"])
+            conn.sendall(pack_report(report["bytes"], report["elapsed_us"], report["packets"], report["lost"],
+                                     report["reordered"], report["jitter_us"]))
+            return report, sent["packets"]
+        # UDP_RECV: датаграммы на порт устройства, затем отчёт отправителя.
+        sent = send_datagrams(self.udp, (addr[0], port), duration_s, rate_kbps, block)
+        conn.sendall(pack_report(sent["bytes"], sent["elapsed_us"], sent["packets"]))
+        return {"bytes": sent["bytes"], "elapsed_us": sent["elapsed_us"], "packets": sent["packets"], "lost": 0,
+                "reordered": 0, "jitter_us": 0}, sent["packets"]
+
+
+def client(host, port, mode, duration_s, rate_kbps, block, local="0.0.0.0"):
+    """Сторона устройства (как CSelfTestTask); возвращает (отчёт получателя, отправлено датаграмм)."""
+    udp = None
+    if mode in (UDP_SEND, UDP_RECV):
+        udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        udp.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 << 20)
+        udp.bind((local, port if mode == UDP_RECV else 0))
+    ctrl = socket.create_connection((host, port), timeout=10, source_address=(local, 0))
+    try:
+        ctrl.sendall(REQUEST.pack(MAGIC, mode, 0, port, int(duration_s * 1000), rate_kbps, block, 0))
+        if mode == TCP_SEND:
+            payload = bytes(i & 0xFF for i in range(block))
+            end = now_us() + int(duration_s * 1e6)
+            while now_us() < end:
+                ctrl.sendall(payload)
+            ctrl.shutdown(socket.SHUT_WR)
+            ctrl.settimeout(REPORT_TIMEOUT_S)
+            return parse_report(recv_exact(ctrl, REPORT.size)), None
+        if mode == TCP_RECV:
+            meter = Meter()
+            ctrl.settimeout(duration_s + REPORT_TIMEOUT_S)
+            while True:
+                data = ctrl.recv(65536)
+                if not data:
+                    break
+                meter.on_bytes(len(data), now_us())
+            return meter.report(), None
+        if mode == UDP_SEND:
+            sent = send_datagrams(udp, (host, port), duration_s, rate_kbps, block)
+            ctrl.sendall(pack_report(sent["bytes"], sent["elapsed_us"], sent["packets"]))
+            ctrl.settimeout(REPORT_TIMEOUT_S)
+            return parse_report(recv_exact(ctrl, REPORT.size)), sent["packets"]
+        meter = Meter()
+        udp.settimeout(0.02)
+        end = now_us() + int(duration_s * 1e6)
+        last = now_us()
+        while True:
+            now = now_us()
+            if now >= end and (now - last >= IDLE_S * 1e6 or now >= end + REPORT_TIMEOUT_S * 1e6):
+                break
+            try:
+                data, addr = udp.recvfrom(65536)
+            except socket.timeout:
+                continue
+            if addr[0] == host:
+                meter.on_datagram(data, now_us())
+                last = now_us()
+        ctrl.settimeout(REPORT_TIMEOUT_S)
+        sent = parse_report(recv_exact(ctrl, REPORT.size))
+        return meter.report(sent["packets"]), sent["packets"]
+    finally:
+        ctrl.close()
+        if udp is not None:
+            udp.close()
+
+
+def loopback(duration_s, port):
+    server = Server("127.0.0.1", port, quiet=True)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    ok = True
+    for name, mode in MODES.items():
+        report, sent = client("127.0.0.1", port, mode, duration_s, 50000, 1400, local="127.0.0.2")
+        time.sleep(0.1)
+        print("%-8s device: %s" % (name, summary(mode, report, sent)))
+        if report["bytes"] == 0:
+            ok = False
+        if mode == UDP_RECV and report["lost"] != 0:
+            ok = False
+        if mode in (UDP_SEND, UDP_RECV) and sent and abs(kbps(report) - 50000) > 5000:
+            ok = False
+    print("OK" if ok else "FAILED")
+    return 0 if ok else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    serve = sub.add_parser("serve")
+    serve.add_argument("--bind", default="0.0.0.0")
+    serve.add_argument("--port", type=int, default=5211)
+    cli = sub.add_parser("client")
+    cli.add_argument("--host", required=True)
+    cli.add_argument("--port", type=int, default=5211)
+    cli.add_argument("--mode", choices=MODES, default="tcp-send")
+    cli.add_argument("--time", type=float, default=10, help="длительность, с")
+    cli.add_argument("--rate", type=int, default=20000, help="скорость UDP, кбит/с (0 - без ограничения)")
+    cli.add_argument("--block", type=int, default=1460)
+    loop = sub.add_parser("loopback")
+    loop.add_argument("--time", type=float, default=2)
+    loop.add_argument("--port", type=int, default=5211)
+    args = parser.parse_args()
+
+    if args.cmd == "serve":
+        print("self-test server on %s:%d" % (args.bind, args.port), flush=True)
+        Server(args.bind, args.port).serve_forever()
+    elif args.cmd == "client":
+        mode = MODES[args.mode]
+        report, sent = client(args.host, args.port, mode, args.time, args.rate, args.block)
+        print(summary(mode, report, sent))
+    else:
+        return loopback(args.time, args.port)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())